@@ -11,20 +11,37 @@
  * ```
  * Hardware ADC → DMA Buffer → task_adc_acquisition → measure_add_sample()
  *                                                            ↓
- *                                              [Ventana completa cada 10 ciclos]
+ *                                   [Cruce por cero: ciclo completo (~20 ms)]
+ *                                   [10 ciclos enteros: ventana completa]
+ *                                                            ↓
+ *                                     notificación → task_measure_compute
+ *                                     (la adquisición sigue acumulando)
  *                                                            ↓
  *                                                 measure_get_results()
  *                                                            ↓
- *                                                  state_update_measure()
+ *                                  state_update_cycle() / state_update_measure()
  * ```
  * 
+ * ## Ventanas ping-pong
+ * 
+ * Hay ACQ_NUM_WINDOWS lugares para ventanas cerradas: al cerrarse una ventana
+ * se copia a un lugar libre y se notifica a task_measure_compute
+ * (ACQ_NOTIFY_WINDOW) mientras la adquisición continúa con la siguiente. Así el
+ * cálculo, la toma del mutex de estado y el guardado en NVS nunca demoran la
+ * lectura del DMA. Cada ciclo cerrado se entrega igual por un buzón de un
+ * lugar (ACQ_NOTIFY_CYCLE) para publicar resultados por ciclo (50/s).
+ * 
+ * Si al cerrar una ventana (o ciclo) no hay lugar libre, se descarta y se
+ * cuenta en acq_stats_t::windows_dropped (o cycles_dropped).
+ * 
  * ## Flujo de procesamiento
  * 
- * 1. **Espera bloqueante**: app_adc_dma_read() espera llenado de buffer DMA
+ * 1. **Espera bloqueante**: app_adc_dma_get_frame() espera el próximo frame DMA
  * 2. **Validación**: Verifica integridad de muestras (rango ADC, calibración)
  * 3. **Sincronización V-I**: Empareja muestras de tensión y corriente
  * 4. **Almacenamiento**: Llama measure_add_sample() por cada par válido
- * 5. **Publicación**: Al completar ventana, actualiza state con resultados
+ * 5. **Entrega**: Al completar ventana, la pasa a task_measure_compute
+ * 6. **Publicación**: task_measure_compute calcula y actualiza state con resultados
  * 
  * ## Características de tiempo real
  * 
@@ -55,30 +72,85 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "app/measure.h"
+#include "app/harmonics.h"
+#include "app/waveform.h"
+#include "app/adc_frame.h"
+#include "app/calibration.h"
 #include "hal/adc_dma.h"
 #include "app/state.h"
 
+/** @brief Cantidad de ventanas de medición (ping-pong) */
+#define ACQ_NUM_WINDOWS 2
+
+/** @brief Bit de notificación a task_measure_compute: hay un ciclo para procesar */
+#define ACQ_NOTIFY_CYCLE  (1 << 0)
+
+/** @brief Bit de notificación a task_measure_compute: hay una ventana para procesar */
+#define ACQ_NOTIFY_WINDOW (1 << 1)
+
+/** @brief Bit de notificación a task_measure_compute: hay un ciclo capturado para análisis armónico */
+#define ACQ_NOTIFY_HARM   (1 << 2)
+
+/** @brief Pares crudos sobre los que se promedia la carga de task_adc_acquisition - 1 s */
+#define ACQ_LOAD_PERIOD_PAIRS ADC_RAW_FREQ_HZ
+
+/**
+ * @brief Contadores del pipeline de adquisición
+ * 
+ * @note Se actualizan desde task_adc_acquisition y task_measure_compute sin
+ *       mutex (escrituras de 32 bits); una lectura puede mezclar valores de
+ *       ventanas consecutivas, suficiente para diagnóstico.
+ */
+typedef struct {
+    uint32_t windows_ok;        /**< Ventanas entregadas a la tarea de cálculo */
+    uint32_t windows_dropped;   /**< Ventanas descartadas por tener la otra ocupada */
+    uint32_t cycles_dropped;    /**< Ciclos descartados por buzón ocupado */
+    uint32_t samples_invalid;   /**< Muestras de canal desconocido */
+    uint32_t samples_unpaired;  /**< Muestras descartadas por quedar sin par V-I */
+    uint32_t frame_us_last;     /**< Proceso del último frame: decodificación, diezmado y medición [us] */
+    uint32_t frame_us_max;      /**< Proceso de frame más largo observado [us] */
+    uint32_t load_permil;       /**< Tiempo de proceso sobre tiempo de señal en el último segundo [‰] */
+    uint32_t handoff_last_us;   /**< Latencia cierre de ventana → inicio de cálculo (última) [us] */
+    uint32_t handoff_max_us;    /**< Latencia máxima observada [us] */
+    uint32_t compute_us_last;   /**< Cálculo de la última ventana en task_measure_compute, hasta publicarla [us] */
+    uint32_t compute_us_max;    /**< Cálculo de ventana más largo observado [us] */
+} acq_stats_t;
+
 /**
  * @brief Tarea de adquisición continua ADC con DMA
  * 
  * Responsabilidades:
  * 
  * ### 1. Lectura de buffer DMA
- * Bloquea en app_adc_dma_read() esperando FRAME_BYTES bytes de datos ADC
- * (típicamente 1024 bytes = 512 muestras intercaladas V-I).
+ * Espera en app_adc_dma_get_frame() el próximo frame de FRAME_BYTES bytes
+ * (típicamente 1024 bytes = 512 muestras intercaladas V-I). Con
+ * ADC_DMA_EVENT_ENABLE el frame se decodifica en el lugar, dentro del buffer
+ * DMA del driver, y se libera antes de procesar los pares.
  * 
  * ### 2. Desempaquetado y validación
- * - Extrae muestras individuales del formato adc_digi_output_data_t
- * - Verifica que valores estén en rango ADC (0-4095 para 12 bits)
- * - Descarta muestras corruptas o fuera de rango
- * 
- * ### 3. Calibración por hardware
- * Aplica corrección ADC mediante app_adc_get_voltage():
+ * adc_frame_decode() convierte el frame completo en arreglos V e I:
+ * - Lee un par (V,I) por cada palabra de 32 bits del formato adc_digi_output_data_t
+ * - Valores enmascarados a 12 bits (siempre dentro de 0-4095)
+ * - Cuenta muestras de canal desconocido o sin par (samples_invalid / samples_unpaired)
+ * 
+ * Con un patrón de más de dos canales (MEASURE_TOPOLOGY multicanal)
+ * adc_frame_demux() separa el frame en un arreglo por slot, también en una
+ * sola pasada, y adc_frame_decimate_n() diezma todos los slots juntos.
+ * 
+ * ### 3. Diezmado (ADC_OVERSAMPLE > 1)
+ * adc_frame_decimate() promedia cada ADC_OVERSAMPLE pares crudos, de modo que
+ * la medición recibe siempre SAMPLE_FREQ_HZ pares por segundo. La fracción
+ * del tiempo de señal que consume la tarea queda en acq_stats_t::load_permil
+ * para evaluar el margen de cada configuración.
+ * 
+ * ### 4. Calibración por hardware
+ * Indexa la tabla raw→mV de app_adc_get_cal_lut(), precalculada al arranque
+ * con el esquema de calibración de IDF (sin llamadas por muestra):
  * - Conversión de cuentas ADC a milivoltios
  * - Corrección de no-linealidad del ADC del ESP32
  * - Compensación de offset y ganancia
  * 
- * ### 4. Sincronización V-I
+ * ### 5. Sincronización V-I
  * Empareja muestras de tensión y corriente en orden estricto:
  * - Canal V (ADC_CH_V) → guarda como v_mv
  * - Canal I (ADC_CH_I) → forma par (v_mv, i_mv) y envía a measure_add_sample()
@@ -86,11 +158,13 @@
  * Si la secuencia se rompe (ej: dos muestras de V consecutivas sin I),
  * descarta la muestra huérfana y resincronizan.
  * 
- * ### 5. Actualización del estado global
- * Cada NUM_SAMPLES_ACCUM pares (~4000 muestras = 10 ciclos @ 50Hz):
- * - measure_add_sample() retorna true
- * - Obtiene resultados con measure_get_results()
- * - Publica en estado global con state_update_measure()
+ * ### 6. Entrega de ciclos y ventanas
+ * measure_add_sample() (o measure_add_set() con pares auxiliares) informa el
+ * cierre de ciclos (cruce por cero) y de ventanas (NUM_CYCLES_ACCUM ciclos
+ * enteros, ~4000 muestras @ 50Hz):
+ * - Copia el ciclo/ventana (y las ventanas de los pares auxiliares) a un
+ *   lugar libre y notifica a task_measure_compute
+ * - Si no hay lugar libre lo descarta (cycles_dropped / windows_dropped)
  * 
  * ## Manejo de errores
  * 
@@ -98,8 +172,7 @@
  * |-------|--------|---------|
  * | ESP_ERR_TIMEOUT | Continue loop | Reinicia espera DMA |
  * | ESP_ERR_INVALID_STATE | Log warning + continue | Buffer overflow - datos perdidos |
- * | Calibración fallida | Descarta par V-I | Pierde 1 muestra de ~4000 |
- * | Valor ADC > 4095 | Descarta par V-I | Pierde 1 muestra de ~4000 |
+ * | Canal desconocido / V-I sin par | Descarta la muestra y cuenta | Pierde 1 muestra de ~4000 |
  * 
  * @param pvParameters Parámetro estándar de FreeRTOS (no usado)
  * 
@@ -109,8 +182,36 @@
  * 
  * @see system_config.h para configuración de prioridades y stack
  * @see measure_add_sample() para procesamiento de cada par (V,I)
- * @see app_adc_dma_read() para lectura bloqueante del buffer DMA
+ * @see app_adc_dma_get_frame() para la lectura del frame DMA
  */
 void task_adc_acquisition(void *pvParameters);
 
+/**
+ * @brief Tarea de cálculo de ventanas de medición
+ * 
+ * Espera la notificación de task_adc_acquisition, calcula los resultados del
+ * ciclo y/o las ventanas entregados con measure_get_results(), los libera y
+ * publica con state_update_cycle() y state_update_measure() (y
+ * state_update_aux() con MEASURE_AUX_PAIRS > 0). Con
+ * MEASURE_HARMONICS_ENABLE también analiza el ciclo capturado con
+ * harmonics_compute() y lo publica con state_update_harmonics().
+ * 
+ * Cada ventana pasa también por calibration_process_window() antes de
+ * liberarse: los cambios de calibración se aplican entre cierres.
+ * 
+ * @param pvParameters Parámetro estándar de FreeRTOS (no usado)
+ * 
+ * @note Prioridad TASK_PRIORITY_MEASURE, menor que la de adquisición
+ * @note Dispone de una ventana completa (~200 ms) para procesar antes de que
+ *       se descarte la siguiente
+ */
+void task_measure_compute(void *pvParameters);
+
+/**
+ * @brief Obtiene los contadores del pipeline de adquisición
+ * 
+ * @param[out] out Copia de los contadores
+ */
+void acquisition_get_stats(acq_stats_t *out);
+
 #endif // ACQUISITION_H
\ No newline at end of file
@@ -0,0 +1,222 @@
+/**
+ * @file adc_frame.h
+ * @brief Decodificación por lotes de frames TYPE1 del ADC DMA en pares (V,I)
+ *
+ * Convierte un frame completo de app_adc_dma_read() en dos arreglos de
+ * muestras calibradas (V e I, en mV), en lugar de tratar cada muestra con
+ * ramas por canal, rango y emparejamiento dentro de task_adc_acquisition.
+ *
+ * ## Formato de entrada
+ *
+ * Cada muestra TYPE1 (adc_digi_output_data_t) ocupa 16 bits:
+ *
+ * ```
+ * bits [11:0]  dato crudo (0..4095)
+ * bits [15:12] canal
+ * ```
+ *
+ * Con el patrón V,I del driver, cada palabra de 32 bits alineada contiene un
+ * par completo: V en la mitad baja e I en la alta (little endian, como el ESP32).
+ *
+ * ## Algoritmo
+ *
+ * 1. **Camino rápido**: una carga de 32 bits por par. Se comparan los dos
+ *    canales de una vez (w & 0xF000F000) contra el patrón esperado y se
+ *    indexa la tabla raw→mV con las dos mitades. Desenrollado ×2
+ * 2. **Camino lento**: si la palabra no es (V,I) o quedó una V pendiente del
+ *    frame anterior, se procesan sus dos muestras con la máquina de
+ *    emparejamiento original (V guarda, I forma el par, canal desconocido
+ *    descarta la V pendiente). Con el ADC sano no se ejecuta
+ * 3. **Contadores**: en lugar de ramificar por muestra inválida se acumulan
+ *    muestras de canal desconocido y muestras huérfanas (V sin I o I sin V)
+ *
+ * Como los datos se enmascaran a 12 bits, el índice de la tabla nunca supera
+ * ADC_MAX_COUNT y no hace falta chequear rango.
+ *
+ * ## Patrones de más de dos canales (ADC_PATTERN_LEN > 2)
+ *
+ * adc_frame_demux() separa el frame en un arreglo por slot del patrón en una
+ * sola pasada: cada muestra se busca en una tabla canal→slot (16 entradas) y
+ * se escribe en el arreglo de su slot si es el slot esperado. Un set que
+ * quedó incompleto al final del frame se completa con el siguiente. Ante una
+ * desincronización se descarta el set en curso (muestras huérfanas) y se
+ * espera al slot 0; un canal ajeno al patrón cuenta como inválido.
+ *
+ * ## Diezmado (ADC_OVERSAMPLE > 1)
+ *
+ * adc_frame_decimate() promedia cada ADC_OVERSAMPLE pares consecutivos sobre
+ * los mismos arreglos (boxcar con redondeo, sumas enteras). Las sumas
+ * parciales pasan de un frame al siguiente, por lo que los frames no
+ * necesitan ser múltiplos de ADC_OVERSAMPLE pares.
+ *
+ * @note No depende de FreeRTOS ni de ESP-IDF (compila en la PC)
+ *
+ * @author Tomás Vovard
+ * @date Diciembre 2025
+ */
+
+#ifndef ADC_FRAME_H
+#define ADC_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "config/measure_config.h"
+
+/** @brief Bytes por muestra TYPE1 */
+#define ADC_FRAME_SAMPLE_BYTES 2
+
+/** @brief Pares máximos que produce un frame de FRAME_BYTES */
+#define ADC_FRAME_MAX_PAIRS (FRAME_BYTES / (2 * ADC_FRAME_SAMPLE_BYTES))
+
+/** @brief Sets completos máximos que produce un frame de FRAME_BYTES con el patrón configurado */
+#define ADC_FRAME_MAX_SETS (FRAME_BYTES / (ADC_PATTERN_LEN * ADC_FRAME_SAMPLE_BYTES))
+
+/* ========================================================================== */
+/*                      ESTRUCTURAS DE DATOS                                  */
+/* ========================================================================== */
+
+/**
+ * @brief Estado del decodificador entre frames
+ *
+ * La V pendiente se conserva de un frame al siguiente, igual que el
+ * emparejamiento de la versión muestra a muestra.
+ */
+typedef struct {
+    const int16_t *lut;     /**< Tabla raw→mV (ADC_MAX_COUNT+1 entradas) */
+    uint32_t pair_key;      /**< Canales esperados en una palabra (V,I): ch_v<<12 | ch_i<<28 */
+    uint8_t ch_v;           /**< Canal de tensión */
+    uint8_t ch_i;           /**< Canal de corriente */
+    bool have_v;            /**< Hay una V esperando a su I */
+    int16_t v_pending;      /**< V pendiente [mV] */
+    uint32_t invalid;       /**< Muestras de canal desconocido (acumulado) */
+    uint32_t unpaired;      /**< Muestras descartadas por quedar sin par (acumulado) */
+} adc_frame_decoder_t;
+
+/**
+ * @brief Estado del demultiplexor de N canales entre frames
+ */
+typedef struct {
+    const int16_t *lut;                 /**< Tabla raw→mV (ADC_MAX_COUNT+1 entradas) */
+    int8_t slot_of[16];                 /**< Slot de cada canal (-1 si no está en el patrón) */
+    uint8_t n_ch;                       /**< Canales del patrón */
+    uint8_t pos;                        /**< Próximo slot esperado */
+    int16_t partial[ADC_PATTERN_MAX];   /**< Set incompleto del frame anterior [mV] */
+    uint32_t invalid;                   /**< Muestras de canal desconocido (acumulado) */
+    uint32_t unpaired;                  /**< Muestras descartadas por set incompleto (acumulado) */
+} adc_frame_demux_t;
+
+/**
+ * @brief Estado del diezmador boxcar entre frames
+ */
+typedef struct {
+    int32_t sum_v;          /**< Suma parcial de tensión [mV] */
+    int32_t sum_i;          /**< Suma parcial de corriente [mV] */
+    uint8_t count;          /**< Pares acumulados en la suma parcial */
+} adc_frame_decim_t;
+
+/**
+ * @brief Estado del diezmador boxcar de N canales entre frames
+ */
+typedef struct {
+    int32_t sum[ADC_PATTERN_MAX];   /**< Suma parcial de cada slot [mV] */
+    uint8_t count;                  /**< Sets acumulados en la suma parcial */
+} adc_frame_decim_n_t;
+
+/* ========================================================================== */
+/*                      FUNCIONES PÚBLICAS                                    */
+/* ========================================================================== */
+
+/**
+ * @brief Inicializa el decodificador
+ *
+ * @param dec Decodificador
+ * @param ch_v Canal de tensión (ADC_CH_V)
+ * @param ch_i Canal de corriente (ADC_CH_I)
+ * @param lut Tabla raw→mV de app_adc_get_cal_lut()
+ */
+void adc_frame_decoder_init(adc_frame_decoder_t *dec, uint8_t ch_v, uint8_t ch_i, const int16_t *lut);
+
+/**
+ * @brief Decodifica un frame en pares (V,I) calibrados
+ *
+ * @param dec Decodificador
+ * @param words Frame leído del DMA, alineado a 4 bytes
+ * @param bytes Bytes válidos del frame (múltiplo de ADC_FRAME_SAMPLE_BYTES)
+ * @param[out] v_mv Tensiones [mV], al menos bytes/4 + 1 lugares
+ * @param[out] i_mv Corrientes [mV], al menos bytes/4 + 1 lugares
+ *
+ * @return Pares escritos en v_mv/i_mv
+ *
+ * @note Si bytes no es múltiplo de ADC_FRAME_SAMPLE_BYTES se ignora el byte sobrante
+ */
+size_t adc_frame_decode(adc_frame_decoder_t *dec, const uint32_t *words, size_t bytes, int16_t *v_mv, int16_t *i_mv);
+
+/**
+ * @brief Inicializa el demultiplexor
+ *
+ * @param dm Demultiplexor
+ * @param ch Canales del patrón en orden de slot (app_adc_get_pattern())
+ * @param n_ch Canales del patrón (1..ADC_PATTERN_MAX)
+ * @param lut Tabla raw→mV de app_adc_get_cal_lut()
+ */
+void adc_frame_demux_init(adc_frame_demux_t *dm, const uint8_t *ch, uint8_t n_ch, const int16_t *lut);
+
+/**
+ * @brief Separa un frame en un arreglo calibrado por slot, en una pasada
+ *
+ * @param dm Demultiplexor
+ * @param samples Frame leído del DMA
+ * @param bytes Bytes válidos del frame
+ * @param[out] out Un arreglo por slot [mV], cada uno con al menos
+ *                 bytes / (2 · n_ch) + 1 lugares
+ *
+ * @return Sets completos escritos en out
+ *
+ * @note Si bytes no es múltiplo de ADC_FRAME_SAMPLE_BYTES se ignora el byte sobrante
+ */
+size_t adc_frame_demux(adc_frame_demux_t *dm, const uint16_t *samples, size_t bytes, int16_t *const out[]);
+
+/**
+ * @brief Inicializa el diezmador
+ *
+ * @param dec Diezmador
+ */
+void adc_frame_decim_init(adc_frame_decim_t *dec);
+
+/**
+ * @brief Promedia cada ADC_OVERSAMPLE pares, en el lugar
+ *
+ * @param dec Diezmador
+ * @param[in,out] v_mv Tensiones [mV]: entran n crudas, salen las promediadas
+ * @param[in,out] i_mv Corrientes [mV]: entran n crudas, salen las promediadas
+ * @param n Pares crudos
+ *
+ * @return Pares promediados escritos al inicio de v_mv/i_mv
+ *
+ * @note Con ADC_OVERSAMPLE = 1 retorna n sin tocar los arreglos
+ */
+size_t adc_frame_decimate(adc_frame_decim_t *dec, int16_t *v_mv, int16_t *i_mv, size_t n);
+
+/**
+ * @brief Inicializa el diezmador de N canales
+ *
+ * @param dec Diezmador
+ */
+void adc_frame_decim_n_init(adc_frame_decim_n_t *dec);
+
+/**
+ * @brief Promedia cada ADC_OVERSAMPLE sets de n_ch canales, en el lugar
+ *
+ * @param dec Diezmador
+ * @param[in,out] ch Un arreglo por slot: entran n sets crudos, salen los promediados
+ * @param n_ch Canales (hasta ADC_PATTERN_MAX)
+ * @param n Sets crudos
+ *
+ * @return Sets promediados escritos al inicio de cada arreglo
+ *
+ * @note Con ADC_OVERSAMPLE = 1 retorna n sin tocar los arreglos
+ */
+size_t adc_frame_decimate_n(adc_frame_decim_n_t *dec, int16_t *const ch[], uint8_t n_ch, size_t n);
+
+#endif // ADC_FRAME_H
@@ -0,0 +1,181 @@
+/**
+ * @file calibration.h
+ * @brief Motor de calibración de la cadena de medición (offset, ganancia y ruido)
+ *
+ * Ajusta en campo la calibración vigente (measure_cal_t) a partir de las
+ * ventanas de medición, en lugar de recompilar las constantes de fábrica de
+ * measure.h para cada placa.
+ *
+ * ## Pasos
+ *
+ * | Paso          | Condición de entrada         | Resultado                                  |
+ * |---------------|------------------------------|--------------------------------------------|
+ * | ZERO V        | Sin tensión aplicada         | v_noise = CAL_NOISE_MARGIN × piso máximo    |
+ * | ZERO I        | Sin carga                    | i_offset = piso medio, i_noise = margen × máx |
+ * | GAIN V \<ref> | Tensión conocida ref [V]     | v_gain = ±Vrms_adc / ref (signo vigente)    |
+ * | GAIN I \<ref> | Corriente conocida ref [A]   | i_sens = Irms_adc / (ref + i_offset)       |
+ *
+ * Cada paso promedia CAL_WINDOWS ventanas de measure_get_raw() (RMS sin DC a
+ * la entrada del ADC, independiente de la calibración vigente). Si el
+ * resultado es plausible se aplica con measure_set_cal() y se pide guardarlo
+ * en NVS con persist_cal(); si no, la calibración vigente no cambia. El
+ * guardado (y el borrado de calibration_restore_default()) lo hace
+ * task_persist, fuera de la tarea de cálculo.
+ *
+ * Conviene calibrar en orden ZERO I → GAIN I: la ganancia de corriente usa
+ * el i_offset vigente.
+ *
+ * ## Concurrencia
+ *
+ * Los comandos (UART/MQTT) sólo dejan pedidos en flags volátiles. El motor
+ * corre en task_measure_compute, una vez por ventana y antes de liberarla,
+ * que es la misma tarea que ejecuta measure_get_results(): la calibración
+ * nunca cambia en medio de un cierre y el lazo por muestra no se toca.
+ *
+ * @author Tomás Vovard
+ * @date Diciembre 2025
+ */
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app/measure.h"
+
+/**
+ * @defgroup calibration_config Parámetros del motor de calibración
+ * @{
+ */
+
+/** @brief Ventanas promediadas por paso (~2 s a 50 Hz) */
+#define CAL_WINDOWS 10
+
+/** @brief Margen entre el piso medido y el umbral de ruido (el de fábrica es 3× ACS712_OFFSET) */
+#define CAL_NOISE_MARGIN 3.0f
+
+/** @brief Piso de tensión máximo aceptado en ZERO V [V] (más indica tensión aplicada) */
+#define CAL_ZERO_V_MAX 50.0f
+
+/** @brief Piso de corriente máximo aceptado en ZERO I [A] (más indica carga conectada) */
+#define CAL_ZERO_I_MAX 0.5f
+
+/** @brief RMS mínimo a la entrada del ADC para resolver una ganancia [mV] */
+#define CAL_GAIN_MIN_MV 50.0f
+
+/** @brief Desvío máximo aceptado de la ganancia resuelta respecto de la de fábrica [fracción] */
+#define CAL_GAIN_MAX_DEV 0.5f
+
+/** @} */ // end of calibration_config
+
+/* ========================================================================== */
+/*                      ESTRUCTURAS DE DATOS                                  */
+/* ========================================================================== */
+
+/** @brief Paso de calibración */
+typedef enum {
+    CAL_STEP_NONE = 0,
+    CAL_STEP_ZERO_V,        /**< Piso de tensión */
+    CAL_STEP_ZERO_I,        /**< Piso y offset de corriente */
+    CAL_STEP_GAIN_V,        /**< Ganancia de tensión con referencia */
+    CAL_STEP_GAIN_I         /**< Sensibilidad de corriente con referencia */
+} cal_step_t;
+
+/** @brief Estado del motor */
+typedef enum {
+    CAL_IDLE = 0,           /**< Nunca se corrió un paso */
+    CAL_RUNNING,            /**< Promediando ventanas */
+    CAL_DONE,               /**< Último paso aplicado (el guardado lo hace task_persist) */
+    CAL_FAILED              /**< Último paso rechazado (ver cal_err_t) */
+} cal_status_t;
+
+/** @brief Motivo del rechazo del último paso */
+typedef enum {
+    CAL_ERR_NONE = 0,
+    CAL_ERR_SIGNAL,         /**< Señal incompatible con el paso (presente en ZERO, ausente en GAIN) */
+    CAL_ERR_RANGE,          /**< Ganancia resuelta fuera de CAL_GAIN_MAX_DEV */
+    CAL_ERR_NVS,            /**< Se aplicó pero task_persist no pudo guardarlo (se informa en la ventana siguiente a la falla) */
+    CAL_ERR_ABORTED         /**< Abortado por comando */
+} cal_err_t;
+
+/**
+ * @brief Estado del motor de calibración
+ */
+typedef struct {
+    cal_status_t status;    /**< Estado actual */
+    cal_step_t step;        /**< Paso en curso o último paso */
+    cal_err_t err;          /**< Motivo del rechazo (CAL_FAILED) */
+    uint8_t windows;        /**< Ventanas promediadas del paso en curso */
+    float ref;              /**< Referencia del paso (GAIN) [V o A] */
+    float result;           /**< Valor resuelto: v_noise, i_offset, v_gain o i_sens */
+    uint32_t runs;          /**< Pasos terminados (aplicados o rechazados) desde el arranque */
+} cal_info_t;
+
+/* ========================================================================== */
+/*                      FUNCIONES PÚBLICAS                                    */
+/* ========================================================================== */
+
+/**
+ * @brief Carga la calibración guardada en NVS (o la de fábrica) y la aplica
+ *
+ * @note Llamar después de nvs_config_init() y antes de crear las tareas
+ */
+void calibration_init();
+
+/**
+ * @brief Pide un paso de calibración
+ *
+ * @param step Paso a ejecutar
+ * @param ref Referencia [V] para GAIN V o [A] para GAIN I (ignorada en ZERO)
+ *
+ * @return false si el paso o la referencia no son válidos
+ *
+ * @note Reemplaza a un paso en curso; comienza en la próxima ventana
+ */
+bool calibration_start(cal_step_t step, float ref);
+
+/**
+ * @brief Pide volver a la calibración de fábrica y borrar la guardada
+ */
+void calibration_restore_default();
+
+/**
+ * @brief Pide abortar el paso en curso
+ */
+void calibration_abort();
+
+/**
+ * @brief Avanza el motor con una ventana cerrada
+ *
+ * Atiende los pedidos pendientes y, si hay un paso en curso, incorpora la
+ * ventana; al completar CAL_WINDOWS resuelve, aplica y pide guardar.
+ *
+ * @param win Ventana cerrada (antes de devolverla a la adquisición)
+ *
+ * @note Sólo desde task_measure_compute
+ */
+void calibration_process_window(const measure_accum_t *win);
+
+/**
+ * @brief Copia el estado del motor
+ *
+ * @param[out] out Destino
+ */
+void calibration_get_info(cal_info_t *out);
+
+/**
+ * @brief Nombre corto de un paso ("ZERO_V", "GAIN_I", ...)
+ */
+const char *calibration_step_name(cal_step_t step);
+
+/**
+ * @brief Nombre corto de un estado ("IDLE", "RUNNING", "DONE", "FAILED")
+ */
+const char *calibration_status_name(cal_status_t status);
+
+/**
+ * @brief Nombre corto de un motivo de rechazo ("NONE", "SIGNAL", ...)
+ */
+const char *calibration_err_name(cal_err_t err);
+
+#endif // CALIBRATION_H
@@ -139,7 +139,23 @@ typedef struct {
 typedef struct {
     float imax;                 /**< Corriente máxima RMS admisible total [A] */
     load_cfg_t load[NUM_LOADS]; /**< Configuración individual de cada carga */
-} sys_load_cfg_t; 
+} sys_load_cfg_t;
+
+/**
+ * @brief Registros de energía activa importada atribuida a cada carga (persistidos en NVS)
+ *
+ * Los lleva state.c en cada cierre de ventana: con corriente por salida
+ * (MEASURE_TOPO_PER_LOAD) cada carga suma su energía medida; si no, la
+ * energía importada de la ventana se reparte entre las cargas según el
+ * tiempo que estuvo encendida cada una (en partes iguales mientras hay
+ * varias encendidas). Sólo crecen.
+ *
+ * @note Se guardan como un único blob con nvs_save_load_energy()
+ */
+typedef struct {
+    double E[NUM_LOADS];        /**< Energía atribuida a cada carga [kWh] */
+    double E_other;             /**< Resto no atribuible: todas apagadas o consumo fuera de las salidas [kWh] */
+} load_energy_t;
 
 /**
  * @brief Estados de la FSM global (protección por sobrecorriente)
@@ -351,12 +367,14 @@ int16_t control_get_v_max(uint8_t id);
  * @brief Guarda configuración actual en memoria flash NVS
  * 
  * Persiste toda la estructura sys_load_cfg_t en NVS para sobrevivir
- * a reinicios y pérdidas de alimentación.
+ * a reinicios y pérdidas de alimentación. La escritura la hace task_persist
+ * dentro de PERSIST_BATCH_MS (persist_config()).
  * 
- * @return true si guardado exitoso, false en caso de error de escritura
- * @note La energía acumulada debe guardarse por separado con nvs_save_energy()
+ * @note Asíncrono: un fallo de escritura se reintenta y se cuenta en
+ *       persist_stats_t::cfg_errors (CFG_ERR en ACQ STALL)
+ * @note La energía acumulada debe guardarse por separado con persist_energy()
  */
-bool control_save_to_nvs();
+void control_save_to_nvs();
 
 /**
  * @brief Carga configuración desde memoria flash NVS
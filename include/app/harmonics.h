@@ -0,0 +1,84 @@
+/**
+ * @file harmonics.h
+ * @brief Análisis armónico de tensión y corriente (THD y armónicos 1..HARM_NUM)
+ *
+ * Las cargas conmutadas (fuentes switching, variadores) deforman la corriente;
+ * RMS/P/fp no alcanzan para verlo. Este módulo calcula la magnitud de los
+ * primeros HARM_NUM armónicos y la distorsión armónica total sobre un ciclo
+ * de red capturado.
+ *
+ * ## Algoritmo
+ *
+ * 1. **Captura**: task_adc_acquisition copia los pares (V,I) del primer ciclo
+ *    de cada ventana, delimitado por cruces por cero (N ≈ fs/f pares)
+ * 2. **Banco de Goertzel**: para k = 1..HARM_NUM se evalúa el bin k de una DFT
+ *    de N puntos. Como la captura abarca un período entero, el bin k coincide
+ *    con el armónico k sin remuestrear a potencia de 2
+ * 3. **Magnitud RMS**: |X_k|·√2/N, escalada a V y A con las constantes de measure.h
+ * 4. **THD**: √(Σ_{k≥2} H_k²) / H_1 [%]
+ *
+ * ## Costo
+ *
+ * Una iteración de Goertzel (1 multiplicación y 2 sumas en float) por muestra,
+ * armónico y canal: 2 × 15 × ~400 ≈ 12k iteraciones por ventana (cada 200 ms),
+ * ejecutadas en task_measure_compute. La adquisición sólo copia los pares del
+ * ciclo capturado, por lo que la lectura del DMA no se demora.
+ *
+ * @note Se habilita con MEASURE_HARMONICS_ENABLE en measure_config.h
+ *
+ * @author Tomás Vovard
+ * @date Diciembre 2025
+ */
+
+#ifndef HARMONICS_H
+#define HARMONICS_H
+
+#include <stdint.h>
+#include "config/measure_config.h"
+
+/* ========================================================================== */
+/*                      ESTRUCTURAS DE DATOS                                  */
+/* ========================================================================== */
+
+/**
+ * @brief Ciclo capturado para el análisis armónico
+ *
+ * Muestras calibradas en mV tal como llegan a measure_add_sample().
+ */
+typedef struct {
+    int16_t v[HARM_CAPTURE_MAX_PAIRS];  /**< Tensión [mV] */
+    int16_t i[HARM_CAPTURE_MAX_PAIRS];  /**< Corriente [mV] */
+    uint16_t n;                         /**< Pares capturados (un período) */
+} harmonics_capture_t;
+
+/**
+ * @brief Resultado del análisis armónico
+ *
+ * Los índices de v[] e i[] corresponden al orden del armónico menos uno
+ * (v[0] es la fundamental).
+ *
+ * @note THD en cero si la fundamental está por debajo del ruido de fondo
+ */
+typedef struct {
+    float thd_v;            /**< Distorsión armónica total de tensión [%] */
+    float thd_i;            /**< Distorsión armónica total de corriente [%] */
+    float v[HARM_NUM];      /**< Magnitud RMS de cada armónico de tensión [V] */
+    float i[HARM_NUM];      /**< Magnitud RMS de cada armónico de corriente [A] */
+} harmonics_t;
+
+/* ========================================================================== */
+/*                      FUNCIONES PÚBLICAS                                    */
+/* ========================================================================== */
+
+/**
+ * @brief Calcula armónicos y THD de un ciclo capturado
+ *
+ * @param cap Ciclo capturado (cap->n pares, un período entero)
+ * @param[out] out Resultados del análisis
+ *
+ * @note Costo O(HARM_NUM · n); pensada para task_measure_compute
+ * @note Si cap->n < 2·HARM_NUM + 1 (no resuelve HARM_NUM armónicos) devuelve todo en cero
+ */
+void harmonics_compute(const harmonics_capture_t *cap, harmonics_t *out);
+
+#endif // HARMONICS_H
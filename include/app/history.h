@@ -0,0 +1,298 @@
+/**
+ * @file history.h
+ * @brief Historial de mediciones en el equipo: segundos en RAM, minutos y horas en flash
+ *
+ * state sólo guarda la última medición: si el broker MQTT o el host UART no
+ * están, la historia se pierde. Este módulo la conserva en tres niveles,
+ * alimentados desde state_update_measure() con cada ventana del par principal:
+ *
+ * | Nivel          | Dónde                   | Contenido por punto            | Alcance (por defecto) |
+ * |----------------|-------------------------|--------------------------------|-----------------------|
+ * | HIST_TIER_SEC  | RAM, HIST_SEC_LEN       | promedio del segundo           | 5 min                 |
+ * | HIST_TIER_MIN  | flash, HIST_MIN_SECTORS | mín / máx / promedio del minuto| 31 a 33 h             |
+ * | HIST_TIER_HOUR | flash, resto (32)       | mín / máx / promedio de la hora| 164 a 169 días        |
+ *
+ * Con 127 puntos por sector (una clave y 126 deltas): el mínimo es justo
+ * después de borrar un sector al dar la vuelta. Cada arranque agrega una
+ * clave (un lugar más) en cada nivel.
+ *
+ * Campos: Vrms, Irms, P, Q, fp y f, cuantizados a int16 con el paso de
+ * history_to_float() (0,1 V, 0,01 A, 1 W, 1 var, 0,001, 0,01 Hz).
+ *
+ * ## Formato en flash
+ *
+ * Cada nivel es un anillo de sectores de la partición "history" dividido en
+ * lugares fijos de HIST_SLOT_BYTES. Un sector empieza siempre con un registro
+ * clave y sigue con registros delta:
+ *
+ * | Registro | Lugares | Contenido                                                  |
+ * |----------|---------|------------------------------------------------------------|
+ * | clave    | 2       | tipo, flags, n, secuencia del sector, t absoluto, 18 int16 |
+ * | delta    | 1       | tipo, flags, n, dt en períodos, 12 escalas, 18 int8        |
+ *
+ * Ambos llevan CRC16. Las diferencias contra el punto anterior se guardan en
+ * pasos de 2^s, con una escala para el promedio de cada campo y otra para su
+ * mín y máx: la menor s en la que entran en int8. Son exactas mientras no
+ * superan ±127 pasos de history_to_float(); en un salto mayor el error queda
+ * por debajo de 1/127 del salto (±8 W en uno de 1 kW). El siguiente delta se
+ * calcula contra el valor reconstruido, así que el error no se acumula.
+ * Se escribe una clave al empezar cada sector, en el primer registro después
+ * de un arranque y cuando el salto de tiempo no entra en 16 bits. Los
+ * sectores se borran en forma circular al empezar a escribirlos, como en
+ * energy_log.h.
+ *
+ * ## Tiempo
+ *
+ * t es el inicio del intervalo en segundos: tiempo Unix si el reloj del
+ * sistema es válido (>= HIST_EPOCH_VALID), si no un contador que sigue desde
+ * el último registro guardado. Los cortes de alimentación no cuentan en ese
+ * contador: el primer punto después de un arranque lleva HIST_F_BOOT.
+ * history_now() da el tiempo actual para que el host traduzca.
+ *
+ * ## Escrituras
+ *
+ * history_add() sólo acumula y, al cerrar un minuto u hora, encola el punto
+ * (HIST_PENDING_LEN) y pide a task_persist que lo escriba (persist_history()):
+ * la tarea de cálculo nunca espera a la flash.
+ *
+ * @note Si la partición no existe sólo queda el nivel de segundos
+ *
+ * @author Tomás Vovard
+ * @date Diciembre 2025
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "app/measure.h"
+
+/**
+ * @defgroup history_config Parámetros del historial
+ * @{
+ */
+
+/** @brief Etiqueta de la partición en partitions.csv */
+#define HIST_PARTITION "history"
+
+/** @brief Segundos guardados en RAM */
+#define HIST_SEC_LEN 300
+
+/** @brief Sectores del anillo de minutos (el resto de la partición es de horas) */
+#define HIST_MIN_SECTORS 16
+
+/** @brief Máximo de sectores por anillo */
+#define HIST_RING_MAX_SECTORS 32
+
+/** @brief Puntos de minuto/hora esperando escritura */
+#define HIST_PENDING_LEN 8
+
+/** @brief Tamaño de un lugar en flash [bytes] (un registro delta; una clave usa dos) */
+#define HIST_SLOT_BYTES 32
+
+/** @brief Tiempo Unix a partir del cual el reloj del sistema se considera válido [s] */
+#define HIST_EPOCH_VALID 1700000000u
+
+/** @brief Sin lecturas durante este tiempo, el volcado en curso se da por abandonado [ms] */
+#define HIST_DUMP_IDLE_MS 2000
+
+/** @} */ // end of history_config
+
+/* ========================================================================== */
+/*                      ESTRUCTURAS DE DATOS                                  */
+/* ========================================================================== */
+
+/**
+ * @brief Nivel del historial
+ */
+typedef enum {
+    HIST_TIER_SEC = 0,      /**< Segundos, en RAM */
+    HIST_TIER_MIN,          /**< Minutos, en flash */
+    HIST_TIER_HOUR,         /**< Horas, en flash */
+    HIST_TIERS
+} hist_tier_t;
+
+/**
+ * @brief Campos guardados (índice en hist_point_t)
+ */
+typedef enum {
+    HIST_V = 0,             /**< Vrms [0,1 V] */
+    HIST_I,                 /**< Irms [0,01 A] */
+    HIST_P,                 /**< Potencia activa [1 W] */
+    HIST_Q,                 /**< Potencia reactiva [1 var] */
+    HIST_FP,                /**< Factor de potencia [0,001] */
+    HIST_F,                 /**< Frecuencia [0,01 Hz] */
+    HIST_FIELDS
+} hist_field_t;
+
+/** @brief Primer punto después de un arranque: hay un hueco de duración desconocida antes */
+#define HIST_F_BOOT (1u << 0)
+
+/**
+ * @brief Punto del historial (44 bytes, formato de HIST DUMP)
+ *
+ * @note En HIST_TIER_SEC min y max son iguales al promedio
+ */
+typedef struct {
+    uint32_t t;                     /**< Inicio del intervalo [s] */
+    uint16_t n;                     /**< Ventanas agregadas (satura en 65535) */
+    uint8_t tier;                   /**< hist_tier_t */
+    uint8_t flags;                  /**< HIST_F_* */
+    int16_t avg[HIST_FIELDS];       /**< Promedios cuantizados */
+    int16_t min[HIST_FIELDS];       /**< Mínimos cuantizados */
+    int16_t max[HIST_FIELDS];       /**< Máximos cuantizados */
+} hist_point_t;
+
+/**
+ * @brief Recorrido de una consulta (los campos son internos)
+ */
+typedef struct {
+    uint8_t tier;
+    bool done;
+    uint32_t from;
+    uint32_t to;
+    int32_t sector;                 /**< Sector en lectura (-1: buscar desde from) */
+    uint32_t sect_seq;              /**< Secuencia del sector al empezarlo */
+    uint16_t slot;
+    uint32_t t;                     /**< Tiempo del último registro decodificado */
+    int16_t q[3 * HIST_FIELDS];     /**< Valores del último registro decodificado */
+} hist_cursor_t;
+
+/**
+ * @brief Estado del historial
+ */
+typedef struct {
+    bool flash;                     /**< Partición encontrada */
+    uint32_t now;                   /**< history_now() */
+    uint32_t oldest[HIST_TIERS];    /**< Punto más antiguo por nivel (0: vacío) */
+    uint32_t newest[HIST_TIERS];    /**< Punto más reciente por nivel (0: vacío) */
+    uint32_t records;               /**< Registros escritos desde el arranque */
+    uint32_t keys;                  /**< De ellos, claves */
+    uint32_t erases;                /**< Sectores borrados desde el arranque */
+    uint32_t dropped;               /**< Puntos perdidos (cola llena, tiempo no creciente o error de flash) */
+    uint32_t boot_us;               /**< Duración de la recuperación [us] */
+} hist_info_t;
+
+/* ========================================================================== */
+/*                      FUNCIONES PÚBLICAS                                    */
+/* ========================================================================== */
+
+/**
+ * @brief Busca la partición y recupera los anillos de minutos y horas
+ *
+ * @return true si la partición existe
+ *
+ * @note Llamar antes de state_init()
+ */
+bool history_init();
+
+/**
+ * @brief Agrega una ventana de medición
+ *
+ * @param m Resultados de la ventana del par principal
+ *
+ * @note Sólo desde state_update_measure() (productor único); no bloquea
+ */
+void history_add(const measure_t *m);
+
+/**
+ * @brief Escribe en flash los puntos encolados
+ *
+ * @return false si alguna escritura falló
+ *
+ * @note Sólo desde persist_flush()
+ */
+bool history_flush();
+
+/**
+ * @brief Tiempo actual del historial [s]
+ */
+uint32_t history_now();
+
+/**
+ * @brief Convierte un valor cuantizado a su unidad
+ *
+ * @param field Campo
+ * @param q Valor cuantizado
+ *
+ * @return Valor en V, A, W, var, adimensional o Hz
+ */
+float history_to_float(hist_field_t field, int16_t q);
+
+/**
+ * @brief Nombre de un nivel ("SEC", "MIN" u "HOUR")
+ *
+ * @param tier Nivel
+ */
+const char *history_tier_name(hist_tier_t tier);
+
+/**
+ * @brief Nivel a partir de su nombre
+ *
+ * @param name "SEC", "MIN" u "HOUR"
+ * @param[out] tier Nivel
+ *
+ * @return false si el nombre no es válido
+ */
+bool history_tier_parse(const char *name, hist_tier_t *tier);
+
+/**
+ * @brief Empieza una consulta de puntos con t en [from, to]
+ *
+ * @param[out] c Recorrido
+ * @param tier Nivel
+ * @param from Tiempo inicial [s]
+ * @param to Tiempo final [s]
+ */
+void history_query_begin(hist_cursor_t *c, hist_tier_t tier, uint32_t from, uint32_t to);
+
+/**
+ * @brief Entrega los siguientes puntos de la consulta, del más antiguo al más nuevo
+ *
+ * @param c Recorrido
+ * @param[out] out Destino
+ * @param max Puntos como máximo
+ *
+ * @return Puntos copiados; 0 al terminar
+ *
+ * @note Si el anillo pisa el sector en lectura, sigue desde el punto siguiente
+ *       al último entregado
+ */
+size_t history_query_next(hist_cursor_t *c, hist_point_t *out, size_t max);
+
+/**
+ * @brief Prepara la consulta que lee history_dump_read()
+ *
+ * Hay un solo cursor de volcado: mientras otro volcado se está leyendo el
+ * pedido se rechaza. El volcado termina cuando history_dump_read() retorna
+ * 0, o si pasan HIST_DUMP_IDLE_MS sin lecturas (el lector lo abandonó).
+ *
+ * @param tier Nivel
+ * @param from Tiempo inicial [s]
+ * @param to Tiempo final [s]
+ *
+ * @return false si hay un volcado en curso
+ */
+bool history_dump_begin(hist_tier_t tier, uint32_t from, uint32_t to);
+
+/**
+ * @brief Lectura secuencial de la consulta como bytes de hist_point_t (uart_dump_read_t)
+ *
+ * @param offset Byte inicial (las lecturas deben ser consecutivas desde 0)
+ * @param[out] dst Destino
+ * @param len Bytes pedidos
+ *
+ * @return Bytes copiados; 0 al terminar
+ */
+size_t history_dump_read(uint32_t offset, uint8_t *dst, size_t len);
+
+/**
+ * @brief Copia el estado del historial
+ *
+ * @param[out] out Destino
+ */
+void history_get_info(hist_info_t *out);
+
+#endif // HISTORY_H
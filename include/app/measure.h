@@ -4,18 +4,39 @@
  * 
  * Este módulo implementa el algoritmo de cálculo de magnitudes eléctricas a partir
  * de muestras ADC sincronizadas de tensión y corriente. Utiliza ventanas de
- * NUM_SAMPLES_ACCUM muestras (típicamente 10 ciclos @ 50Hz = 4000 muestras) para
- * obtener valores RMS estables.
+ * NUM_CYCLES_ACCUM ciclos enteros delimitados por cruces por cero (típicamente
+ * 10 ciclos @ 50Hz ≈ 4000 muestras) para obtener valores RMS estables, y
+ * además entrega resultados de cada ciclo.
  * 
  * ## Algoritmo de medición
  * 
- * 1. **Adquisición**: Muestras simultáneas V-I a 20 kHz (400 muestras/ciclo @ 50Hz)
- * 2. **Acumulación**: 10 ciclos completos = 4000 pares (V,I)
- * 3. **Cálculo RMS**: √(Σ(v²)/N) para tensión y corriente
- * 4. **Potencia activa**: P = Σ(v·i)/N
- * 5. **Potencia aparente**: S = Vrms × Irms
- * 6. **Factor de potencia**: fp = P/S
- * 7. **Energía**: E = P × Δt
+ * 1. **Adquisición**: Muestras V-I a 20 kHz (400 muestras/ciclo @ 50Hz). V se
+ *    interpola al instante de conversión de I (MEASURE_SKEW_COMP) para que el
+ *    par sea simultáneo
+ * 2. **Acumulación (streaming)**: por cada par se actualizan Σv, Σi, Σv², Σi², Σvi,
+ *    Σ(v[n-1]·i[n] - v[n]·i[n-1]) y los extremos; no se guardan las muestras de la ventana
+ * 3. **Cierre de ciclo y ventana**: cruce ascendente de V por cero cierra el
+ *    ciclo; 10 ciclos completos (~4000 pares @ 50Hz) cierran la ventana
+ * 4. **Cálculo RMS**: √(Σv²/N - (Σv/N)²) para tensión y corriente (DC removida)
+ * 5. **Potencia activa**: P = Σvi/N - (Σv/N)(Σi/N)
+ * 6. **Potencia aparente**: S = Vrms × Irms
+ * 7. **Potencia reactiva**: Q = ⟨v[n-1]·i[n] - v[n]·i[n-1]⟩ / (2·sin(2π·f/fs)),
+ *    producto cruzado con la muestra anterior (sin buffers de retardo)
+ * 8. **Factor de potencia**: fp = |P|/S (total) y fp_disp = |P|/√(P²+Q²) (desplazamiento)
+ * 9. **Energía**: E = P × Δt, Eq = |Q| × Δt
+ * 10. **Frecuencia**: f = fs × ciclos / (pares entre el primer y último cruce),
+ *    con los cruces interpolados linealmente entre muestras
+ * 
+ * El cálculo al cierre de ventana es de costo constante (no recorre muestras).
+ * 
+ * ### Tolerancia respecto del cálculo en dos pasadas
+ * 
+ * Las muestras son enteras en mV (|v| < 4096), por lo que todas las sumas son
+ * enteros exactos en double (< 2^53) y los numeradores N·Σv² - (Σv)² se
+ * calculan sin error de redondeo. La diferencia con el algoritmo anterior de
+ * dos pasadas (restar DC muestra a muestra) queda acotada por el redondeo final
+ * de la división y la raíz: error relativo < 1e-12 en Vrms, Irms y P, muy por
+ * debajo de la resolución de float en measure_t (~6e-8).
  * 
  * ## Calibración de hardware
  * 
@@ -32,6 +53,10 @@
  * - Ganancia calibrada: -4.05 mV/V (signo por inversión de fase)
  * - Ruido de fondo
  * 
+ * Las constantes de measure_calibration son los valores de fábrica: en
+ * ejecución rige measure_cal_t, que se carga desde NVS al arrancar y se
+ * ajusta por comando con el motor de calibración (calibration.h).
+ * 
  * @note La precisión mejora significativamente con señales de amplitud grande
  * @warning Con tensiones <50V las mediciones de fp no son confiables
  * 
@@ -43,8 +68,15 @@
 #define MEASURE_H
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <math.h>
-#include "config/system_config.h"
+#include "config/measure_config.h"
+
+/* M_PI no es C estándar: lo definen newlib (ESP-IDF) y glibc en modo gnu, no un compilador en -std=c11 */
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
 
 /* ========================================================================== */
 /*                      CALIBRACIÓN DEL HARDWARE                              */
@@ -113,8 +145,9 @@
 /**
  * @brief Resultados de una medición eléctrica completa
  * 
- * Contiene todas las magnitudes calculadas a partir de NUM_SAMPLES_ACCUM
- * muestras ADC. Esta estructura se actualiza cada ~200ms (10 ciclos @ 50Hz).
+ * Contiene todas las magnitudes calculadas a partir de un ciclo o de una
+ * ventana de NUM_CYCLES_ACCUM ciclos. La ventana se actualiza cada ~200ms
+ * (10 ciclos @ 50Hz) y el ciclo cada ~20ms.
  * 
  * ## Interpretación de valores:
  * 
@@ -129,14 +162,24 @@
  * - Ipk: Valor de pico [A] - importante para dimensionar relés
  * 
  * ### Potencia
- * - P: Activa [W] - potencia real consumida/generada
+ * - P: Activa [W] con signo - positiva importada (consumo), negativa exportada
+ * - Q: Reactiva [var] con signo - positiva inductiva (I atrasa a V), negativa capacitiva
  * - S: Aparente [VA] - producto Vrms × Irms
- * - fp: Factor de potencia
+ * - fp: Factor de potencia total |P|/S (incluye distorsión)
+ * - fp_disp: Factor de potencia de desplazamiento |P|/√(P²+Q²) - cos φ de la
+ *   fundamental; fp/fp_disp es el factor de distorsión
+ * 
+ * ### Frecuencia
+ * - f: Frecuencia de red medida [Hz] - 0 si no hubo cruces por cero válidos
+ *   (sin tensión). Resolución ~0.01 Hz por ventana gracias a la interpolación
  * 
  * ### Energía
  * - E: Energía incremental [kWh] - suma cada ventana de medición
- *   * E = P × TIME_SAMPLE_H donde TIME_SAMPLE_H ≈ 0.000056h (200ms)
+ *   * E = P × n / SAMPLE_FREQ_HZ / 3600, con n los pares efectivos de la ventana
+ *     (≈ 0.000056h para 10 ciclos de 50 Hz)
  *   * Esta E se ACUMULA en state.measure.E para obtener consumo total
+ *     y en los registros de importación/exportación de state.energy
+ * - Eq: Energía reactiva incremental |Q| × Δt (registro kvarh de state.energy)
  * 
  * @note Todas las unidades son del SI (V, A, W, VA, kWh)
  * @warning Los valores de pico (Vpk, Ipk) son aproximados (asumen sinusoidal)
@@ -150,11 +193,194 @@ typedef struct
     float IDC;
     float Ipk;
     float P;
+    float Q;
     float S;
     float fp;
+    float fp_disp;
+    float f;
     float E;
+    float Eq;
 } measure_t;
 
+/**
+ * @brief Registros de energía acumulada (persistidos en NVS)
+ * 
+ * E es el neto histórico (importación - exportación) que muestran el display
+ * y las comunicaciones; E_imp, E_exp y E_q sólo crecen.
+ * 
+ * @note Se guardan como un único blob con nvs_save_energy()
+ */
+typedef struct {
+    double E;       /**< Energía neta [kWh] */
+    double E_imp;   /**< Energía activa importada (P > 0) [kWh] */
+    double E_exp;   /**< Energía activa exportada (P < 0) [kWh] */
+    double E_q;     /**< Energía reactiva |Q|·Δt [kvarh] */
+} energy_regs_t;
+
+/**
+ * @brief Calibración vigente de la cadena de medición
+ * 
+ * Reemplaza en tiempo de ejecución a las constantes de measure_calibration,
+ * que quedan como valores de fábrica (measure_cal_default()). Se carga desde
+ * NVS al arrancar y la ajusta el motor de calibración (calibration.h).
+ * 
+ * @note Se aplica sólo en el cierre (measure_get_results() y
+ *       harmonics_compute()), nunca por muestra
+ */
+typedef struct {
+    float v_gain;       /**< Ganancia del atenuador de tensión [V/V] (con signo) */
+    float i_sens;       /**< Sensibilidad del sensor de corriente [V/A] */
+    float v_noise;      /**< Umbral de ruido de tensión [V] */
+    float i_noise;      /**< Umbral de ruido de corriente [A] */
+    float i_offset;     /**< Piso de Irms sin carga que se resta al resultado [A] */
+} measure_cal_t;
+
+/**
+ * @brief Magnitudes crudas de un acumulador, a la salida del ADC
+ * 
+ * Entrada del motor de calibración: no dependen de measure_cal_t.
+ */
+typedef struct {
+    float v_dc_mv;      /**< DC de tensión [mV] */
+    float i_dc_mv;      /**< DC de corriente [mV] */
+    float v_rms_mv;     /**< RMS de tensión sin DC [mV] */
+    float i_rms_mv;     /**< RMS de corriente sin DC [mV] */
+} measure_raw_t;
+
+#if MEASURE_FIXED_POINT
+/** @brief Tipo de las sumas lineales (Σv, Σi) del acumulador */
+typedef int32_t measure_sum_t;
+/** @brief Tipo de las sumas cuadráticas (Σv², Σi², Σvi) del acumulador */
+typedef int64_t measure_sum2_t;
+#else
+typedef double measure_sum_t;
+typedef double measure_sum2_t;
+#endif
+
+/**
+ * @brief Acumulador de una ventana de medición (sumas corridas)
+ * 
+ * Reemplaza a los buffers de muestras de la ventana: cada par (V,I) se
+ * incorpora en tiempo constante y al cierre se derivan todas las magnitudes
+ * con measure_get_results().
+ * 
+ * Se usa tanto para un ciclo de red como para una ventana completa: la
+ * ventana se obtiene combinando los acumuladores de sus ciclos.
+ * 
+ * Unidades: sumas en mV, mV² y mV·mV sobre las muestras crudas (con DC).
+ * 
+ * Con MEASURE_FIXED_POINT las sumas son enteras: |v| < 4096 mV, por lo que
+ * Σv entra en int32 hasta ~500k pares y Σv² en int64 sin riesgo de overflow.
+ * Las constantes de calibración se aplican una sola vez en el cierre.
+ * 
+ * @note Tamaño fijo independiente de la cantidad de muestras
+ */
+typedef struct {
+    uint32_t n;             /**< Pares acumulados */
+    measure_sum_t sum_v;    /**< Σv [mV] */
+    measure_sum_t sum_i;    /**< Σi [mV] */
+    measure_sum2_t sum_v2;  /**< Σv² [mV²] */
+    measure_sum2_t sum_i2;  /**< Σi² [mV²] */
+    measure_sum2_t sum_vi;  /**< Σv·i [mV²] */
+    measure_sum2_t sum_q;   /**< Σ(v[n-1]·i[n] - v[n]·i[n-1]) [mV²] */
+    int16_t v_max;          /**< Máximo de v en la ventana [mV] */
+    int16_t v_min;          /**< Mínimo de v en la ventana [mV] */
+    int16_t i_max;          /**< Máximo de i en la ventana [mV] */
+    int16_t i_min;          /**< Mínimo de i en la ventana [mV] */
+    int16_t v_first;        /**< Primera muestra de v (une acumuladores en sum_q) [mV] */
+    int16_t i_first;        /**< Primera muestra de i [mV] */
+    int16_t v_last;         /**< Última muestra de v [mV] */
+    int16_t i_last;         /**< Última muestra de i [mV] */
+    uint16_t zc_periods;    /**< Períodos completos medidos entre cruces interpolados */
+    float zc_span;          /**< Duración de esos períodos [pares, fraccionario] */
+} measure_accum_t;
+
+/**
+ * @defgroup measure_events Eventos devueltos por measure_add_sample()
+ * @{
+ */
+
+/** @brief Ningún ciclo ni ventana cerrados */
+#define MEASURE_EVT_NONE    0x00
+
+/** @brief Se cerró un ciclo de red: resultado en measure_stream_t::last_cycle */
+#define MEASURE_EVT_CYCLE   0x01
+
+/** @brief Se cerró una ventana: resultado en measure_stream_t::last_window */
+#define MEASURE_EVT_WINDOW  0x02
+
+/** @} */ // end of measure_events
+
+/**
+ * @brief Slots del patrón de un par auxiliar (tensión, corriente)
+ */
+typedef struct {
+    uint8_t v_slot;     /**< Slot de tensión */
+    uint8_t i_slot;     /**< Slot de corriente (posterior a v_slot) */
+} measure_pair_slots_t;
+
+/**
+ * @brief Pares auxiliares que siguen los cierres del flujo principal
+ * 
+ * Cada par (tensión, corriente) tiene sus propios acumuladores de ciclo y
+ * ventana, que se cierran en la misma muestra que los del par principal y
+ * heredan su período medido (zc_periods, zc_span): measure_get_results()
+ * da la frecuencia y Q de la red aunque el par no tenga cruces propios.
+ * 
+ * @note Pertenece al mismo productor que el flujo (task_adc_acquisition)
+ */
+typedef struct {
+    uint8_t n;                                      /**< Pares en uso (hasta MEASURE_AUX_MAX) */
+    measure_pair_slots_t slots[MEASURE_AUX_MAX];    /**< Slots de cada par */
+    int32_t skew_q15[MEASURE_AUX_MAX];              /**< Retardo de I respecto de V, en Q15 de par */
+    int16_t skew_v[MEASURE_AUX_MAX];                /**< V guardada para la compensación de desfasaje [mV] */
+    int16_t skew_i[MEASURE_AUX_MAX];                /**< I guardada para la compensación de desfasaje [mV] */
+    measure_accum_t cycle[MEASURE_AUX_MAX];         /**< Ciclo en curso de cada par */
+    measure_accum_t window[MEASURE_AUX_MAX];        /**< Ventana en curso de cada par */
+    measure_accum_t last_window[MEASURE_AUX_MAX];   /**< Última ventana cerrada (válida tras MEASURE_EVT_WINDOW) */
+} measure_aux_t;
+
+/**
+ * @brief Estado del flujo de medición con ventanas alineadas a cruces por cero
+ * 
+ * Las muestras se acumulan en el ciclo en curso. Un detector de cruce por
+ * cero ascendente sobre el canal de tensión (con histéresis MEASURE_ZC_HYST_MV
+ * alrededor de la DC de la ventana anterior) cierra cada ciclo; el ciclo se
+ * combina en tiempo constante con la ventana en curso, que se cierra al
+ * completar NUM_CYCLES_ACCUM ciclos enteros. Así la ventana nunca contiene
+ * ciclos parciales aunque la frecuencia de red se desvíe de FUND_FREQ_HZ.
+ * 
+ * Cada cruce se interpola linealmente entre la muestra anterior y la actual,
+ * y la distancia entre cruces consecutivos mide el período del ciclo. Al
+ * cerrar cada ventana el período medido (acotado a MEASURE_FREQ_MIN_HZ..
+ * MEASURE_FREQ_MAX_HZ) recalcula los límites min_pairs y max_pairs.
+ * 
+ * Sin tensión (o sin cruces válidos) los ciclos se cierran por longitud
+ * máxima max_pairs, lo que mantiene el flujo de resultados.
+ * 
+ * @note Pertenece a un único productor (task_adc_acquisition)
+ */
+typedef struct {
+    measure_accum_t cycle;          /**< Ciclo en curso */
+    measure_accum_t window;         /**< Ciclos completos de la ventana en curso */
+    measure_accum_t last_cycle;     /**< Último ciclo cerrado (válido tras MEASURE_EVT_CYCLE) */
+    measure_accum_t last_window;    /**< Última ventana cerrada (válida tras MEASURE_EVT_WINDOW) */
+    uint16_t window_cycles;         /**< Ciclos combinados en la ventana en curso */
+    int16_t zc_level;               /**< Nivel de cruce: DC de tensión de la última ventana [mV] */
+    bool zc_armed;                  /**< La tensión bajó de zc_level - histéresis desde el último cruce */
+    bool zc_valid;                  /**< zc_idx/zc_frac corresponden al cruce que abrió el ciclo en curso */
+    int16_t v_prev;                 /**< Muestra de tensión anterior (interpolación del cruce) [mV] */
+    uint32_t sample_idx;            /**< Contador de pares (sólo se usan diferencias) */
+    uint32_t zc_idx;                /**< Par en el que se detectó el último cruce */
+    float zc_frac;                  /**< Posición del último cruce dentro del par anterior [0..1] */
+    uint16_t min_pairs;             /**< Largo mínimo de ciclo vigente [pares] */
+    uint16_t max_pairs;             /**< Largo máximo de ciclo vigente [pares] */
+    bool skew_primed;               /**< Hay un par guardado para la compensación de desfasaje */
+    int16_t skew_v;                 /**< V del par guardado [mV] */
+    int16_t skew_i;                 /**< I del par guardado [mV] */
+    measure_aux_t *aux;             /**< Pares auxiliares (NULL si no hay) */
+} measure_stream_t;
+
 /* ========================================================================== */
 /*                      FUNCIONES PÚBLICAS                                    */
 /* ========================================================================== */
@@ -165,43 +391,138 @@ typedef struct
  */
 
 /**
- * @brief Agrega un par sincronizado (tensión, corriente) al buffer de muestras
+ * @brief Reinicia un acumulador para comenzar un ciclo o ventana nuevos
+ * 
+ * @param[out] acc Acumulador a reiniciar
+ */
+void measure_accum_reset(measure_accum_t *acc);
+
+/**
+ * @brief Inicializa el flujo de medición
+ * 
+ * @param[out] st Estado del flujo a inicializar
+ * 
+ * @note El detector de cruces se habilita al cerrarse la primera ventana
+ *       (hasta entonces no se conoce la DC de tensión)
+ */
+void measure_stream_init(measure_stream_t *st);
+
+/**
+ * @brief Inicializa pares auxiliares y los asocia al flujo
+ * 
+ * @param st Flujo ya inicializado con measure_stream_init()
+ * @param aux Pares auxiliares a inicializar
+ * @param slots Slots de cada par (MEASURE_AUX_SLOTS)
+ * @param n Pares (hasta MEASURE_AUX_MAX)
  * 
- * Acumula muestras ADC calibradas hasta completar NUM_SAMPLES_ACCUM pares.
- * Cuando se completa una ventana, dispara el cálculo de
- * todas las magnitudes eléctricas.
+ * @note Los pares se alimentan con measure_add_set()
+ */
+void measure_aux_init(measure_stream_t *st, measure_aux_t *aux, const measure_pair_slots_t *slots, uint8_t n);
+
+/**
+ * @brief Agrega un par sincronizado (tensión, corriente) al flujo de medición
  * 
+ * Actualiza las sumas corridas del ciclo en curso y detecta cruces por cero
+ * de tensión. Al cerrarse un ciclo lo copia a st->last_cycle y lo combina
+ * con la ventana; al completarse NUM_CYCLES_ACCUM ciclos copia la ventana a
+ * st->last_window y comienza una nueva.
+ * 
+ * @param st Estado del flujo
  * @param v_mv Muestra de tensión calibrada en milivoltios [mV]
  * @param i_mv Muestra de corriente calibrada en milivoltios [mV]
  * 
- * @return true si se completó una ventana (resultados listos), false en caso contrario
+ * @return Máscara de MEASURE_EVT_* con los cierres ocurridos en esta muestra
  * 
- * @note Thread-safe si se llama desde una única tarea (típicamente task_adc_acquisition)
+ * @note Costo constante por muestra; el cierre de ciclo agrega una
+ *       combinación de acumuladores (~10 sumas) cada ~20 ms
  * @note Las muestras deben estar pre-calibradas (offset y ganancia aplicados)
  * @note Frecuencia de llamada típica: 20 kHz (cada 50 μs)
+ * @note Con MEASURE_SKEW_COMP el par se procesa en la llamada siguiente
+ *       (V interpolado con la muestra posterior): la primera llamada no acumula
  * 
- * @warning No verificar NULL en v_mv/i_mv por razones de performance
+ * @warning No verifica NULL en st por razones de performance
  * @warning Si no se llama con frecuencia constante, el cálculo de energía será inexacto
  * 
- * @see measure_get_results() para obtener los cálculos realizados
+ * @see measure_get_results() para obtener los cálculos de un ciclo o ventana
+ */
+uint8_t measure_add_sample(measure_stream_t *st, int16_t v_mv, int16_t i_mv);
+
+/**
+ * @brief Agrega un set completo del patrón (par principal y pares auxiliares)
+ * 
+ * Igual que measure_add_sample() con ch[0][p], ch[1][p] como par principal;
+ * además acumula cada par auxiliar de st->aux desde sus slots. Los pares
+ * auxiliares se cierran junto con el principal y, con MEASURE_SKEW_COMP, se
+ * compensan por su propia distancia entre slots.
+ * 
+ * @param st Estado del flujo (con st->aux asociado por measure_aux_init())
+ * @param ch Un arreglo por slot del patrón [mV] (salida de adc_frame_demux())
+ * @param p Índice del set dentro de los arreglos
+ * 
+ * @return Máscara de MEASURE_EVT_* con los cierres ocurridos en este set
  */
-bool measure_add_sample(int16_t v_mv, int16_t i_mv);
+uint8_t measure_add_set(measure_stream_t *st, int16_t *const ch[], size_t p);
 
 /**
- * @brief Obtiene los resultados de la última ventana de medición completa
+ * @brief Calcula las magnitudes eléctricas de un ciclo o ventana completos
  * 
- * Copia la estructura measure_t calculada por la última invocación exitosa
- * de measure_add_sample() que retornó true.
+ * Remueve la componente DC a partir de las sumas, aplica la calibración
+ * vigente (measure_set_cal()) una única vez y filtra el ruido de fondo.
  * 
+ * @param acc Acumulador con el ciclo o la ventana completos
  * @param[out] out Puntero a estructura donde copiar los resultados
+ *                 (E corresponde a la duración de lo acumulado)
+ * 
+ * @note Costo constante (no depende de la cantidad de muestras)
+ * @note Si acc->n == 0 devuelve todas las magnitudes en cero
+ * @note Puede ejecutarse en otra tarea mientras se llena otro acumulador
+ */
+void measure_get_results(const measure_accum_t *acc, measure_t *out);
+
+/**
+ * @brief Combina los resultados de las fases en totales trifásicos
+ * 
+ * P, Q, S, E y Eq se suman; Vrms e Irms se promedian; Vpk e Ipk toman el
+ * máximo; fp y fp_disp se recalculan sobre los totales. f, VDC e IDC son los
+ * de la primera fase.
+ * 
+ * @param phases Resultados de cada fase (la primera es la del par principal)
+ * @param n Fases
+ * @param[out] out Totales
+ */
+void measure_total(const measure_t *phases, uint8_t n, measure_t *out);
+
+/**
+ * @brief Calcula las magnitudes crudas (sin calibración) de un acumulador
  * 
- * @note No requiere thread-safety si se llama desde la misma tarea que measure_add_sample()
- * @note Resultados disponibles cada ~200ms (10 ciclos @ 50Hz)
+ * @param acc Acumulador con el ciclo o la ventana completos
+ * @param[out] out Valores en mV a la entrada del ADC (cero si acc->n == 0)
+ */
+void measure_get_raw(const measure_accum_t *acc, measure_raw_t *out);
+
+/**
+ * @brief Carga en cal los valores de fábrica de measure_calibration
  * 
- * @warning Los resultados no cambian hasta el próximo retorno true de measure_add_sample()
+ * @param[out] cal Calibración a completar
+ */
+void measure_cal_default(measure_cal_t *cal);
+
+/**
+ * @brief Reemplaza la calibración vigente
+ * 
+ * @param cal Calibración nueva
+ * 
+ * @note Llamar desde la tarea que ejecuta measure_get_results() (task_measure_compute)
+ *       o antes de crearla; no hay exclusión mutua
+ */
+void measure_set_cal(const measure_cal_t *cal);
+
+/**
+ * @brief Copia la calibración vigente
  * 
+ * @param[out] cal Destino
  */
-void measure_get_results(measure_t *out);
+void measure_get_cal(measure_cal_t *cal);
 
 /**
  * @brief Imprime resultados de medición en consola serial (debug)
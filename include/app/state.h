@@ -4,20 +4,48 @@
  * 
  * Este módulo guarda el estado del sistema, consolidando tres categorías de información:
  * 
- * 1. **Mediciones eléctricas**: Tensión, corriente, potencia, factor de potencia, energía
+ * 1. **Mediciones eléctricas**: Tensión, corriente, potencias P/Q/S, factores de potencia,
+ *    registros de energía importada, exportada y reactiva
  * 2. **Estados de salida**: Estado ON/OFF de cada carga
  * 3. **Fallas activas**: Indicadores de protecciones disparadas
  * 
  * ## Características principales
  * 
- * ### Thread-Safety
- * Todos los accesos están protegidos por un mutex interno (state_mutex), permitiendo
- * que múltiples tareas (control, comunicación, display) accedan concurrentemente sin
- * race conditions.
+ * ### Thread-Safety (seqlock)
+ * Las escrituras se serializan con una sección crítica corta (state_lock) y
+ * avanzan un contador de secuencia: impar mientras escriben, par al publicar.
+ * state_get() no toma ningún lock: copia la estructura y reintenta si el
+ * contador era impar o cambió durante la copia. Así los lectores (control
+ * cada 10 ms, UART, display, IoT) nunca bloquean a la adquisición y un
+ * lector lento nunca demora a un escritor.
+ * 
+ * Como la sección crítica no se puede interrumpir, un lector sólo reintenta
+ * ante un escritor del otro núcleo, y por microsegundos: dentro de las
+ * escrituras no se bloquea, no se loguea ni se accede a NVS.
  * 
  * ### Persistencia automática de energía
- * La energía acumulada se guarda automáticamente en NVS flash cada 1 kWh
- * (SAVE_ENERGY_THS_KWH) para sobrevivir a pérdidas de alimentación.
+ * Los registros de energía (energy_regs_t) se guardan automáticamente cada
+ * vez que avanzan en conjunto ENERGY_LOG_STEP_KWH (10 Wh) en el diario de la
+ * partición "energylog" (energy_log.h), o 1 kWh (SAVE_ENERGY_THS_KWH) en NVS
+ * si la partición no existe, para sobrevivir a pérdidas de alimentación. La
+ * escritura la hace task_persist (persist_energy()): la tarea de cálculo
+ * nunca espera a la flash.
+ * 
+ * ### Energía por carga
+ * En cada cierre de ventana la energía importada se atribuye a las cargas
+ * (load_energy_t): con corriente por salida (MEASURE_TOPO_PER_LOAD) cada
+ * carga suma la suya; si no, se reparte según la línea de tiempo de
+ * encendido que llega por state_update_outputs(). Se guarda en NVS con el
+ * mismo disparo que los registros totales.
+ * 
+ * ### Generaciones y avisos de cambio
+ * Cada dominio (mediciones, salidas, fallas) tiene un contador de generación
+ * en state_t::gen que avanza con cada cambio publicado. Las tareas
+ * consumidoras se suscriben con state_subscribe() y se bloquean en
+ * state_wait() hasta que cambia un dominio que les interesa, en lugar de
+ * sondear el estado con un período fijo: las salidas y fallas sólo avisan
+ * cuando cambian de verdad (control las reescribe cada 10 ms) y las
+ * mediciones una vez por ventana.
  * 
  * ### Change detection
  * Sistema opcional para detectar cambios significativos en el estado.
@@ -33,9 +61,27 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "app/measure.h"
+#include "app/harmonics.h"
+#include "hal/adc_dma.h"
 #include "core/nvs_config.h"
 #include "esp_log.h"
 
+/**
+ * @defgroup state_events Dominios y avisos de cambio
+ * @{
+ */
+
+#define STATE_EV_MEASURE    (1u << 0)   /**< Nueva ventana: measure, aux, total, energía, harm, dma */
+#define STATE_EV_OUTPUTS    (1u << 1)   /**< Cambió el estado de alguna salida */
+#define STATE_EV_FAILS      (1u << 2)   /**< Cambió alguna falla */
+#define STATE_EV_WAKE       (1u << 3)   /**< Aviso externo al suscriptor (state_wake()) */
+#define STATE_EV_ALL        (STATE_EV_MEASURE | STATE_EV_OUTPUTS | STATE_EV_FAILS | STATE_EV_WAKE)
+
+/** @brief Máximo de suscriptores (uart_tx, display, iot_tx y uno libre) */
+#define STATE_MAX_SUBS 4
+
+/** @} */ // end of state_events
+
 /* ========================================================================== */
 /*                      ESTRUCTURAS DE DATOS                                  */
 /* ========================================================================== */
@@ -52,17 +98,44 @@ typedef struct{
     bool FAIL_I_NR;
 }fail_t;
 
+/**
+ * @brief Generación de cada dominio del estado
+ * 
+ * Avanza con cada cambio publicado: dos copias con la misma generación
+ * tienen el mismo contenido en ese dominio.
+ */
+typedef struct {
+    uint32_t measure;           /**< Ventanas publicadas (y reseteos de energía) */
+    uint32_t outputs;           /**< Cambios de output[] */
+    uint32_t fails;             /**< Cambios de fails */
+} state_gen_t;
+
+/** @brief Suscripción a los avisos de cambio (-1: no hay lugar, state_wait() sondea) */
+typedef int8_t state_sub_t;
+
 /**
  * @brief Estado completo del sistema en un instante dado
  * 
  * Todas las lecturas mediante state_get() obtienen una copia consistente
- * de esta estructura protegida por mutex.
+ * de esta estructura (ver seqlock arriba).
  *
  */
 typedef struct {
-    measure_t measure;
+    measure_t measure;          /**< Resultados de la última ventana (E acumulada) */
+    measure_t cycle;            /**< Resultados del último ciclo de red (E del ciclo) */
+    harmonics_t harm;           /**< Último análisis armónico (en cero si MEASURE_HARMONICS_ENABLE = 0) */
+    energy_regs_t energy;       /**< Registros de energía acumulada (measure.E y measure.Eq los reflejan) */
+    load_energy_t load_energy;  /**< Energía importada atribuida a cada carga */
+    adc_dma_stats_t dma;        /**< Telemetría del DMA del ADC (copiada una vez por ventana) */
+#if MEASURE_AUX_PAIRS > 0
+    measure_t aux[MEASURE_AUX_PAIRS];   /**< Pares auxiliares: corriente de cada salida o fases B y C (E de la ventana) */
+#endif
+#if MEASURE_TOPOLOGY == MEASURE_TOPO_THREE_PHASE
+    measure_t total;            /**< Totales trifásicos (E acumulada, igual a measure.E) */
+#endif
     bool output[NUM_LOADS]; 
     fail_t fails;
+    state_gen_t gen;            /**< Generación de cada dominio en esta copia */
 } state_t;
 
 /**
@@ -106,7 +179,7 @@ typedef struct {
  * @brief Inicializa el módulo de gestión de estado
  * 
  * Operaciones realizadas:
- * - Crea el mutex de protección concurrente (state_mutex)
+ * - Reinicia el contador de secuencia del seqlock
  * - Inicializa todas las estructuras a cero
  * - Carga energía acumulada desde NVS flash (si existe)
  * - Inicializa el sistema de guardado automático
@@ -128,27 +201,95 @@ void state_init();
 /**
  * @brief Actualiza las mediciones eléctricas en el estado global
  * 
- * Copia las nuevas mediciones (V, I, P, S, fp) y acumula la energía (E).
- * Si la energía acumulada supera el umbral SAVE_ENERGY_THS_KWH (típicamente 1 kWh),
- * guarda automáticamente en NVS flash.
+ * Copia las nuevas mediciones (V, I, P, Q, S, fp, fp_disp, f) y acumula la
+ * energía: E en el neto y en importada o exportada según el signo de P, y Eq
+ * en el registro reactivo. Si los registros avanzaron en conjunto más que
+ * ENERGY_LOG_STEP_KWH (SAVE_ENERGY_THS_KWH sin diario), pide guardarlos
+ * junto con la energía por carga.
+ * 
+ * Sin pares auxiliares también atribuye la energía importada de la ventana
+ * a las cargas, en proporción al tiempo encendida de cada una desde el
+ * cierre anterior.
  * 
  * @param m Puntero a estructura con las nuevas mediciones
  * 
- * @note Thread-safe - protegido por mutex interno
+ * @note Thread-safe - escritura serializada por el seqlock
  * @note La energía se ACUMULA (no se sobrescribe): E_total += m->E
  * @note El guardado automático previene pérdida de datos por cortes de energía
  * 
+ * @note Sin pares auxiliares cierra la ventana: avanza gen.measure y avisa
+ *       STATE_EV_MEASURE (con pares lo hace state_update_aux())
+ * 
  * @warning Esta función se llama muy frecuentemente desde task_adc_acquisition()
  */
 void state_update_measure(const measure_t *m);
 
+/**
+ * @brief Actualiza las mediciones del último ciclo de red en el estado global
+ * 
+ * Copia los resultados de un ciclo (~20 ms @ 50Hz) para que el control de
+ * protecciones reaccione con un ciclo de demora en lugar de una ventana.
+ * 
+ * @param m Puntero a estructura con las mediciones del ciclo
+ * 
+ * @note Thread-safe - escritura serializada por el seqlock
+ * @note No acumula energía: la energía se acumula sólo por ventana en state_update_measure()
+ */
+void state_update_cycle(const measure_t *m);
+
+/**
+ * @brief Actualiza el último análisis armónico en el estado global
+ * 
+ * @param h Puntero a estructura con THD y armónicos de tensión y corriente
+ * 
+ * @note Thread-safe - escritura serializada por el seqlock
+ * @note Se llama desde task_measure_compute una vez por ventana
+ */
+void state_update_harmonics(const harmonics_t *h);
+
+#if MEASURE_AUX_PAIRS > 0
+/**
+ * @brief Actualiza los resultados de los pares auxiliares en el estado global
+ * 
+ * Con MEASURE_TOPO_PER_LOAD aux[k] es la corriente (y potencia) de la salida
+ * k: son ramas del total, por lo que no suman a los registros totales pero
+ * sí a la energía de la carga k (el resto de la ventana va a E_other). Con
+ * MEASURE_TOPO_THREE_PHASE son las fases B y C: su energía se acumula en los
+ * registros (que pasan a ser los de las tres fases), se recalculan los
+ * totales de state_t::total y la energía de las tres fases se atribuye a las
+ * cargas según la línea de tiempo.
+ * 
+ * @param aux MEASURE_AUX_PAIRS resultados de la misma ventana que la última
+ *            state_update_measure()
+ * 
+ * @note Thread-safe - escritura serializada por el seqlock
+ * @note Se llama desde task_measure_compute después de state_update_measure()
+ * @note Cierra la ventana: avanza gen.measure y avisa STATE_EV_MEASURE
+ */
+void state_update_aux(const measure_t *aux);
+#endif
+
+/**
+ * @brief Actualiza la telemetría del DMA del ADC en el estado global
+ * 
+ * @param d Contadores de desbordes, frames y tiempos entre lecturas
+ * 
+ * @note Thread-safe - escritura serializada por el seqlock
+ * @note Se llama desde task_measure_compute una vez por ventana
+ */
+void state_update_dma(const adc_dma_stats_t *d);
+
 /**
  * @brief Actualiza el estado de las cargas en el estado global
  * 
+ * Cierra el tramo de la línea de tiempo de encendido con el estado anterior
+ * (atribución de energía sin corriente por salida).
+ * 
  * @param out Array de NUM_LOADS booleanos con el estado de cada carga
  * 
- * @note Thread-safe - protegido por mutex interno
- * @note Se llama desde task_control() cada TASK_PERIOD_CONTROL_MS (típicamente 10ms)
+ * @note Thread-safe - escritura serializada por el seqlock
+ * @note Se llama desde task_control() cada TASK_PERIOD_CONTROL_MS (típicamente 10ms):
+ *       gen.outputs avanza y se avisa STATE_EV_OUTPUTS sólo si algo cambió
  * @warning El array debe tener exactamente NUM_LOADS elementos
  */
 void state_update_outputs(const bool *out);
@@ -158,8 +299,9 @@ void state_update_outputs(const bool *out);
  * 
  * @param fails Puntero a estructura con los nuevos estados de falla
  * 
- * @note Thread-safe - protegido por mutex interno
- * @note Se llama desde task_control() cada vez que cambia alguna FSM
+ * @note Thread-safe - escritura serializada por el seqlock
+ * @note Se llama desde task_control() cada vez que cambia alguna FSM:
+ *       gen.fails avanza y se avisa STATE_EV_FAILS sólo si algo cambió
  */
 void state_update_fails(const fail_t *fails); 
 
@@ -173,19 +315,66 @@ void state_update_fails(const fail_t *fails);
 /**
  * @brief Obtiene una imagen instantánea del estado del sistema
  * 
- * Copia toda la estructura state_t de forma protegida por mutex.
- * Garantiza consistencia: no es posible leer mediciones nuevas con estados
- * de carga antiguos.
+ * Copia toda la estructura state_t sin bloquear, reintentando si una
+ * escritura se cruzó con la copia. Garantiza consistencia: no es posible
+ * leer una actualización a medias.
  * 
  * @param[out] out Puntero a estructura donde copiar el estado actual
  * 
- * @note Thread-safe - múltiples tareas pueden llamar simultáneamente
+ * @note Thread-safe y sin lock - múltiples tareas pueden llamar simultáneamente
  * 
  */
 void state_get(state_t *out);
 
 /** @} */ // end of state_read
 
+/**
+ * @defgroup state_notify Avisos de cambio
+ * @{
+ */
+
+/**
+ * @brief Suscribe a la tarea llamante a los avisos de uno o más dominios
+ * 
+ * @param mask Combinación de STATE_EV_MEASURE, STATE_EV_OUTPUTS y STATE_EV_FAILS
+ *             (STATE_EV_WAKE se agrega siempre)
+ * 
+ * @return Suscripción para state_wait() y state_wake(), o -1 si se agotaron
+ *         los STATE_MAX_SUBS lugares (state_wait() degrada a un sondeo)
+ * 
+ * @note Llamar una vez, al comenzar la tarea y antes de su lazo
+ */
+state_sub_t state_subscribe(uint32_t mask);
+
+/**
+ * @brief Bloquea hasta un aviso de la suscripción o hasta timeout_ms
+ * 
+ * @param sub Suscripción devuelta por state_subscribe()
+ * @param timeout_ms Espera máxima [ms]
+ * 
+ * @return Dominios avisados desde la última espera (se consumen), 0 si
+ *         venció el timeout, o STATE_EV_ALL si sub no es válida
+ */
+uint32_t state_wait(state_sub_t sub, uint32_t timeout_ms);
+
+/**
+ * @brief Despierta a un suscriptor con STATE_EV_WAKE
+ * 
+ * Para productores que no pasan por state: p. ej. la cola de respuestas UART.
+ * 
+ * @param sub Suscripción a despertar (se ignora si no es válida)
+ */
+void state_wake(state_sub_t sub);
+
+/**
+ * @brief Lee sólo los contadores de generación, sin copiar el estado
+ * 
+ * @param[out] out Generaciones vigentes
+ */
+void state_get_gen(state_gen_t *out);
+
+/** @} */ // end of state_notify
+
 /**
  * @defgroup state_energy Gestión de energía acumulada
  * @{
@@ -195,11 +384,11 @@ void state_get(state_t *out);
  * @brief Resetea el contador de energía acumulada a cero
  * 
  * Operaciones realizadas:
- * - Pone E = 0.0 en memoria RAM
- * - Guarda 0.0 en NVS flash inmediatamente
+ * - Pone todos los registros de energía (totales y por carga) en 0.0 en memoria RAM
+ * - Pide guardar los registros en cero (un checkpoint en cero en el diario)
  * - Resetea el umbral de guardado automático
  * 
- * @note Thread-safe - protegido por mutex interno
+ * @note Thread-safe - escritura serializada por el seqlock
  * @note Se llama típicamente desde comandos UART "ENERGY RESET" o IoT
  * 
  * @see nvs_save_energy() para persistencia en flash
@@ -207,14 +396,18 @@ void state_get(state_t *out);
 void state_reset_energy();
 
 /**
- * @brief Carga energía acumulada desde NVS flash
+ * @brief Carga energía acumulada desde el diario o NVS flash
  * 
  * Llamada automáticamente por state_init() para restaurar el valor
- * persistido en caso de reinicio.
+ * persistido en caso de reinicio. Usa el último checkpoint del diario
+ * (energy_log_latest()); con el diario vacío o sin partición lee NVS, de
+ * donde migra el valor al primer checkpoint. También fija el umbral de
+ * guardado automático según haya diario o no.
  * 
- * Si no hay valor guardado en NVS, inicializa en 0.0 sin error.
+ * Si no hay valor guardado en NVS, inicializa en 0.0 sin error. Si sólo
+ * existe la energía neta del formato anterior, nvs_load_energy() la migra.
  * 
- * @note Thread-safe - protegido por mutex interno
+ * @note Thread-safe - escritura serializada por el seqlock
  * @note Se llama una sola vez al inicio del sistema
  * 
  * @see nvs_load_energy() para lectura desde flash
@@ -237,7 +430,7 @@ void state_set_energy();
  * 
  * @param[out] detector Puntero a estructura a inicializar
  * 
- * @note No requiere mutex - es una operación local
+ * @note No requiere sincronización - es una operación local
  * @note Llamar una vez por cada instancia de change_detector_t
  * 
  */
@@ -263,7 +456,7 @@ void state_change_detector_init(change_detector_t *detector);
  * @return true si hay cambio significativo (debe actualizar), false en caso contrario
  * 
  * @note No modifica el detector - usar state_change_detector_mark_sent() después
- * @note No requiere mutex - opera sobre copias locales del estado
+ * @note No requiere sincronización - opera sobre copias locales del estado
  * 
  */
 bool state_change_detector_update(change_detector_t *detector, const state_t *s, state_ths_t *ths);
@@ -278,7 +471,7 @@ bool state_change_detector_update(change_detector_t *detector, const state_t *s,
  * @param detector Puntero a detector a actualizar
  * @param sent Puntero al estado que fue enviado
  * 
- * @note No requiere mutex - opera sobre datos locales
+ * @note No requiere sincronización - opera sobre datos locales
  * 
  */
 void state_change_detector_mark_sent(change_detector_t *detector, const state_t *sent);
@@ -0,0 +1,139 @@
+/**
+ * @file waveform.h
+ * @brief Captura de forma de onda (V,I) diezmada con disparo por falla
+ *
+ * Buffer circular de los últimos WAVE_CYCLES ciclos de red alimentado desde
+ * task_adc_acquisition. Ante un disparo (falla FAIL_I en control o comando
+ * manual) se completan WAVE_POST_PAIRS pares más y la captura se congela con
+ * el pre y post disparo, hasta que se la rearme.
+ *
+ * ## Formato
+ *
+ * Cada par (V,I) se guarda empaquetado en 3 bytes (12 bits por muestra, mV
+ * del ADC calibrado, 0..4095):
+ *
+ * ```
+ * byte 0: V[7:0]
+ * byte 1: I[3:0] << 4 | V[11:8]
+ * byte 2: I[11:4]
+ * ```
+ *
+ * waveform_read() entrega la captura congelada linealizada (el par más
+ * antiguo primero) y el disparo queda en el par waveform_info_t::trig_pair.
+ *
+ * ## Concurrencia (sin locks)
+ *
+ * - Un único productor (task_adc_acquisition) escribe el buffer y el estado
+ * - waveform_trigger() y waveform_rearm() sólo levantan pedidos que el
+ *   productor atiende en la próxima muestra
+ * - Los lectores sólo acceden al buffer en WAVE_STATE_FROZEN, cuando el
+ *   productor ya no escribe
+ *
+ * ## Costo
+ *
+ * - Memoria: WAVE_RING_BYTES (6000 B con la configuración por defecto) más
+ *   unos 20 B de estado
+ * - Por par: un contador de diezmado; cada WAVE_DECIM pares, 3 escrituras de
+ *   byte y el avance del índice. Congelada, sólo una comparación
+ *
+ * @note Se habilita con WAVE_CAPTURE_ENABLE en measure_config.h
+ *
+ * @author Tomás Vovard
+ * @date Diciembre 2025
+ */
+
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "config/measure_config.h"
+
+/** @brief Pares (V,I) guardados en el buffer circular */
+#define WAVE_PAIRS (PAIRS_PER_CYCLE / WAVE_DECIM * WAVE_CYCLES)
+
+/** @brief Pares guardados después del disparo */
+#define WAVE_POST_PAIRS (WAVE_PAIRS - WAVE_PAIRS * WAVE_PRETRIG_PCT / 100)
+
+/** @brief Bytes por par empaquetado (2 × 12 bits) */
+#define WAVE_BYTES_PER_PAIR 3
+
+/** @brief Tamaño del buffer circular [bytes] */
+#define WAVE_RING_BYTES (WAVE_PAIRS * WAVE_BYTES_PER_PAIR)
+
+/* ========================================================================== */
+/*                      ESTRUCTURAS DE DATOS                                  */
+/* ========================================================================== */
+
+/**
+ * @brief Estado de la captura
+ */
+typedef enum {
+    WAVE_STATE_ARMED = 0,   /**< Grabando, esperando disparo */
+    WAVE_STATE_TRIGGERED,   /**< Disparada, grabando el post disparo */
+    WAVE_STATE_FROZEN       /**< Captura congelada, disponible para lectura */
+} wave_state_t;
+
+/**
+ * @brief Descripción de la captura actual
+ */
+typedef struct {
+    wave_state_t state;     /**< Estado de la captura */
+    uint16_t pairs;         /**< Pares disponibles en la captura congelada */
+    uint16_t trig_pair;     /**< Índice (desde el más antiguo) del par del disparo */
+    uint32_t fs_hz;         /**< Frecuencia de muestreo de la captura [Hz] */
+    uint32_t bytes;         /**< Bytes de la captura congelada */
+    uint32_t mem_bytes;     /**< Memoria total del módulo [bytes] */
+    uint32_t triggers;      /**< Disparos atendidos desde el arranque */
+} waveform_info_t;
+
+/* ========================================================================== */
+/*                      FUNCIONES PÚBLICAS                                    */
+/* ========================================================================== */
+
+/**
+ * @brief Agrega un par (V,I) a la captura
+ *
+ * @param v_mv Muestra de tensión [mV]
+ * @param i_mv Muestra de corriente [mV]
+ *
+ * @note Sólo desde task_adc_acquisition (productor único), por cada par
+ */
+void waveform_add_sample(int16_t v_mv, int16_t i_mv);
+
+/**
+ * @brief Pide el disparo de la captura
+ *
+ * Ignorado si la captura no está armada.
+ *
+ * @note Puede llamarse desde cualquier tarea (p. ej. control_global_fsm())
+ */
+void waveform_trigger(void);
+
+/**
+ * @brief Descarta la captura congelada y vuelve a armar
+ *
+ * @note Puede llamarse desde cualquier tarea
+ */
+void waveform_rearm(void);
+
+/**
+ * @brief Describe la captura actual
+ *
+ * @param[out] out Estado, tamaño y posición del disparo
+ */
+void waveform_get_info(waveform_info_t *out);
+
+/**
+ * @brief Lee bytes de la captura congelada, linealizada desde el par más antiguo
+ *
+ * @param offset Byte inicial dentro de la captura
+ * @param[out] dst Destino
+ * @param len Bytes pedidos
+ *
+ * @return Bytes copiados; 0 si la captura no está congelada o offset llegó al final
+ */
+size_t waveform_read(uint32_t offset, uint8_t *dst, size_t len);
+
+#endif // WAVEFORM_H
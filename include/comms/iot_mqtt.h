@@ -44,6 +44,12 @@
 /** @brief Topic para suscripción de comandos remotos */
 #define MQTT_TOPIC_CMD "sm/"MQTT_DEVICE_ID"/cmd"
 
+/** @brief Topic para las respuestas de HIST_GET (páginas del historial) */
+#define MQTT_TOPIC_HIST "sm/"MQTT_DEVICE_ID"/history"
+
+/** @brief Puntos por página de HIST_GET (el host pide la siguiente con "next") */
+#define IOT_HIST_PAGE_POINTS 24
+
 /** @brief Tamaño máximo de payload JSON de comando */
 #define IOT_CMD_JSON_MAX_LEN 256
 
@@ -64,7 +70,11 @@ typedef enum {
     IOT_CMD_CFG_IMAX_SET,
     IOT_CMD_CFG_VRANGE_SET,
     IOT_CMD_CFG_AUTOREC_SET,
-    IOT_CMD_CFG_PRIORITY_SET
+    IOT_CMD_CFG_PRIORITY_SET,
+    IOT_CMD_CAL_ZERO,
+    IOT_CMD_CAL_GAIN,
+    IOT_CMD_CAL_DEFAULT,
+    IOT_CMD_HIST_GET
 } iot_cmd_type;
 
 /**
@@ -105,6 +115,18 @@ typedef struct {
             uint8_t id;
             uint8_t pr;
         } cfg_priority_set;
+
+        struct {
+            bool current;   /**< Canal de corriente (false: tensión) */
+            float ref;      /**< Referencia [V o A] (sólo CAL_GAIN) */
+        } cal;
+
+        struct {
+            uint8_t tier;   /**< hist_tier_t */
+            uint32_t from;  /**< Tiempo inicial [s] */
+            uint32_t to;    /**< Tiempo final [s] */
+            bool valid;     /**< false: from/to no son enteros en [0, UINT32_MAX] (responde HIST_INVALID) */
+        } hist_get;
         
     };
 }iot_cmd_t;
@@ -125,9 +147,9 @@ void iot_mqtt_init();
 /**
  * @brief Tarea de transmisión MQTT (publicación de telemetría y eventos)
  * 
- * Publica cada TASK_PERIOD_COMM_IOT_MS (~1 Hz):
- * - Telemetría completa en MQTT_TOPIC_TEL
- * - Eventos de cambio de fallas en MQTT_TOPIC_EVT
+ * Publica:
+ * - Telemetría completa en MQTT_TOPIC_TEL cada TASK_PERIOD_COMM_IOT_MS (~1 Hz)
+ * - Eventos de cambio de fallas en MQTT_TOPIC_EVT apenas state avisa STATE_EV_FAILS
  * 
  * @param pvParameters Parámetro estándar de FreeRTOS (no usado)
  */
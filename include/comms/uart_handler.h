@@ -63,8 +63,10 @@ void uart_logout(session_t *session);
  * 
  * Comandos soportados:
  * - PING, LOGIN, LOGOUT, USERID (sin autenticación)
- * - MEAS, MODE, LOAD, DISPMODE (viewer)
- * - ENERGY, CFG (requiere admin)
+ * - MEAS GET/AUX/TOTAL, MODE, LOAD, DISPMODE, ACQ GET/STALL, TASKS, HARM, WAVE GET/DUMP,
+ *   ADCREC GET/DUMP, DMA GET, CAL GET, HIST GET/DUMP (viewer)
+ * - ENERGY GET [id|OTHER|LOG] (viewer), ENERGY RESET, CFG, WAVE ARM/TRIG, ADCREC START/STOP/REPLAY,
+ *   DMA SET/AUTO/RESET y CAL ZERO/GAIN/DEFAULT/ABORT (requiere admin)
  * 
  * @note Verifica permisos antes de ejecutar comandos protegidos
  */
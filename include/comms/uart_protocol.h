@@ -61,6 +61,15 @@
 /** @brief Longitud máxima de respuesta */
 #define RESPONSE_MAX_LEN 256
 
+/** @brief Bytes binarios por línea de un volcado (64 caracteres base64) */
+#define UART_DUMP_CHUNK_BYTES 48
+
+/** @brief Líneas de un volcado enviadas por iteración de task_uart_tx */
+#define UART_DUMP_LINES_PER_TICK 8
+
+/** @brief Longitud máxima de la cabecera <tag>_BEGIN de un volcado */
+#define UART_DUMP_HEADER_LEN 96
+
 /* ========================================================================== */
 /*                      TIPOS DE USUARIO Y SESIÓN                             */
 /* ========================================================================== */
@@ -134,7 +143,7 @@ typedef struct {
  * @brief Enumeración de comandos reconocidos
  * 
  * Comandos agrupados por nivel de acceso:
- * - Viewer: PING, USERID, MEAS, MODE, LOAD, DISPMODE, HELP
+ * - Viewer: PING, USERID, MEAS, MODE, LOAD, DISPMODE, ACQ, TASKS, HIST, HELP
  * - Admin: LOGIN, LOGOUT, ENERGY, CFG
  */
 typedef enum {
@@ -145,9 +154,17 @@ typedef enum {
     CMD_MEAS,           /**< Obtener mediciones */
     CMD_MODE,           /**< Get/Set modo de control */
     CMD_LOAD,           /**< Get/Set estado de cargas */
-    CMD_ENERGY,         /**< Reset de energía */
+    CMD_ENERGY,         /**< Registros de energía (totales y por carga) y reset */
     CMD_CFG,            /**< Configuración del sistema */
     CMD_DISPMODE,       /**< Modo de visualización */
+    CMD_ACQ,            /**< Diagnóstico del pipeline de adquisición */
+    CMD_TASKS,          /**< Reparto de CPU por tarea y núcleo */
+    CMD_HARM,           /**< Análisis armónico (THD y armónicos) */
+    CMD_WAVE,           /**< Captura de forma de onda ante fallas */
+    CMD_ADCREC,         /**< Grabación y reproducción de frames del ADC */
+    CMD_DMA,            /**< Dimensionado y telemetría del DMA del ADC */
+    CMD_CAL,            /**< Calibración de offset, ganancia y ruido */
+    CMD_HIST,           /**< Historial de mediciones (segundos, minutos, horas) */
     CMD_HELP,           /**< Ayuda */
     CMD_UNK             /**< Comando no reconocido */
 } cmd_type_t;
@@ -190,10 +207,13 @@ void task_uart_rx(void *pvParameters);
  * - Cambios de fallas (FAIL_I, FAIL_V)
  * - Reposiciones automáticas
  * - Telemetría continua si DISP_CONT activo
+ * - Volcados binarios en base64 (uart_dump_start())
  * 
  * @param pvParameters Parámetro estándar de FreeRTOS (no usado)
  * 
- * @note Periodo de actualización: TASK_PERIOD_COMM_UART_MS (~100 ms)
+ * @note Despierta con avisos de state (fallas, salidas, ventanas), con
+ *       respuestas en cola (state_wake()) o cada STATE_WAIT_MAX_MS; con un
+ *       volcado en curso, cada TASK_PERIOD_COMM_UART_MS (~100 ms)
  */
 void task_uart_tx(void *pvParameters);
 
@@ -221,4 +241,45 @@ void uart_set_disp_mode(uart_disp_mode_t mode);
  */
 uart_disp_mode_t uart_get_disp_mode(void);
 
+/**
+ * @brief Función de lectura de un volcado
+ * 
+ * Copia hasta len bytes desde offset y retorna los bytes copiados (0 al final).
+ */
+typedef size_t (*uart_dump_read_t)(uint32_t offset, uint8_t *dst, size_t len);
+
+/**
+ * @brief Pide un volcado binario por UART
+ * 
+ * task_uart_tx envía, de a UART_DUMP_LINES_PER_TICK líneas por iteración
+ * para no demorar alertas ni telemetría:
+ * 
+ * ```
+ * <tag>_BEGIN <header>
+ * <tag> <offset> <base64 de hasta UART_DUMP_CHUNK_BYTES bytes>
+ * ...
+ * <tag>_END <bytes enviados>
+ * ```
+ * 
+ * @param tag Prefijo de las líneas (cadena constante, p. ej. "WAVE")
+ * @param read_fn Fuente de los datos
+ * @param header Texto de la línea <tag>_BEGIN (se copia)
+ * 
+ * @return false si hay otro volcado pedido o en curso (no se interrumpe)
+ * 
+ * @note Si la fuente deja de estar disponible, <tag>_END llega antes de completar
+ */
+bool uart_dump_start(const char *tag, uart_dump_read_t read_fn, const char *header);
+
+/**
+ * @brief Indica si hay un volcado pedido o en curso
+ * 
+ * Sirve para rechazar un pedido antes de reservar su fuente; el único que
+ * pide volcados es task_uart_handler, así que el resultado sigue valiendo
+ * al llamar a uart_dump_start().
+ * 
+ * @return true desde uart_dump_start() hasta enviar <tag>_END
+ */
+bool uart_dump_busy(void);
+
 #endif // UART_PROTOCOL_H
\ No newline at end of file
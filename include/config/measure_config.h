@@ -0,0 +1,261 @@
+/**
+ * @file measure_config.h
+ * @brief Parámetros de medición ADC, análisis armónico y captura de forma de onda
+ * 
+ * Separado de system_config.h (que lo incluye) porque no depende de
+ * FreeRTOS ni de ESP-IDF: measure.c, harmonics.c y waveform.c sólo incluyen
+ * este header y la biblioteca estándar de C, por lo que compilan también
+ * con un compilador nativo del host para analizar y medir el algoritmo
+ * fuera del ESP32.
+ * 
+ * @author Tomás Vovard
+ * @date Diciembre 2025
+ */
+
+#ifndef MEASURE_CONFIG_H
+#define MEASURE_CONFIG_H
+
+/* ========================================================================== */
+/*                      PARÁMETROS DE MEDICIÓN ADC                            */
+/* ========================================================================== */
+
+/**
+ * @defgroup measurement_config Configuración del sistema de medición
+ * 
+ * ## Diseño del sistema de muestreo
+ * 
+ * El sistema usa ventanas de NUM_CYCLES_ACCUM ciclos completos para calcular
+ * valores RMS estables.
+ * 
+ * @{
+ */
+
+/** @brief Frecuencia de muestreo efectiva (pares V-I por segundo que llegan a la medición) [Hz] */
+#define SAMPLE_FREQ_HZ 20000
+
+/** @brief Factor de sobremuestreo del ADC: 1 (sin sobremuestreo), 2, 4 u 8
+ *  
+ *  El ADC convierte a ADC_RAW_FREQ_HZ y la adquisición promedia cada
+ *  ADC_OVERSAMPLE pares consecutivos (boxcar, un CIC de primer orden) antes
+ *  de medir. El ruido blanco del ADC del ESP32 baja √ADC_OVERSAMPLE veces,
+ *  lo que reduce el piso de Irms sin carga (ACS712_GROUNDNOISE). Las
+ *  muestras siguen en mV enteros: el cuantizado de 1 mV (~1.2 cuentas) queda
+ *  por debajo del ruido residual.
+ *  
+ *  Costo: ADC_OVERSAMPLE veces más muestras por decodificar (~ADC_OVERSAMPLE
+ *  veces más interrupciones de frame) más una suma por muestra. La carga
+ *  resultante se informa en acq_stats_t::load_permil (comando ACQ GET).
+ */
+#define ADC_OVERSAMPLE 1
+
+/** @brief Frecuencia de conversión real del ADC (sets del patrón por segundo) [Hz] */
+#define ADC_RAW_FREQ_HZ (SAMPLE_FREQ_HZ * ADC_OVERSAMPLE)
+
+/** @brief Tamaño del frame DMA en bytes (muestras crudas, a ADC_RAW_FREQ_HZ) */
+#define FRAME_BYTES 1024
+
+/** @brief Frecuencia fundamental nominal de la red eléctrica [Hz]
+ *  
+ *  Sólo fija el arranque: la frecuencia real se mide por cruces por cero y
+ *  ajusta la longitud de ciclos y ventanas en tiempo de ejecución.
+ */
+#define FUND_FREQ_HZ 50
+
+/** @brief Frecuencia de red mínima seguida por la medición [Hz] */
+#define MEASURE_FREQ_MIN_HZ 45
+
+/** @brief Frecuencia de red máxima seguida por la medición [Hz] */
+#define MEASURE_FREQ_MAX_HZ 65
+
+/** @brief Muestras (pares V-I) por ciclo de red   - 400 muestras por ciclo*/
+#define PAIRS_PER_CYCLE (SAMPLE_FREQ_HZ / FUND_FREQ_HZ) 
+
+/** @brief Número de ciclos de red acumulados por ventana de medición */
+#define NUM_CYCLES_ACCUM 10
+
+/** @brief Histéresis del detector de cruce por cero de tensión [mV en el ADC]
+ *  
+ *  50 mV en el ADC ≈ 12 V de línea: rechaza ruido sin perder cruces a tensión nominal.
+ */
+#define MEASURE_ZC_HYST_MV 50
+
+/** @brief Mínimo de pares para aceptar un cruce como fin de ciclo - medio ciclo nominal
+ *  
+ *  Valor de arranque: al cerrar cada ventana se recalcula como medio período medido.
+ */
+#define MEASURE_MIN_CYCLE_PAIRS (PAIRS_PER_CYCLE / 2)
+
+/** @brief Máximo de pares por ciclo: sin cruces válidos el ciclo se cierra por longitud
+ *  
+ *  Valor de arranque (1.25 ciclos nominales): al cerrar cada ventana se
+ *  recalcula como 1.25 períodos medidos, de modo que sin tensión los ciclos
+ *  forzados conservan la duración de la última red vista (50 o 60 Hz).
+ */
+#define MEASURE_MAX_CYCLE_PAIRS (PAIRS_PER_CYCLE * 5 / 4)
+
+/** @brief Total nominal de pares (V,I) por ventana - 4000
+ *  
+ *  La ventana real se cierra en NUM_CYCLES_ACCUM cruces por cero, por lo que
+ *  su longitud sigue a la frecuencia de red.
+ */
+#define NUM_SAMPLES_ACCUM (PAIRS_PER_CYCLE * NUM_CYCLES_ACCUM)
+
+/** @brief Tiempo nominal de una ventana de medición [s] - 200ms */
+#define TIME_SAMPLE_S (1.0f/SAMPLE_FREQ_HZ)*NUM_SAMPLES_ACCUM
+
+/** @brief Tiempo de una ventana de medición [h] */
+#define TIME_SAMPLE_H (TIME_SAMPLE_S / 3600.0f)
+
+/** @brief Habilita el análisis armónico (1 = habilitado, 0 = deshabilitado)
+ *  
+ *  Captura el primer ciclo de cada ventana y calcula THD y armónicos en
+ *  task_measure_compute. Deshabilitado, la adquisición no copia muestras.
+ */
+#define MEASURE_HARMONICS_ENABLE 1
+
+/** @brief Cantidad de armónicos analizados (incluye la fundamental) */
+#define HARM_NUM 15
+
+/** @brief Capacidad del ciclo capturado [pares] - el ciclo más largo posible (MEASURE_FREQ_MIN_HZ) */
+#define HARM_CAPTURE_MAX_PAIRS (SAMPLE_FREQ_HZ / MEASURE_FREQ_MIN_HZ * 5 / 4 + 1)
+
+/** @brief Compensación del desfasaje entre canales (1 = habilitada, 0 = deshabilitada)
+ *  
+ *  El patrón del ADC convierte V y luego I, por lo que cada I se tomó una
+ *  conversión (medio par) después que su V: en 50 Hz son 0.45° a 20 kHz,
+ *  que sesgan P y fp con cargas inductivas. measure_add_sample() interpola
+ *  linealmente V al instante de I (una multiplicación entera por par) y
+ *  demora el par una muestra.
+ *  
+ *  Se puede fijar desde el build (-DMEASURE_SKEW_COMP=0); test/host mide el
+ *  error de fp con y sin compensación en función del ángulo.
+ */
+#ifndef MEASURE_SKEW_COMP
+#define MEASURE_SKEW_COMP 1
+#endif
+
+/** @brief Retardo entre slots consecutivos del patrón en pares efectivos, en Q15
+ *  
+ *  Una conversión cruda: 1 / (ADC_PATTERN_LEN · ADC_OVERSAMPLE) pares de
+ *  SAMPLE_FREQ_HZ (el diezmado promedia todos los canales sobre los mismos
+ *  pares y conserva el retardo). Con el patrón V, I es medio par; un par
+ *  auxiliar usa (i_slot - v_slot) veces este valor.
+ */
+#define MEASURE_SKEW_Q15 (32768 / (ADC_PATTERN_LEN * ADC_OVERSAMPLE))
+
+/** @brief Kernel de acumulación de measure.c
+ *  
+ *  - 1: Punto fijo - sumas en int32/int64 sobre las muestras en mV
+ *  - 0: Double - referencia (emulado por software en el ESP32)
+ *  
+ *  Ambos kernels dan el mismo resultado: las sumas son enteros exactos en
+ *  los dos casos. El de punto fijo evita la emulación de double por muestra
+ *  (el ESP32 sólo tiene FPU de simple precisión).
+ *  
+ *  Se puede fijar desde el build (-DMEASURE_FIXED_POINT=0); test/host compila
+ *  los dos kernels y compara resultados y costo.
+ *  
+ *  @see measure_accum_t
+ */
+#ifndef MEASURE_FIXED_POINT
+#define MEASURE_FIXED_POINT 1
+#endif
+
+/** @} */ // end of measurement_config
+
+/* ========================================================================== */
+/*                      CANALES Y TOPOLOGÍA                                   */
+/* ========================================================================== */
+
+/**
+ * @defgroup channel_config Canales del ADC y topología de medición
+ * 
+ * El patrón del ADC convierte ADC_PATTERN_LEN canales en orden fijo: cada
+ * vuelta del patrón es un "set" de muestras simultáneas (a ADC_RAW_FREQ_HZ).
+ * Los slots 0 y 1 son siempre el par principal (V, I), que define cruces por
+ * cero, ciclos y ventanas, y alimenta armónicos, forma de onda, protecciones
+ * y energía. Los pares auxiliares (tensión, corriente) se acumulan con los
+ * mismos cierres de ciclo y ventana que el principal.
+ * 
+ * | Topología                | Slots                  | Pares auxiliares        |
+ * |--------------------------|------------------------|-------------------------|
+ * | MEASURE_TOPO_SINGLE      | V, I                   | -                       |
+ * | MEASURE_TOPO_PER_LOAD    | V, I, I0, I1, I2, I3   | (V, Ik): una por salida |
+ * | MEASURE_TOPO_THREE_PHASE | Va, Ia, Vb, Ib, Vc, Ic | (Vb, Ib), (Vc, Ic)      |
+ * 
+ * Los canales físicos de cada slot se asignan en adc_dma.h
+ * (ADC_PATTERN_CHANNELS). En cada par el slot de tensión debe preceder al de
+ * corriente: la compensación de desfasaje interpola la tensión hacia adelante.
+ * 
+ * @{
+ */
+
+/** @brief Un único par V, I (hardware actual) */
+#define MEASURE_TOPO_SINGLE         0
+
+/** @brief V, I total y una corriente por cada salida */
+#define MEASURE_TOPO_PER_LOAD       1
+
+/** @brief Tres fases: el par principal es la fase A */
+#define MEASURE_TOPO_THREE_PHASE    2
+
+/** @brief Topología de medición */
+#define MEASURE_TOPOLOGY MEASURE_TOPO_SINGLE
+
+/** @brief Canales máximos del patrón (los 8 canales de ADC1) */
+#define ADC_PATTERN_MAX 8
+
+/** @brief Pares auxiliares máximos */
+#define MEASURE_AUX_MAX (ADC_PATTERN_MAX - 2)
+
+/** @brief Corrientes por salida en MEASURE_TOPO_PER_LOAD (igual a NUM_LOADS) */
+#define MEASURE_PER_LOAD_CH 4
+
+#if MEASURE_TOPOLOGY == MEASURE_TOPO_PER_LOAD
+/** @brief Canales del patrón del ADC */
+#define ADC_PATTERN_LEN (2 + MEASURE_PER_LOAD_CH)
+/** @brief Pares auxiliares de la topología */
+#define MEASURE_AUX_PAIRS MEASURE_PER_LOAD_CH
+/** @brief Slots {tensión, corriente} de cada par auxiliar (sólo con MEASURE_AUX_PAIRS > 0) */
+#define MEASURE_AUX_SLOTS { {0, 2}, {0, 3}, {0, 4}, {0, 5} }
+#elif MEASURE_TOPOLOGY == MEASURE_TOPO_THREE_PHASE
+#define ADC_PATTERN_LEN 6
+#define MEASURE_AUX_PAIRS 2
+#define MEASURE_AUX_SLOTS { {2, 3}, {4, 5} }
+#else
+#define ADC_PATTERN_LEN 2
+#define MEASURE_AUX_PAIRS 0
+#endif
+
+/** @} */ // end of channel_config
+
+/* ========================================================================== */
+/*                      CAPTURA DE FORMA DE ONDA                              */
+/* ========================================================================== */
+
+/**
+ * @defgroup waveform_config Captura de forma de onda ante fallas
+ * 
+ * Con los valores por defecto: 20 ciclos a 5 kHz (100 pares por ciclo @ 50Hz),
+ * 2000 pares × 3 bytes = 6000 bytes de RAM, mitad antes y mitad después del
+ * disparo.
+ * 
+ * @see waveform.h
+ * @{
+ */
+
+/** @brief Habilita la captura de forma de onda (1 = habilitada, 0 = deshabilitada) */
+#define WAVE_CAPTURE_ENABLE 1
+
+/** @brief Factor de diezmado: se guarda 1 de cada WAVE_DECIM pares */
+#define WAVE_DECIM 4
+
+/** @brief Ciclos de red (nominales) que abarca la captura */
+#define WAVE_CYCLES 20
+
+/** @brief Porcentaje de la captura previo al disparo */
+#define WAVE_PRETRIG_PCT 50
+
+/** @} */ // end of waveform_config
+
+#endif // MEASURE_CONFIG_H
@@ -6,9 +6,9 @@
  * 
  * ## Categorías de configuración
  * 
- * 1. **Tareas FreeRTOS**: Prioridades, stacks y períodos
+ * 1. **Tareas FreeRTOS**: Prioridades, stacks, núcleos y períodos
  * 2. **Control de cargas**: Timers de protección y recuperación
- * 3. **Medición ADC**: Frecuencias, ventanas y cálculos derivados
+ * 3. **Medición ADC**: Frecuencias, ventanas y cálculos derivados (measure_config.h)
  * 4. **Comunicaciones**: Umbrales de change detection
  * 5. **Persistencia**: Frecuencia de guardado en NVS
  * 
@@ -53,6 +53,10 @@
  * 2. **Control (5)** - Segunda prioridad
  *    - Protecciones de seguridad (sobrecorriente, tensión)
  * 
+ *    **Measure compute (5)** - Cálculo de ventanas entregadas por la adquisición
+ *    - Corre una vez por ventana (~200 ms), ejecución corta
+ *    - Debe terminar antes de que se cierre la siguiente ventana
+ * 
  * 3. **UART Communication (4)** - Tercera prioridad
  *    - Comandos de usuario/configuración
  *    - Buffer limitado (1 KB) → necesita vaciarse rápidamente
@@ -64,6 +68,10 @@
  *    - Network I/O puede tomar varios segundos
  *    - Menos crítico que interacción local (UART/Display)
  * 
+ * 6. **Persistencia NVS (1)** - La más baja
+ *    - Escribe energía y configuración en flash (decenas de ms por commit)
+ *    - Ninguna tarea de tiempo real espera a la flash
+ * 
  * @{
  */
 
@@ -73,6 +81,9 @@
 /** @brief Prioridad de tarea de control de cargas y protecciones */
 #define TASK_PRIORITY_CONTROL 5
 
+/** @brief Prioridad de tarea de cálculo de ventanas de medición */
+#define TASK_PRIORITY_MEASURE 5
+
 /** @brief Prioridad de tarea de comunicación UART */
 #define TASK_PRIORITY_COMM_UART 4
 
@@ -82,6 +93,9 @@
 /** @brief Prioridad de tarea de comunicación IoT (MQTT) */
 #define TASK_PRIORITY_DISPLAY 3 
 
+/** @brief Prioridad de tarea de escritura en NVS (la más baja de la aplicación) */
+#define TASK_PRIORITY_PERSIST 1
+
 /** @} */ // end of task_priorities
 
 /* ========================================================================== */
@@ -89,7 +103,7 @@
 /* ========================================================================== */
 
 /**
- * @defgroup task_stacks Tamaños de stack de tareas (en palabras de 4 bytes)
+ * @defgroup task_stacks Tamaños de stack de tareas [bytes]
  * 
  * ## Cálculo de stack necesario
  * 
@@ -99,26 +113,103 @@
  * - Buffers temporales (ej: strings de printf)
  * - Margen de seguridad
  * 
+ * xTaskCreatePinnedToCore() de ESP-IDF recibe el stack en bytes (no en
+ * palabras como el FreeRTOS original).
+ * 
  * @{
  */
 
-/** @brief Stack para ADC acquisition: 16 KB */
+/** @brief Stack para ADC acquisition: 4096 bytes */
 #define TASK_STACK_ADC_ACQ 4096
 
-/** @brief Stack para control: 12 KB */
+/** @brief Stack para control: 3072 bytes */
 #define TASK_STACK_CONTROL 3072 
 
-/** @brief Stack para comunicación UART: 16 KB */
+/** @brief Stack para cálculo de ventanas de medición: 3072 bytes */
+#define TASK_STACK_MEASURE 3072
+
+/** @brief Stack para comunicación UART: 4096 bytes */
 #define TASK_STACK_COMM_UART 4096
 
-/** @brief Stack para comunicación IoT: 12 KB */
+/** @brief Stack para comunicación IoT: 3072 bytes */
 #define TASK_STACK_COMM_IOT 3072
 
-/** @brief Stack para display: 12 KB */
+/** @brief Stack para display: 3072 bytes */
 #define TASK_STACK_DISPLAY 3072 
 
+/**
+ * @brief Stack para escritura en NVS y flash: 4096 bytes
+ *
+ * Encadena commits de NVS, borrado/escritura del journal de energía y
+ * history_flush(); el camino de escritura de spi_flash/NVS por sí solo
+ * consume cerca de 2 KB.
+ */
+#define TASK_STACK_PERSIST 4096
+
 /** @} */ // end of task_stacks
 
+/* ========================================================================== */
+/*                      AFINIDAD DE NÚCLEO                                    */
+/* ========================================================================== */
+
+/**
+ * @defgroup task_cores Núcleo asignado a cada tarea
+ * 
+ * Junto con TASK_PRIORITY_* y TASK_STACK_* conforman la tabla de ubicación
+ * de tareas que app_main() recorre con xTaskCreatePinnedToCore().
+ * 
+ * | Tarea          | Núcleo   | Prioridad               | Stack                 |
+ * |----------------|----------|-------------------------|-----------------------|
+ * | adc_acq        | APP (1)  | TASK_PRIORITY_ADC_ACQ   | TASK_STACK_ADC_ACQ    |
+ * | meas_compute   | APP (1)  | TASK_PRIORITY_MEASURE   | TASK_STACK_MEASURE    |
+ * | control_cargas | APP (1)  | TASK_PRIORITY_CONTROL   | TASK_STACK_CONTROL    |
+ * | uart_*         | PRO (0)  | TASK_PRIORITY_COMM_UART | TASK_STACK_COMM_UART  |
+ * | task_display   | PRO (0)  | TASK_PRIORITY_DISPLAY   | TASK_STACK_DISPLAY    |
+ * | task_iot_*     | PRO (0)  | TASK_PRIORITY_COMM_IOT  | TASK_STACK_COMM_IOT   |
+ * | persist        | PRO (0)  | TASK_PRIORITY_PERSIST   | TASK_STACK_PERSIST    |
+ * 
+ * El stack WiFi (CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_0) y el serializado
+ * cJSON quedan en el PRO_CPU, dejando el APP_CPU para el drenado del DMA a
+ * 20 kHz y el cálculo de mediciones.
+ * 
+ * Valores válidos: TASK_CORE_PRO, TASK_CORE_APP o TASK_CORE_ANY (sin afinidad).
+ * El reparto de CPU resultante se consulta con el comando UART "TASKS GET".
+ * 
+ * @{
+ */
+
+/** @brief Núcleo de protocolo (PRO_CPU) */
+#define TASK_CORE_PRO 0
+
+/** @brief Núcleo de aplicación (APP_CPU) */
+#define TASK_CORE_APP 1
+
+/** @brief Sin afinidad: el scheduler elige el núcleo */
+#define TASK_CORE_ANY tskNO_AFFINITY
+
+/** @brief Núcleo de tarea de adquisición ADC */
+#define TASK_CORE_ADC_ACQ TASK_CORE_APP
+
+/** @brief Núcleo de tarea de cálculo de ventanas de medición */
+#define TASK_CORE_MEASURE TASK_CORE_APP
+
+/** @brief Núcleo de tarea de control de cargas */
+#define TASK_CORE_CONTROL TASK_CORE_APP
+
+/** @brief Núcleo de tareas de comunicación UART */
+#define TASK_CORE_COMM_UART TASK_CORE_PRO
+
+/** @brief Núcleo de tarea de display */
+#define TASK_CORE_DISPLAY TASK_CORE_PRO
+
+/** @brief Núcleo de tareas de comunicación IoT */
+#define TASK_CORE_COMM_IOT TASK_CORE_PRO
+
+/** @brief Núcleo de tarea de escritura en NVS */
+#define TASK_CORE_PERSIST TASK_CORE_PRO
+
+/** @} */ // end of task_cores
+
 /* ========================================================================== */
 /*                      PERÍODOS DE TAREAS                                    */
 /* ========================================================================== */
@@ -126,7 +217,8 @@
 /**
  * @defgroup task_periods Períodos de ejecución de tareas periódicas
  * 
- * Define con qué frecuencia se ejecuta cada tarea (via vTaskDelay).
+ * Define con qué frecuencia se ejecuta cada tarea (via vTaskDelay), o el
+ * ritmo máximo de las que esperan avisos de state (state_wait()).
  * 
  * @note task_adc_acquisition NO tiene período - bloqueante en DMA
  * 
@@ -136,14 +228,21 @@
 /** @brief Período de tarea de control [ms] - 10ms */
 #define TASK_PERIOD_CONTROL_MS 10 
 
-/** @brief Período de tarea de comunicación UART [ms] - 100ms */
+/** @brief Período de tarea de comunicación UART mientras hay un volcado en curso [ms] - 100ms
+ *
+ *  Sin volcado task_uart_tx sólo despierta con avisos de state (fallas,
+ *  salidas, ventanas) o respuestas en cola.
+ */
 #define TASK_PERIOD_COMM_UART_MS 100
 
-/** @brief Período de tarea de comunicación IoT [ms] - 1000ms */
+/** @brief Período de telemetría IoT [ms] - 1000ms (los eventos de falla salen al aviso) */
 #define TASK_PERIOD_COMM_IOT_MS 1000
 
-/** @brief Período de tarea de display [ms] - 500ms → 2 Hz de refresco del OLED */
-#define TASK_PERIOD_DISPLAY_MS  500 
+/** @brief Espera máxima de una tarea suscripta a state sin avisos [ms]
+ *
+ *  Mantiene vivas las tareas aunque la adquisición se detenga.
+ */
+#define STATE_WAIT_MAX_MS 1000
 
 /** @} */ // end of task_periods
 
@@ -247,42 +346,9 @@
 /*                      PARÁMETROS DE MEDICIÓN ADC                            */
 /* ========================================================================== */
 
-/**
- * @defgroup measurement_config Configuración del sistema de medición
- * 
- * ## Diseño del sistema de muestreo
- * 
- * El sistema usa ventanas de NUM_CYCLES_ACCUM ciclos completos para calcular
- * valores RMS estables.
- * 
- * @{
- */
-
-/** @brief Frecuencia de muestreo ADC [Hz] */
-#define SAMPLE_FREQ_HZ 20000
-
-/** @brief Tamaño del frame DMA en bytes */
-#define FRAME_BYTES 1024
-
-/** @brief Frecuencia fundamental de la red eléctrica [Hz] */
-#define FUND_FREQ_HZ 50
-
-/** @brief Muestras (pares V-I) por ciclo de red   - 400 muestras por ciclo*/
-#define PAIRS_PER_CYCLE (SAMPLE_FREQ_HZ / FUND_FREQ_HZ) 
-
-/** @brief Número de ciclos de red acumulados por ventana de medición */
-#define NUM_CYCLES_ACCUM 10
-
-/** @brief Total de pares (V,I) acumulados por ventana - 4000*/
-#define NUM_SAMPLES_ACCUM (PAIRS_PER_CYCLE * NUM_CYCLES_ACCUM)
-
-/** @brief Tiempo de una ventana de medición [s] - 200ms */
-#define TIME_SAMPLE_S (1.0f/SAMPLE_FREQ_HZ)*NUM_SAMPLES_ACCUM
-
-/** @brief Tiempo de una ventana de medición [h] */
-#define TIME_SAMPLE_H (TIME_SAMPLE_S / 3600.0f)
-
-/** @} */ // end of measurement_config
+/* Medición y captura de forma de onda: en un header propio sin dependencias
+   de FreeRTOS/ESP-IDF para que el núcleo de medición compile fuera del target */
+#include "config/measure_config.h"
 
 /* ========================================================================== */
 /*                      UMBRALES DE COMUNICACIÓN                              */
@@ -323,10 +389,22 @@
 /** @brief Incremento de energía que dispara guardado automático [kWh]
  *  
  *  @see state_update_measure() para implementación de guardado automático
+ *  @see persist_energy() para la escritura asíncrona
  *  
  */
 #define SAVE_ENERGY_THS_KWH 1
 
+/** @brief Incremento de energía entre checkpoints del diario [kWh]
+ *
+ *  Reemplaza a SAVE_ENERGY_THS_KWH cuando existe la partición "energylog":
+ *  es lo máximo que se pierde ante un corte de alimentación. Con 10 Wh y
+ *  816 lugares en 64 KB, cada sector se borra una vez cada 8,16 kWh de
+ *  avance conjunto.
+ *
+ *  @see energy_log.h
+ */
+#define ENERGY_LOG_STEP_KWH 0.01
+
 /** @} */ // end of storage_thresholds
 
 #endif // SYSTEM_CONFIG_H
\ No newline at end of file
@@ -0,0 +1,151 @@
+/**
+ * @file energy_log.h
+ * @brief Diario de energía en una partición propia: registros anexados con nivelación de desgaste
+ *
+ * Reemplaza al blob "energy_regs" de NVS como punto de guardado de la
+ * energía. Con NVS cada guardado reescribe el mismo blob, por lo que el
+ * umbral debía ser alto (SAVE_ENERGY_THS_KWH = 1 kWh perdible ante un corte).
+ * El diario sólo anexa: cada checkpoint ocupa el siguiente lugar de la
+ * partición "energylog" y los sectores se borran en forma circular, uno a la
+ * vez, de modo que el desgaste se reparte en toda la partición y el umbral
+ * baja a ENERGY_LOG_STEP_KWH.
+ *
+ * ## Formato
+ *
+ * | Campo  | Tamaño | Contenido                                      |
+ * |--------|--------|------------------------------------------------|
+ * | seq    | 4 B    | Secuencia creciente desde 1 (0xFFFFFFFF: libre) |
+ * | crc    | 4 B    | CRC32 de seq y los registros                   |
+ * | regs   | 32 B   | energy_regs_t                                  |
+ * | loads  | 40 B   | load_energy_t                                  |
+ *
+ * Cada sector de ENERGY_LOG_SECTOR_BYTES guarda ENERGY_LOG_RECS_PER_SECTOR
+ * registros; se borra justo antes de escribir su primer registro, así que
+ * los lugares escritos de un sector siempre son un prefijo y la secuencia
+ * del primer registro de cada sector crece en forma circular.
+ *
+ * ## Recuperación en tiempo acotado
+ *
+ * energy_log_init() busca el sector cabeza por búsqueda binaria sobre el
+ * primer registro de cada sector y, dentro de él, el último lugar escrito
+ * por búsqueda binaria sobre los lugares; luego retrocede hasta el primer
+ * registro con CRC válido (un corte en medio de una escritura deja uno
+ * roto). Son O(log sectores + log registros) lecturas, independiente de
+ * cuánto se usó el diario.
+ *
+ * El retroceso no pasa del primer lugar de la cabeza: si ninguno es legible
+ * se recupera el último registro válido del sector anterior y, si tampoco
+ * hay, el diario se toma como vacío. La secuencia sigue desde la mayor vista,
+ * así un registro nuevo nunca queda detrás de la cabeza.
+ *
+ * Si el lugar siguiente al último válido está entero sin escribir (apagado
+ * limpio) la escritura continúa ahí; si hubo que retroceder sobre un
+ * registro roto continúa en el sector siguiente, sin programar sobre los
+ * bytes a medio escribir.
+ *
+ * @note Si la partición no existe el módulo queda deshabilitado y state
+ *       vuelve a guardar en NVS con SAVE_ENERGY_THS_KWH
+ *
+ * @author Tomás Vovard
+ * @date Diciembre 2025
+ */
+
+#ifndef ENERGY_LOG_H
+#define ENERGY_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app/control.h"
+#include "app/measure.h"
+
+/**
+ * @defgroup energy_log_config Parámetros del diario de energía
+ * @{
+ */
+
+/** @brief Etiqueta de la partición en partitions.csv */
+#define ENERGY_LOG_PARTITION "energylog"
+
+/** @brief Tamaño de sector de borrado de la flash [bytes] */
+#define ENERGY_LOG_SECTOR_BYTES 4096
+
+/** @brief Secuencia de un lugar sin escribir (flash borrada) */
+#define ENERGY_LOG_SEQ_FREE 0xFFFFFFFFu
+
+/** @} */ // end of energy_log_config
+
+/**
+ * @brief Registro del diario
+ */
+typedef struct {
+    uint32_t seq;               /**< Secuencia, creciente desde 1 */
+    uint32_t crc;               /**< CRC32 de seq, regs y loads */
+    energy_regs_t regs;         /**< Registros totales */
+    load_energy_t loads;        /**< Energía por carga */
+} energy_log_rec_t;
+
+/** @brief Registros por sector (el resto del sector queda sin usar) */
+#define ENERGY_LOG_RECS_PER_SECTOR (ENERGY_LOG_SECTOR_BYTES / sizeof(energy_log_rec_t))
+
+/**
+ * @brief Estado del diario
+ */
+typedef struct {
+    bool ready;                 /**< Partición encontrada */
+    uint32_t sectors;           /**< Sectores de la partición */
+    uint32_t seq;               /**< Secuencia del último registro válido (0: vacío) */
+    uint32_t next;              /**< Próximo lugar a escribir (índice global) */
+    uint32_t appends;           /**< Registros escritos desde el arranque */
+    uint32_t erases;            /**< Sectores borrados desde el arranque */
+    uint32_t errors;            /**< Fallos de lectura/escritura desde el arranque */
+    uint32_t boot_reads;        /**< Lecturas de flash de la recuperación */
+    uint32_t boot_torn;         /**< Lugares rotos o ilegibles salteados en la recuperación */
+    uint32_t boot_us;           /**< Duración de la recuperación [us] */
+} energy_log_info_t;
+
+/**
+ * @brief Busca la partición y recupera el último registro válido
+ *
+ * @return true si la partición existe (haya o no registros)
+ *
+ * @note Llamar después de nvs_config_init() y antes de state_init()
+ */
+bool energy_log_init();
+
+/**
+ * @brief Último registro recuperado por energy_log_init()
+ *
+ * @param[out] regs Registros totales
+ * @param[out] loads Energía por carga
+ *
+ * @return false si el diario está vacío o deshabilitado (salidas sin tocar)
+ */
+bool energy_log_latest(energy_regs_t *regs, load_energy_t *loads);
+
+/**
+ * @brief Anexa un checkpoint
+ *
+ * Borra el sector siguiente cuando el registro es el primero de ese sector.
+ *
+ * @param regs Registros totales
+ * @param loads Energía por carga
+ *
+ * @return false si el diario está deshabilitado o falló la flash
+ *
+ * @note Bloquea durante la escritura (y el borrado): sólo desde task_persist
+ */
+bool energy_log_append(const energy_regs_t *regs, const load_energy_t *loads);
+
+/**
+ * @brief true si la partición existe y el diario está en uso
+ */
+bool energy_log_is_ready();
+
+/**
+ * @brief Copia el estado del diario
+ *
+ * @param[out] out Destino
+ */
+void energy_log_get_info(energy_log_info_t *out);
+
+#endif // ENERGY_LOG_H
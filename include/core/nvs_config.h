@@ -4,7 +4,9 @@
  * 
  * Wrapper sobre ESP-IDF NVS (Non-Volatile Storage) para guardar/cargar:
  * - Configuración del sistema de control (sys_load_cfg_t)
- * - Energía acumulada (kWh)
+ * - Registros de energía acumulada (neta, importada, exportada y reactiva)
+ * - Energía atribuida a cada carga (load_energy_t)
+ * - Calibración de la cadena de medición (measure_cal_t)
  * 
  * @note Requiere nvs_flash_init() antes de usar estas funciones
  * @author Tomás Vovard
@@ -16,6 +18,7 @@
 #define NVS_CONFIG_H
 
 #include "app/control.h"
+#include "app/measure.h"
 #include <stdbool.h>
 #include "nvs_flash.h"
 #include "nvs.h"
@@ -49,17 +52,57 @@ bool nvs_save_config(const sys_load_cfg_t *cfg);
 bool nvs_load_config(sys_load_cfg_t *cfg);
 
 /**
- * @brief Guarda energía acumulada en NVS
- * @param energy Energía en kWh
+ * @brief Guarda los registros de energía acumulada en NVS
+ * @param regs Registros a persistir (un único blob "energy_regs")
  * @return true si exitoso, false en caso de error
  */
-bool nvs_save_energy(double energy);
+bool nvs_save_energy(const energy_regs_t *regs);
 
 /**
- * @brief Carga energía acumulada desde NVS
- * @return Energía en kWh, o 0.0 si no hay datos guardados
+ * @brief Carga los registros de energía acumulada desde NVS
+ * 
+ * Si sólo existe la clave anterior "energy" (un double con la energía neta)
+ * la migra: E y E_imp toman ese valor y el resto queda en cero.
+ * 
+ * @param[out] regs Registros cargados, todos en 0.0 si no hay datos guardados
+ * @return true si había datos guardados, false en caso contrario
+ */
+bool nvs_load_energy(energy_regs_t *regs);
+
+/**
+ * @brief Guarda la energía atribuida a cada carga en NVS
+ * @param regs Registros a persistir (un único blob "load_energy")
+ * @return true si exitoso, false en caso de error
+ */
+bool nvs_save_load_energy(const load_energy_t *regs);
+
+/**
+ * @brief Carga la energía atribuida a cada carga desde NVS
+ * @param[out] regs Registros cargados, todos en 0.0 si no hay datos guardados
+ *                  o si el blob no coincide con NUM_LOADS
+ * @return true si había datos guardados del tamaño esperado
+ */
+bool nvs_load_load_energy(load_energy_t *regs);
+
+/**
+ * @brief Guarda la calibración de medición en NVS
+ * @param cal Calibración a persistir (un único blob "meas_cal")
+ * @return true si exitoso, false en caso de error
+ */
+bool nvs_save_cal(const measure_cal_t *cal);
+
+/**
+ * @brief Carga la calibración de medición desde NVS
+ * @param[out] cal Calibración cargada (sin modificar si no hay datos guardados)
+ * @return true si había una calibración guardada del tamaño esperado
+ */
+bool nvs_load_cal(measure_cal_t *cal);
+
+/**
+ * @brief Borra la calibración guardada (al arrancar rigen los valores de fábrica)
+ * @return true si exitoso o si no había calibración guardada
  */
-double nvs_load_energy();
+bool nvs_erase_cal();
 
 /**
  * @brief Resetea toda la configuración NVS a valores por defecto
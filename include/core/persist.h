@@ -0,0 +1,141 @@
+/**
+ * @file persist.h
+ * @brief Escritura asíncrona en flash de energía, configuración, calibración e historial
+ *
+ * Saca las escrituras de flash de las tareas de tiempo real: un borrado o
+ * commit de NVS tarda decenas de milisegundos y, hecho desde
+ * state_update_measure() (task_measure_compute), demoraba el cálculo de
+ * ventanas y con él la devolución de buffers a la adquisición.
+ *
+ * ## Buzón con coalescencia
+ *
+ * persist_energy(), persist_config() y persist_cal() sólo copian el dato a
+ * un buzón (un lugar por tipo, protegido por una sección crítica corta) y despiertan a
+ * task_persist. Un pedido que llega con otro del mismo tipo pendiente lo
+ * reemplaza: sólo se escribe el último. La tarea, de baja prioridad, espera
+ * PERSIST_BATCH_MS para juntar pedidos cercanos y escribe todo lo pendiente
+ * en una pasada.
+ *
+ * ## Flush inmediato
+ *
+ * persist_flush() escribe lo pendiente en el contexto del llamante, sin
+ * esperar a la tarea. Se registra como shutdown handler (esp_restart()) y
+ * queda disponible para una detección de caída de alimentación: el
+ * detector de brown-out del ESP32 resetea desde una ISR, donde no se puede
+ * escribir flash.
+ *
+ * @note La escritura en flash deshabilita la caché en ambos núcleos: la
+ *       adquisición (código fuera de IRAM) igual se detiene durante el
+ *       commit, pero ya no se suma la espera de la tarea de cálculo.
+ *
+ * @author Tomás Vovard
+ * @date Diciembre 2025
+ */
+
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app/control.h"
+#include "app/measure.h"
+
+/**
+ * @defgroup persist_config Parámetros de la escritura asíncrona
+ * @{
+ */
+
+/** @brief Espera desde el primer pedido hasta escribir, para juntar los cercanos [ms] */
+#define PERSIST_BATCH_MS 2000
+
+/** @} */ // end of persist_config
+
+/**
+ * @brief Contadores de la escritura asíncrona
+ */
+typedef struct {
+    uint32_t requests;          /**< Pedidos recibidos */
+    uint32_t coalesced;         /**< Pedidos que reemplazaron a uno pendiente */
+    uint32_t writes;            /**< Pasadas de escritura con algo pendiente */
+    uint32_t errors;            /**< Pasadas con alguna escritura fallida (la energía la repone el próximo pedido) */
+    uint32_t cfg_errors;        /**< Guardados de configuración fallidos (se reintentan en la pasada siguiente) */
+    uint32_t cal_errors;        /**< Guardados o borrados de calibración fallidos (incluidos en errors) */
+    uint32_t write_us_last;     /**< Duración de la última pasada [us] */
+    uint32_t write_us_max;      /**< Pasada más larga observada [us] */
+} persist_stats_t;
+
+/**
+ * @brief Inicializa el buzón y registra el flush de apagado
+ *
+ * @note Llamar después de nvs_config_init() y antes de state_init()
+ */
+void persist_init();
+
+/**
+ * @brief Pide guardar los registros de energía (totales y por carga)
+ *
+ * @param regs Registros totales
+ * @param loads Energía por carga
+ *
+ * @note No bloquea: copia al buzón y retorna
+ */
+void persist_energy(const energy_regs_t *regs, const load_energy_t *loads);
+
+/**
+ * @brief Pide guardar la configuración del control de cargas
+ *
+ * @param cfg Configuración a guardar
+ *
+ * @note No bloquea: copia al buzón y retorna. Si la escritura falla queda
+ *       pendiente y se reintenta cada PERSIST_BATCH_MS (persist_stats_t::cfg_errors)
+ */
+void persist_config(const sys_load_cfg_t *cfg);
+
+/**
+ * @brief Pide guardar la calibración
+ *
+ * @param cal Calibración a guardar
+ *
+ * @note No bloquea: copia al buzón y retorna. Comparte lugar con
+ *       persist_cal_erase(): gana el último pedido
+ */
+void persist_cal(const measure_cal_t *cal);
+
+/**
+ * @brief Pide borrar la calibración guardada (vuelve la de fábrica al arrancar)
+ *
+ * @note No bloquea; reemplaza a un persist_cal() pendiente
+ */
+void persist_cal_erase();
+
+/**
+ * @brief Pide escribir los puntos de minuto y hora encolados en el historial
+ *
+ * @note No bloquea: history_flush() corre en task_persist
+ */
+void persist_history();
+
+/**
+ * @brief Escribe ya lo pendiente, en el contexto del llamante
+ *
+ * @return false si alguna escritura falló
+ *
+ * @note Bloquea mientras task_persist esté escribiendo
+ */
+bool persist_flush();
+
+/**
+ * @brief Copia los contadores
+ *
+ * @param[out] out Destino
+ */
+void persist_get_stats(persist_stats_t *out);
+
+/**
+ * @brief Tarea de escritura: espera pedidos, junta PERSIST_BATCH_MS y escribe
+ *
+ * @param pvParameters Parámetro estándar de FreeRTOS (no usado)
+ */
+void task_persist(void *pvParameters);
+
+#endif // PERSIST_H
@@ -0,0 +1,52 @@
+/**
+ * @file task_stats.h
+ * @brief Reparto de CPU por tarea y por núcleo para ajustar la ubicación de tareas
+ * 
+ * Usa las estadísticas de tiempo de ejecución de FreeRTOS
+ * (CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS, reloj esp_timer en μs) para
+ * informar qué porcentaje de su núcleo consumió cada tarea desde la consulta
+ * anterior. Permite validar bajo carga real la tabla TASK_CORE_* de
+ * system_config.h.
+ * 
+ * @note Requiere CONFIG_FREERTOS_USE_TRACE_FACILITY (uxTaskGetSystemState)
+ * @author Tomás Vovard
+ * @date Diciembre 2025
+ */
+
+#ifndef TASK_STATS_H
+#define TASK_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/** @brief Máximo de tareas contempladas (aplicación + sistema: IDLE, ipc, wifi, lwIP, mqtt...) */
+#define TASK_STATS_MAX_TASKS 28
+
+/** @brief Porcentaje mínimo [décimas de %] para listar una tarea en el reporte */
+#define TASK_STATS_MIN_SHARE_PERMIL 1
+
+/**
+ * @brief Genera el reporte de uso de CPU desde la llamada anterior
+ * 
+ * Formato: "C0:<carga>% C1:<carga>% <tarea>/<núcleo>:<%> ..." donde la carga
+ * de cada núcleo es 100% menos el tiempo de su tarea IDLE y el núcleo de cada
+ * tarea es 0, 1 o '*' (sin afinidad). Las tareas se listan en orden de
+ * consumo decreciente hasta llenar el buffer; las que consumieron menos de
+ * TASK_STATS_MIN_SHARE_PERMIL se omiten.
+ * 
+ * @param[out] buf Buffer de salida
+ * @param len Tamaño del buffer
+ * 
+ * @return true si se generó el reporte, false si hay más tareas que TASK_STATS_MAX_TASKS
+ *         (o len == 0)
+ * 
+ * @note La primera llamada informa el consumo desde el arranque
+ * @note No es reentrante: pensada para un único consumidor (task_uart_handler)
+ * @note El contador de 32 bits en μs da vuelta cada ~71 min; consultas más
+ *       espaciadas informan valores incorrectos
+ */
+bool task_stats_format(char *buf, size_t len);
+
+#endif // TASK_STATS_H
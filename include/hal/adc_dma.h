@@ -9,6 +9,68 @@
  * - ADC1_CH4 (GPIO32): Tensión de red (divisor resistivo)
  * - ADC1_CH6 (GPIO34): Corriente (sensor ACS712-5A)
  * 
+ * Con MEASURE_TOPOLOGY multicanal el patrón suma las corrientes por salida o
+ * las fases B y C (ADC_PATTERN_CHANNELS, hasta los 8 canales de ADC1). Cada
+ * canal conserva la tasa del patrón V-I: el driver convierte
+ * ADC_RAW_FREQ_HZ · ADC_PATTERN_LEN / 2 muestras por segundo.
+ * 
+ * ## Dimensionado del DMA y desbordes
+ * 
+ * El ring buffer del driver (ring_bytes) y el tamaño de frame (frame_bytes)
+ * se configuran en tiempo de ejecución con app_adc_dma_set_config(); la
+ * reinicialización del driver la hace la propia tarea lectora en su próxima
+ * app_adc_dma_read(), sin carreras con la lectura.
+ * 
+ * Los frames perdidos los informa la ISR del driver, por lo que el conteo es
+ * exacto; además cada lectura mide el tiempo desde la anterior. Con
+ * auto_grow, ADC_DMA_AUTOGROW_OVF desbordes dentro de ADC_DMA_AUTOGROW_WINDOW_MS
+ * duplican el ring (hasta ADC_DMA_RING_MAX_BYTES).
+ * 
+ * ## Lectura por eventos (ADC_DMA_EVENT_ENABLE)
+ * 
+ * En lugar de bloquear en adc_continuous_read() (que copia cada frame del
+ * ring del driver a un buffer de la tarea), el callback on_conv_done encola
+ * una referencia al buffer DMA recién completado y notifica a la tarea
+ * lectora, que lo procesa en el lugar con app_adc_dma_get_frame():
+ * 
+ * - Sin memcpy por frame en la tarea
+ * - El driver rota ADC_DMA_DRIVER_BUFS buffers DMA: un frame es válido
+ *   mientras no se completen ADC_DMA_DRIVER_BUFS - 1 frames posteriores
+ *   (~51 ms con 1024 B a 20 kHz, ~13 ms con ADC_OVERSAMPLE = 4). La cola admite ADC_DMA_EVT_QUEUE frames
+ *   pendientes; uno más se descarta desde la ISR y se cuenta como desborde
+ * - app_adc_dma_release_frame() detecta si el DMA alcanzó al frame mientras
+ *   se procesaba (también cuenta como desborde)
+ * 
+ * El driver igual copia cada frame a su ring, que en este modo no se lee:
+ * se abre con flags.flush_pool para que lo vacíe él mismo al llenarse, en
+ * lugar de llamar a on_pool_ovf en cada frame siguiente. Por eso su tamaño y
+ * auto_grow no tienen efecto, y un on_pool_ovf que igual llegue se cuenta
+ * aparte (pool_ovf): no es un frame perdido. En la lectura bloqueante
+ * (ADC_DMA_EVENT_ENABLE = 0) on_pool_ovf sí es un frame perdido y cuenta
+ * como desborde.
+ * 
+ * La carga de CPU de ambos caminos se compara en el host con
+ * test/host/bench_adc_dma (un binario por modo); en el equipo, compilar con
+ * cada valor y leer el porcentaje de ADC_ACQ con el comando TASKS bajo la
+ * misma carga.
+ * 
+ * ## Grabación y reproducción de frames
+ * 
+ * app_adc_dma_get_frame() (y app_adc_dma_read(), que la usa) es la única
+ * entrada de datos crudos, por lo que ahí se graban los frames tal como los
+ * entrega el driver (ADC_REC_ENABLE). La grabación se vuelca por UART
+ * ("ADCREC DUMP") para analizar anomalías del campo, y puede reproducirse en
+ * lugar del ADC para repetir de forma determinística todo el camino
+ * adquisición → estado.
+ * 
+ * Formato de la grabación: registros consecutivos
+ * 
+ * ```
+ * uint32_t t_us   (little endian) tiempo desde el inicio de la grabación
+ * uint16_t len    (little endian) bytes del frame
+ * uint8_t  data[len]              adc_digi_output_data_t crudos (TYPE1)
+ * ```
+ * 
  * @author Tomás Vovard
  * @date Diciembre 2025
  */
@@ -36,6 +98,25 @@
 /** @brief Canal ADC para medición de corriente - GPIO34 */
 #define ADC_CH_I ADC_CHANNEL_6
 
+#if MEASURE_TOPOLOGY == MEASURE_TOPO_PER_LOAD
+/** @brief Canales ADC de corriente por salida - GPIO36, GPIO39, GPIO33, GPIO35 */
+#define ADC_CH_I_LOAD0 ADC_CHANNEL_0
+#define ADC_CH_I_LOAD1 ADC_CHANNEL_3
+#define ADC_CH_I_LOAD2 ADC_CHANNEL_5
+#define ADC_CH_I_LOAD3 ADC_CHANNEL_7
+/** @brief Canales del patrón en orden de slot (ver channel_config en measure_config.h) */
+#define ADC_PATTERN_CHANNELS { ADC_CH_V, ADC_CH_I, ADC_CH_I_LOAD0, ADC_CH_I_LOAD1, ADC_CH_I_LOAD2, ADC_CH_I_LOAD3 }
+#elif MEASURE_TOPOLOGY == MEASURE_TOPO_THREE_PHASE
+/** @brief Canales ADC de las fases B y C - GPIO33, GPIO35, GPIO36, GPIO39 (ADC_CH_V/ADC_CH_I son la fase A) */
+#define ADC_CH_V_B ADC_CHANNEL_5
+#define ADC_CH_I_B ADC_CHANNEL_7
+#define ADC_CH_V_C ADC_CHANNEL_0
+#define ADC_CH_I_C ADC_CHANNEL_3
+#define ADC_PATTERN_CHANNELS { ADC_CH_V, ADC_CH_I, ADC_CH_V_B, ADC_CH_I_B, ADC_CH_V_C, ADC_CH_I_C }
+#else
+#define ADC_PATTERN_CHANNELS { ADC_CH_V, ADC_CH_I }
+#endif
+
 /** @brief Atenuación del ADC: 11 dB para rango 0-3.3V */
 #define ADC_ATTEN_CFG ADC_ATTEN_DB_12
 
@@ -45,6 +126,113 @@
 /** @brief Valor máximo de cuenta ADC de 12 bits */
 #define ADC_MAX_COUNT 4095
 
+/** @brief Tensión de fondo de escala nominal con ADC_ATTEN_DB_12 [mV]
+ *
+ * Sólo se usa para construir la tabla de conversión cuando no hay esquema
+ * de calibración disponible (conversión lineal aproximada).
+ */
+#define ADC_FALLBACK_FULL_SCALE_MV 3100
+
+/** @brief Lectura por eventos del driver (1) o bloqueante con adc_continuous_read() (0) - se puede fijar desde el build */
+#ifndef ADC_DMA_EVENT_ENABLE
+#define ADC_DMA_EVENT_ENABLE 1
+#endif
+
+/** @brief Buffers DMA que rota el driver continuo de IDF (INTERNAL_BUF_NUM) */
+#define ADC_DMA_DRIVER_BUFS 5
+
+/** @brief Frames pendientes de procesar en lectura por eventos - menor que ADC_DMA_DRIVER_BUFS - 1 */
+#define ADC_DMA_EVT_QUEUE 3
+
+/** @brief Tamaño por defecto del ring buffer del driver [bytes] - ~12.8 ms de muestras a cualquier sobremuestreo y patrón */
+#define ADC_DMA_RING_DEFAULT_BYTES (512 * ADC_PATTERN_LEN * ADC_OVERSAMPLE)
+
+/** @brief Tamaño máximo del ring buffer del driver [bytes] - ~100 ms de muestras sin sobremuestreo */
+#define ADC_DMA_RING_MAX_BYTES 8192
+
+/** @brief Tamaño mínimo de frame [bytes] - 64 pares */
+#define ADC_DMA_FRAME_MIN_BYTES 256
+
+/** @brief Granularidad del tamaño de frame y del ring [bytes] - un par V-I */
+#define ADC_DMA_ALIGN_BYTES 4
+
+/** @brief Desbordes que disparan el crecimiento automático del ring */
+#define ADC_DMA_AUTOGROW_OVF 3
+
+/** @brief Ventana en la que se cuentan los desbordes para el crecimiento automático [ms] */
+#define ADC_DMA_AUTOGROW_WINDOW_MS 10000
+
+/** @brief Espera entre intentos de reabrir el driver si quedó cerrado tras una reconfiguración fallida [ms] */
+#define ADC_DMA_REOPEN_RETRY_MS 100
+
+/** @brief Habilita la grabación/reproducción de frames DMA (1 = habilitada, 0 = deshabilitada) */
+#define ADC_REC_ENABLE 1
+
+/** @brief Bytes de cabecera de cada frame grabado (t_us + len) */
+#define ADC_REC_HDR_BYTES 6
+
+/** @brief Frames completos que entran en la grabación - 16 frames ≈ 4096 pares crudos ≈ 205 ms sin sobremuestreo */
+#define ADC_REC_FRAMES 16
+
+/** @brief Tamaño del buffer de grabación [bytes] */
+#define ADC_REC_BUF_BYTES (ADC_REC_FRAMES * (FRAME_BYTES + ADC_REC_HDR_BYTES))
+
+/* ========================================================================== */
+/*                      ESTRUCTURAS DE DATOS                                  */
+/* ========================================================================== */
+
+/**
+ * @brief Configuración del driver continuo del ADC
+ */
+typedef struct {
+    uint32_t ring_bytes;    /**< Ring buffer del driver (max_store_buf_size) [bytes] */
+    uint32_t frame_bytes;   /**< Tamaño de frame (conv_frame_size), hasta FRAME_BYTES [bytes] */
+    bool auto_grow;         /**< Duplicar el ring ante desbordes repetidos */
+} adc_dma_cfg_t;
+
+/**
+ * @brief Telemetría del DMA
+ * 
+ * @note La escribe sólo la tarea lectora; una lectura desde otra tarea puede
+ *       mezclar valores de frames consecutivos, suficiente para diagnóstico.
+ */
+typedef struct {
+    uint32_t frames;        /**< Lecturas exitosas */
+    uint32_t overflows;     /**< Frames perdidos por desborde (informados por la ISR del driver) */
+    uint32_t pool_ovf;      /**< Desbordes del ring del driver sin pérdida de frames (lectura por eventos) */
+    uint32_t bytes_lost;    /**< Bytes perdidos por desborde */
+    uint32_t gap_last_us;   /**< Tiempo entre las dos últimas lecturas [us] */
+    uint32_t gap_max_us;    /**< Peor tiempo entre lecturas [us] */
+    uint32_t reinits;       /**< Reinicializaciones del driver */
+    uint32_t reinit_errors; /**< Pasos fallidos de una reinicialización (se vuelve a la configuración anterior) */
+    int32_t last_err;       /**< Último error del driver en una reinicialización (esp_err_t, ESP_OK si ninguno) */
+    uint32_t grows;         /**< Crecimientos automáticos del ring */
+    uint32_t ring_bytes;    /**< Ring buffer en uso [bytes] (0: driver cerrado, se reintenta abrir) */
+    uint32_t frame_bytes;   /**< Frame en uso [bytes] (0: driver cerrado) */
+} adc_dma_stats_t;
+
+/**
+ * @brief Estado de la grabación de frames
+ */
+typedef enum {
+    ADC_REC_IDLE = 0,       /**< Sin grabación */
+    ADC_REC_RECORDING,      /**< Grabando los frames leídos */
+    ADC_REC_DONE,           /**< Grabación completa, disponible para volcado o reproducción */
+    ADC_REC_REPLAY          /**< app_adc_dma_read() entrega la grabación en lugar del ADC */
+} adc_rec_state_t;
+
+/**
+ * @brief Descripción de la grabación actual
+ */
+typedef struct {
+    adc_rec_state_t state;  /**< Estado */
+    bool realtime;          /**< Reproducción al ritmo del ADC (true) o máxima velocidad */
+    uint32_t bytes;         /**< Bytes grabados (cabeceras incluidas) */
+    uint32_t frames;        /**< Frames grabados */
+    uint32_t duration_us;   /**< Tiempo entre el primer y el último frame */
+    uint32_t loops;         /**< Vueltas completas de la reproducción */
+} adc_rec_info_t;
+
 /* ========================================================================== */
 /*                      FUNCIONES PÚBLICAS                                    */
 /* ========================================================================== */
@@ -54,7 +242,7 @@
  * 
  * Configura:
  * - Patrón de conversión dual-canal (V, I)
- * - Frecuencia de muestreo: SAMPLE_FREQ_HZ
+ * - Frecuencia de muestreo: ADC_RAW_FREQ_HZ (SAMPLE_FREQ_HZ × ADC_OVERSAMPLE)
  * - Buffer circular DMA
  * 
  * @note Debe llamarse antes de app_adc_dma_start_conv()
@@ -64,10 +252,55 @@ void app_adc_dma_init();
 /**
  * @brief Inicia conversiones continuas ADC
  * 
- * @note Llamar una sola vez después de app_adc_dma_init()
+ * Registra a la tarea que llama como lectora de los frames (lectura por
+ * eventos): los frames de antes de que exista un lector desbordarían el ring
+ * y quedarían contados en adc_dma_stats_t como pérdidas.
+ * 
+ * @note Llamar una sola vez después de app_adc_dma_init(), desde la tarea
+ *       que llama a app_adc_dma_get_frame() (task_adc_acquisition)
  */
 void app_adc_dma_start_conv();
 
+/**
+ * @brief Pide un nuevo tamaño de ring y de frame (reinicializa el driver)
+ * 
+ * @param cfg Configuración nueva
+ * 
+ * @return false si los tamaños son inválidos: ring_bytes en
+ *         [frame_bytes, ADC_DMA_RING_MAX_BYTES], frame_bytes en
+ *         [ADC_DMA_FRAME_MIN_BYTES, FRAME_BYTES], ambos múltiplos de ADC_DMA_ALIGN_BYTES
+ * 
+ * @note La reinicialización se hace en la próxima app_adc_dma_read() (se
+ *       pierden las muestras de ese intervalo); auto_grow se aplica en el acto
+ * @note Si el driver rechaza la configuración nueva se reabre con la
+ *       anterior; el fallo queda en reinit_errors y last_err de
+ *       adc_dma_stats_t. Si tampoco abre con la anterior, las lecturas
+ *       devuelven ESP_ERR_INVALID_STATE y se reintenta cada
+ *       ADC_DMA_REOPEN_RETRY_MS
+ */
+bool app_adc_dma_set_config(const adc_dma_cfg_t *cfg);
+
+/**
+ * @brief Configuración vigente (o pedida y todavía no aplicada)
+ * 
+ * @param[out] out Configuración
+ */
+void app_adc_dma_get_config(adc_dma_cfg_t *out);
+
+/**
+ * @brief Copia la telemetría del DMA
+ * 
+ * @param[out] out Contadores
+ */
+void app_adc_dma_get_stats(adc_dma_stats_t *out);
+
+/**
+ * @brief Pone en cero los contadores de la telemetría del DMA
+ * 
+ * @note Se hace efectivo en la próxima app_adc_dma_read()
+ */
+void app_adc_dma_reset_stats();
+
 /**
  * @brief Lee datos del buffer DMA (bloqueante)
  * 
@@ -78,10 +311,82 @@ void app_adc_dma_start_conv();
  * 
  * @return ESP_OK si exitoso, ESP_ERR_TIMEOUT si timeout, ESP_ERR_INVALID_STATE si overflow
  * 
+ * @note Aplica la configuración pedida con app_adc_dma_set_config() y
+ *       actualiza la telemetría (adc_dma_stats_t)
  * @note Bloquea hasta que haya len bytes disponibles o expire tout
+ * @note Graba el frame si hay una grabación en curso y, en reproducción,
+ *       entrega el próximo frame grabado en lugar del leído
  */
 esp_err_t app_adc_dma_read(uint8_t *buf, size_t len, uint32_t *out_bytes, TickType_t tout);
 
+/**
+ * @brief Espera el próximo frame y lo entrega sin copiarlo
+ * 
+ * @param[out] frame Frame alineado a 4 bytes: el buffer DMA del driver en
+ *             lectura por eventos, o un buffer interno en lectura bloqueante
+ *             y en reproducción
+ * @param[out] out_bytes Bytes del frame
+ * @param tout Timeout máximo de espera
+ * 
+ * @return ESP_OK si hay frame, ESP_ERR_TIMEOUT si timeout, ESP_ERR_INVALID_STATE si el driver no está iniciado
+ * 
+ * @note Sólo desde la tarea lectora; el frame es válido hasta app_adc_dma_release_frame()
+ * @note Graba y reproduce igual que app_adc_dma_read()
+ */
+esp_err_t app_adc_dma_get_frame(const uint8_t **frame, uint32_t *out_bytes, TickType_t tout);
+
+/**
+ * @brief Libera el frame entregado por app_adc_dma_get_frame()
+ * 
+ * @return false si el DMA volvió a escribir el buffer mientras se procesaba
+ *         (las muestras leídas pueden mezclar dos frames; se cuenta como desborde)
+ */
+bool app_adc_dma_release_frame();
+
+/**
+ * @brief Inicia una grabación nueva (descarta la anterior)
+ * 
+ * @return false si ADC_REC_ENABLE = 0
+ * 
+ * @note Se hace efectiva en la próxima app_adc_dma_read(); termina sola al llenarse el buffer
+ */
+bool app_adc_rec_start();
+
+/**
+ * @brief Reproduce la grabación en lugar del ADC, en bucle
+ * 
+ * @param realtime true: se sigue leyendo el ADC y cada frame leído se
+ *                 reemplaza por uno grabado (mismo ritmo que en vivo).
+ *                 false: se entregan los frames sin esperar al ADC, con una
+ *                 pausa de un tick por frame para no acaparar el núcleo
+ * 
+ * @return false si no hay una grabación completa
+ */
+bool app_adc_rec_replay(bool realtime);
+
+/**
+ * @brief Detiene la grabación o reproducción en curso (vuelve a leer el ADC)
+ */
+void app_adc_rec_stop();
+
+/**
+ * @brief Describe la grabación actual
+ * 
+ * @param[out] out Estado y tamaño de la grabación
+ */
+void app_adc_rec_get_info(adc_rec_info_t *out);
+
+/**
+ * @brief Lee bytes de la grabación completa (formato en la cabecera del archivo)
+ * 
+ * @param offset Byte inicial
+ * @param[out] dst Destino
+ * @param len Bytes pedidos
+ * 
+ * @return Bytes copiados; 0 si no hay grabación completa o offset llegó al final
+ */
+size_t app_adc_rec_read(uint32_t offset, uint8_t *dst, size_t len);
+
 /**
  * @brief Convierte cuenta ADC raw a milivoltios calibrados
  * 
@@ -91,6 +396,8 @@ esp_err_t app_adc_dma_read(uint8_t *buf, size_t len, uint32_t *out_bytes, TickTy
  * @return ESP_OK si exitoso, ESP_FAIL si no hay calibración
  * 
  * @note Requiere app_adc_init_calibration() previo
+ * @note Camino lento (llamada al esquema de IDF): el lazo de adquisición usa
+ *       la tabla de app_adc_get_cal_lut()
  */
 esp_err_t app_adc_get_voltage(int raw, int *mv);
 
@@ -98,12 +405,41 @@ esp_err_t app_adc_get_voltage(int raw, int *mv);
  * @brief Inicializa calibración del ADC
  * 
  * Crea esquema de calibración line fitting para compensar
- * no-linealidad del ADC del ESP32.
+ * no-linealidad del ADC del ESP32 y precalcula la tabla raw→mV
+ * (ADC_MAX_COUNT+1 entradas int16, 8 KB) evaluando el esquema una vez por
+ * cada cuenta posible.
  * 
- * @return true si exitoso, false en caso de error
+ * Si el esquema no está disponible la tabla se llena con una conversión
+ * lineal nominal (0 - ADC_FALLBACK_FULL_SCALE_MV) para no detener la medición.
  * 
- * @note Llamar antes de usar app_adc_get_voltage()
+ * @return true si la calibración está disponible, false si se usa la conversión nominal
+ * 
+ * @note Llamar antes de usar app_adc_get_voltage() o app_adc_get_cal_lut()
  */
 bool app_adc_init_calibration();
 
+/**
+ * @brief Obtiene la tabla de conversión raw→mV precalculada
+ * 
+ * @return Puntero a ADC_MAX_COUNT+1 entradas en mV, indexables directamente
+ *         con la cuenta de 12 bits
+ * 
+ * @note Válida luego de app_adc_init_calibration() (calibrada o nominal)
+ */
+const int16_t *app_adc_get_cal_lut();
+
+/**
+ * @brief Indica si la tabla de conversión proviene del esquema de calibración
+ * 
+ * @return true si calibrada, false si es la conversión lineal nominal
+ */
+bool app_adc_is_calibrated();
+
+/**
+ * @brief Obtiene los canales del patrón de conversión en orden de slot
+ * 
+ * @return Puntero a ADC_PATTERN_LEN canales (ADC_PATTERN_CHANNELS)
+ */
+const uint8_t *app_adc_get_pattern();
+
 #endif  // ADC_DMA_H
\ No newline at end of file
@@ -107,16 +107,17 @@ esp_err_t oled_draw_text_line(uint8_t row, const char *text);
 esp_err_t display_init(void);
 
 /**
- * @brief Tarea periódica de actualización del display
+ * @brief Tarea de actualización del display
  * 
- * Lee estado del sistema cada TASK_PERIOD_DISPLAY_MS (~500ms) y actualiza:
+ * Espera avisos de state (state_wait()) y actualiza:
  * - Línea 0-4: Mediciones (V, I, P, S, fp, E)
  * - Línea 5: Estados de cargas (L1-L4)
  * - Línea 6-7: Indicadores de fallas
  * 
  * @param pvParameters Parámetro estándar de FreeRTOS (no usado)
  * 
- * @note Actualización a ~2 Hz (suficiente para lectura humana)
+ * @note Cambios de salidas y fallas: al aviso. Mediciones: hasta ~2 Hz
+ *       (umbrales y UPDATE_MIN_INTERVAL_MS del detector de cambios)
  */
 void task_display(void *pvParameters);
 
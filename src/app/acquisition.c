@@ -1,73 +1,306 @@
 #include "app/acquisition.h"
+#include "esp_timer.h"
+#include <string.h>
+
+/*ventanas ping-pong: la adquisición entrega una mientras task_measure_compute procesa la otra*/
+static measure_accum_t windows[ACQ_NUM_WINDOWS];
+static volatile bool window_busy[ACQ_NUM_WINDOWS];
+static int64_t window_close_us[ACQ_NUM_WINDOWS];
+
+/*buzón de un ciclo: resultados por ciclo para el control*/
+static measure_accum_t cycle_slot;
+static volatile bool cycle_busy = false;
+
+static measure_stream_t stream;
+#if ADC_PATTERN_LEN > 2
+static adc_frame_demux_t demux;
+static adc_frame_decim_n_t decim_n;
+#else
+static adc_frame_decoder_t decoder;
+static adc_frame_decim_t decim;
+#endif
+
+#if MEASURE_AUX_PAIRS > 0
+#if MEASURE_TOPOLOGY == MEASURE_TOPO_PER_LOAD
+_Static_assert(MEASURE_PER_LOAD_CH == NUM_LOADS, "MEASURE_PER_LOAD_CH debe coincidir con NUM_LOADS");
+#endif
+_Static_assert(ADC_PATTERN_LEN <= ADC_PATTERN_MAX && MEASURE_AUX_PAIRS <= MEASURE_AUX_MAX, "patrón del ADC demasiado largo");
+
+static const measure_pair_slots_t aux_slots[MEASURE_AUX_PAIRS] = MEASURE_AUX_SLOTS;
+static measure_aux_t aux;
+/*ventanas de los pares auxiliares, en los mismos lugares que las del par principal*/
+static measure_accum_t aux_windows[ACQ_NUM_WINDOWS][MEASURE_AUX_PAIRS];
+#endif
+
+#if MEASURE_HARMONICS_ENABLE
+/*ciclo capturado para el análisis armónico: el primero de cada ventana*/
+static harmonics_capture_t harm_capture;
+static volatile bool harm_busy = false;
+static bool harm_recording = false;
+#endif
+
+static TaskHandle_t compute_task_handle = NULL;
+static acq_stats_t acq_stats;
+
+/* Entrega una ventana cerrada a la tarea de cálculo. Retorna false si no hay lugar (se descarta) */
+static bool acquisition_handoff_window(const measure_accum_t *win){
+    if(compute_task_handle == NULL) return false;
+
+    for(uint8_t idx = 0; idx < ACQ_NUM_WINDOWS; idx++){
+        if(!window_busy[idx]){
+            windows[idx] = *win;
+#if MEASURE_AUX_PAIRS > 0
+            memcpy(aux_windows[idx], aux.last_window, sizeof(aux_windows[idx]));
+#endif
+            window_close_us[idx] = esp_timer_get_time();
+            window_busy[idx] = true;
+            xTaskNotify(compute_task_handle, ACQ_NOTIFY_WINDOW, eSetBits);
+            return true;
+        }
+    }
+    return false;
+}
+
+#if MEASURE_HARMONICS_ENABLE
+/* Captura del ciclo para análisis armónico: arranca al cerrar una ventana y termina en el próximo cierre de ciclo */
+static void acquisition_harm_capture(uint8_t evt, int16_t v_mv, int16_t i_mv){
+    if(evt & MEASURE_EVT_CYCLE){
+        if(harm_recording){
+            harm_recording = false;
+            // sólo ciclos entre dos cruces reales: un ciclo forzado por longitud no es un período
+            if(stream.last_cycle.zc_periods > 0 && compute_task_handle != NULL){
+                harm_busy = true;
+                xTaskNotify(compute_task_handle, ACQ_NOTIFY_HARM, eSetBits);
+            }
+        } else if((evt & MEASURE_EVT_WINDOW) && !harm_busy){
+            harm_recording = true;
+            harm_capture.n = 0;
+        }
+    }
+
+    if(harm_recording){
+        if(harm_capture.n < HARM_CAPTURE_MAX_PAIRS){
+            harm_capture.v[harm_capture.n] = v_mv;
+            harm_capture.i[harm_capture.n] = i_mv;
+            harm_capture.n++;
+        } else {
+            harm_recording = false;
+        }
+    }
+}
+#endif
+
+/* Entrega un ciclo cerrado a la tarea de cálculo. Retorna false si el buzón está ocupado */
+static bool acquisition_handoff_cycle(const measure_accum_t *cyc){
+    if(compute_task_handle == NULL || cycle_busy) return false;
+
+    cycle_slot = *cyc;
+    cycle_busy = true;
+    xTaskNotify(compute_task_handle, ACQ_NOTIFY_CYCLE, eSetBits);
+    return true;
+}
 
 void task_adc_acquisition(void *pvParameters){
 
     (void)pvParameters;
 
-    // buffers static para evitar overflow de la task
-    static uint8_t result[FRAME_BYTES];
-    static measure_t measure_results;
+    // buffers static para evitar overflow de la task; el frame se lee en el lugar (buffer DMA o de adc_dma)
+    const uint8_t *frame;
     uint32_t ret_bytes = 0;
 
-    int mv, v_mv;
-    bool have_v = false; //flag de sincronización: true si hay V esperando a su par I
+#if ADC_PATTERN_LEN > 2
+    // un arreglo por slot del patrón; el par principal son los slots 0 y 1
+    static int16_t ch_buf[ADC_PATTERN_LEN][ADC_FRAME_MAX_SETS + 1];
+    int16_t *ch[ADC_PATTERN_LEN];
+    for(uint8_t k = 0; k < ADC_PATTERN_LEN; k++){
+        ch[k] = ch_buf[k];
+    }
+    int16_t *v_buf = ch_buf[0];
+    int16_t *i_buf = ch_buf[1];
+
+    //raw → mV precalculado en app_adc_init_calibration(); el set incompleto se conserva entre frames
+    adc_frame_demux_init(&demux, app_adc_get_pattern(), ADC_PATTERN_LEN, app_adc_get_cal_lut());
+    adc_frame_decim_n_init(&decim_n);
+#else
+    static int16_t v_buf[ADC_FRAME_MAX_PAIRS + 1];
+    static int16_t i_buf[ADC_FRAME_MAX_PAIRS + 1];
+
+    //raw → mV precalculado en app_adc_init_calibration(); la V pendiente se conserva entre frames
+    adc_frame_decoder_init(&decoder, ADC_CH_V, ADC_CH_I, app_adc_get_cal_lut());
+    adc_frame_decim_init(&decim);
+#endif
+
+    measure_stream_init(&stream);
+#if MEASURE_AUX_PAIRS > 0
+    measure_aux_init(&stream, &aux, aux_slots, MEASURE_AUX_PAIRS);
+#endif
+
+    // carga: tiempo de proceso sobre el tiempo de señal de los pares crudos, cada ACQ_LOAD_PERIOD_PAIRS
+    uint32_t busy_us = 0;
+    uint32_t raw_pairs = 0;
+
+    // recién acá: hasta que esta tarea lee, los frames sólo se contarían como perdidos
+    app_adc_dma_start_conv();
 
     while(1){
 
-        esp_err_t ret = app_adc_dma_read(result, sizeof(result), &ret_bytes, portMAX_DELAY);
+        esp_err_t ret = app_adc_dma_get_frame(&frame, &ret_bytes, portMAX_DELAY);
+        int64_t t_start = esp_timer_get_time();
 
         if(ret == ESP_OK){
 
-            const size_t step = sizeof(adc_digi_output_data_t);
-
             // Cada muestra ADC ocupa sizeof(adc_digi_output_data_t) bytes.
             // Si ret_bytes no es múltiplo exacto, hay corrupción de datos y se descarta el frame
-            if(ret_bytes % step != 0) continue;
-
-            for(size_t i = 0; i < ret_bytes; i += step){
+            if(ret_bytes % sizeof(adc_digi_output_data_t) != 0){
+                app_adc_dma_release_frame();
+                continue;
+            }
 
-                adc_digi_output_data_t *adc_digi_output_data = (adc_digi_output_data_t*)&result[i];
+            // el frame sólo se lee al decodificar: se libera antes de procesar los pares
+#if ADC_PATTERN_LEN > 2
+            size_t pairs = adc_frame_demux(&demux, (const uint16_t*)frame, ret_bytes, ch);
+            app_adc_dma_release_frame();
+            raw_pairs += pairs;
+            pairs = adc_frame_decimate_n(&decim_n, ch, ADC_PATTERN_LEN, pairs);
+#else
+            size_t pairs = adc_frame_decode(&decoder, (const uint32_t*)frame, ret_bytes, v_buf, i_buf);
+            app_adc_dma_release_frame();
+            raw_pairs += pairs;
+            pairs = adc_frame_decimate(&decim, v_buf, i_buf, pairs);
+#endif
 
-                uint32_t channel = adc_digi_output_data->type1.channel;
-                uint32_t value = adc_digi_output_data->type1.data & 0x0FFF; //12bits
+            for(size_t p = 0; p < pairs; p++){
+                int16_t v_mv = v_buf[p];
+                int16_t i_mv = i_buf[p];
 
-                // Chequeo valor dentro del rango del ADC (0 - 4095)
-                if(value <= ADC_MAX_COUNT){
-                    esp_err_t cal_ret = app_adc_get_voltage(value, &mv); 
-                    if(cal_ret != ESP_OK){
-                        // Si no convirtió bien el valor leído descarto todo el par V-I
-                        have_v = false;
-                        continue;
+#if MEASURE_AUX_PAIRS > 0
+                uint8_t evt = measure_add_set(&stream, ch, p);
+#else
+                uint8_t evt = measure_add_sample(&stream, v_mv, i_mv);
+#endif
+                if(evt & MEASURE_EVT_CYCLE){
+                    if(!acquisition_handoff_cycle(&stream.last_cycle)) acq_stats.cycles_dropped++;
+                }
+                if(evt & MEASURE_EVT_WINDOW){
+                    if(acquisition_handoff_window(&stream.last_window)){
+                        acq_stats.windows_ok++;
+                    } else {
+                        // La tarea de cálculo no liberó ninguna ventana: se pierde esta
+                        acq_stats.windows_dropped++;
                     }
-                } else {
-                    // Valor fuera de rango - descarto este par V-I
-                    have_v = false;
-                    continue;
                 }
+#if MEASURE_HARMONICS_ENABLE
+                acquisition_harm_capture(evt, v_mv, i_mv);
+#endif
+#if WAVE_CAPTURE_ENABLE
+                waveform_add_sample(v_mv, i_mv);
+#endif
+            }
+#if ADC_PATTERN_LEN > 2
+            acq_stats.samples_invalid = demux.invalid;
+            acq_stats.samples_unpaired = demux.unpaired;
+#else
+            acq_stats.samples_invalid = decoder.invalid;
+            acq_stats.samples_unpaired = decoder.unpaired;
+#endif
 
-                if (channel == ADC_CH_V) {
-                    v_mv = mv;
-                    have_v = true;
-                } else if (channel == ADC_CH_I){
-                    if(!have_v)continue; 
-                    else {
-                        if(measure_add_sample((int16_t)v_mv, (int16_t)mv)){
-                            measure_get_results(&measure_results);
-                            state_update_measure(&measure_results);
-                            //measure_display_results(measure_results);                         
-                        }
-                        have_v = false;
-                    }                 
-                }
+            uint32_t proc_us = (uint32_t)(esp_timer_get_time() - t_start);
+            acq_stats.frame_us_last = proc_us;
+            if(proc_us > acq_stats.frame_us_max) acq_stats.frame_us_max = proc_us;
+            busy_us += proc_us;
+            if(raw_pairs >= ACQ_LOAD_PERIOD_PAIRS){
+                uint64_t signal_us = (uint64_t)raw_pairs * 1000000 / ADC_RAW_FREQ_HZ;
+                acq_stats.load_permil = (uint32_t)((uint64_t)busy_us * 1000 / signal_us);
+                busy_us = 0;
+                raw_pairs = 0;
             }
 
         } else if (ret == ESP_ERR_TIMEOUT){
             // Timeout: No debería ocurrir con portMAX_DELAY, pero está por las dudas
             continue;
         } else if(ret == ESP_ERR_INVALID_STATE){
-            // Overflow porque DMA escribió más rápido de lo que leímos = la tarea quedo bloqueada mucho tiempo
-            ESP_LOGW("ADC", "Warning. Buffer Overflow");
+            // Overflow porque DMA escribió más rápido de lo que leímos = la tarea quedo bloqueada mucho tiempo,
+            // o driver cerrado tras una reconfiguración fallida (adc_dma reintenta abrirlo)
+            ESP_LOGW("ADC", "Warning. Buffer Overflow o driver cerrado");
             continue;
         }
     }
-}
\ No newline at end of file
+}
+
+void task_measure_compute(void *pvParameters){
+
+    (void)pvParameters;
+
+    static measure_t measure_results;
+    static measure_t cycle_results;
+#if MEASURE_AUX_PAIRS > 0
+    static measure_t aux_results[MEASURE_AUX_PAIRS];
+#endif
+#if MEASURE_HARMONICS_ENABLE
+    static harmonics_t harm_results;
+#endif
+    uint32_t bits;
+
+    compute_task_handle = xTaskGetCurrentTaskHandle();
+
+    while(1){
+        xTaskNotifyWait(0, ACQ_NOTIFY_CYCLE | ACQ_NOTIFY_WINDOW | ACQ_NOTIFY_HARM, &bits, portMAX_DELAY);
+
+        if((bits & ACQ_NOTIFY_CYCLE) && cycle_busy){
+            measure_get_results(&cycle_slot, &cycle_results);
+            cycle_busy = false;
+            state_update_cycle(&cycle_results);
+        }
+
+        if(bits & ACQ_NOTIFY_WINDOW){
+            /*proceso las ventanas entregadas en orden de cierre*/
+            while(1){
+                int8_t idx = -1;
+                for(uint8_t k = 0; k < ACQ_NUM_WINDOWS; k++){
+                    if(window_busy[k] && (idx < 0 || window_close_us[k] < window_close_us[idx])) idx = k;
+                }
+                if(idx < 0) break;
+
+                int64_t start_us = esp_timer_get_time();
+                uint32_t latency_us = (uint32_t)(start_us - window_close_us[idx]);
+                acq_stats.handoff_last_us = latency_us;
+                if(latency_us > acq_stats.handoff_max_us) acq_stats.handoff_max_us = latency_us;
+
+                measure_get_results(&windows[idx], &measure_results);
+#if MEASURE_AUX_PAIRS > 0
+                for(uint8_t k = 0; k < MEASURE_AUX_PAIRS; k++){
+                    measure_get_results(&aux_windows[idx][k], &aux_results[k]);
+                }
+#endif
+                calibration_process_window(&windows[idx]);
+                window_busy[idx] = false; // la ventana vuelve a estar disponible para la adquisición
+
+                state_update_measure(&measure_results);
+#if MEASURE_AUX_PAIRS > 0
+                state_update_aux(aux_results);
+#endif
+
+                adc_dma_stats_t dma_stats;
+                app_adc_dma_get_stats(&dma_stats);
+                state_update_dma(&dma_stats);
+                //measure_display_results(measure_results);
+
+                uint32_t compute_us = (uint32_t)(esp_timer_get_time() - start_us);
+                acq_stats.compute_us_last = compute_us;
+                if(compute_us > acq_stats.compute_us_max) acq_stats.compute_us_max = compute_us;
+            }
+        }
+
+#if MEASURE_HARMONICS_ENABLE
+        if((bits & ACQ_NOTIFY_HARM) && harm_busy){
+            harmonics_compute(&harm_capture, &harm_results);
+            harm_busy = false;
+            state_update_harmonics(&harm_results);
+        }
+#endif
+    }
+}
+
+void acquisition_get_stats(acq_stats_t *out){
+    *out = acq_stats;
+}
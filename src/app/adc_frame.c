@@ -0,0 +1,228 @@
+#include "app/adc_frame.h"
+
+#define ADC_FRAME_DATA_MASK 0x0FFFu
+#define ADC_FRAME_CH_SHIFT 12
+#define ADC_FRAME_PAIR_CH_MASK 0xF000F000u
+
+/* Emparejamiento muestra a muestra (camino lento). Retorna 1 si formó un par en v_mv/i_mv */
+static size_t adc_frame_slow_sample(adc_frame_decoder_t *dec, uint16_t s, int16_t *v_mv, int16_t *i_mv){
+    uint8_t ch = (uint8_t)(s >> ADC_FRAME_CH_SHIFT);
+    int16_t mv = dec->lut[s & ADC_FRAME_DATA_MASK];
+
+    if(ch == dec->ch_v){
+        if(dec->have_v) dec->unpaired++; // V sin I: se reemplaza
+        dec->v_pending = mv;
+        dec->have_v = true;
+        return 0;
+    }
+    if(ch == dec->ch_i){
+        if(!dec->have_v){
+            dec->unpaired++;
+            return 0;
+        }
+        *v_mv = dec->v_pending;
+        *i_mv = mv;
+        dec->have_v = false;
+        return 1;
+    }
+
+    dec->invalid++;
+    if(dec->have_v){
+        dec->unpaired++;
+        dec->have_v = false;
+    }
+    return 0;
+}
+
+void adc_frame_decoder_init(adc_frame_decoder_t *dec, uint8_t ch_v, uint8_t ch_i, const int16_t *lut){
+    dec->lut = lut;
+    dec->ch_v = ch_v;
+    dec->ch_i = ch_i;
+    dec->pair_key = ((uint32_t)ch_v << ADC_FRAME_CH_SHIFT) | ((uint32_t)ch_i << (16 + ADC_FRAME_CH_SHIFT));
+    dec->have_v = false;
+    dec->v_pending = 0;
+    dec->invalid = 0;
+    dec->unpaired = 0;
+}
+
+size_t adc_frame_decode(adc_frame_decoder_t *dec, const uint32_t *words, size_t bytes, int16_t *v_mv, int16_t *i_mv){
+
+    const int16_t *lut = dec->lut;
+    const uint32_t key = dec->pair_key;
+    size_t nwords = bytes / 4;
+    size_t n = 0;
+    size_t k = 0;
+
+    while(k < nwords){
+        if(!dec->have_v){
+            // camino rápido: dos palabras (V,I) por iteración
+            for(; k + 1 < nwords; k += 2){
+                uint32_t w0 = words[k];
+                uint32_t w1 = words[k + 1];
+                if(((w0 & ADC_FRAME_PAIR_CH_MASK) != key) | ((w1 & ADC_FRAME_PAIR_CH_MASK) != key)) break;
+
+                v_mv[n]     = lut[w0 & ADC_FRAME_DATA_MASK];
+                i_mv[n]     = lut[(w0 >> 16) & ADC_FRAME_DATA_MASK];
+                v_mv[n + 1] = lut[w1 & ADC_FRAME_DATA_MASK];
+                i_mv[n + 1] = lut[(w1 >> 16) & ADC_FRAME_DATA_MASK];
+                n += 2;
+            }
+            if(k >= nwords) break;
+
+            uint32_t w = words[k];
+            if((w & ADC_FRAME_PAIR_CH_MASK) == key){
+                v_mv[n] = lut[w & ADC_FRAME_DATA_MASK];
+                i_mv[n] = lut[(w >> 16) & ADC_FRAME_DATA_MASK];
+                n++;
+                k++;
+                continue;
+            }
+        }
+
+        // camino lento: secuencia rota o V pendiente
+        uint32_t w = words[k++];
+        n += adc_frame_slow_sample(dec, (uint16_t)w, &v_mv[n], &i_mv[n]);
+        n += adc_frame_slow_sample(dec, (uint16_t)(w >> 16), &v_mv[n], &i_mv[n]);
+    }
+
+    // muestra suelta al final (frame de longitud impar en muestras)
+    if((bytes & 2u) != 0){
+        const uint16_t *tail = (const uint16_t *)&words[nwords];
+        n += adc_frame_slow_sample(dec, *tail, &v_mv[n], &i_mv[n]);
+    }
+
+    return n;
+}
+
+void adc_frame_demux_init(adc_frame_demux_t *dm, const uint8_t *ch, uint8_t n_ch, const int16_t *lut){
+    dm->lut = lut;
+    dm->n_ch = n_ch;
+    dm->pos = 0;
+    dm->invalid = 0;
+    dm->unpaired = 0;
+    for(uint8_t c = 0; c < 16; c++){
+        dm->slot_of[c] = -1;
+    }
+    for(uint8_t k = 0; k < n_ch; k++){
+        dm->slot_of[ch[k] & 0x0F] = (int8_t)k;
+    }
+}
+
+size_t adc_frame_demux(adc_frame_demux_t *dm, const uint16_t *samples, size_t bytes, int16_t *const out[]){
+
+    const int16_t *lut = dm->lut;
+    const uint8_t n_ch = dm->n_ch;
+    size_t nsamples = bytes / ADC_FRAME_SAMPLE_BYTES;
+    uint8_t pos = dm->pos;
+    size_t n = 0;
+
+    // el set incompleto del frame anterior continúa en el primer lugar
+    for(uint8_t k = 0; k < pos; k++){
+        out[k][0] = dm->partial[k];
+    }
+
+    for(size_t j = 0; j < nsamples; j++){
+        uint16_t s = samples[j];
+        int8_t slot = dm->slot_of[s >> ADC_FRAME_CH_SHIFT];
+        int16_t mv = lut[s & ADC_FRAME_DATA_MASK];
+
+        if(slot == (int8_t)pos){
+            out[pos][n] = mv;
+            if(++pos == n_ch){
+                pos = 0;
+                n++;
+            }
+            continue;
+        }
+
+        // desincronización: se descarta el set en curso y se espera al slot 0
+        dm->unpaired += pos;
+        if(slot < 0){
+            dm->invalid++;
+            pos = 0;
+        } else if(slot == 0){
+            out[0][n] = mv;
+            pos = 1;
+        } else {
+            dm->unpaired++;
+            pos = 0;
+        }
+    }
+
+    for(uint8_t k = 0; k < pos; k++){
+        dm->partial[k] = out[k][n];
+    }
+    dm->pos = pos;
+    return n;
+}
+
+void adc_frame_decim_init(adc_frame_decim_t *dec){
+    dec->sum_v = 0;
+    dec->sum_i = 0;
+    dec->count = 0;
+}
+
+size_t adc_frame_decimate(adc_frame_decim_t *dec, int16_t *v_mv, int16_t *i_mv, size_t n){
+#if ADC_OVERSAMPLE > 1
+    int32_t sv = dec->sum_v;
+    int32_t si = dec->sum_i;
+    uint8_t cnt = dec->count;
+    size_t out = 0;
+
+    // out <= k siempre: se escribe sobre pares ya sumados
+    for(size_t k = 0; k < n; k++){
+        sv += v_mv[k];
+        si += i_mv[k];
+        if(++cnt == ADC_OVERSAMPLE){
+            v_mv[out] = (int16_t)((sv + ADC_OVERSAMPLE / 2) / ADC_OVERSAMPLE);
+            i_mv[out] = (int16_t)((si + ADC_OVERSAMPLE / 2) / ADC_OVERSAMPLE);
+            out++;
+            sv = 0;
+            si = 0;
+            cnt = 0;
+        }
+    }
+
+    dec->sum_v = sv;
+    dec->sum_i = si;
+    dec->count = cnt;
+    return out;
+#else
+    (void)dec; (void)v_mv; (void)i_mv;
+    return n;
+#endif
+}
+
+void adc_frame_decim_n_init(adc_frame_decim_n_t *dec){
+    for(uint8_t k = 0; k < ADC_PATTERN_MAX; k++){
+        dec->sum[k] = 0;
+    }
+    dec->count = 0;
+}
+
+size_t adc_frame_decimate_n(adc_frame_decim_n_t *dec, int16_t *const ch[], uint8_t n_ch, size_t n){
+#if ADC_OVERSAMPLE > 1
+    uint8_t cnt = dec->count;
+    size_t out = 0;
+
+    for(size_t j = 0; j < n; j++){
+        for(uint8_t k = 0; k < n_ch; k++){
+            dec->sum[k] += ch[k][j];
+        }
+        if(++cnt == ADC_OVERSAMPLE){
+            for(uint8_t k = 0; k < n_ch; k++){
+                ch[k][out] = (int16_t)((dec->sum[k] + ADC_OVERSAMPLE / 2) / ADC_OVERSAMPLE);
+                dec->sum[k] = 0;
+            }
+            out++;
+            cnt = 0;
+        }
+    }
+
+    dec->count = cnt;
+    return out;
+#else
+    (void)dec; (void)ch; (void)n_ch;
+    return n;
+#endif
+}
@@ -0,0 +1,207 @@
+#include "app/calibration.h"
+#include "core/nvs_config.h"
+#include "core/persist.h"
+#include "esp_log.h"
+#include <math.h>
+
+static const char *TAG = "CAL";
+
+/*pedidos de los comandos: los atiende calibration_process_window()*/
+static volatile cal_step_t req_step = CAL_STEP_NONE;
+static volatile float req_ref = 0.0f;
+static volatile bool req_default = false;
+static volatile bool req_abort = false;
+
+/*estado del paso en curso: sólo lo modifica task_measure_compute*/
+static cal_info_t info;
+static float sum_rms_mv;
+static float max_rms_mv;
+static bool save_pending;           // CAL_DONE cuyo guardado sigue en task_persist
+static uint32_t save_errors_seen;   // persist_stats_t::cal_errors al pedir el guardado
+
+void calibration_init(){
+    measure_cal_t cal;
+
+    measure_cal_default(&cal);
+    if(!nvs_load_cal(&cal)){
+        ESP_LOGI(TAG, "Sin calibracion guardada, usando valores de fabrica");
+    }
+    measure_set_cal(&cal);
+}
+
+bool calibration_start(cal_step_t step, float ref){
+    if(step == CAL_STEP_NONE || step > CAL_STEP_GAIN_I) return false;
+    if((step == CAL_STEP_GAIN_V || step == CAL_STEP_GAIN_I) && !(ref > 0.0f)) return false;
+
+    req_ref = ref;
+    req_step = step; // último: publica el pedido
+    return true;
+}
+
+void calibration_restore_default(){
+    req_default = true;
+}
+
+void calibration_abort(){
+    req_abort = true;
+}
+
+/* Errores de guardado de calibración acumulados por task_persist */
+static uint32_t calibration_save_errors(){
+    persist_stats_t ps;
+    persist_get_stats(&ps);
+    return ps.cal_errors;
+}
+
+/* Paso terminado: aplica y pide guardar cal, o registra el rechazo */
+static void calibration_finish(const measure_cal_t *cal, cal_err_t err){
+    if(err == CAL_ERR_NONE){
+        measure_set_cal(cal);
+        save_errors_seen = calibration_save_errors();
+        save_pending = true;
+        persist_cal(cal);
+    }
+    info.err = err;
+    info.status = (err == CAL_ERR_NONE) ? CAL_DONE : CAL_FAILED;
+    info.runs++;
+    ESP_LOGI(TAG, "%s %s: %.4e", calibration_step_name(info.step), calibration_status_name(info.status), info.result);
+}
+
+/* Resuelve el paso con el promedio (y máximo) de RMS de las ventanas */
+static void calibration_solve(){
+    measure_cal_t cal, fab;
+    measure_get_cal(&cal);
+    measure_cal_default(&fab);
+
+    float mean_v = sum_rms_mv / 1000.0f / info.windows; // [V] a la entrada del ADC
+    float max_v = max_rms_mv / 1000.0f;
+    cal_err_t err = CAL_ERR_NONE;
+
+    switch(info.step){
+    case CAL_STEP_ZERO_V:
+        info.result = CAL_NOISE_MARGIN * max_v / fabsf(cal.v_gain);
+        if(max_v / fabsf(cal.v_gain) > CAL_ZERO_V_MAX) err = CAL_ERR_SIGNAL;
+        cal.v_noise = info.result;
+        break;
+
+    case CAL_STEP_ZERO_I:
+        info.result = mean_v / cal.i_sens;
+        if(max_v / cal.i_sens > CAL_ZERO_I_MAX) err = CAL_ERR_SIGNAL;
+        cal.i_offset = info.result;
+        cal.i_noise = CAL_NOISE_MARGIN * max_v / cal.i_sens;
+        break;
+
+    case CAL_STEP_GAIN_V:
+        // el signo (inversión de fase del divisor) no se puede medir con una referencia RMS
+        info.result = copysignf(mean_v / info.ref, cal.v_gain);
+        if(mean_v * 1000.0f < CAL_GAIN_MIN_MV) err = CAL_ERR_SIGNAL;
+        else if(fabsf(info.result / fab.v_gain - 1.0f) > CAL_GAIN_MAX_DEV) err = CAL_ERR_RANGE;
+        cal.v_gain = info.result;
+        break;
+
+    case CAL_STEP_GAIN_I:
+        // measure_get_results() resta i_offset al Irms: la referencia lo incluye
+        info.result = mean_v / (info.ref + cal.i_offset);
+        if(mean_v * 1000.0f < CAL_GAIN_MIN_MV) err = CAL_ERR_SIGNAL;
+        else if(fabsf(info.result / fab.i_sens - 1.0f) > CAL_GAIN_MAX_DEV) err = CAL_ERR_RANGE;
+        cal.i_sens = info.result;
+        break;
+
+    default:
+        return;
+    }
+
+    calibration_finish(&cal, err);
+}
+
+void calibration_process_window(const measure_accum_t *win){
+
+    if(req_default){
+        req_default = false;
+        measure_cal_t cal;
+        measure_cal_default(&cal);
+        measure_set_cal(&cal);
+        save_pending = false;
+        persist_cal_erase();
+        ESP_LOGI(TAG, "Calibracion de fabrica restaurada");
+    }
+
+    // el guardado del último paso falló en task_persist: queda aplicado pero no guardado
+    if(save_pending && calibration_save_errors() != save_errors_seen){
+        save_pending = false;
+        if(info.status == CAL_DONE){
+            info.status = CAL_FAILED;
+            info.err = CAL_ERR_NVS;
+            ESP_LOGW(TAG, "%s aplicado pero no guardado", calibration_step_name(info.step));
+        }
+    }
+
+    if(req_abort){
+        req_abort = false;
+        if(info.status == CAL_RUNNING){
+            info.status = CAL_FAILED;
+            info.err = CAL_ERR_ABORTED;
+            info.runs++;
+        }
+    }
+
+    cal_step_t step = req_step;
+    if(step != CAL_STEP_NONE){
+        info.ref = req_ref;
+        req_step = CAL_STEP_NONE;
+        info.step = step;
+        save_pending = false;
+        info.status = CAL_RUNNING;
+        info.err = CAL_ERR_NONE;
+        info.windows = 0;
+        info.result = 0.0f;
+        sum_rms_mv = 0.0f;
+        max_rms_mv = 0.0f;
+        return; // la ventana actual pudo empezar antes del pedido
+    }
+
+    if(info.status != CAL_RUNNING) return;
+
+    measure_raw_t raw;
+    measure_get_raw(win, &raw);
+    float rms = (info.step == CAL_STEP_ZERO_V || info.step == CAL_STEP_GAIN_V) ? raw.v_rms_mv : raw.i_rms_mv;
+    sum_rms_mv += rms;
+    if(rms > max_rms_mv) max_rms_mv = rms;
+
+    if(++info.windows >= CAL_WINDOWS){
+        calibration_solve();
+    }
+}
+
+void calibration_get_info(cal_info_t *out){
+    *out = info;
+}
+
+const char *calibration_step_name(cal_step_t step){
+    switch(step){
+    case CAL_STEP_ZERO_V: return "ZERO_V";
+    case CAL_STEP_ZERO_I: return "ZERO_I";
+    case CAL_STEP_GAIN_V: return "GAIN_V";
+    case CAL_STEP_GAIN_I: return "GAIN_I";
+    default:              return "NONE";
+    }
+}
+
+const char *calibration_status_name(cal_status_t status){
+    switch(status){
+    case CAL_RUNNING: return "RUNNING";
+    case CAL_DONE:    return "DONE";
+    case CAL_FAILED:  return "FAILED";
+    default:          return "IDLE";
+    }
+}
+
+const char *calibration_err_name(cal_err_t err){
+    switch(err){
+    case CAL_ERR_SIGNAL:  return "SIGNAL";
+    case CAL_ERR_RANGE:   return "RANGE";
+    case CAL_ERR_NVS:     return "NVS";
+    case CAL_ERR_ABORTED: return "ABORTED";
+    default:              return "NONE";
+    }
+}
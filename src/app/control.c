@@ -1,8 +1,10 @@
 /*conttrol.c*/
 #include "app/control.h"
 #include "core/nvs_config.h"
+#include "core/persist.h"
 #include "app/state.h"
 #include "hal/gpio_loads.h"
+#include "app/waveform.h"
 #include <string.h>
 
 static const char *TAG = "Control";
@@ -189,11 +191,12 @@ int16_t control_get_v_max(uint8_t id){
     return ret;
 }
 
-bool control_save_to_nvs(){
+void control_save_to_nvs(){
+    sys_load_cfg_t cfg;
     xSemaphoreTake(control_mutex, portMAX_DELAY);
-    bool result = nvs_save_config(&s_cfg);
+    cfg = s_cfg;
     xSemaphoreGive(control_mutex);
-    return result;
+    persist_config(&cfg);
 }
 
 bool control_load_from_nvs(){
@@ -259,6 +262,7 @@ bool control_global_fsm(float I){
             ret = false;
             cont_fails_i++;
             timer_stop(&timer_cont_fails_i);
+            waveform_trigger(); // congela la forma de onda alrededor de la falla
         }
         break;
 
@@ -287,6 +291,7 @@ bool control_global_fsm(float I){
             ret = false;
             cont_fails_i++;
             imax_fail = true;
+            waveform_trigger();
         } else if(timer_expired(&timer_global_rec)){
             timer_stop(&timer_global_rec);
             control_global_state = CONTROL_GLOBAL_OK;
@@ -379,8 +384,8 @@ void task_control(void *pvParameters){
             state_t st;
             state_get(&st);
 
-            int16_t V = (int16_t) st.measure.Vrms;
-            float I = (float) st.measure.Irms;
+            int16_t V = (int16_t) st.cycle.Vrms;
+            float I = (float) st.cycle.Irms;
 
             xSemaphoreTake(control_mutex, portMAX_DELAY);
 
@@ -0,0 +1,63 @@
+#include "app/harmonics.h"
+#include "app/measure.h"
+#include <math.h>
+#include <string.h>
+
+/* Valor medio de la captura [mV] */
+static float harmonics_mean(const int16_t *x, uint16_t n){
+    int32_t sum = 0;
+    for(uint16_t j = 0; j < n; j++){
+        sum += x[j];
+    }
+    return (float)sum / (float)n;
+}
+
+/* Magnitud RMS (en las unidades de x) del bin k de una DFT de n puntos */
+static float harmonics_goertzel(const int16_t *x, uint16_t n, float dc, float coeff){
+    float s1 = 0.0f, s2 = 0.0f;
+
+    // sin la DC el resonador de k=1 (coeff ≈ 2) no acumula offset y no pierde precisión en float
+    for(uint16_t j = 0; j < n; j++){
+        float s0 = ((float)x[j] - dc) + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    float power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+    if(power < 0.0f) power = 0.0f;
+
+    return sqrtf(2.0f * power) / (float)n;
+}
+
+/* THD [%] a partir de las magnitudes de cada armónico */
+static float harmonics_thd(const float *h, float floor){
+    if(h[0] <= floor) return 0.0f;
+
+    float sum = 0.0f;
+    for(uint8_t k = 1; k < HARM_NUM; k++){
+        sum += h[k] * h[k];
+    }
+    return 100.0f * sqrtf(sum) / h[0];
+}
+
+void harmonics_compute(const harmonics_capture_t *cap, harmonics_t *out){
+
+    memset(out, 0, sizeof(*out));
+    if(cap->n < 2 * HARM_NUM + 1) return;
+
+    measure_cal_t cal;
+    measure_get_cal(&cal);
+    const float v_scale = 1.0f / 1000.0f / fabsf(cal.v_gain);
+    const float i_scale = 1.0f / 1000.0f / cal.i_sens;
+
+    float v_dc = harmonics_mean(cap->v, cap->n);
+    float i_dc = harmonics_mean(cap->i, cap->n);
+
+    for(uint8_t k = 1; k <= HARM_NUM; k++){
+        float coeff = 2.0f * cosf(2.0f * (float)M_PI * k / (float)cap->n);
+        out->v[k - 1] = harmonics_goertzel(cap->v, cap->n, v_dc, coeff) * v_scale;
+        out->i[k - 1] = harmonics_goertzel(cap->i, cap->n, i_dc, coeff) * i_scale;
+    }
+
+    out->thd_v = harmonics_thd(out->v, cal.v_noise);
+    out->thd_i = harmonics_thd(out->i, cal.i_noise);
+}
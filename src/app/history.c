@@ -0,0 +1,785 @@
+#include "app/history.h"
+#include "core/persist.h"
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_partition.h"
+#include "esp_crc.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "HIST";
+
+#define HIST_VALUES (3 * HIST_FIELDS)           // avg, min y max de cada campo
+#define SECTOR_BYTES 4096
+#define SLOTS_PER_SECTOR (SECTOR_BYTES / HIST_SLOT_BYTES)
+
+#define REC_KEY   'K'
+#define REC_DELTA 'D'
+
+/*escalas de un delta: una para el promedio de cada campo y otra para su mín y máx*/
+#define DELTA_SCALES (2 * HIST_FIELDS)
+
+/*registros en flash*/
+typedef struct {
+    uint8_t kind;
+    uint8_t flags;
+    uint16_t n;
+    uint16_t dt;                // períodos desde el registro anterior
+    uint8_t shift[DELTA_SCALES / 2];    // escala 2^s, un nibble por escala (delta_scale_of())
+    int8_t d[HIST_VALUES];      // diferencia con el registro anterior, en pasos de 2^s
+    uint16_t crc;
+} hist_delta_rec_t;
+
+typedef struct {
+    uint8_t kind;
+    uint8_t flags;
+    uint16_t n;
+    uint32_t sect_seq;          // secuencia del sector que la contiene
+    uint32_t t;
+    int16_t q[HIST_VALUES];
+    uint8_t pad[14];
+    uint16_t crc;
+} hist_key_rec_t;
+
+typedef union {
+    uint8_t kind;
+    hist_delta_rec_t delta;
+    hist_key_rec_t key;
+} hist_rec_t;
+
+_Static_assert(sizeof(hist_delta_rec_t) == HIST_SLOT_BYTES, "registro delta: un lugar");
+_Static_assert(sizeof(hist_key_rec_t) == 2 * HIST_SLOT_BYTES, "registro clave: dos lugares");
+
+/*anillo de un nivel en flash*/
+typedef struct {
+    uint32_t first;                         // primer sector en la partición
+    uint32_t sectors;
+    uint32_t period;                        // [s]
+    uint32_t seq[HIST_RING_MAX_SECTORS];    // secuencia de cada sector (0: vacío o roto)
+    uint32_t t0[HIST_RING_MAX_SECTORS];     // t de la clave inicial de cada sector
+    uint32_t head;                          // sector en escritura
+    uint16_t slot;                          // próximo lugar de head
+    uint32_t last_seq;                      // 0: anillo vacío
+    bool chain;                             // el próximo registro puede ser delta
+    uint32_t t;                             // último punto escrito
+    int16_t q[HIST_VALUES];
+} hist_ring_t;
+
+/*acumulador de un intervalo*/
+typedef struct {
+    uint32_t t;
+    uint32_t n;
+    uint8_t flags;
+    float sum[HIST_FIELDS];
+    float min[HIST_FIELDS];
+    float max[HIST_FIELDS];
+} hist_acc_t;
+
+typedef struct {
+    int16_t q[HIST_FIELDS];
+    uint8_t n;                              // 0: segundo sin ventanas
+} hist_sec_t;
+
+static const float hist_step[HIST_FIELDS] = {0.1f, 0.01f, 1.0f, 1.0f, 0.001f, 0.01f};
+
+/*flash: la escribe task_persist, la leen las consultas*/
+static const esp_partition_t *part;
+static SemaphoreHandle_t flash_mutex;
+static hist_ring_t rings[2];                // HIST_TIER_MIN, HIST_TIER_HOUR
+static uint32_t time_base;                  // history_now() sin reloj = time_base + uptime
+static uint32_t stat_records, stat_keys, stat_erases, boot_us;
+
+/*segundos y cola de puntos: productor task_measure_compute*/
+static portMUX_TYPE hist_lock = portMUX_INITIALIZER_UNLOCKED;
+static hist_sec_t sec_ring[HIST_SEC_LEN];
+static uint32_t sec_last;                   // segundo de uptime de la última entrada
+static uint32_t sec_count;
+static hist_point_t pending[HIST_PENDING_LEN];
+static uint8_t pend_head, pend_count;
+static uint32_t stat_dropped;
+
+/*acumuladores: sólo el productor*/
+static hist_acc_t acc_sec, acc_min, acc_hour;
+static uint8_t boot_flags = HIST_F_BOOT;    // para el primer minuto y la primera hora
+
+static inline uint32_t uptime_s(){
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+static uint32_t hist_time(uint32_t up){
+    time_t now = time(NULL);
+    if(now >= (time_t)HIST_EPOCH_VALID) return (uint32_t)now;
+    return time_base + up;
+}
+
+uint32_t history_now(){
+    return hist_time(uptime_s());
+}
+
+float history_to_float(hist_field_t field, int16_t q){
+    return q * hist_step[field];
+}
+
+static const char *const tier_names[HIST_TIERS] = {"SEC", "MIN", "HOUR"};
+
+const char *history_tier_name(hist_tier_t tier){
+    return (tier < HIST_TIERS) ? tier_names[tier] : "?";
+}
+
+bool history_tier_parse(const char *name, hist_tier_t *tier){
+    for(uint8_t k = 0; k < HIST_TIERS; k++){
+        if(strcmp(name, tier_names[k]) == 0){
+            *tier = (hist_tier_t)k;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline int16_t clamp_q(int32_t q){
+    if(q < -32767) return -32767;
+    if(q > 32767) return 32767;
+    return (int16_t)q;
+}
+
+static int16_t quantize(hist_field_t field, float v){
+    float q = roundf(v / hist_step[field]);
+    if(!(q > -32767.0f)) return -32767;     // incluye NaN
+    if(q > 32767.0f) return 32767;
+    return (int16_t)q;
+}
+
+/* ========================================================================== */
+/*                      FLASH                                                 */
+/* ========================================================================== */
+
+static inline uint32_t slot_addr(const hist_ring_t *r, uint32_t sector, uint32_t slot){
+    return (r->first + sector) * SECTOR_BYTES + slot * HIST_SLOT_BYTES;
+}
+
+static uint16_t rec_crc(const void *rec, size_t len){
+    return esp_crc16_le(0, rec, len - sizeof(uint16_t));  // el CRC es el último campo
+}
+
+/* Escala que usa el valor k (0..HIST_VALUES-1): su promedio solo, o mín y máx juntos */
+static inline uint8_t delta_scale_of(uint8_t k){
+    return (k < HIST_FIELDS) ? k : HIST_FIELDS + k % HIST_FIELDS;
+}
+
+static inline uint8_t delta_shift(const hist_delta_rec_t *rec, uint8_t k){
+    uint8_t g = delta_scale_of(k);
+    return (rec->shift[g / 2] >> ((g % 2) * 4)) & 0x0F;
+}
+
+/* d / 2^s redondeado (al más cercano, medios hacia +inf) */
+static inline int32_t delta_scale(int32_t d, uint8_t s){
+    return (s == 0) ? d : (d + (1 << (s - 1))) >> s;
+}
+
+/* Valor que reconstruye el decodificador a partir del anterior y el delta */
+static inline int16_t delta_apply(int16_t prev, int8_t d, uint8_t s){
+    return clamp_q((int32_t)prev + (int32_t)d * (1 << s));
+}
+
+/*
+ * Decodifica el registro en (sector, *slot) sobre t y q, y avanza *slot.
+ * Retorna false al final de los datos del sector: lugar libre, CRC roto o
+ * delta sin clave previa.
+ */
+static bool ring_decode(const hist_ring_t *r, uint32_t sector, uint16_t *slot, uint32_t *t, int16_t *q, uint16_t *n, uint8_t *flags){
+    hist_rec_t rec;
+
+    if(*slot >= SLOTS_PER_SECTOR) return false;
+    if(esp_partition_read(part, slot_addr(r, sector, *slot), &rec, HIST_SLOT_BYTES) != ESP_OK) return false;
+
+    if(rec.kind == REC_KEY){
+        if(*slot + 2 > SLOTS_PER_SECTOR) return false;
+        if(esp_partition_read(part, slot_addr(r, sector, *slot + 1), (uint8_t *)&rec + HIST_SLOT_BYTES, HIST_SLOT_BYTES) != ESP_OK) return false;
+        if(rec_crc(&rec.key, sizeof(rec.key)) != rec.key.crc) return false;
+        *t = rec.key.t;
+        memcpy(q, rec.key.q, sizeof(rec.key.q));
+        *n = rec.key.n;
+        *flags = rec.key.flags;
+        *slot += 2;
+        return true;
+    }
+    if(rec.kind == REC_DELTA && *slot > 0){
+        if(rec_crc(&rec.delta, sizeof(rec.delta)) != rec.delta.crc) return false;
+        *t += (uint32_t)rec.delta.dt * r->period;
+        for(uint8_t k = 0; k < HIST_VALUES; k++){
+            q[k] = delta_apply(q[k], rec.delta.d[k], delta_shift(&rec.delta, k));
+        }
+        *n = rec.delta.n;
+        *flags = rec.delta.flags;
+        *slot += 1;
+        return true;
+    }
+    return false;
+}
+
+/* true si los lugares [slot, slot + count) están borrados */
+static bool slots_free(const hist_ring_t *r, uint32_t sector, uint32_t slot, uint32_t count){
+    uint8_t buf[HIST_SLOT_BYTES];
+    for(uint32_t s = slot; s < slot + count; s++){
+        if(esp_partition_read(part, slot_addr(r, sector, s), buf, sizeof(buf)) != ESP_OK) return false;
+        for(uint8_t k = 0; k < sizeof(buf); k++){
+            if(buf[k] != 0xFF) return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Arma el índice de sectores (secuencia y t de la clave inicial), toma como
+ * cabeza el de mayor secuencia y la recorre hasta el último registro válido.
+ * Se sigue escribiendo ahí si los dos lugares siguientes están borrados
+ * (el primer registro después del arranque es una clave); si no, en el
+ * sector siguiente.
+ */
+static void ring_recover(hist_ring_t *r){
+    hist_key_rec_t key;
+
+    r->last_seq = 0;
+    r->head = 0;
+    for(uint32_t s = 0; s < r->sectors; s++){
+        r->seq[s] = 0;
+        if(esp_partition_read(part, slot_addr(r, s, 0), &key, sizeof(key)) != ESP_OK) continue;
+        if(key.kind != REC_KEY || key.sect_seq == 0 || rec_crc(&key, sizeof(key)) != key.crc) continue;
+        r->seq[s] = key.sect_seq;
+        r->t0[s] = key.t;
+        if(key.sect_seq > r->last_seq){
+            r->last_seq = key.sect_seq;
+            r->head = s;
+        }
+    }
+
+    r->slot = 0;
+    r->chain = false;
+    r->t = 0;
+    if(r->last_seq == 0) return;
+
+    uint16_t slot = 0, n;
+    uint8_t flags;
+    while(ring_decode(r, r->head, &slot, &r->t, r->q, &n, &flags)){
+        r->slot = slot;
+    }
+    if(r->slot + 2 > SLOTS_PER_SECTOR || !slots_free(r, r->head, r->slot, 2)){
+        r->head = (r->head + 1) % r->sectors;
+        r->slot = 0;
+    }
+}
+
+/* Escribe un punto en su anillo. Retorna false si falló la flash */
+static bool ring_write(hist_ring_t *r, const hist_point_t *p){
+    int16_t q[HIST_VALUES];
+    memcpy(&q[0], p->avg, sizeof(p->avg));
+    memcpy(&q[HIST_FIELDS], p->min, sizeof(p->min));
+    memcpy(&q[2 * HIST_FIELDS], p->max, sizeof(p->max));
+
+    if(r->last_seq != 0 && p->t <= r->t){
+        portENTER_CRITICAL(&hist_lock);
+        stat_dropped++;                     // el reloj retrocedió
+        portEXIT_CRITICAL(&hist_lock);
+        return true;
+    }
+
+    hist_rec_t rec;
+    memset(&rec, 0xFF, sizeof(rec));
+
+    bool key = !r->chain || (p->flags & HIST_F_BOOT);
+    uint32_t gap = p->t - r->t;
+    if(!key && (gap % r->period != 0 || gap / r->period > 0xFFFF)) key = true;
+
+    // delta: cada escala es la menor 2^s en la que sus valores entran en int8
+    int16_t dq[HIST_VALUES];
+    if(!key){
+        uint8_t s[DELTA_SCALES] = {0};
+        for(uint8_t k = 0; k < HIST_VALUES; k++){
+            int32_t d = (int32_t)q[k] - r->q[k];
+            uint8_t g = delta_scale_of(k);
+            while(delta_scale(d, s[g]) < INT8_MIN || delta_scale(d, s[g]) > INT8_MAX) s[g]++;
+        }
+        memset(rec.delta.shift, 0, sizeof(rec.delta.shift));
+        for(uint8_t g = 0; g < DELTA_SCALES; g++){
+            rec.delta.shift[g / 2] |= (uint8_t)(s[g] << ((g % 2) * 4));
+        }
+        for(uint8_t k = 0; k < HIST_VALUES; k++){
+            uint8_t sk = s[delta_scale_of(k)];
+            rec.delta.d[k] = (int8_t)delta_scale((int32_t)q[k] - r->q[k], sk);
+            dq[k] = delta_apply(r->q[k], rec.delta.d[k], sk);
+        }
+    }
+
+    uint16_t need = key ? 2 : 1;
+    if(r->slot + need > SLOTS_PER_SECTOR){
+        r->head = (r->head + 1) % r->sectors;
+        r->slot = 0;
+    }
+
+    esp_err_t err = ESP_OK;
+    uint32_t sect_seq = r->seq[r->head];
+    if(r->slot == 0){
+        // sector nuevo: se borra (pierde los datos más viejos) y empieza con clave
+        r->seq[r->head] = 0;
+        err = esp_partition_erase_range(part, slot_addr(r, r->head, 0), SECTOR_BYTES);
+        if(err == ESP_OK) stat_erases++;
+        key = true;
+        need = 2;
+        sect_seq = r->last_seq + 1;
+    }
+
+    if(err == ESP_OK){
+        if(key){
+            memset(&rec, 0xFF, sizeof(rec));    // pudo quedar un delta armado
+            rec.key.kind = REC_KEY;
+            rec.key.flags = p->flags;
+            rec.key.n = p->n;
+            rec.key.sect_seq = sect_seq;
+            rec.key.t = p->t;
+            memcpy(rec.key.q, q, sizeof(q));
+            rec.key.crc = rec_crc(&rec.key, sizeof(rec.key));
+        } else {
+            rec.delta.kind = REC_DELTA;
+            rec.delta.flags = p->flags;
+            rec.delta.n = p->n;
+            rec.delta.dt = (uint16_t)(gap / r->period);
+            rec.delta.crc = rec_crc(&rec.delta, sizeof(rec.delta));
+        }
+        err = esp_partition_write(part, slot_addr(r, r->head, r->slot), &rec, need * HIST_SLOT_BYTES);
+    }
+
+    if(err != ESP_OK){
+        // en el primer lugar se reintenta el mismo sector; más adelante se abandona
+        if(r->slot != 0){
+            r->head = (r->head + 1) % r->sectors;
+            r->slot = 0;
+        }
+        r->chain = false;
+        portENTER_CRITICAL(&hist_lock);
+        stat_dropped++;
+        portEXIT_CRITICAL(&hist_lock);
+        ESP_LOGE(TAG, "Fallo la escritura: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    if(r->slot == 0){
+        r->seq[r->head] = sect_seq;
+        r->t0[r->head] = p->t;
+        r->last_seq = sect_seq;
+    }
+    r->slot += need;
+    r->t = p->t;
+    memcpy(r->q, key ? q : dq, sizeof(q));  // el valor que va a leer el decodificador
+    r->chain = true;
+    stat_records++;
+    if(key) stat_keys++;
+    return true;
+}
+
+bool history_init(){
+    int64_t t0 = esp_timer_get_time();
+
+    flash_mutex = xSemaphoreCreateMutex();
+    configASSERT(flash_mutex != NULL);
+
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, HIST_PARTITION);
+    uint32_t sectors = (part != NULL) ? part->size / SECTOR_BYTES : 0;
+    if(sectors < 4){
+        ESP_LOGW(TAG, "Sin partición '%s': sólo historial de segundos", HIST_PARTITION);
+        part = NULL;
+        return false;
+    }
+
+    hist_ring_t *rm = &rings[HIST_TIER_MIN - 1];
+    hist_ring_t *rh = &rings[HIST_TIER_HOUR - 1];
+    rm->first = 0;
+    rm->sectors = (HIST_MIN_SECTORS < sectors / 2) ? HIST_MIN_SECTORS : sectors / 2;
+    rm->period = 60;
+    rh->first = rm->sectors;
+    rh->sectors = sectors - rm->sectors;
+    if(rh->sectors > HIST_RING_MAX_SECTORS) rh->sectors = HIST_RING_MAX_SECTORS;
+    rh->period = 3600;
+
+    ring_recover(rm);
+    ring_recover(rh);
+
+    // el contador sin reloj sigue desde el fin del último intervalo guardado
+    uint32_t last = 0;
+    for(uint8_t k = 0; k < 2; k++){
+        if(rings[k].last_seq != 0 && rings[k].t + rings[k].period > last) last = rings[k].t + rings[k].period;
+    }
+    uint32_t up = uptime_s();
+    time_base = (last > up) ? last - up : 0;
+
+    boot_us = (uint32_t)(esp_timer_get_time() - t0);
+    ESP_LOGI(TAG, "Recuperado: minutos hasta %lu, horas hasta %lu (%lu us)", (unsigned long)rm->t, (unsigned long)rh->t, (unsigned long)boot_us);
+    return true;
+}
+
+bool history_flush(){
+    if(part == NULL) return true;
+
+    bool ok = true;
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    while(1){
+        hist_point_t p;
+        portENTER_CRITICAL(&hist_lock);
+        bool empty = (pend_count == 0);
+        if(!empty){
+            p = pending[pend_head];
+            pend_head = (pend_head + 1) % HIST_PENDING_LEN;
+            pend_count--;
+        }
+        portEXIT_CRITICAL(&hist_lock);
+        if(empty) break;
+
+        ok &= ring_write(&rings[p.tier - 1], &p);
+    }
+    xSemaphoreGive(flash_mutex);
+    return ok;
+}
+
+/* ========================================================================== */
+/*                      ACUMULACIÓN                                           */
+/* ========================================================================== */
+
+static void acc_start(hist_acc_t *a, uint32_t t){
+    a->t = t;
+    a->n = 0;
+    a->flags = 0;
+    for(uint8_t k = 0; k < HIST_FIELDS; k++){
+        a->sum[k] = 0.0f;
+        a->min[k] = INFINITY;
+        a->max[k] = -INFINITY;
+    }
+}
+
+static void acc_merge(hist_acc_t *a, const hist_acc_t *b){
+    a->n += b->n;
+    for(uint8_t k = 0; k < HIST_FIELDS; k++){
+        a->sum[k] += b->sum[k];
+        if(b->min[k] < a->min[k]) a->min[k] = b->min[k];
+        if(b->max[k] > a->max[k]) a->max[k] = b->max[k];
+    }
+}
+
+static void acc_point(const hist_acc_t *a, hist_tier_t tier, hist_point_t *p){
+    p->t = a->t;
+    p->n = (a->n > 0xFFFF) ? 0xFFFF : (uint16_t)a->n;
+    p->tier = tier;
+    p->flags = a->flags;
+    for(uint8_t k = 0; k < HIST_FIELDS; k++){
+        p->avg[k] = quantize(k, a->sum[k] / a->n);
+        p->min[k] = quantize(k, a->min[k]);
+        p->max[k] = quantize(k, a->max[k]);
+    }
+}
+
+static void pending_push(const hist_point_t *p){
+    portENTER_CRITICAL(&hist_lock);
+    if(pend_count == HIST_PENDING_LEN){
+        pend_head = (pend_head + 1) % HIST_PENDING_LEN;    // se pierde el más viejo
+        pend_count--;
+        stat_dropped++;
+    }
+    pending[(pend_head + pend_count) % HIST_PENDING_LEN] = *p;
+    pend_count++;
+    portEXIT_CRITICAL(&hist_lock);
+    persist_history();
+}
+
+static void sec_close(){
+    hist_sec_t e;
+    for(uint8_t k = 0; k < HIST_FIELDS; k++){
+        e.q[k] = quantize(k, acc_sec.sum[k] / acc_sec.n);
+    }
+    e.n = (acc_sec.n > 0xFF) ? 0xFF : (uint8_t)acc_sec.n;
+
+    portENTER_CRITICAL(&hist_lock);
+    uint32_t step = (sec_count == 0) ? 1 : acc_sec.t - sec_last;
+    // segundos sin ventanas (cálculo demorado): entradas vacías
+    for(uint32_t k = 1; k < step && k <= HIST_SEC_LEN; k++){
+        sec_ring[(acc_sec.t - k) % HIST_SEC_LEN].n = 0;
+    }
+    sec_ring[acc_sec.t % HIST_SEC_LEN] = e;
+    sec_count = (sec_count + step > HIST_SEC_LEN) ? HIST_SEC_LEN : sec_count + step;
+    sec_last = acc_sec.t;
+    portEXIT_CRITICAL(&hist_lock);
+}
+
+/* Cierra el minuto y lo suma a la hora; la hora se cierra con el primer minuto de la siguiente */
+static void min_close(){
+    hist_point_t p;
+    acc_point(&acc_min, HIST_TIER_MIN, &p);
+    pending_push(&p);
+
+    uint32_t hour = acc_min.t / 3600 * 3600;
+    if(acc_hour.n != 0 && acc_hour.t != hour){
+        acc_point(&acc_hour, HIST_TIER_HOUR, &p);
+        pending_push(&p);
+        acc_hour.n = 0;
+    }
+    if(acc_hour.n == 0){
+        acc_start(&acc_hour, hour);
+        acc_hour.flags = acc_min.flags;
+    }
+    acc_merge(&acc_hour, &acc_min);
+}
+
+void history_add(const measure_t *m){
+    const float v[HIST_FIELDS] = {m->Vrms, m->Irms, m->P, m->Q, m->fp, m->f};
+    uint32_t up = uptime_s();
+
+    if(acc_sec.n != 0 && acc_sec.t != up){
+        sec_close();
+        acc_sec.n = 0;
+    }
+    if(acc_sec.n == 0) acc_start(&acc_sec, up);
+
+    if(part != NULL){
+        uint32_t minute = hist_time(up) / 60 * 60;
+        if(acc_min.n != 0 && acc_min.t != minute){
+            min_close();
+            acc_min.n = 0;
+        }
+        if(acc_min.n == 0){
+            acc_start(&acc_min, minute);
+            acc_min.flags = boot_flags;
+            boot_flags = 0;
+        }
+    }
+
+    acc_sec.n++;
+    for(uint8_t k = 0; k < HIST_FIELDS; k++){
+        acc_sec.sum[k] += v[k];
+    }
+    if(part == NULL) return;
+
+    acc_min.n++;
+    for(uint8_t k = 0; k < HIST_FIELDS; k++){
+        acc_min.sum[k] += v[k];
+        if(v[k] < acc_min.min[k]) acc_min.min[k] = v[k];
+        if(v[k] > acc_min.max[k]) acc_min.max[k] = v[k];
+    }
+}
+
+/* ========================================================================== */
+/*                      CONSULTAS                                             */
+/* ========================================================================== */
+
+/* Elige el sector desde donde empezar: el más nuevo que arranca antes de from, o el más viejo */
+static bool cursor_seek(const hist_ring_t *r, hist_cursor_t *c){
+    int32_t best = -1, oldest = -1;
+    for(uint32_t s = 0; s < r->sectors; s++){
+        if(r->seq[s] == 0) continue;
+        if(oldest < 0 || r->seq[s] < r->seq[oldest]) oldest = s;
+        if(r->t0[s] <= c->from && (best < 0 || r->seq[s] > r->seq[best])) best = s;
+    }
+    if(best < 0) best = oldest;
+    if(best < 0) return false;
+
+    c->sector = best;
+    c->sect_seq = r->seq[best];
+    c->slot = 0;
+    return true;
+}
+
+static size_t query_sec(hist_cursor_t *c, hist_point_t *out, size_t max){
+    size_t k = 0;
+
+    uint32_t up = uptime_s();
+    int64_t off = (int64_t)hist_time(up) - up;  // t = segundo de uptime + off
+
+    portENTER_CRITICAL(&hist_lock);
+    int64_t first = (int64_t)sec_last - sec_count + 1;
+    int64_t u = (int64_t)c->from - off;
+    if(u < first) u = first;
+
+    for(; k < max && sec_count != 0 && u <= (int64_t)sec_last && u + off <= (int64_t)c->to; u++){
+        const hist_sec_t *e = &sec_ring[u % HIST_SEC_LEN];
+        if(e->n == 0) continue;
+        hist_point_t *p = &out[k++];
+        p->t = (uint32_t)(u + off);
+        p->n = e->n;
+        p->tier = HIST_TIER_SEC;
+        p->flags = 0;
+        memcpy(p->avg, e->q, sizeof(p->avg));
+        memcpy(p->min, e->q, sizeof(p->min));
+        memcpy(p->max, e->q, sizeof(p->max));
+    }
+    portEXIT_CRITICAL(&hist_lock);
+
+    if(k < max) c->done = true;
+    if(k > 0) c->from = out[k - 1].t + 1;
+    return k;
+}
+
+void history_query_begin(hist_cursor_t *c, hist_tier_t tier, uint32_t from, uint32_t to){
+    memset(c, 0, sizeof(*c));
+    c->tier = tier;
+    c->from = from;
+    c->to = to;
+    c->sector = -1;
+    c->done = (tier >= HIST_TIERS) || from > to || (tier != HIST_TIER_SEC && part == NULL);
+}
+
+size_t history_query_next(hist_cursor_t *c, hist_point_t *out, size_t max){
+    if(c->done) return 0;
+    if(c->tier == HIST_TIER_SEC) return query_sec(c, out, max);
+
+    const hist_ring_t *r = &rings[c->tier - 1];
+    size_t k = 0;
+
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    while(k < max && !c->done){
+        // sector pisado por el anillo (o primera vez): se busca de nuevo desde from
+        if(c->sector < 0 || r->seq[c->sector] != c->sect_seq){
+            if(!cursor_seek(r, c)){
+                c->done = true;
+                break;
+            }
+        }
+
+        uint16_t n;
+        uint8_t flags;
+        if(!ring_decode(r, c->sector, &c->slot, &c->t, c->q, &n, &flags)){
+            uint32_t next = (c->sector + 1) % r->sectors;
+            if((uint32_t)c->sector == r->head || r->seq[next] <= c->sect_seq){
+                c->done = true;     // era el sector más nuevo
+            } else {
+                c->sector = next;
+                c->sect_seq = r->seq[next];
+                c->slot = 0;
+            }
+            continue;
+        }
+        if(c->t > c->to){
+            c->done = true;
+            break;
+        }
+        if(c->t < c->from) continue;
+
+        hist_point_t *p = &out[k++];
+        p->t = c->t;
+        p->n = n;
+        p->tier = c->tier;
+        p->flags = flags;
+        memcpy(p->avg, &c->q[0], sizeof(p->avg));
+        memcpy(p->min, &c->q[HIST_FIELDS], sizeof(p->min));
+        memcpy(p->max, &c->q[2 * HIST_FIELDS], sizeof(p->max));
+        c->from = c->t + 1;
+    }
+    xSemaphoreGive(flash_mutex);
+    return k;
+}
+
+/*volcado por UART: una consulta a la vez, leída en orden*/
+static hist_tier_t dump_tier;
+static uint32_t dump_from, dump_to;
+static hist_cursor_t dump_cur;
+static hist_point_t dump_buf[4];
+static size_t dump_bytes, dump_pos;
+static uint32_t dump_offset;
+static bool dump_active;            // entre history_dump_begin() y la última lectura
+static int64_t dump_last_us;        // última lectura (o el pedido)
+
+bool history_dump_begin(hist_tier_t tier, uint32_t from, uint32_t to){
+    int64_t now = esp_timer_get_time();
+    bool busy;
+
+    portENTER_CRITICAL(&hist_lock);
+    busy = dump_active && (now - dump_last_us) < (int64_t)HIST_DUMP_IDLE_MS * 1000;
+    if(!busy){
+        dump_tier = tier;
+        dump_from = from;
+        dump_to = to;
+        dump_active = true;
+        dump_last_us = now;
+    }
+    portEXIT_CRITICAL(&hist_lock);
+    return !busy;
+}
+
+/* Fin del volcado: libera el cursor para el próximo history_dump_begin() */
+static size_t history_dump_end(){
+    portENTER_CRITICAL(&hist_lock);
+    dump_active = false;
+    portEXIT_CRITICAL(&hist_lock);
+    return 0;
+}
+
+size_t history_dump_read(uint32_t offset, uint8_t *dst, size_t len){
+    if(!dump_active) return 0;
+    if(offset == 0){
+        hist_tier_t tier;
+        uint32_t from, to;
+        portENTER_CRITICAL(&hist_lock);
+        tier = dump_tier;
+        from = dump_from;
+        to = dump_to;
+        portEXIT_CRITICAL(&hist_lock);
+        history_query_begin(&dump_cur, tier, from, to);
+        dump_bytes = dump_pos = 0;
+        dump_offset = 0;
+    }
+    if(offset != dump_offset) return 0;
+
+    size_t done = 0;
+    while(done < len){
+        if(dump_pos == dump_bytes){
+            size_t n = history_query_next(&dump_cur, dump_buf, sizeof(dump_buf) / sizeof(dump_buf[0]));
+            if(n == 0) break;
+            dump_bytes = n * sizeof(hist_point_t);
+            dump_pos = 0;
+        }
+        size_t chunk = dump_bytes - dump_pos;
+        if(chunk > len - done) chunk = len - done;
+        memcpy(dst + done, (const uint8_t *)dump_buf + dump_pos, chunk);
+        dump_pos += chunk;
+        done += chunk;
+    }
+    if(done == 0) return history_dump_end();
+
+    dump_offset += done;
+    portENTER_CRITICAL(&hist_lock);
+    dump_last_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&hist_lock);
+    return done;
+}
+
+void history_get_info(hist_info_t *out){
+    memset(out, 0, sizeof(*out));
+    out->now = history_now();
+
+    portENTER_CRITICAL(&hist_lock);
+    if(sec_count != 0){
+        uint32_t off = out->now - uptime_s();
+        out->newest[HIST_TIER_SEC] = sec_last + off;
+        out->oldest[HIST_TIER_SEC] = sec_last + off - sec_count + 1;
+    }
+    out->dropped = stat_dropped;
+    portEXIT_CRITICAL(&hist_lock);
+
+    if(part == NULL) return;
+    out->flash = true;
+
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    for(uint8_t k = 0; k < 2; k++){
+        const hist_ring_t *r = &rings[k];
+        if(r->last_seq == 0) continue;
+        uint32_t oldest = 0;
+        for(uint32_t s = 0; s < r->sectors; s++){
+            if(r->seq[s] != 0 && (oldest == 0 || r->t0[s] < oldest)) oldest = r->t0[s];
+        }
+        out->oldest[HIST_TIER_MIN + k] = oldest;
+        out->newest[HIST_TIER_MIN + k] = r->t;
+    }
+    out->records = stat_records;
+    out->keys = stat_keys;
+    out->erases = stat_erases;
+    out->boot_us = boot_us;
+    xSemaphoreGive(flash_mutex);
+}
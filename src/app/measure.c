@@ -1,76 +1,441 @@
 #include "measure.h"
 #include "string.h"
 
-static int16_t v_buf[NUM_SAMPLES_ACCUM];
-static int16_t i_buf[NUM_SAMPLES_ACCUM];
-static size_t  sample_index = 0;
+void measure_accum_reset(measure_accum_t *acc){
+    memset(acc, 0, sizeof(*acc));
+    acc->v_max = INT16_MIN;
+    acc->v_min = INT16_MAX;
+    acc->i_max = INT16_MIN;
+    acc->i_min = INT16_MAX;
+}
+
+static inline void measure_accum_add(measure_accum_t *acc, int16_t v_mv, int16_t i_mv){
+
+#if MEASURE_FIXED_POINT
+    int32_t v = v_mv;
+    int32_t i = i_mv;
 
-bool measure_add_sample(int16_t v_mv, int16_t i_mv){
+    // productos en 32 bits (|v·i| < 2^24), suma en 64 bits
+    acc->sum_v += v;
+    acc->sum_i += i;
+    acc->sum_v2 += (int64_t)(v * v);
+    acc->sum_i2 += (int64_t)(i * i);
+    acc->sum_vi += (int64_t)(v * i);
+    acc->sum_q += (int64_t)(acc->v_last * i - v * acc->i_last);
+#else
+    double v = (double)v_mv;
+    double i = (double)i_mv;
 
-    v_buf[sample_index] = v_mv;
-    i_buf[sample_index] = i_mv;
-    sample_index++;
+    acc->sum_v += v;
+    acc->sum_i += i;
+    acc->sum_v2 += v * v;
+    acc->sum_i2 += i * i;
+    acc->sum_vi += v * i;
+    acc->sum_q += acc->v_last * i - v * acc->i_last;
+#endif
 
-    if(sample_index >= NUM_SAMPLES_ACCUM){
-        sample_index = 0;
-        return true;
+    // con el acumulador vacío v_last = i_last = 0 y el término cruzado es nulo
+    if(acc->n == 0){
+        acc->v_first = v_mv;
+        acc->i_first = i_mv;
     }
-    return false;
+    acc->v_last = v_mv;
+    acc->i_last = i_mv;
+
+    if(v_mv > acc->v_max) acc->v_max = v_mv;
+    if(v_mv < acc->v_min) acc->v_min = v_mv;
+    if(i_mv > acc->i_max) acc->i_max = i_mv;
+    if(i_mv < acc->i_min) acc->i_min = i_mv;
+
+    acc->n++;
 }
 
-void measure_get_results(measure_t *out){
+static void measure_accum_merge(measure_accum_t *dst, const measure_accum_t *src){
+    if(src->n == 0) return;
+
+    // término cruzado entre la última muestra de dst y la primera de src (nulo si dst está vacío)
+    dst->sum_q += src->sum_q + ((measure_sum2_t)dst->v_last * src->i_first - (measure_sum2_t)src->v_first * dst->i_last);
+    if(dst->n == 0){
+        dst->v_first = src->v_first;
+        dst->i_first = src->i_first;
+    }
+    dst->v_last = src->v_last;
+    dst->i_last = src->i_last;
+
+    dst->n += src->n;
+    dst->sum_v += src->sum_v;
+    dst->sum_i += src->sum_i;
+    dst->sum_v2 += src->sum_v2;
+    dst->sum_i2 += src->sum_i2;
+    dst->sum_vi += src->sum_vi;
+    if(src->v_max > dst->v_max) dst->v_max = src->v_max;
+    if(src->v_min < dst->v_min) dst->v_min = src->v_min;
+    if(src->i_max > dst->i_max) dst->i_max = src->i_max;
+    if(src->i_min < dst->i_min) dst->i_min = src->i_min;
+    dst->zc_periods += src->zc_periods;
+    dst->zc_span += src->zc_span;
+}
+
+void measure_stream_init(measure_stream_t *st){
+    memset(st, 0, sizeof(*st));
+    measure_accum_reset(&st->cycle);
+    measure_accum_reset(&st->window);
+    measure_accum_reset(&st->last_cycle);
+    measure_accum_reset(&st->last_window);
+    st->zc_level = 0; // con nivel 0 nunca se arma: ciclos por longitud hasta conocer la DC
+    st->zc_armed = false;
+    st->zc_valid = false;
+    st->min_pairs = MEASURE_MIN_CYCLE_PAIRS;
+    st->max_pairs = MEASURE_MAX_CYCLE_PAIRS;
+}
 
-    double sum_v = 0.0, v_dc, v_ac_meas, v_ac_real, v_pk = 0.0;
-    double sum_i = 0.0, i_dc, i_ac_meas, i_ac_real, i_pk = 0.0;
-    double sum_rms_v = 0.0, sum_rms_i = 0.0, sum_p_inst = 0.0;
-    double Vrms, Irms, P, S, fp;
+/* Ajusta los límites de largo de ciclo al período medido en la ventana */
+static void measure_track_period(measure_stream_t *st, const measure_accum_t *win){
+    if(win->zc_periods == 0) return; // sin cruces: se conserva la última red vista
 
-    for(uint16_t k = 0; k < NUM_SAMPLES_ACCUM; k++){
-        sum_v += v_buf[k];
-        sum_i += i_buf[k];
+    float period = win->zc_span / (float)win->zc_periods;
+    const float period_min = (float)SAMPLE_FREQ_HZ / MEASURE_FREQ_MAX_HZ;
+    const float period_max = (float)SAMPLE_FREQ_HZ / MEASURE_FREQ_MIN_HZ;
+    if(period < period_min) period = period_min;
+    if(period > period_max) period = period_max;
+
+    st->min_pairs = (uint16_t)(period / 2.0f);
+    st->max_pairs = (uint16_t)(period * 5.0f / 4.0f);
+}
+
+/* Cierra el ciclo de los pares auxiliares junto con el principal (y la ventana si close_window) */
+static void measure_aux_close_cycle(measure_aux_t *aux, const measure_accum_t *main_cycle, bool close_window){
+    for(uint8_t k = 0; k < aux->n; k++){
+        aux->cycle[k].zc_periods = main_cycle->zc_periods;
+        aux->cycle[k].zc_span = main_cycle->zc_span;
+        measure_accum_merge(&aux->window[k], &aux->cycle[k]);
+        measure_accum_reset(&aux->cycle[k]);
+        if(close_window){
+            aux->last_window[k] = aux->window[k];
+            measure_accum_reset(&aux->window[k]);
+        }
     }
+}
+
+/* Cierra el ciclo en curso y, si corresponde, la ventana. Retorna los eventos generados */
+static uint8_t measure_close_cycle(measure_stream_t *st){
+    uint8_t evt = MEASURE_EVT_CYCLE;
+    bool close_window = (st->window_cycles + 1 >= NUM_CYCLES_ACCUM);
 
-    v_dc = sum_v / (double)NUM_SAMPLES_ACCUM;
-    i_dc = sum_i / (double)NUM_SAMPLES_ACCUM;
+    if(st->aux != NULL) measure_aux_close_cycle(st->aux, &st->cycle, close_window);
 
-    for(uint16_t k = 0; k < NUM_SAMPLES_ACCUM; k++){
-        v_ac_meas = ((double)v_buf[k] - v_dc)/1000.0;
-        v_ac_real = v_ac_meas / VOLT_DRIVER_GAIN;
-        i_ac_meas = ((double)i_buf[k] - i_dc)/1000.0;
-        i_ac_real = i_ac_meas / ACS712_5A_SENSITIVITY;
+    st->last_cycle = st->cycle;
+    measure_accum_merge(&st->window, &st->cycle);
+    st->window_cycles++;
+    measure_accum_reset(&st->cycle);
 
-        if(v_ac_real > v_pk) v_pk = v_ac_real;
-        if(i_ac_real > i_pk) i_pk = i_ac_real;
+    if(close_window){
+        st->last_window = st->window;
+        // la DC de esta ventana es el nivel de cruce de la siguiente
+        st->zc_level = (int16_t)(st->window.sum_v / (measure_sum_t)st->window.n);
+        measure_track_period(st, &st->window);
+        measure_accum_reset(&st->window);
+        st->window_cycles = 0;
+        evt |= MEASURE_EVT_WINDOW;
+    }
+    return evt;
+}
+
+void measure_aux_init(measure_stream_t *st, measure_aux_t *aux, const measure_pair_slots_t *slots, uint8_t n){
+    memset(aux, 0, sizeof(*aux));
+    if(n > MEASURE_AUX_MAX) n = MEASURE_AUX_MAX;
+    aux->n = n;
+    for(uint8_t k = 0; k < n; k++){
+        aux->slots[k] = slots[k];
+        aux->skew_q15[k] = (int32_t)MEASURE_SKEW_Q15 * (slots[k].i_slot - slots[k].v_slot);
+        measure_accum_reset(&aux->cycle[k]);
+        measure_accum_reset(&aux->window[k]);
+        measure_accum_reset(&aux->last_window[k]);
+    }
+    st->aux = aux;
+}
+
+/* Detector de cruce por cero ascendente con histéresis: cierra el ciclo antes de acumular la muestra actual */
+static inline uint8_t measure_zc_detect(measure_stream_t *st, int16_t v_mv){
+    uint8_t evt = MEASURE_EVT_NONE;
+
+    st->sample_idx++;
+
+    if(v_mv < st->zc_level - MEASURE_ZC_HYST_MV){
+        st->zc_armed = true;
+    } else if(st->zc_armed && v_mv >= st->zc_level){
+        st->zc_armed = false;
+        // un cruce antes de medio ciclo es ruido: no cierra el ciclo
+        if(st->cycle.n >= st->min_pairs){
+            // v_prev < zc_level <= v_mv: posición del cruce entre ambas muestras
+            float frac = (float)(st->zc_level - st->v_prev) / (float)(v_mv - st->v_prev);
+            if(st->zc_valid){
+                st->cycle.zc_span = (float)(st->sample_idx - st->zc_idx) + (frac - st->zc_frac);
+                st->cycle.zc_periods = 1;
+            }
+            st->zc_idx = st->sample_idx;
+            st->zc_frac = frac;
+            st->zc_valid = true;
+            evt = measure_close_cycle(st); // la muestra actual abre el ciclo nuevo
+        }
+    }
+    st->v_prev = v_mv;
+    return evt;
+}
+
+uint8_t measure_add_sample(measure_stream_t *st, int16_t v_mv, int16_t i_mv){
+
+    uint8_t evt;
+
+#if MEASURE_SKEW_COMP
+    // I[n] se convirtió después que V[n]: V se interpola a ese instante con V[n+1], el par sale una muestra tarde
+    if(!st->skew_primed){
+        st->skew_v = v_mv;
+        st->skew_i = i_mv;
+        st->skew_primed = true;
+        return MEASURE_EVT_NONE;
+    }
+    int16_t v_al = (int16_t)(st->skew_v + (((int32_t)(v_mv - st->skew_v) * MEASURE_SKEW_Q15 + (1 << 14)) >> 15));
+    int16_t i_al = st->skew_i;
+    st->skew_v = v_mv;
+    st->skew_i = i_mv;
+    v_mv = v_al;
+    i_mv = i_al;
+#endif
+
+    evt = measure_zc_detect(st, v_mv);
+
+    measure_accum_add(&st->cycle, v_mv, i_mv);
+
+    /*sin cruces válidos: cierre por longitud máxima*/
+    if(st->cycle.n >= st->max_pairs){
+        st->zc_valid = false; // el próximo ciclo no empieza en un cruce
+        evt |= measure_close_cycle(st);
+    }
+    return evt;
+}
+
+uint8_t measure_add_set(measure_stream_t *st, int16_t *const ch[], size_t p){
+
+    uint8_t evt;
+    measure_aux_t *aux = st->aux;
+    uint8_t n_aux = (aux != NULL) ? aux->n : 0;
+    int16_t v_mv = ch[0][p];
+    int16_t i_mv = ch[1][p];
+    int16_t aux_v[MEASURE_AUX_MAX];
+    int16_t aux_i[MEASURE_AUX_MAX];
+
+    for(uint8_t k = 0; k < n_aux; k++){
+        aux_v[k] = ch[aux->slots[k].v_slot][p];
+        aux_i[k] = ch[aux->slots[k].i_slot][p];
+    }
+
+#if MEASURE_SKEW_COMP
+    // igual que measure_add_sample(); cada par auxiliar con su distancia entre slots
+    if(!st->skew_primed){
+        st->skew_v = v_mv;
+        st->skew_i = i_mv;
+        for(uint8_t k = 0; k < n_aux; k++){
+            aux->skew_v[k] = aux_v[k];
+            aux->skew_i[k] = aux_i[k];
+        }
+        st->skew_primed = true;
+        return MEASURE_EVT_NONE;
+    }
+    int16_t v_al = (int16_t)(st->skew_v + (((int32_t)(v_mv - st->skew_v) * MEASURE_SKEW_Q15 + (1 << 14)) >> 15));
+    int16_t i_al = st->skew_i;
+    st->skew_v = v_mv;
+    st->skew_i = i_mv;
+    v_mv = v_al;
+    i_mv = i_al;
 
-        sum_rms_v += v_ac_real * v_ac_real;
-        sum_rms_i += i_ac_real * i_ac_real;
-        sum_p_inst += v_ac_real * i_ac_real;
+    for(uint8_t k = 0; k < n_aux; k++){
+        int16_t v_now = aux_v[k];
+        int16_t i_now = aux_i[k];
+        aux_v[k] = (int16_t)(aux->skew_v[k] + (((int32_t)(v_now - aux->skew_v[k]) * aux->skew_q15[k] + (1 << 14)) >> 15));
+        aux_i[k] = aux->skew_i[k];
+        aux->skew_v[k] = v_now;
+        aux->skew_i[k] = i_now;
     }
+#endif
 
-    Vrms = sqrt(sum_rms_v / (double)NUM_SAMPLES_ACCUM);
-    Irms = sqrt(sum_rms_i / (double)NUM_SAMPLES_ACCUM);
-    P = (sum_p_inst / (double)NUM_SAMPLES_ACCUM);
-    if(Vrms <= VOLT_DRIVER_GROUNDNOISE){
+    evt = measure_zc_detect(st, v_mv);
+
+    measure_accum_add(&st->cycle, v_mv, i_mv);
+    for(uint8_t k = 0; k < n_aux; k++){
+        measure_accum_add(&aux->cycle[k], aux_v[k], aux_i[k]);
+    }
+
+    /*sin cruces válidos: cierre por longitud máxima (los auxiliares se cierran con el principal)*/
+    if(st->cycle.n >= st->max_pairs){
+        st->zc_valid = false;
+        evt |= measure_close_cycle(st);
+    }
+    return evt;
+}
+
+/* Calibración vigente: sólo la lee el cierre de ciclo/ventana */
+static measure_cal_t measure_cal = {
+    .v_gain = (float)VOLT_DRIVER_GAIN,
+    .i_sens = ACS712_5A_SENSITIVITY,
+    .v_noise = VOLT_DRIVER_GROUNDNOISE,
+    .i_noise = ACS712_GROUNDNOISE,
+    .i_offset = ACS712_OFFSET,
+};
+
+void measure_cal_default(measure_cal_t *cal){
+    cal->v_gain = (float)VOLT_DRIVER_GAIN;
+    cal->i_sens = ACS712_5A_SENSITIVITY;
+    cal->v_noise = VOLT_DRIVER_GROUNDNOISE;
+    cal->i_noise = ACS712_GROUNDNOISE;
+    cal->i_offset = ACS712_OFFSET;
+}
+
+void measure_set_cal(const measure_cal_t *cal){
+    measure_cal = *cal;
+}
+
+void measure_get_cal(measure_cal_t *cal){
+    *cal = measure_cal;
+}
+
+/* DC y momentos centrados (varianzas y covarianza) de un acumulador no vacío [mV, mV²] */
+static void measure_moments(const measure_accum_t *acc, double *v_dc, double *i_dc, double *var_v, double *var_i, double *cov_vi){
+
+    double N = (double)acc->n;
+
+    *v_dc = (double)acc->sum_v / N;
+    *i_dc = (double)acc->sum_i / N;
+
+#if MEASURE_FIXED_POINT
+    // Numeradores exactos en int64: N·Σv² ≤ N²·2^24, sin overflow para N < ~700k pares
+    int64_t n64 = acc->n;
+    *var_v = (double)(n64 * acc->sum_v2 - (int64_t)acc->sum_v * acc->sum_v) / (N * N);
+    *var_i = (double)(n64 * acc->sum_i2 - (int64_t)acc->sum_i * acc->sum_i) / (N * N);
+    *cov_vi = (double)(n64 * acc->sum_vi - (int64_t)acc->sum_v * acc->sum_i) / (N * N);
+#else
+    // Numeradores exactos: las sumas son enteros representables en double
+    *var_v = (N * acc->sum_v2 - acc->sum_v * acc->sum_v) / (N * N);
+    *var_i = (N * acc->sum_i2 - acc->sum_i * acc->sum_i) / (N * N);
+    *cov_vi = (N * acc->sum_vi - acc->sum_v * acc->sum_i) / (N * N);
+#endif
+    if(*var_v < 0.0) *var_v = 0.0;
+    if(*var_i < 0.0) *var_i = 0.0;
+}
+
+void measure_get_raw(const measure_accum_t *acc, measure_raw_t *out){
+
+    double v_dc, i_dc, var_v, var_i, cov_vi;
+
+    memset(out, 0, sizeof(*out));
+    if(acc->n == 0) return;
+
+    measure_moments(acc, &v_dc, &i_dc, &var_v, &var_i, &cov_vi);
+    out->v_dc_mv = v_dc;
+    out->i_dc_mv = i_dc;
+    out->v_rms_mv = sqrt(var_v);
+    out->i_rms_mv = sqrt(var_i);
+}
+
+void measure_get_results(const measure_accum_t *acc, measure_t *out){
+
+    double v_dc, i_dc, v_pk, i_pk, v_ext, i_ext;
+    double var_v, var_i, cov_vi, cross_vi;
+    double Vrms, Irms, P, Q, S, fp, fp_disp, f;
+
+    memset(out, 0, sizeof(*out));
+    if(acc->n == 0) return;
+
+    double N = (double)acc->n;
+    const double v_gain = measure_cal.v_gain;
+    const double i_sens = measure_cal.i_sens;
+
+    measure_moments(acc, &v_dc, &i_dc, &var_v, &var_i, &cov_vi);
+
+    // ⟨v[n-1]·i[n] - v[n]·i[n-1]⟩ sin DC: la DC sólo aporta términos de borde (suma telescópica)
+    cross_vi = 0.0;
+    if(acc->n > 1){
+        cross_vi = ((double)acc->sum_q - v_dc * (acc->i_last - acc->i_first) + i_dc * (acc->v_last - acc->v_first)) / (N - 1.0);
+    }
+
+    // Picos AC: el mayor desvío respecto de DC en la dirección de la ganancia (puede ser negativa)
+    v_pk = 0.0;
+    v_ext = ((double)acc->v_max - v_dc) / 1000.0 / v_gain;
+    if(v_ext > v_pk) v_pk = v_ext;
+    v_ext = ((double)acc->v_min - v_dc) / 1000.0 / v_gain;
+    if(v_ext > v_pk) v_pk = v_ext;
+
+    i_pk = 0.0;
+    i_ext = ((double)acc->i_max - i_dc) / 1000.0 / i_sens;
+    if(i_ext > i_pk) i_pk = i_ext;
+    i_ext = ((double)acc->i_min - i_dc) / 1000.0 / i_sens;
+    if(i_ext > i_pk) i_pk = i_ext;
+
+    Vrms = sqrt(var_v) / 1000.0 / fabs(v_gain);
+    Irms = sqrt(var_i) / 1000.0 / i_sens;
+    P = cov_vi / 1e6 / (v_gain * i_sens);
+
+    // para sinusoides ⟨v[n-1]·i[n] - v[n]·i[n-1]⟩ = 2·Q·sin(ω), con ω = 2π·f/fs
+    f = (acc->zc_periods > 0 && acc->zc_span > 0.0f) ? (double)SAMPLE_FREQ_HZ * acc->zc_periods / acc->zc_span : 0.0;
+    double w = 2.0 * M_PI * (f > 0.0 ? f : (double)FUND_FREQ_HZ) / (double)SAMPLE_FREQ_HZ;
+    Q = cross_vi / (2.0 * sin(w)) / 1e6 / (v_gain * i_sens);
+
+    if(Vrms <= measure_cal.v_noise){
         Vrms = 0;
         P = 0;
+        Q = 0;
     }
-    if(Irms <= ACS712_GROUNDNOISE){
+    if(Irms <= measure_cal.i_noise){
         Irms = 0;
         P = 0;
+        Q = 0;
     }
     S = Vrms * Irms;
     fp = (S > 1e-6) ? fabs(P) / S : 0.0;
+    double s1 = sqrt(P * P + Q * Q);
+    fp_disp = (s1 > 1e-6) ? fabs(P) / s1 : 0.0;
 
     out->Vrms = Vrms;
     out->VDC = v_dc/1000.0;
     out->Vpk = v_pk;
-    out->Irms = (Irms <= ACS712_OFFSET)? 0.0 : (Irms - ACS712_OFFSET);
+    out->Irms = (Irms <= measure_cal.i_offset)? 0.0 : (Irms - measure_cal.i_offset);
     out->IDC = i_dc/1000.0;
     out->Ipk = i_pk;
     out->P = P;
+    out->Q = Q;
     out->S = S;
     out->fp = fp;
-    out->E = P*(double)TIME_SAMPLE_H;
+    out->fp_disp = fp_disp;
+    out->f = f;
+    out->E = P * N / (double)SAMPLE_FREQ_HZ / 3600.0;
+    out->Eq = fabs(Q) * N / (double)SAMPLE_FREQ_HZ / 3600.0;
+}
+
+void measure_total(const measure_t *phases, uint8_t n, measure_t *out){
+
+    memset(out, 0, sizeof(*out));
+    if(n == 0) return;
+
+    for(uint8_t k = 0; k < n; k++){
+        out->Vrms += phases[k].Vrms;
+        out->Irms += phases[k].Irms;
+        if(phases[k].Vpk > out->Vpk) out->Vpk = phases[k].Vpk;
+        if(phases[k].Ipk > out->Ipk) out->Ipk = phases[k].Ipk;
+        out->P += phases[k].P;
+        out->Q += phases[k].Q;
+        out->S += phases[k].S;
+        out->E += phases[k].E;
+        out->Eq += phases[k].Eq;
+    }
+    out->Vrms /= n;
+    out->Irms /= n;
+    out->VDC = phases[0].VDC;
+    out->IDC = phases[0].IDC;
+    out->f = phases[0].f;
+
+    out->fp = (out->S > 1e-6f) ? fabsf(out->P) / out->S : 0.0f;
+    float s1 = sqrtf(out->P * out->P + out->Q * out->Q);
+    out->fp_disp = (s1 > 1e-6f) ? fabsf(out->P) / s1 : 0.0f;
 }
 
 void measure_display_results(measure_t results){
@@ -78,5 +443,5 @@ void measure_display_results(measure_t results){
     printf("\nResultados medición:\n");
     printf(" Tensiones:\n  Vrms = %.2f V,\n  Vdc = %.2f V,\n  Vpk = %.2f V,\n", results.Vrms, results.VDC, results.Vpk);
     printf(" Corrientes:\n  Irms = %.2f A,\n  Idc = %.2f A,\n  Ipk_real = %.2f A,\n", results.Irms, results.IDC, results.Ipk);
-    printf(" Potencia:\n  P = %.2f W,\n  S = %.2f VA,\n  fp = %.3f\n", results.P, results.S, results.fp);
+    printf(" Potencia:\n  P = %.2f W,\n  Q = %.2f var,\n  S = %.2f VA,\n  fp = %.3f,\n  fp_disp = %.3f\n", results.P, results.Q, results.S, results.fp, results.fp_disp);
 }
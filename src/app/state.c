@@ -1,21 +1,125 @@
 #include "state.h"
+#include "freertos/event_groups.h"
+#include "core/persist.h"
+#include "core/energy_log.h"
+#include "app/history.h"
 #include <string.h>
+#include <stdatomic.h>
 
 static state_t state;
-static SemaphoreHandle_t state_mutex;
-static double last_saved_E = 0.0;
+static portMUX_TYPE state_lock = portMUX_INITIALIZER_UNLOCKED;  // serializa a los escritores
+static atomic_uint state_seq;                                   // impar: escritura en curso
+static energy_regs_t last_saved;
+static double save_ths = SAVE_ENERGY_THS_KWH;  // ENERGY_LOG_STEP_KWH con el diario
+
+/*suscriptores a los avisos de cambio: sólo se agregan, nunca se quitan*/
+static EventGroupHandle_t sub_group[STATE_MAX_SUBS];
+static uint32_t sub_mask[STATE_MAX_SUBS];
+static atomic_int sub_count;
+
+/* Abre una escritura: los lectores que la crucen reintentan */
+static inline void state_write_begin(){
+    portENTER_CRITICAL(&state_lock);
+    unsigned seq = atomic_load_explicit(&state_seq, memory_order_relaxed);
+    atomic_store_explicit(&state_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/* Publica la escritura */
+static inline void state_write_end(){
+    unsigned seq = atomic_load_explicit(&state_seq, memory_order_relaxed);
+    atomic_store_explicit(&state_seq, seq + 1, memory_order_release);
+    portEXIT_CRITICAL(&state_lock);
+}
+
+/* Avisa a los suscriptores de los dominios en ev (fuera de la escritura) */
+static void state_notify(uint32_t ev){
+    int n = atomic_load_explicit(&sub_count, memory_order_acquire);
+    for(int i = 0; i < n; i++){
+        uint32_t bits = sub_mask[i] & ev;
+        if(bits) xEventGroupSetBits(sub_group[i], bits);
+    }
+}
+
+static float win_E;                     // energía de la última state_update_measure() [kWh]
+
+#if MEASURE_TOPOLOGY == MEASURE_TOPO_PER_LOAD
+/* Con corriente por salida cada carga suma su energía medida (escritura abierta) */
+static void state_attribute_energy(const measure_t *aux){
+    double sum = 0.0;
+    for(uint8_t i = 0; i < NUM_LOADS; i++){
+        if(aux[i].E > 0.0f){
+            state.load_energy.E[i] += aux[i].E;
+            sum += aux[i].E;
+        }
+    }
+    if(win_E > sum){
+        state.load_energy.E_other += win_E - sum;
+    }
+}
+#else
+/*línea de tiempo de las salidas desde el último cierre de ventana*/
+static float out_share_ms[NUM_LOADS];   // tiempo encendida, repartido entre las encendidas a la vez
+static float out_other_ms;              // tiempo con todas apagadas
+static TickType_t out_tick;
+
+/* Integra el tramo desde la última marca con las salidas vigentes (escritura abierta) */
+static void state_outputs_integrate(){
+    TickType_t now = xTaskGetTickCount();
+    float dt = pdTICKS_TO_MS(now - out_tick);
+    out_tick = now;
+
+    uint8_t n_on = 0;
+    for(uint8_t i = 0; i < NUM_LOADS; i++){
+        n_on += state.output[i]? 1 : 0;
+    }
+    if(n_on == 0){
+        out_other_ms += dt;
+        return;
+    }
+    for(uint8_t i = 0; i < NUM_LOADS; i++){
+        if(state.output[i]) out_share_ms[i] += dt / n_on;
+    }
+}
+
+/* Reparte la energía importada de la ventana según la línea de tiempo (escritura abierta) */
+static void state_attribute_energy(float E){
+    state_outputs_integrate();
+
+    float total = out_other_ms;
+    for(uint8_t i = 0; i < NUM_LOADS; i++){
+        total += out_share_ms[i];
+    }
+
+    if(E > 0.0f){
+        if(total > 0.0f){
+            for(uint8_t i = 0; i < NUM_LOADS; i++){
+                state.load_energy.E[i] += E * out_share_ms[i] / total;
+            }
+            state.load_energy.E_other += E * out_other_ms / total;
+        } else {
+            state.load_energy.E_other += E;
+        }
+    }
+
+    memset(out_share_ms, 0, sizeof(out_share_ms));
+    out_other_ms = 0.0f;
+}
+#endif
 
 void state_init(){
-    state_mutex = xSemaphoreCreateMutex();
-    configASSERT(state_mutex != NULL);
+    atomic_store(&state_seq, 0);
     memset(&state, 0, sizeof(state));
+#if MEASURE_TOPOLOGY != MEASURE_TOPO_PER_LOAD
+    out_tick = xTaskGetTickCount();
+#endif
     state_set_energy();
 }
 
 void state_update_measure(const measure_t *m){
     bool should_save = false;
 
-    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    state_write_begin();
     state.measure.Vrms = m->Vrms;
     state.measure.VDC = m->VDC;
     state.measure.Vpk = m->Vpk;
@@ -23,57 +127,233 @@ void state_update_measure(const measure_t *m){
     state.measure.IDC = m->IDC;
     state.measure.Ipk = m->Ipk;
     state.measure.P = m->P;
+    state.measure.Q = m->Q;
     state.measure.S = m->S;
     state.measure.fp = m->fp;
-    state.measure.E += m->E;
+    state.measure.fp_disp = m->fp_disp;
+    state.measure.f = m->f;
+
+    state.energy.E += m->E;
+    if(m->E >= 0.0f){
+        state.energy.E_imp += m->E;
+    } else {
+        state.energy.E_exp -= m->E;
+    }
+    state.energy.E_q += m->Eq;
+    state.measure.E = state.energy.E;
+    state.measure.Eq = state.energy.E_q;
+
+    win_E = m->E;
+#if MEASURE_AUX_PAIRS == 0
+    state_attribute_energy(m->E);
+    state.gen.measure++;
+#endif
 
-    double delta = state.measure.E - last_saved_E;
-    if(delta >= SAVE_ENERGY_THS_KWH){
+    // los registros sólo crecen: se guarda cuando su avance conjunto supera el umbral
+    double delta = (state.energy.E_imp - last_saved.E_imp) + (state.energy.E_exp - last_saved.E_exp) + (state.energy.E_q - last_saved.E_q);
+    energy_regs_t to_save;
+    load_energy_t loads_to_save;
+    if(delta >= save_ths){
         should_save = true;
-        last_saved_E = state.measure.E;
+        last_saved = state.energy;
+        to_save = state.energy;
+        loads_to_save = state.load_energy;
     }
-    xSemaphoreGive(state_mutex);
+    state_write_end();
+
+#if MEASURE_AUX_PAIRS == 0
+    state_notify(STATE_EV_MEASURE);
+#endif
+
+    history_add(m);
 
     if(should_save){
-        nvs_save_energy(last_saved_E);
-        ESP_LOGI("STATE", "Energía guardada automáticamente: %.3f kWh", last_saved_E);
+        // la energía por carga no avanza más que la importada: se guarda con el mismo disparo
+        persist_energy(&to_save, &loads_to_save);
+        ESP_LOGI("STATE", "Guardado de energía pedido: %.3f kWh", to_save.E);
     }
 }
 
+#if MEASURE_AUX_PAIRS > 0
+void state_update_aux(const measure_t *aux){
+    state_write_begin();
+    memcpy(state.aux, aux, sizeof(state.aux));
+
+#if MEASURE_TOPOLOGY == MEASURE_TOPO_PER_LOAD
+    state_attribute_energy(aux);
+#elif MEASURE_TOPOLOGY == MEASURE_TOPO_THREE_PHASE
+    // los registros suman las tres fases: la A entró en state_update_measure()
+    for(uint8_t k = 0; k < MEASURE_AUX_PAIRS; k++){
+        state.energy.E += aux[k].E;
+        if(aux[k].E >= 0.0f){
+            state.energy.E_imp += aux[k].E;
+        } else {
+            state.energy.E_exp -= aux[k].E;
+        }
+        state.energy.E_q += aux[k].Eq;
+    }
+    state.measure.E = state.energy.E;
+    state.measure.Eq = state.energy.E_q;
+
+    float E = win_E;
+    for(uint8_t k = 0; k < MEASURE_AUX_PAIRS; k++){
+        E += aux[k].E;
+    }
+    state_attribute_energy(E);
+
+    measure_t phases[1 + MEASURE_AUX_PAIRS];
+    phases[0] = state.measure;
+    memcpy(&phases[1], aux, MEASURE_AUX_PAIRS * sizeof(measure_t));
+    measure_total(phases, 1 + MEASURE_AUX_PAIRS, &state.total);
+    state.total.E = state.energy.E;
+    state.total.Eq = state.energy.E_q;
+#endif
+    // la ventana se completa con los pares auxiliares
+    state.gen.measure++;
+    state_write_end();
+
+    state_notify(STATE_EV_MEASURE);
+}
+#endif
+
+void state_update_cycle(const measure_t *m){
+    state_write_begin();
+    state.cycle = *m;
+    state_write_end();
+}
+
+void state_update_harmonics(const harmonics_t *h){
+    state_write_begin();
+    state.harm = *h;
+    state_write_end();
+}
+
+void state_update_dma(const adc_dma_stats_t *d){
+    state_write_begin();
+    state.dma = *d;
+    state_write_end();
+}
+
 void state_update_outputs(const bool *out){ 
-    xSemaphoreTake(state_mutex, portMAX_DELAY);
-    memcpy(state.output, out, NUM_LOADS * sizeof(bool));
-    xSemaphoreGive(state_mutex);
+    state_write_begin();
+#if MEASURE_TOPOLOGY != MEASURE_TOPO_PER_LOAD
+    state_outputs_integrate();
+#endif
+    bool changed = memcmp(state.output, out, NUM_LOADS * sizeof(bool)) != 0;
+    if(changed){
+        memcpy(state.output, out, NUM_LOADS * sizeof(bool));
+        state.gen.outputs++;
+    }
+    state_write_end();
+
+    if(changed) state_notify(STATE_EV_OUTPUTS);
 } 
 
 void state_update_fails(const fail_t *fails){
-    xSemaphoreTake(state_mutex, portMAX_DELAY);
-    state.fails = *fails;
-    xSemaphoreGive(state_mutex);
+    state_write_begin();
+    bool changed = memcmp(&state.fails, fails, sizeof(fail_t)) != 0;
+    if(changed){
+        state.fails = *fails;
+        state.gen.fails++;
+    }
+    state_write_end();
+
+    if(changed) state_notify(STATE_EV_FAILS);
 } 
 
 void state_get(state_t *out){
-    xSemaphoreTake(state_mutex, portMAX_DELAY);
-    *out = state;
-    xSemaphoreGive(state_mutex);
+    unsigned s0, s1;
+    do{
+        s0 = atomic_load_explicit(&state_seq, memory_order_acquire);
+        if(s0 & 1u) continue; // escritor activo en el otro núcleo: son microsegundos
+        memcpy(out, (const void *)&state, sizeof(state_t));
+        atomic_thread_fence(memory_order_acquire);
+        s1 = atomic_load_explicit(&state_seq, memory_order_relaxed);
+    } while((s0 & 1u) || s0 != s1);
+}
+
+void state_get_gen(state_gen_t *out){
+    unsigned s0, s1;
+    do{
+        s0 = atomic_load_explicit(&state_seq, memory_order_acquire);
+        if(s0 & 1u) continue;
+        memcpy(out, (const void *)&state.gen, sizeof(state_gen_t));
+        atomic_thread_fence(memory_order_acquire);
+        s1 = atomic_load_explicit(&state_seq, memory_order_relaxed);
+    } while((s0 & 1u) || s0 != s1);
+}
+
+state_sub_t state_subscribe(uint32_t mask){
+    EventGroupHandle_t group = xEventGroupCreate();
+    if(group == NULL) return -1;
+
+    state_sub_t sub = -1;
+    portENTER_CRITICAL(&state_lock);
+    int n = atomic_load_explicit(&sub_count, memory_order_relaxed);
+    if(n < STATE_MAX_SUBS){
+        sub_group[n] = group;
+        sub_mask[n] = (mask & STATE_EV_ALL) | STATE_EV_WAKE;
+        atomic_store_explicit(&sub_count, n + 1, memory_order_release);
+        sub = n;
+    }
+    portEXIT_CRITICAL(&state_lock);
+
+    if(sub < 0){
+        vEventGroupDelete(group);
+        ESP_LOGW("STATE", "Sin lugar para otro suscriptor, se sondea");
+    }
+    return sub;
+}
+
+uint32_t state_wait(state_sub_t sub, uint32_t timeout_ms){
+    if(sub < 0 || sub >= atomic_load_explicit(&sub_count, memory_order_acquire)){
+        vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+        return STATE_EV_ALL;
+    }
+    return xEventGroupWaitBits(sub_group[sub], STATE_EV_ALL, pdTRUE, pdFALSE, pdMS_TO_TICKS(timeout_ms)) & STATE_EV_ALL;
+}
+
+void state_wake(state_sub_t sub){
+    if(sub < 0 || sub >= atomic_load_explicit(&sub_count, memory_order_acquire)) return;
+    xEventGroupSetBits(sub_group[sub], STATE_EV_WAKE);
 }
 
 void state_reset_energy(){
-    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    energy_regs_t regs = {0};
+    load_energy_t loads = {0};
+
+    state_write_begin();
+    state.energy = regs;
+    state.load_energy = loads;
     state.measure.E = 0.0;
-    nvs_save_energy(0.0);
-    last_saved_E = 0.0;
+    state.measure.Eq = 0.0;
+    last_saved = regs;
+    state.gen.measure++;
+    state_write_end();
+
+    state_notify(STATE_EV_MEASURE);
+
+    persist_energy(&regs, &loads);
     ESP_LOGI("STATE", "Energía reseteada");
-    xSemaphoreGive(state_mutex);
 }
 
 void state_set_energy(){
-    double energy = nvs_load_energy();
+    energy_regs_t regs;
+    load_energy_t loads;
+    // el diario manda; NVS queda para placas sin la partición y para migrar de ahí
+    if(!energy_log_latest(&regs, &loads)){
+        nvs_load_energy(&regs);
+        nvs_load_load_energy(&loads);
+    }
+    save_ths = energy_log_is_ready() ? ENERGY_LOG_STEP_KWH : SAVE_ENERGY_THS_KWH;
     
-    xSemaphoreTake(state_mutex, portMAX_DELAY);
-    state.measure.E = energy;
-    last_saved_E = energy;
-    xSemaphoreGive(state_mutex);
+    state_write_begin();
+    state.energy = regs;
+    state.load_energy = loads;
+    state.measure.E = regs.E;
+    state.measure.Eq = regs.E_q;
+    last_saved = regs;
+    state_write_end();
 }
 
 void state_change_detector_init(change_detector_t *detector){
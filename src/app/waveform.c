@@ -0,0 +1,98 @@
+#include "app/waveform.h"
+#include <string.h>
+
+static uint8_t ring[WAVE_RING_BYTES];
+
+/*estado del productor (task_adc_acquisition)*/
+static uint16_t head = 0;           // próximo par a escribir
+static uint16_t filled = 0;         // pares válidos desde el último armado
+static uint16_t post_left = 0;      // pares que faltan para congelar
+static uint8_t decim_cnt = 0;
+
+/*captura congelada: la escribe el productor antes de pasar a FROZEN*/
+static uint16_t snap_start = 0;
+static uint16_t snap_pairs = 0;
+static uint16_t snap_trig = 0;
+static uint32_t trigger_count = 0;
+
+static volatile wave_state_t wave_state = WAVE_STATE_ARMED;
+static volatile bool trig_req = false;
+static volatile bool rearm_req = false;
+
+void waveform_add_sample(int16_t v_mv, int16_t i_mv){
+
+    if(rearm_req){
+        rearm_req = false;
+        trig_req = false;
+        filled = 0;
+        wave_state = WAVE_STATE_ARMED;
+    }
+    if(wave_state == WAVE_STATE_FROZEN) return;
+
+    if(++decim_cnt < WAVE_DECIM) return;
+    decim_cnt = 0;
+
+    if(trig_req){
+        trig_req = false;
+        if(wave_state == WAVE_STATE_ARMED){
+            wave_state = WAVE_STATE_TRIGGERED;
+            post_left = WAVE_POST_PAIRS;
+            trigger_count++;
+        }
+    }
+
+    uint16_t v = (v_mv < 0) ? 0 : (v_mv > 0x0FFF ? 0x0FFF : (uint16_t)v_mv);
+    uint16_t i = (i_mv < 0) ? 0 : (i_mv > 0x0FFF ? 0x0FFF : (uint16_t)i_mv);
+
+    uint8_t *p = &ring[head * WAVE_BYTES_PER_PAIR];
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(((i & 0x0F) << 4) | (v >> 8));
+    p[2] = (uint8_t)(i >> 4);
+
+    if(++head >= WAVE_PAIRS) head = 0;
+    if(filled < WAVE_PAIRS) filled++;
+
+    if(wave_state == WAVE_STATE_TRIGGERED && --post_left == 0){
+        snap_pairs = filled;
+        snap_start = (uint16_t)((head + WAVE_PAIRS - filled) % WAVE_PAIRS);
+        snap_trig = (filled > WAVE_POST_PAIRS) ? (uint16_t)(filled - WAVE_POST_PAIRS) : 0;
+        wave_state = WAVE_STATE_FROZEN; // a partir de acá el buffer es de los lectores
+    }
+}
+
+void waveform_trigger(void){
+    trig_req = true;
+}
+
+void waveform_rearm(void){
+    rearm_req = true;
+}
+
+void waveform_get_info(waveform_info_t *out){
+    memset(out, 0, sizeof(*out));
+    out->state = wave_state;
+    if(out->state == WAVE_STATE_FROZEN){
+        out->pairs = snap_pairs;
+        out->trig_pair = snap_trig;
+        out->bytes = (uint32_t)snap_pairs * WAVE_BYTES_PER_PAIR;
+    }
+    out->fs_hz = SAMPLE_FREQ_HZ / WAVE_DECIM;
+    out->mem_bytes = sizeof(ring) + 4 * sizeof(uint16_t) + 2 * sizeof(uint32_t);
+    out->triggers = trigger_count;
+}
+
+size_t waveform_read(uint32_t offset, uint8_t *dst, size_t len){
+    if(wave_state != WAVE_STATE_FROZEN) return 0;
+
+    uint32_t total = (uint32_t)snap_pairs * WAVE_BYTES_PER_PAIR;
+    if(offset >= total) return 0;
+    if(len > total - offset) len = total - offset;
+
+    uint32_t pos = ((uint32_t)snap_start * WAVE_BYTES_PER_PAIR + offset) % WAVE_RING_BYTES;
+    size_t first = WAVE_RING_BYTES - pos;
+    if(first > len) first = len;
+
+    memcpy(dst, &ring[pos], first);
+    memcpy(dst + first, ring, len - first);
+    return len;
+}
@@ -1,6 +1,8 @@
 #include "comms/iot_mqtt.h"
 #include "app/control.h"
 #include "app/state.h"
+#include "app/calibration.h"
+#include "app/history.h"
 #include "core/nvs_config.h"
 #include "esp_log.h"
 #include "cJSON.h"
@@ -13,6 +15,7 @@ static QueueHandle_t iot_cmd_queue = NULL;
 static bool last_fail_i = false;
 static bool last_fail_i_nr = false;
 static bool last_fail_v[NUM_LOADS] = {0};
+static uint32_t last_cal_runs = 0;
 
 static void iot_publish_event(const char *name, cJSON *extra){
     cJSON *root = cJSON_CreateObject();
@@ -32,6 +35,19 @@ static void iot_publish_event(const char *name, cJSON *extra){
     cJSON_Delete(root);
 }
 
+/* Tiempo [s] de HIST_GET: entero en [0, UINT32_MAX], def si no viene */
+static bool iot_json_time(const cJSON *item, uint32_t def, uint32_t *out){
+    if(item == NULL){
+        *out = def;
+        return true;
+    }
+    if(!cJSON_IsNumber(item)) return false;
+    double v = item->valuedouble;
+    if(!(v >= 0.0) || v > (double)UINT32_MAX || v != (double)(uint32_t)v) return false;
+    *out = (uint32_t)v;
+    return true;
+}
+
 static bool iot_parse_cmd_json(const char *payload, int len, iot_cmd_t *out_cmd){
     if(!payload || !out_cmd) return false;
     if(len <= 0 || len >= IOT_CMD_JSON_MAX_LEN){
@@ -125,6 +141,35 @@ static bool iot_parse_cmd_json(const char *payload, int len, iot_cmd_t *out_cmd)
         out_cmd->cfg_priority_set.id   = (uint8_t)id->valuedouble;
         out_cmd->cfg_priority_set.pr = (uint8_t)val->valuedouble;
     }
+    else if (strcmp(cmd->valuestring, "CAL_ZERO") == 0 || strcmp(cmd->valuestring, "CAL_GAIN") == 0) {
+        bool gain = (strcmp(cmd->valuestring, "CAL_GAIN") == 0);
+        cJSON *ch  = cJSON_GetObjectItem(root, "ch");
+        cJSON *ref = cJSON_GetObjectItem(root, "ref");
+        if (!cJSON_IsString(ch) || (gain && !cJSON_IsNumber(ref))) {
+            cJSON_Delete(root);
+            return false;
+        }
+        out_cmd->type = gain ? IOT_CMD_CAL_GAIN : IOT_CMD_CAL_ZERO;
+        out_cmd->cal.current = (strcmp(ch->valuestring, "I") == 0);
+        out_cmd->cal.ref = gain ? (float)ref->valuedouble : 0.0f;
+    }
+    else if (strcmp(cmd->valuestring, "CAL_DEFAULT") == 0) {
+        out_cmd->type = IOT_CMD_CAL_DEFAULT;
+    }
+    else if (strcmp(cmd->valuestring, "HIST_GET") == 0) {
+        cJSON *tier = cJSON_GetObjectItem(root, "tier");
+        cJSON *from = cJSON_GetObjectItem(root, "from");
+        cJSON *to   = cJSON_GetObjectItem(root, "to");
+        hist_tier_t t;
+        if (!cJSON_IsString(tier) || !history_tier_parse(tier->valuestring, &t)) {
+            cJSON_Delete(root);
+            return false;
+        }
+        out_cmd->type = IOT_CMD_HIST_GET;
+        out_cmd->hist_get.tier = t;
+        out_cmd->hist_get.valid = iot_json_time(from, 0, &out_cmd->hist_get.from) &&
+                                  iot_json_time(to, UINT32_MAX, &out_cmd->hist_get.to);
+    }
     else {
         cJSON_Delete(root);
         return false;
@@ -133,6 +178,53 @@ static bool iot_parse_cmd_json(const char *payload, int len, iot_cmd_t *out_cmd)
      return true;
 }
 
+/* Publica una página de HIST_GET; "next" indica desde dónde pedir la siguiente */
+static void iot_publish_history(hist_tier_t tier, uint32_t from, uint32_t to){
+    static hist_point_t pts[IOT_HIST_PAGE_POINTS];   // sólo task_iot_rx
+    static const char *const names[HIST_FIELDS] = {"V", "I", "P", "Q", "fp", "f"};
+    hist_cursor_t cur;
+
+    history_query_begin(&cur, tier, from, to);
+    size_t n = history_query_next(&cur, pts, IOT_HIST_PAGE_POINTS);
+    bool more = (n == IOT_HIST_PAGE_POINTS) && !cur.done;   // puede anticipar una página vacía
+
+    cJSON *root = cJSON_CreateObject();
+    if(!root) return;
+
+    cJSON_AddStringToObject(root, "tier", history_tier_name(tier));
+    cJSON_AddNumberToObject(root, "now", history_now());
+    if(more){
+        cJSON_AddNumberToObject(root, "next", pts[n - 1].t + 1);
+    }
+
+    cJSON *arr = cJSON_CreateArray();
+    for(size_t i = 0; i < n; i++){
+        cJSON *p = cJSON_CreateObject();
+        cJSON_AddNumberToObject(p, "t", pts[i].t);
+        cJSON_AddNumberToObject(p, "n", pts[i].n);
+        if(pts[i].flags & HIST_F_BOOT){
+            cJSON_AddBoolToObject(p, "boot", true);
+        }
+        for(uint8_t k = 0; k < HIST_FIELDS; k++){
+            // [promedio, mínimo, máximo]
+            cJSON *v = cJSON_CreateArray();
+            cJSON_AddItemToArray(v, cJSON_CreateNumber(history_to_float(k, pts[i].avg[k])));
+            cJSON_AddItemToArray(v, cJSON_CreateNumber(history_to_float(k, pts[i].min[k])));
+            cJSON_AddItemToArray(v, cJSON_CreateNumber(history_to_float(k, pts[i].max[k])));
+            cJSON_AddItemToObject(p, names[k], v);
+        }
+        cJSON_AddItemToArray(arr, p);
+    }
+    cJSON_AddItemToObject(root, "points", arr);
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    if(json_str){
+        esp_mqtt_client_publish(mqtt_client, MQTT_TOPIC_HIST, json_str, 0, 1, 0);
+        cJSON_free(json_str);
+    }
+    cJSON_Delete(root);
+}
+
 static void iot_publish_telemetry(const state_t *st){
 
     cJSON *root = cJSON_CreateObject();
@@ -141,9 +233,41 @@ static void iot_publish_telemetry(const state_t *st){
     cJSON_AddNumberToObject(root, "V", st->measure.Vrms);
     cJSON_AddNumberToObject(root, "I", st->measure.Irms);
     cJSON_AddNumberToObject(root, "P",  st->measure.P);
+    cJSON_AddNumberToObject(root, "Q",  st->measure.Q);
     cJSON_AddNumberToObject(root, "S",  st->measure.S);
     cJSON_AddNumberToObject(root, "fp", st->measure.fp);
+    cJSON_AddNumberToObject(root, "fp_disp", st->measure.fp_disp);
+    cJSON_AddNumberToObject(root, "f",  st->measure.f);
     cJSON_AddNumberToObject(root, "E",  st->measure.E);
+    cJSON_AddNumberToObject(root, "E_imp", st->energy.E_imp);
+    cJSON_AddNumberToObject(root, "E_exp", st->energy.E_exp);
+    cJSON_AddNumberToObject(root, "E_q", st->energy.E_q);
+    cJSON_AddNumberToObject(root, "thd_v", st->harm.thd_v);
+    cJSON_AddNumberToObject(root, "thd_i", st->harm.thd_i);
+    cJSON_AddNumberToObject(root, "dma_ovf", st->dma.overflows);
+    cJSON_AddNumberToObject(root, "dma_lost", st->dma.bytes_lost);
+    cJSON_AddNumberToObject(root, "dma_gap_max_us", st->dma.gap_max_us);
+    cJSON_AddNumberToObject(root, "dma_ring", st->dma.ring_bytes);
+
+#if MEASURE_AUX_PAIRS > 0
+    cJSON *arrA = cJSON_CreateArray();
+    for(uint8_t k = 0; k < MEASURE_AUX_PAIRS; k++){
+        cJSON *a = cJSON_CreateObject();
+        cJSON_AddNumberToObject(a, "V", st->aux[k].Vrms);
+        cJSON_AddNumberToObject(a, "I", st->aux[k].Irms);
+        cJSON_AddNumberToObject(a, "P", st->aux[k].P);
+        cJSON_AddNumberToObject(a, "Q", st->aux[k].Q);
+        cJSON_AddNumberToObject(a, "fp", st->aux[k].fp);
+        cJSON_AddItemToArray(arrA, a);
+    }
+    cJSON_AddItemToObject(root, "aux", arrA);
+#endif
+#if MEASURE_TOPOLOGY == MEASURE_TOPO_THREE_PHASE
+    cJSON_AddNumberToObject(root, "P_tot", st->total.P);
+    cJSON_AddNumberToObject(root, "Q_tot", st->total.Q);
+    cJSON_AddNumberToObject(root, "S_tot", st->total.S);
+    cJSON_AddNumberToObject(root, "fp_tot", st->total.fp);
+#endif
 
     cJSON *arrL = cJSON_CreateArray();
     for(uint8_t i = 0; i < NUM_LOADS; i++){
@@ -151,6 +275,13 @@ static void iot_publish_telemetry(const state_t *st){
     }
     cJSON_AddItemToObject(root, "L", arrL);
 
+    cJSON *arrE = cJSON_CreateArray();
+    for(uint8_t i = 0; i < NUM_LOADS; i++){
+        cJSON_AddItemToArray(arrE, cJSON_CreateNumber(st->load_energy.E[i]));
+    }
+    cJSON_AddItemToObject(root, "E_load", arrE);
+    cJSON_AddNumberToObject(root, "E_other", st->load_energy.E_other);
+
     cJSON_AddBoolToObject(root, "FAIL_I", st->fails.FAIL_I);
     cJSON_AddBoolToObject(root, "FAIL_I_NR", st->fails.FAIL_I_NR);
 
@@ -218,6 +349,25 @@ static void iot_publish_event_fail_changes(const state_t *st){
     }
 }
 
+static void iot_publish_event_cal_changes(){
+    cal_info_t info;
+    calibration_get_info(&info);
+
+    if(info.runs == last_cal_runs) return;
+    last_cal_runs = info.runs;
+
+    cJSON *d = cJSON_CreateObject();
+    if(!d) return;
+    cJSON_AddStringToObject(d, "step", calibration_step_name(info.step));
+    cJSON_AddNumberToObject(d, "result", info.result);
+    if(info.status == CAL_DONE){
+        iot_publish_event("CAL_DONE", d);
+    } else {
+        cJSON_AddStringToObject(d, "err", calibration_err_name(info.err));
+        iot_publish_event("CAL_FAIL", d);
+    }
+}
+
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data){
     esp_mqtt_event_handle_t event = event_data;
 
@@ -267,14 +417,25 @@ void iot_mqtt_init(){
 void task_iot_tx(void *pvParameters){
     (void)pvParameters;
 
+    state_sub_t sub = state_subscribe(STATE_EV_FAILS);
+    TickType_t next_tel = xTaskGetTickCount();
+
     while(1){
         state_t st;
         state_get(&st);
 
-        iot_publish_telemetry(&st);
+        // telemetría a período fijo; los eventos de falla salen apenas llega el aviso
+        TickType_t now = xTaskGetTickCount();
+        if((int32_t)(now - next_tel) >= 0){
+            iot_publish_telemetry(&st);
+            iot_publish_event_cal_changes();
+            next_tel = now + pdMS_TO_TICKS(TASK_PERIOD_COMM_IOT_MS);
+        }
         iot_publish_event_fail_changes(&st);
 
-        vTaskDelay(pdMS_TO_TICKS(TASK_PERIOD_COMM_IOT_MS));
+        now = xTaskGetTickCount();
+        int32_t wait = (int32_t)(next_tel - now);
+        state_wait(sub, wait > 0 ? pdTICKS_TO_MS(wait) : 0);
     }
 }
 
@@ -341,6 +502,39 @@ void task_iot_rx(void *pvParameters){
                 break;
             }
 
+            case IOT_CMD_CAL_ZERO:
+            case IOT_CMD_CAL_GAIN:{
+                cal_step_t step;
+                if(cmd.type == IOT_CMD_CAL_ZERO){
+                    step = cmd.cal.current ? CAL_STEP_ZERO_I : CAL_STEP_ZERO_V;
+                } else {
+                    step = cmd.cal.current ? CAL_STEP_GAIN_I : CAL_STEP_GAIN_V;
+                }
+                cJSON *d = cJSON_CreateObject();
+                cJSON_AddStringToObject(d, "step", calibration_step_name(step));
+                if(calibration_start(step, cmd.cal.ref)){
+                    iot_publish_event("CAL_START", d);
+                } else {
+                    iot_publish_event("CAL_INVALID", d);
+                }
+                break;
+            }
+
+            case IOT_CMD_CAL_DEFAULT:{
+                calibration_restore_default();
+                iot_publish_event("CAL_DEFAULT", NULL);
+                break;
+            }
+
+            case IOT_CMD_HIST_GET:{
+                if(!cmd.hist_get.valid){
+                    iot_publish_event("HIST_INVALID", NULL);
+                    break;
+                }
+                iot_publish_history(cmd.hist_get.tier, cmd.hist_get.from, cmd.hist_get.to);
+                break;
+            }
+
             default:
                 iot_publish_event("CMD_INVALID", NULL);
                 break;
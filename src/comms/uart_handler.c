@@ -2,10 +2,19 @@
 #include "comms/uart_handler.h"
 #include "app/control.h"
 #include "app/state.h"
+#include "app/acquisition.h"
+#include "app/waveform.h"
+#include "app/calibration.h"
+#include "app/history.h"
+#include "hal/adc_dma.h"
 #include "core/nvs_config.h"
+#include "core/task_stats.h"
+#include "core/persist.h"
+#include "core/energy_log.h"
 #include "esp_log.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #define ADMIN_PASSWORD "admin123"
 #define SESSION_TOUT_MS (30*60*1000) // 30 min
@@ -23,10 +32,27 @@ static const cmd_map_t cmd_lookup_table[] = {
     {"ENERGY", CMD_ENERGY},
     {"CFG",    CMD_CFG},
     {"DISPMODE", CMD_DISPMODE},
+    {"ACQ",    CMD_ACQ},
+    {"TASKS",  CMD_TASKS},
+    {"HARM",   CMD_HARM},
+    {"WAVE",   CMD_WAVE},
+    {"ADCREC", CMD_ADCREC},
+    {"DMA",    CMD_DMA},
+    {"CAL",    CMD_CAL},
+    {"HIST",   CMD_HIST},
     {"HELP",   CMD_HELP},
     {NULL,     CMD_UNK}
 };
 
+/* Entero decimal completo en [0, max]: "1x", "-1" o "" no se aceptan */
+static bool parse_uint_arg(const char *arg, long max, long *out){
+    char *end;
+    long v = strtol(arg, &end, 10);
+    if(end == arg || *end != '\0' || v < 0 || v > max) return false;
+    *out = v;
+    return true;
+}
+
 static cmd_type_t parse_command(const char *cmd_str){
     for(uint8_t i = 0; cmd_lookup_table[i].str != NULL; i++){
         if(strcmp(cmd_str, cmd_lookup_table[i].str) == 0) return cmd_lookup_table[i].type;
@@ -124,8 +150,30 @@ void uart_process_command(uart_cmd_t *cmd, uart_resp_t *resp){
 
         if(strcmp(subcmd, "GET") == 0){
             char buf[200];
-            snprintf(buf, sizeof(buf), "V:%.2f I:%.3f P:%.3f S:%.3f FP:%.3f E:%.3f", st.measure.Vrms, st.measure.Irms, st.measure.P, st.measure.S, st.measure.fp, st.measure.E);
+            snprintf(buf, sizeof(buf), "V:%.2f I:%.3f P:%.3f Q:%.3f S:%.3f FP:%.3f FPD:%.3f F:%.2f E:%.3f", st.measure.Vrms, st.measure.Irms, st.measure.P, st.measure.Q, st.measure.S, st.measure.fp, st.measure.fp_disp, st.measure.f, st.measure.E);
             send_ok(resp, buf);
+        } else if(strcmp(subcmd, "AUX") == 0){
+#if MEASURE_AUX_PAIRS > 0
+            long id;
+            if(!parse_uint_arg(arg1, MEASURE_AUX_PAIRS - 1, &id)){
+                send_error(resp, "ID_INVALIDO");
+                break;
+            }
+            const measure_t *m = &st.aux[id];
+            char buf[160];
+            snprintf(buf, sizeof(buf), "%ld V:%.2f I:%.3f P:%.3f Q:%.3f S:%.3f FP:%.3f FPD:%.3f", id, m->Vrms, m->Irms, m->P, m->Q, m->S, m->fp, m->fp_disp);
+            send_ok(resp, buf);
+#else
+            send_error(resp, "DESHABILITADO");
+#endif
+        } else if(strcmp(subcmd, "TOTAL") == 0){
+#if MEASURE_TOPOLOGY == MEASURE_TOPO_THREE_PHASE
+            char buf[160];
+            snprintf(buf, sizeof(buf), "V:%.2f I:%.3f P:%.3f Q:%.3f S:%.3f FP:%.3f FPD:%.3f E:%.3f", st.total.Vrms, st.total.Irms, st.total.P, st.total.Q, st.total.S, st.total.fp, st.total.fp_disp, st.total.E);
+            send_ok(resp, buf);
+#else
+            send_error(resp, "DESHABILITADO");
+#endif
         } else {
             send_error(resp, "SUBCMD_INVALIDO");
         }
@@ -193,6 +241,34 @@ void uart_process_command(uart_cmd_t *cmd, uart_resp_t *resp){
     }
 
     case CMD_ENERGY:{
+        if(strcmp(subcmd, "GET") == 0){ // lectura de registros: no requiere admin
+            state_t st;
+            state_get(&st);
+            char buf[192];
+            if(arg1[0] == '\0'){
+                snprintf(buf, sizeof(buf), "E:%.3f IMP:%.3f EXP:%.3f EQ:%.3f", st.energy.E, st.energy.E_imp, st.energy.E_exp, st.energy.E_q);
+            } else if(strcmp(arg1, "OTHER") == 0){
+                snprintf(buf, sizeof(buf), "OTHER E:%.3f", st.load_energy.E_other);
+            } else if(strcmp(arg1, "LOG") == 0){
+                energy_log_info_t li;
+                energy_log_get_info(&li);
+                if(!li.ready){
+                    snprintf(buf, sizeof(buf), "LOG OFF");
+                } else {
+                    snprintf(buf, sizeof(buf), "LOG SEQ:%lu NEXT:%lu SECT:%lu APP:%lu ERASE:%lu ERR:%lu BOOT_RD:%lu BOOT_TORN:%lu BOOT_US:%lu", (unsigned long)li.seq, (unsigned long)li.next, (unsigned long)li.sectors, (unsigned long)li.appends, (unsigned long)li.erases, (unsigned long)li.errors, (unsigned long)li.boot_reads, (unsigned long)li.boot_torn, (unsigned long)li.boot_us);
+                }
+            } else {
+                // "1x", "-255" o "256" no deben caer en otra carga
+                long id;
+                if(!parse_uint_arg(arg1, NUM_LOADS - 1, &id)){
+                    send_error(resp, "ID_INVALIDO");
+                    break;
+                }
+                snprintf(buf, sizeof(buf), "%ld E:%.3f %s", id, st.load_energy.E[id], st.output[id]? "ON" : "OFF");
+            }
+            send_ok(resp, buf);
+            break;
+        }
         if(!uart_session_check(cmd->session)){
             send_unauthorized(resp);
             break;
@@ -224,14 +300,12 @@ void uart_process_command(uart_cmd_t *cmd, uart_resp_t *resp){
             send_ok(resp, buf);
         } 
         else if(strcmp(subcmd, "SAVE") == 0){
-            if(control_save_to_nvs()){
-                state_t st;
-                state_get(&st);
-                nvs_save_energy(st.measure.E);
-                send_ok(resp, "CONFIG_GUARDADA");
-            } else {
-                send_error(resp, "FALLO_GUARDADO");
-            }
+            // la escritura la hace task_persist: el resultado se ve en ACQ STALL (CFG_ERR)
+            control_save_to_nvs();
+            state_t st;
+            state_get(&st);
+            persist_energy(&st.energy, &st.load_energy);
+            send_ok(resp, "CONFIG_EN_COLA");
         }
         else if(strcmp(subcmd, "LOAD") == 0){
             if(control_load_from_nvs()){
@@ -340,8 +414,291 @@ void uart_process_command(uart_cmd_t *cmd, uart_resp_t *resp){
         break;
     }
 
+    case CMD_ACQ: {
+        if(strcmp(subcmd, "GET") == 0){
+            acq_stats_t stats;
+            acquisition_get_stats(&stats);
+            char buf[240];
+            snprintf(buf, sizeof(buf), "WIN:%lu DROP:%lu CYC_DROP:%lu LAT_US:%lu LAT_MAX_US:%lu INVALID:%lu UNPAIRED:%lu OS:%d LOAD:%lu.%lu%% FRAME_US:%lu FRAME_MAX_US:%lu", (unsigned long)stats.windows_ok, (unsigned long)stats.windows_dropped, (unsigned long)stats.cycles_dropped, (unsigned long)stats.handoff_last_us, (unsigned long)stats.handoff_max_us, (unsigned long)stats.samples_invalid, (unsigned long)stats.samples_unpaired, ADC_OVERSAMPLE, (unsigned long)(stats.load_permil / 10), (unsigned long)(stats.load_permil % 10), (unsigned long)stats.frame_us_last, (unsigned long)stats.frame_us_max);
+            send_ok(resp, buf);
+        } else if(strcmp(subcmd, "STALL") == 0){
+            acq_stats_t stats;
+            persist_stats_t ps;
+            acquisition_get_stats(&stats);
+            persist_get_stats(&ps);
+            char buf[240];
+            snprintf(buf, sizeof(buf), "COMP_US:%lu COMP_MAX_US:%lu NVS_US:%lu NVS_MAX_US:%lu NVS_REQ:%lu NVS_COAL:%lu NVS_WR:%lu NVS_ERR:%lu CFG_ERR:%lu CAL_ERR:%lu", (unsigned long)stats.compute_us_last, (unsigned long)stats.compute_us_max, (unsigned long)ps.write_us_last, (unsigned long)ps.write_us_max, (unsigned long)ps.requests, (unsigned long)ps.coalesced, (unsigned long)ps.writes, (unsigned long)ps.errors, (unsigned long)ps.cfg_errors, (unsigned long)ps.cal_errors);
+            send_ok(resp, buf);
+        } else {
+            send_error(resp, "SUBCMD_INVALIDO");
+        }
+        break;
+    }
+
+    case CMD_TASKS: {
+        if(strcmp(subcmd, "GET") == 0){
+            char buf[RESPONSE_MAX_LEN - 8]; // margen para "OK " y "\r\n"
+            if(task_stats_format(buf, sizeof(buf))){
+                send_ok(resp, buf);
+            } else {
+                send_error(resp, "STATS_NO_DISPONIBLES");
+            }
+        } else {
+            send_error(resp, "SUBCMD_INVALIDO");
+        }
+        break;
+    }
+
+    case CMD_HARM: {
+        state_t st;
+        state_get(&st);
+
+        if(strcmp(subcmd, "GET") == 0){
+            char buf[64];
+            snprintf(buf, sizeof(buf), "THD_V:%.1f THD_I:%.1f", st.harm.thd_v, st.harm.thd_i);
+            send_ok(resp, buf);
+        } else if(strcmp(subcmd, "V") == 0 || strcmp(subcmd, "I") == 0){
+            // magnitudes de cada armónico en % de la fundamental
+            const float *h = (subcmd[0] == 'V') ? st.harm.v : st.harm.i;
+            char buf[RESPONSE_MAX_LEN - 8]; // margen para "OK " y "\r\n"
+            size_t len = 0;
+            for(uint8_t k = 0; k < HARM_NUM && len < sizeof(buf); k++){
+                float pct = (h[0] > 0.0f) ? 100.0f * h[k] / h[0] : 0.0f;
+                len += snprintf(buf + len, sizeof(buf) - len, "%sH%d:%.1f", k ? " " : "", k + 1, pct);
+            }
+            send_ok(resp, buf);
+        } else {
+            send_error(resp, "SUBCMD_INVALIDO");
+        }
+        break;
+    }
+
+    case CMD_WAVE: {
+        waveform_info_t info;
+        waveform_get_info(&info);
+
+        if(strcmp(subcmd, "GET") == 0){
+            static const char *state_str[] = {"ARMED", "TRIGGERED", "FROZEN"};
+            char buf[128];
+            snprintf(buf, sizeof(buf), "STATE:%s PAIRS:%u TRIG:%u FS:%lu BYTES:%lu MEM:%lu COUNT:%lu", state_str[info.state], info.pairs, info.trig_pair, (unsigned long)info.fs_hz, (unsigned long)info.bytes, (unsigned long)info.mem_bytes, (unsigned long)info.triggers);
+            send_ok(resp, buf);
+        } else if(strcmp(subcmd, "DUMP") == 0){
+            if(info.state != WAVE_STATE_FROZEN){
+                send_error(resp, "SIN_CAPTURA");
+                break;
+            }
+            char header[UART_DUMP_HEADER_LEN];
+            snprintf(header, sizeof(header), "PAIRS:%u TRIG:%u FS:%lu BYTES:%lu", info.pairs, info.trig_pair, (unsigned long)info.fs_hz, (unsigned long)info.bytes);
+            if(!uart_dump_start("WAVE", waveform_read, header)){
+                send_error(resp, "VOLCADO_EN_CURSO");
+                break;
+            }
+            send_ok(resp, "WAVE_DUMP");
+        } else if(strcmp(subcmd, "ARM") == 0 || strcmp(subcmd, "TRIG") == 0){
+            if(!uart_session_check(cmd->session)){
+                send_unauthorized(resp);
+                break;
+            }
+            if(subcmd[0] == 'A'){
+                waveform_rearm();
+            } else {
+                waveform_trigger();
+            }
+            send_ok(resp, subcmd);
+        } else {
+            send_error(resp, "SUBCMD_INVALIDO");
+        }
+        break;
+    }
+
+    case CMD_ADCREC: {
+        adc_rec_info_t info;
+        app_adc_rec_get_info(&info);
+
+        if(strcmp(subcmd, "GET") == 0){
+            static const char *state_str[] = {"IDLE", "RECORDING", "DONE", "REPLAY"};
+            char buf[128];
+            snprintf(buf, sizeof(buf), "STATE:%s FRAMES:%lu BYTES:%lu DUR_US:%lu MEM:%u LOOPS:%lu%s", state_str[info.state], (unsigned long)info.frames, (unsigned long)info.bytes, (unsigned long)info.duration_us, (unsigned)ADC_REC_BUF_BYTES, (unsigned long)info.loops, (info.state == ADC_REC_REPLAY) ? (info.realtime ? " RT" : " FAST") : "");
+            send_ok(resp, buf);
+        } else if(strcmp(subcmd, "DUMP") == 0){
+            if(info.state != ADC_REC_DONE && info.state != ADC_REC_REPLAY){
+                send_error(resp, "SIN_GRABACION");
+                break;
+            }
+            char header[UART_DUMP_HEADER_LEN];
+            snprintf(header, sizeof(header), "FRAMES:%lu BYTES:%lu DUR_US:%lu FS:%u", (unsigned long)info.frames, (unsigned long)info.bytes, (unsigned long)info.duration_us, (unsigned)ADC_RAW_FREQ_HZ);
+            if(!uart_dump_start("ADCREC", app_adc_rec_read, header)){
+                send_error(resp, "VOLCADO_EN_CURSO");
+                break;
+            }
+            send_ok(resp, "ADCREC_DUMP");
+        } else if(strcmp(subcmd, "START") == 0 || strcmp(subcmd, "STOP") == 0 || strcmp(subcmd, "REPLAY") == 0){
+            if(!uart_session_check(cmd->session)){
+                send_unauthorized(resp);
+                break;
+            }
+            if(strcmp(subcmd, "START") == 0){
+                if(!app_adc_rec_start()){
+                    send_error(resp, "DESHABILITADO");
+                    break;
+                }
+            } else if(strcmp(subcmd, "STOP") == 0){
+                app_adc_rec_stop();
+            } else {
+                bool realtime = (strcmp(arg1, "FAST") != 0); // RT por defecto
+                if(!app_adc_rec_replay(realtime)){
+                    send_error(resp, "SIN_GRABACION");
+                    break;
+                }
+            }
+            send_ok(resp, subcmd);
+        } else {
+            send_error(resp, "SUBCMD_INVALIDO");
+        }
+        break;
+    }
+
+    case CMD_DMA: {
+        if(strcmp(subcmd, "GET") == 0){
+            adc_dma_stats_t stats;
+            adc_dma_cfg_t cfg;
+            app_adc_dma_get_stats(&stats);
+            app_adc_dma_get_config(&cfg);
+            char buf[256];
+            snprintf(buf, sizeof(buf), "RING:%lu FRAME:%lu AUTO:%s FRAMES:%lu OVF:%lu POOL_OVF:%lu LOST:%lu GAP_US:%lu GAP_MAX_US:%lu REINIT:%lu REINIT_ERR:%lu LAST_ERR:%s GROW:%lu", (unsigned long)stats.ring_bytes, (unsigned long)stats.frame_bytes, cfg.auto_grow ? "ON" : "OFF", (unsigned long)stats.frames, (unsigned long)stats.overflows, (unsigned long)stats.pool_ovf, (unsigned long)stats.bytes_lost, (unsigned long)stats.gap_last_us, (unsigned long)stats.gap_max_us, (unsigned long)stats.reinits, (unsigned long)stats.reinit_errors, esp_err_to_name(stats.last_err), (unsigned long)stats.grows);
+            send_ok(resp, buf);
+            break;
+        }
+        if(strcmp(subcmd, "SET") != 0 && strcmp(subcmd, "AUTO") != 0 && strcmp(subcmd, "RESET") != 0){
+            send_error(resp, "SUBCMD_INVALIDO");
+            break;
+        }
+        if(!uart_session_check(cmd->session)){
+            send_unauthorized(resp);
+            break;
+        }
+        if(strcmp(subcmd, "RESET") == 0){
+            app_adc_dma_reset_stats();
+            send_ok(resp, "DMA_RESET");
+            break;
+        }
+
+        adc_dma_cfg_t cfg;
+        app_adc_dma_get_config(&cfg);
+        if(strcmp(subcmd, "AUTO") == 0){
+            if(strcmp(arg1, "ON") == 0){
+                cfg.auto_grow = true;
+            } else if(strcmp(arg1, "OFF") == 0){
+                cfg.auto_grow = false;
+            } else {
+                send_error(resp, "VALOR_INVALIDO");
+                break;
+            }
+        } else if(strcmp(arg1, "RING") == 0 || strcmp(arg1, "FRAME") == 0){
+            long bytes;
+            if(!parse_uint_arg(arg2, ADC_DMA_RING_MAX_BYTES, &bytes)){
+                send_error(resp, "VALOR_INVALIDO");
+                break;
+            }
+            if(arg1[0] == 'R'){
+                cfg.ring_bytes = (uint32_t)bytes;
+            } else {
+                cfg.frame_bytes = (uint32_t)bytes;
+            }
+        } else {
+            send_error(resp, "SUBCMD_INVALIDO");
+            break;
+        }
+        if(!app_adc_dma_set_config(&cfg)){
+            send_error(resp, "VALOR_INVALIDO");
+            break;
+        }
+        send_ok(resp, "DMA_CFG");
+        break;
+    }
+
+    case CMD_CAL: {
+        if(strcmp(subcmd, "GET") == 0){
+            cal_info_t info;
+            measure_cal_t cal;
+            calibration_get_info(&info);
+            measure_get_cal(&cal);
+            char buf[200];
+            snprintf(buf, sizeof(buf), "ST:%s STEP:%s WIN:%u/%u ERR:%s RES:%.4e VG:%.4e IS:%.4f VN:%.1f IN:%.3f IO:%.3f", calibration_status_name(info.status), calibration_step_name(info.step), (unsigned)info.windows, (unsigned)CAL_WINDOWS, calibration_err_name(info.err), info.result, cal.v_gain, cal.i_sens, cal.v_noise, cal.i_noise, cal.i_offset);
+            send_ok(resp, buf);
+            break;
+        }
+        if(strcmp(subcmd, "ZERO") != 0 && strcmp(subcmd, "GAIN") != 0 && strcmp(subcmd, "DEFAULT") != 0 && strcmp(subcmd, "ABORT") != 0){
+            send_error(resp, "SUBCMD_INVALIDO");
+            break;
+        }
+        if(!uart_session_check(cmd->session)){
+            send_unauthorized(resp);
+            break;
+        }
+        if(strcmp(subcmd, "DEFAULT") == 0){
+            calibration_restore_default();
+            send_ok(resp, "CAL_DEFAULT");
+            break;
+        }
+        if(strcmp(subcmd, "ABORT") == 0){
+            calibration_abort();
+            send_ok(resp, "CAL_ABORT");
+            break;
+        }
+
+        bool zero = (strcmp(subcmd, "ZERO") == 0);
+        cal_step_t step;
+        if(strcmp(arg1, "V") == 0){
+            step = zero ? CAL_STEP_ZERO_V : CAL_STEP_GAIN_V;
+        } else if(strcmp(arg1, "I") == 0){
+            step = zero ? CAL_STEP_ZERO_I : CAL_STEP_GAIN_I;
+        } else {
+            send_error(resp, "CANAL_INVALIDO");
+            break;
+        }
+        if(!calibration_start(step, zero ? 0.0f : (float)atof(arg2))){
+            send_error(resp, "VALOR_INVALIDO");
+            break;
+        }
+        send_ok(resp, "CAL_START");
+        break;
+    }
+
+    case CMD_HIST: {
+        if(strcmp(subcmd, "GET") == 0){
+            hist_info_t info;
+            history_get_info(&info);
+            char buf[240];
+            snprintf(buf, sizeof(buf), "NOW:%lu FLASH:%s SEC:%lu-%lu MIN:%lu-%lu HOUR:%lu-%lu REC:%lu KEY:%lu ERASE:%lu DROP:%lu BOOT_US:%lu", (unsigned long)info.now, info.flash ? "ON" : "OFF", (unsigned long)info.oldest[HIST_TIER_SEC], (unsigned long)info.newest[HIST_TIER_SEC], (unsigned long)info.oldest[HIST_TIER_MIN], (unsigned long)info.newest[HIST_TIER_MIN], (unsigned long)info.oldest[HIST_TIER_HOUR], (unsigned long)info.newest[HIST_TIER_HOUR], (unsigned long)info.records, (unsigned long)info.keys, (unsigned long)info.erases, (unsigned long)info.dropped, (unsigned long)info.boot_us);
+            send_ok(resp, buf);
+        } else if(strcmp(subcmd, "DUMP") == 0){
+            // HIST DUMP <SEC|MIN|HOUR> [desde] [hasta]: todo por defecto
+            hist_tier_t tier;
+            if(!history_tier_parse(arg1, &tier)){
+                send_error(resp, "NIVEL_INVALIDO");
+                break;
+            }
+            uint32_t now = history_now();
+            uint32_t from = (arg2[0] != '\0') ? strtoul(arg2, NULL, 10) : 0;
+            uint32_t to = (arg3[0] != '\0') ? strtoul(arg3, NULL, 10) : now;
+            // la UART primero: si está ocupada no hay que reservar el cursor del historial
+            if(uart_dump_busy() || !history_dump_begin(tier, from, to)){
+                send_error(resp, "VOLCADO_EN_CURSO");
+                break;
+            }
+            char header[UART_DUMP_HEADER_LEN];
+            snprintf(header, sizeof(header), "TIER:%s FROM:%lu TO:%lu NOW:%lu REC:%u", history_tier_name(tier), (unsigned long)from, (unsigned long)to, (unsigned long)now, (unsigned)sizeof(hist_point_t));
+            uart_dump_start("HIST", history_dump_read, header);
+            send_ok(resp, "HIST_DUMP");
+        } else {
+            send_error(resp, "SUBCMD_INVALIDO");
+        }
+        break;
+    }
+
     case CMD_HELP: {
-        send_ok(resp, "PING LOGIN LOGOUT USERID MEAS MODE LOAD ENERGY CFG HELP");
+        send_ok(resp, "PING LOGIN LOGOUT USERID MEAS MODE LOAD ENERGY CFG ACQ TASKS HARM WAVE ADCREC DMA CAL HIST HELP");
         break;
     }
 
@@ -13,6 +13,15 @@ static change_detector_t change_detector;
 static QueueHandle_t uart_cmd_buffer;
 static QueueHandle_t uart_resp_buffer;
 
+/*pedido de volcado: lo escribe task_uart_handler, lo consume task_uart_tx (bajo dump_lock)*/
+static portMUX_TYPE dump_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool dump_req = false;
+static bool dump_busy = false;      // desde el pedido hasta <tag>_END
+static state_sub_t tx_sub = -1;
+static const char *dump_req_tag;
+static uart_dump_read_t dump_req_read;
+static char dump_req_header[UART_DUMP_HEADER_LEN];
+
 static state_ths_t update_thresholds = {
     .i_ths = UPDATE_CURR_THS,
     .v_ths = UPDATE_VOLT_THS,
@@ -28,6 +37,45 @@ static void uart_send_string(const char *str){
     uart_write_bytes(UART_NUM, str, len);
 }
 
+/* Codifica len bytes en base64 terminado en '\0'. out debe tener 4*ceil(len/3)+1 bytes */
+static void uart_base64_encode(const uint8_t *in, size_t len, char *out){
+    static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t o = 0;
+
+    for(size_t k = 0; k < len; k += 3){
+        uint32_t w = (uint32_t)in[k] << 16;
+        if(k + 1 < len) w |= (uint32_t)in[k + 1] << 8;
+        if(k + 2 < len) w |= in[k + 2];
+
+        out[o++] = b64[(w >> 18) & 0x3F];
+        out[o++] = b64[(w >> 12) & 0x3F];
+        out[o++] = (k + 1 < len) ? b64[(w >> 6) & 0x3F] : '=';
+        out[o++] = (k + 2 < len) ? b64[w & 0x3F] : '=';
+    }
+    out[o] = '\0';
+}
+
+/* Envía hasta UART_DUMP_LINES_PER_TICK líneas del volcado. Retorna false al terminar */
+static bool uart_dump_step(const char *tag, uart_dump_read_t read_fn, uint32_t *offset){
+    static uint8_t chunk[UART_DUMP_CHUNK_BYTES];
+    static char line[32 + (UART_DUMP_CHUNK_BYTES + 2) / 3 * 4 + 4];
+    static char b64[(UART_DUMP_CHUNK_BYTES + 2) / 3 * 4 + 1];
+
+    for(uint8_t l = 0; l < UART_DUMP_LINES_PER_TICK; l++){
+        size_t n = read_fn(*offset, chunk, sizeof(chunk));
+        if(n == 0){
+            snprintf(line, sizeof(line), "%s_END %lu\r\n", tag, (unsigned long)*offset);
+            uart_send_string(line);
+            return false;
+        }
+        uart_base64_encode(chunk, n, b64);
+        snprintf(line, sizeof(line), "%s %lu %s\r\n", tag, (unsigned long)*offset, b64);
+        uart_send_string(line);
+        *offset += n;
+    }
+    return true;
+}
+
 void uart_protocol_init(){
     uart_config_t uart_config = {
         .baud_rate = UART_BAUD_RATE,
@@ -136,6 +184,13 @@ void task_uart_tx(void *pvParameters){
     static char buf[200];
     static state_t st;
     static sys_load_cfg_t cfg;
+    static bool dump_active = false;
+    static uint32_t dump_offset = 0;
+    static const char *dump_tag;
+    static uart_dump_read_t dump_read;
+    static char dump_header[UART_DUMP_HEADER_LEN];
+
+    tx_sub = state_subscribe(STATE_EV_MEASURE | STATE_EV_OUTPUTS | STATE_EV_FAILS);
 
     while(1){
         /*enviar respuestas pendientes*/
@@ -143,6 +198,32 @@ void task_uart_tx(void *pvParameters){
             uart_send_string(resp.data);
         }
 
+        /*volcados binarios, repartidos entre iteraciones para no demorar las alertas*/
+        if(!dump_active){
+            portENTER_CRITICAL(&dump_lock);
+            if(dump_req){
+                dump_req = false;
+                dump_tag = dump_req_tag;
+                dump_read = dump_req_read;
+                memcpy(dump_header, dump_req_header, sizeof(dump_header));
+                dump_active = true;
+            }
+            portEXIT_CRITICAL(&dump_lock);
+            if(dump_active){
+                snprintf(buf, sizeof(buf), "%s_BEGIN %s\r\n", dump_tag, dump_header);
+                uart_send_string(buf);
+                dump_offset = 0;
+            }
+        }
+        if(dump_active){
+            dump_active = uart_dump_step(dump_tag, dump_read, &dump_offset);
+            if(!dump_active){
+                portENTER_CRITICAL(&dump_lock);
+                dump_busy = false;
+                portEXIT_CRITICAL(&dump_lock);
+            }
+        }
+
         state_get(&st);
         control_get_cfg(&cfg);
 
@@ -196,12 +277,14 @@ void task_uart_tx(void *pvParameters){
         if(uart_get_disp_mode() == DISP_CONT){
 
             if(state_change_detector_update(&change_detector, &st, &update_thresholds)){
-                snprintf(buf, sizeof(buf), "CONT_MEAS V:%d I:%.2f P:%.3f S:%.3f FP:%.3f E:%.3f\r\n", (uint16_t)st.measure.Vrms, st.measure.Irms, st.measure.P, st.measure.S, st.measure.fp, st.measure.E);              
+                snprintf(buf, sizeof(buf), "CONT_MEAS V:%d I:%.2f P:%.3f Q:%.3f S:%.3f FP:%.3f FPD:%.3f F:%.2f E:%.3f\r\n", (uint16_t)st.measure.Vrms, st.measure.Irms, st.measure.P, st.measure.Q, st.measure.S, st.measure.fp, st.measure.fp_disp, st.measure.f, st.measure.E);              
                 uart_send_string(buf);
                 state_change_detector_mark_sent(&change_detector, &st);
             }
         }
-        vTaskDelay(pdMS_TO_TICKS(TASK_PERIOD_COMM_UART_MS));
+
+        /*esperar avisos de state o respuestas; con un volcado en curso, a su ritmo*/
+        state_wait(tx_sub, dump_active ? TASK_PERIOD_COMM_UART_MS : STATE_WAIT_MAX_MS);
     }
 }
 
@@ -220,6 +303,7 @@ void task_uart_handler(void *pvParameters){
         if(!xQueueSend(uart_resp_buffer, &resp, pdMS_TO_TICKS(TASK_UART_RX_TIMEOUT*10))){
             ESP_LOGW(TAG, "Cola Tx llena, respuesta perdida");
         }
+        state_wake(tx_sub);
     }
 }
 
@@ -229,4 +313,29 @@ void uart_set_disp_mode(uart_disp_mode_t mode){
 
 uart_disp_mode_t uart_get_disp_mode(void){
     return uart_state.disp_mode;
+}
+
+bool uart_dump_busy(void){
+    portENTER_CRITICAL(&dump_lock);
+    bool busy = dump_busy;
+    portEXIT_CRITICAL(&dump_lock);
+    return busy;
+}
+
+bool uart_dump_start(const char *tag, uart_dump_read_t read_fn, const char *header){
+    portENTER_CRITICAL(&dump_lock);
+    bool busy = dump_busy;
+    if(!busy){
+        dump_req_tag = tag;
+        dump_req_read = read_fn;
+        strncpy(dump_req_header, header, sizeof(dump_req_header) - 1);
+        dump_req_header[sizeof(dump_req_header) - 1] = '\0';
+        dump_req = true;
+        dump_busy = true;
+    }
+    portEXIT_CRITICAL(&dump_lock);
+    if(busy) return false;
+
+    state_wake(tx_sub);
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "core/energy_log.h"
+#include <string.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_partition.h"
+#include "esp_crc.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "ELOG";
+
+#define RECS_PER_SECTOR ((uint32_t)ENERGY_LOG_RECS_PER_SECTOR)
+
+static const esp_partition_t *part;
+static uint32_t sectors;
+static uint32_t slots;              // sectors * RECS_PER_SECTOR
+static uint32_t next_slot;          // próximo lugar a escribir
+static uint32_t last_seq;           // 0: diario vacío
+static energy_log_rec_t latest;
+static bool have_latest;
+
+static portMUX_TYPE info_lock = portMUX_INITIALIZER_UNLOCKED;
+static energy_log_info_t info;
+
+static uint32_t rec_crc(const energy_log_rec_t *rec){
+    uint32_t crc = esp_crc32_le(0, (const uint8_t *)&rec->seq, sizeof(rec->seq));
+    return esp_crc32_le(crc, (const uint8_t *)&rec->regs, sizeof(*rec) - offsetof(energy_log_rec_t, regs));
+}
+
+static inline uint32_t slot_addr(uint32_t slot){
+    return (slot / RECS_PER_SECTOR) * ENERGY_LOG_SECTOR_BYTES + (slot % RECS_PER_SECTOR) * sizeof(energy_log_rec_t);
+}
+
+/* Lee un lugar; retorna la secuencia si el registro es válido, 0 si no */
+static uint32_t read_slot(uint32_t slot, energy_log_rec_t *rec){
+    info.boot_reads++;
+    if(esp_partition_read(part, slot_addr(slot), rec, sizeof(*rec)) != ESP_OK){
+        info.errors++;
+        return 0;
+    }
+    if(rec->seq == 0 || rec->seq == ENERGY_LOG_SEQ_FREE) return 0;
+    return rec_crc(rec) == rec->crc ? rec->seq : 0;
+}
+
+/* Lee sólo la secuencia de un lugar (para buscar el último escrito) */
+static uint32_t read_seq(uint32_t slot){
+    uint32_t seq = ENERGY_LOG_SEQ_FREE;
+    info.boot_reads++;
+    if(esp_partition_read(part, slot_addr(slot), &seq, sizeof(seq)) != ESP_OK){
+        info.errors++;
+    }
+    return seq;
+}
+
+/*
+ * La secuencia del primer registro de cada sector, recorrida en círculo
+ * desde el sector siguiente a la cabeza, es no decreciente (los sectores sin
+ * escribir o recién borrados valen 0). Si el sector 0 es válido, los
+ * sectores 0..cabeza son los únicos con secuencia >= la suya: la cabeza es
+ * el último que cumple, y se encuentra por búsqueda binaria. head_seq es la
+ * secuencia de su primer registro.
+ */
+static bool find_head_sector(uint32_t *head, uint32_t *head_seq){
+    energy_log_rec_t rec;
+    uint32_t first = read_slot(0, &rec);
+
+    if(first == 0){
+        // sector 0 borrado a mitad de vuelta: la cabeza es el último, si tiene algo
+        uint32_t seq = read_slot((sectors - 1) * RECS_PER_SECTOR, &rec);
+        if(seq == 0) return false;
+        *head = sectors - 1;
+        *head_seq = seq;
+        return true;
+    }
+
+    uint32_t lo = 0, hi = sectors - 1;      // invariante: lo cumple
+    uint32_t lo_seq = first;
+    while(lo < hi){
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        uint32_t seq = read_slot(mid * RECS_PER_SECTOR, &rec);
+        if(seq >= first){
+            lo = mid;
+            lo_seq = seq;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    *head = lo;
+    *head_seq = lo_seq;
+    return true;
+}
+
+/*
+ * Último registro válido del sector, retrocediendo desde el lugar top hasta
+ * el primero. torn cuenta los lugares salteados (rotos o ilegibles).
+ */
+static bool find_valid_back(uint32_t sector, uint32_t top, energy_log_rec_t *rec, uint32_t *torn){
+    uint32_t base = sector * RECS_PER_SECTOR;
+    for(uint32_t k = top + 1; k-- > 0;){
+        if(read_slot(base + k, rec) != 0) return true;
+        (*torn)++;
+    }
+    return false;
+}
+
+/* true si el lugar está entero en 0xFF (nunca se empezó a escribir) */
+static bool slot_is_free(uint32_t slot){
+    uint32_t words[sizeof(energy_log_rec_t) / sizeof(uint32_t)];
+    info.boot_reads++;
+    if(esp_partition_read(part, slot_addr(slot), words, sizeof(words)) != ESP_OK){
+        info.errors++;
+        return false;
+    }
+    for(size_t k = 0; k < sizeof(words) / sizeof(words[0]); k++){
+        if(words[k] != 0xFFFFFFFFu) return false;
+    }
+    return true;
+}
+
+bool energy_log_init(){
+    int64_t t0 = esp_timer_get_time();
+
+    portENTER_CRITICAL(&info_lock);
+    memset(&info, 0, sizeof(info));
+    portEXIT_CRITICAL(&info_lock);
+
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, ENERGY_LOG_PARTITION);
+    if(part == NULL){
+        ESP_LOGW(TAG, "Sin partición '%s': energía en NVS", ENERGY_LOG_PARTITION);
+        return false;
+    }
+
+    sectors = part->size / ENERGY_LOG_SECTOR_BYTES;
+    slots = sectors * RECS_PER_SECTOR;
+    if(sectors < 2){
+        ESP_LOGE(TAG, "Partición '%s' demasiado chica", ENERGY_LOG_PARTITION);
+        part = NULL;
+        return false;
+    }
+
+    uint32_t head, head_seq;
+    uint32_t torn = 0;
+    if(find_head_sector(&head, &head_seq)){
+        // los lugares escritos de la cabeza son un prefijo: último con secuencia no libre
+        uint32_t base = head * RECS_PER_SECTOR;
+        uint32_t lo = 0, hi = RECS_PER_SECTOR - 1;  // el lugar 0 es válido
+        while(lo < hi){
+            uint32_t mid = lo + (hi - lo + 1) / 2;
+            if(read_seq(base + mid) != ENERGY_LOG_SEQ_FREE){
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+
+        // un corte durante la escritura deja el último roto: retrocede al válido, sin pasar del lugar 0.
+        // Si la cabeza no tiene ninguno legible se usa el último del sector anterior
+        uint32_t prev = (head + sectors - 1) % sectors;
+        have_latest = find_valid_back(head, lo, &latest, &torn);
+        if(!have_latest){
+            have_latest = find_valid_back(prev, RECS_PER_SECTOR - 1, &latest, &torn) && latest.seq < head_seq;
+            ESP_LOGW(TAG, "Sector cabeza %lu ilegible: %s", (unsigned long)head, have_latest ? "se usa el anterior" : "diario vacío");
+        }
+
+        // la secuencia nunca retrocede, aunque se recupere un registro anterior a la cabeza
+        last_seq = head_seq;
+        if(have_latest && latest.seq > last_seq) last_seq = latest.seq;
+
+        if(torn == 0 && lo + 1 < RECS_PER_SECTOR && slot_is_free(base + lo + 1)){
+            // cierre limpio: se sigue en el mismo sector
+            next_slot = base + lo + 1;
+        } else {
+            // el resto de la cabeza puede tener un registro a medio escribir: se sigue en el siguiente
+            next_slot = ((head + 1) % sectors) * RECS_PER_SECTOR;
+        }
+    } else {
+        have_latest = false;
+        last_seq = 0;
+        next_slot = 0;
+    }
+
+    portENTER_CRITICAL(&info_lock);
+    info.ready = true;
+    info.sectors = sectors;
+    info.seq = last_seq;
+    info.next = next_slot;
+    info.boot_torn = torn;
+    info.boot_us = (uint32_t)(esp_timer_get_time() - t0);
+    portEXIT_CRITICAL(&info_lock);
+
+    if(have_latest){
+        ESP_LOGI(TAG, "Recuperado seq %lu: %.3f kWh (%lu lecturas, %lu us)", (unsigned long)last_seq, latest.regs.E, (unsigned long)info.boot_reads, (unsigned long)info.boot_us);
+    } else {
+        ESP_LOGI(TAG, "Diario vacío (%lu sectores)", (unsigned long)sectors);
+    }
+    return true;
+}
+
+bool energy_log_latest(energy_regs_t *regs, load_energy_t *loads){
+    if(!have_latest) return false;
+    *regs = latest.regs;
+    *loads = latest.loads;
+    return true;
+}
+
+bool energy_log_append(const energy_regs_t *regs, const load_energy_t *loads){
+    if(part == NULL) return false;
+
+    energy_log_rec_t rec;
+    rec.seq = last_seq + 1;
+    rec.regs = *regs;
+    rec.loads = *loads;
+    rec.crc = rec_crc(&rec);
+
+    uint32_t slot = next_slot;
+    uint32_t addr = slot_addr(slot);
+    esp_err_t err = ESP_OK;
+    bool erased = false;
+
+    if(slot % RECS_PER_SECTOR == 0){
+        err = esp_partition_erase_range(part, addr, ENERGY_LOG_SECTOR_BYTES);
+        erased = (err == ESP_OK);
+    }
+    if(err == ESP_OK){
+        err = esp_partition_write(part, addr, &rec, sizeof(rec));
+    }
+
+    if(err == ESP_OK){
+        last_seq = rec.seq;
+        next_slot = (slot + 1) % slots;
+    } else {
+        // a mitad de sector el lugar puede quedar roto: se abandona el sector.
+        // En el primer lugar se reintenta el mismo (borrado incluido), para que
+        // un sector sin primer registro válido nunca quede antes de la cabeza
+        if(slot % RECS_PER_SECTOR != 0){
+            next_slot = ((slot / RECS_PER_SECTOR + 1) % sectors) * RECS_PER_SECTOR;
+        }
+        ESP_LOGE(TAG, "Fallo la escritura en el lugar %lu: %s", (unsigned long)slot, esp_err_to_name(err));
+    }
+
+    portENTER_CRITICAL(&info_lock);
+    if(err == ESP_OK) info.appends++;
+    else info.errors++;
+    if(erased) info.erases++;
+    info.seq = last_seq;
+    info.next = next_slot;
+    portEXIT_CRITICAL(&info_lock);
+
+    return err == ESP_OK;
+}
+
+bool energy_log_is_ready(){
+    return part != NULL;
+}
+
+void energy_log_get_info(energy_log_info_t *out){
+    portENTER_CRITICAL(&info_lock);
+    *out = info;
+    portEXIT_CRITICAL(&info_lock);
+}
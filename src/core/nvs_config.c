@@ -145,14 +145,14 @@ bool nvs_load_config(sys_load_cfg_t *cfg){
     return true;
 }
 
-bool nvs_save_energy(double energy){
+bool nvs_save_energy(const energy_regs_t *regs){
     nvs_handle_t handle;
     esp_err_t err;
 
     err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
     if( err != ESP_OK) return false;
 
-    err = nvs_set_blob(handle, "energy", &energy, sizeof(double));
+    err = nvs_set_blob(handle, "energy_regs", regs, sizeof(energy_regs_t));
     if(err == ESP_OK){
         err = nvs_commit(handle);
     }
@@ -160,31 +160,145 @@ bool nvs_save_energy(double energy){
     nvs_close(handle);
 
     if(err == ESP_OK){
-        ESP_LOGI(TAG, "Energia guardada: %.3f KWh", energy);
+        ESP_LOGI(TAG, "Energia guardada: %.3f KWh (imp %.3f, exp %.3f, q %.3f)", regs->E, regs->E_imp, regs->E_exp, regs->E_q);
         return true;
     }
     return false;
 }
 
-double nvs_load_energy(){
+bool nvs_load_energy(energy_regs_t *regs){
     nvs_handle_t handle;
     esp_err_t err;
-    double energy = 0.0;
+
+    memset(regs, 0, sizeof(*regs));
 
     err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
-    if( err != ESP_OK) return 0.0;
+    if( err != ESP_OK) return false;
 
-    size_t req_size = sizeof(double);
-    err = nvs_get_blob(handle, "energy", &energy, &req_size);
+    size_t req_size = sizeof(energy_regs_t);
+    err = nvs_get_blob(handle, "energy_regs", regs, &req_size);
+    if(err != ESP_OK || req_size != sizeof(energy_regs_t)){
+        // formato anterior: sólo la energía neta
+        double energy = 0.0;
+        memset(regs, 0, sizeof(*regs));
+        req_size = sizeof(double);
+        err = nvs_get_blob(handle, "energy", &energy, &req_size);
+        if(err == ESP_OK){
+            regs->E = energy;
+            regs->E_imp = energy;
+        }
+    }
 
     nvs_close(handle);
 
     if(err == ESP_OK){
-        ESP_LOGI(TAG, "Energia cargada: %.3f KWh", energy);
-        return energy;
+        ESP_LOGI(TAG, "Energia cargada: %.3f KWh (imp %.3f, exp %.3f, q %.3f)", regs->E, regs->E_imp, regs->E_exp, regs->E_q);
+        return true;
     }
 
-    return 0.0;
+    return false;
+}
+
+bool nvs_save_load_energy(const load_energy_t *regs){
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if( err != ESP_OK) return false;
+
+    err = nvs_set_blob(handle, "load_energy", regs, sizeof(load_energy_t));
+    if(err == ESP_OK){
+        err = nvs_commit(handle);
+    }
+
+    nvs_close(handle);
+
+    if(err == ESP_OK){
+        ESP_LOGI(TAG, "Energia por carga guardada (resto %.3f KWh)", regs->E_other);
+        return true;
+    }
+    return false;
+}
+
+bool nvs_load_load_energy(load_energy_t *regs){
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    memset(regs, 0, sizeof(*regs));
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if( err != ESP_OK) return false;
+
+    size_t req_size = sizeof(load_energy_t);
+    err = nvs_get_blob(handle, "load_energy", regs, &req_size);
+    nvs_close(handle);
+
+    if(err != ESP_OK || req_size != sizeof(load_energy_t)){
+        // otra cantidad de cargas: se descarta
+        memset(regs, 0, sizeof(*regs));
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Energia por carga cargada (resto %.3f KWh)", regs->E_other);
+    return true;
+}
+
+bool nvs_save_cal(const measure_cal_t *cal){
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if( err != ESP_OK) return false;
+
+    err = nvs_set_blob(handle, "meas_cal", cal, sizeof(measure_cal_t));
+    if(err == ESP_OK){
+        err = nvs_commit(handle);
+    }
+
+    nvs_close(handle);
+
+    if(err == ESP_OK){
+        ESP_LOGI(TAG, "Calibracion guardada: Vg %.4e, Is %.4f, Vn %.1f, In %.3f, Io %.3f", cal->v_gain, cal->i_sens, cal->v_noise, cal->i_noise, cal->i_offset);
+        return true;
+    }
+    return false;
+}
+
+bool nvs_load_cal(measure_cal_t *cal){
+    nvs_handle_t handle;
+    esp_err_t err;
+    measure_cal_t tmp;
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if( err != ESP_OK) return false;
+
+    size_t req_size = sizeof(measure_cal_t);
+    err = nvs_get_blob(handle, "meas_cal", &tmp, &req_size);
+    nvs_close(handle);
+
+    if(err != ESP_OK || req_size != sizeof(measure_cal_t)) return false;
+
+    *cal = tmp;
+    ESP_LOGI(TAG, "Calibracion cargada: Vg %.4e, Is %.4f, Vn %.1f, In %.3f, Io %.3f", cal->v_gain, cal->i_sens, cal->v_noise, cal->i_noise, cal->i_offset);
+    return true;
+}
+
+bool nvs_erase_cal(){
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if( err != ESP_OK) return false;
+
+    err = nvs_erase_key(handle, "meas_cal");
+    if(err == ESP_ERR_NVS_NOT_FOUND){
+        err = ESP_OK;
+    }else if(err == ESP_OK){
+        err = nvs_commit(handle);
+    }
+
+    nvs_close(handle);
+    return err == ESP_OK;
 }
 
 bool nvs_reset_default(){
@@ -0,0 +1,197 @@
+#include "core/persist.h"
+#include "core/nvs_config.h"
+#include "core/energy_log.h"
+#include "app/history.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "PERSIST";
+
+#define PENDING_ENERGY  (1u << 0)
+#define PENDING_CONFIG  (1u << 1)
+#define PENDING_HISTORY (1u << 2)   // los datos quedan en la cola del historial
+#define PENDING_CAL     (1u << 3)   // guardar mbox_cal o, con mbox_cal_erase, borrarla
+
+/*buzón: un lugar por tipo, el último pedido gana*/
+static portMUX_TYPE mbox_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t pending;
+static energy_regs_t mbox_regs;
+static load_energy_t mbox_loads;
+static sys_load_cfg_t mbox_cfg;
+static measure_cal_t mbox_cal;
+static bool mbox_cal_erase;
+
+static SemaphoreHandle_t write_mutex;   // task_persist o un flush: uno a la vez
+static TaskHandle_t persist_task_handle;
+static persist_stats_t stats;
+
+static void persist_shutdown(){
+    persist_flush();
+}
+
+void persist_init(){
+    write_mutex = xSemaphoreCreateMutex();
+    configASSERT(write_mutex != NULL);
+
+    if(esp_register_shutdown_handler(persist_shutdown) != ESP_OK){
+        ESP_LOGW(TAG, "No se pudo registrar el flush de apagado");
+    }
+}
+
+/* Marca un pedido pendiente (sección crítica tomada) */
+static inline void persist_mark(uint32_t bit){
+    stats.requests++;
+    if(pending & bit) stats.coalesced++;
+    pending |= bit;
+}
+
+static void persist_kick(){
+    TaskHandle_t task = persist_task_handle;
+    if(task != NULL) xTaskNotifyGive(task);
+}
+
+void persist_energy(const energy_regs_t *regs, const load_energy_t *loads){
+    portENTER_CRITICAL(&mbox_lock);
+    mbox_regs = *regs;
+    mbox_loads = *loads;
+    persist_mark(PENDING_ENERGY);
+    portEXIT_CRITICAL(&mbox_lock);
+    persist_kick();
+}
+
+void persist_config(const sys_load_cfg_t *cfg){
+    portENTER_CRITICAL(&mbox_lock);
+    mbox_cfg = *cfg;
+    persist_mark(PENDING_CONFIG);
+    portEXIT_CRITICAL(&mbox_lock);
+    persist_kick();
+}
+
+void persist_cal(const measure_cal_t *cal){
+    portENTER_CRITICAL(&mbox_lock);
+    mbox_cal = *cal;
+    mbox_cal_erase = false;
+    persist_mark(PENDING_CAL);
+    portEXIT_CRITICAL(&mbox_lock);
+    persist_kick();
+}
+
+void persist_cal_erase(){
+    portENTER_CRITICAL(&mbox_lock);
+    mbox_cal_erase = true;
+    persist_mark(PENDING_CAL);
+    portEXIT_CRITICAL(&mbox_lock);
+    persist_kick();
+}
+
+void persist_history(){
+    portENTER_CRITICAL(&mbox_lock);
+    persist_mark(PENDING_HISTORY);
+    portEXIT_CRITICAL(&mbox_lock);
+    persist_kick();
+}
+
+bool persist_flush(){
+    static energy_regs_t regs;
+    static load_energy_t loads;
+    static sys_load_cfg_t cfg;
+    static measure_cal_t cal;
+    bool cal_erase = false;
+    bool ok = true;
+
+    xSemaphoreTake(write_mutex, portMAX_DELAY);
+
+    portENTER_CRITICAL(&mbox_lock);
+    uint32_t todo = pending;
+    pending = 0;
+    if(todo & PENDING_ENERGY){
+        regs = mbox_regs;
+        loads = mbox_loads;
+    }
+    if(todo & PENDING_CONFIG){
+        cfg = mbox_cfg;
+    }
+    if(todo & PENDING_CAL){
+        cal = mbox_cal;
+        cal_erase = mbox_cal_erase;
+    }
+    portEXIT_CRITICAL(&mbox_lock);
+
+    if(todo){
+        int64_t t0 = esp_timer_get_time();
+
+        if(todo & PENDING_ENERGY){
+            if(energy_log_is_ready()){
+                ok &= energy_log_append(&regs, &loads);
+            } else {
+                ok &= nvs_save_energy(&regs);
+                ok &= nvs_save_load_energy(&loads);
+            }
+        }
+        if(todo & PENDING_CONFIG){
+            bool cfg_ok = nvs_save_config(&cfg);
+            if(!cfg_ok){
+                // no hay otro pedido que la reponga: vuelve a quedar pendiente
+                // (mbox_cfg tiene esta u otra más nueva)
+                portENTER_CRITICAL(&mbox_lock);
+                pending |= PENDING_CONFIG;
+                stats.cfg_errors++;
+                portEXIT_CRITICAL(&mbox_lock);
+            }
+            ok &= cfg_ok;
+        }
+        if(todo & PENDING_CAL){
+            bool cal_ok = cal_erase ? nvs_erase_cal() : nvs_save_cal(&cal);
+            if(!cal_ok){
+                portENTER_CRITICAL(&mbox_lock);
+                stats.cal_errors++;
+                portEXIT_CRITICAL(&mbox_lock);
+            }
+            ok &= cal_ok;
+        }
+        if(todo & PENDING_HISTORY){
+            ok &= history_flush();
+        }
+
+        uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+        stats.writes++;
+        stats.write_us_last = us;
+        if(us > stats.write_us_max) stats.write_us_max = us;
+        if(!ok){
+            stats.errors++;
+            ESP_LOGE(TAG, "Fallo la escritura en flash");
+        }
+    }
+
+    xSemaphoreGive(write_mutex);
+    return ok;
+}
+
+void persist_get_stats(persist_stats_t *out){
+    portENTER_CRITICAL(&mbox_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&mbox_lock);
+}
+
+void task_persist(void *pvParameters){
+    (void)pvParameters;
+
+    persist_task_handle = xTaskGetCurrentTaskHandle();
+
+    while(1){
+        portENTER_CRITICAL(&mbox_lock);
+        bool idle = (pending == 0);
+        portEXIT_CRITICAL(&mbox_lock);
+
+        if(idle){
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        vTaskDelay(pdMS_TO_TICKS(PERSIST_BATCH_MS)); // junta los pedidos cercanos
+        ulTaskNotifyTake(pdTRUE, 0);                 // los avisos del lote ya están atendidos
+        persist_flush();
+    }
+}
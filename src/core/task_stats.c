@@ -0,0 +1,88 @@
+#include "core/task_stats.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    UBaseType_t task_number;
+    uint32_t run_time;
+} task_sample_t;
+
+static TaskStatus_t status[TASK_STATS_MAX_TASKS];
+static task_sample_t prev[TASK_STATS_MAX_TASKS];
+static UBaseType_t prev_count = 0;
+static uint32_t prev_total = 0;
+
+static uint32_t task_stats_prev_runtime(UBaseType_t task_number){
+    for(UBaseType_t i = 0; i < prev_count; i++){
+        if(prev[i].task_number == task_number) return prev[i].run_time;
+    }
+    return 0; // tarea nueva desde la última consulta
+}
+
+bool task_stats_format(char *buf, size_t len){
+    uint32_t total;
+    uint32_t share[TASK_STATS_MAX_TASKS]; // décimas de % de su núcleo
+    uint32_t idle_share[portNUM_PROCESSORS] = {0};
+
+    if(len == 0) return false;
+    buf[0] = '\0';
+
+    // retorna 0 si hay más tareas que lugares en status[]
+    UBaseType_t count = uxTaskGetSystemState(status, TASK_STATS_MAX_TASKS, &total);
+    if(count == 0) return false;
+
+    uint32_t d_total = total - prev_total;
+    if(d_total == 0) d_total = 1;
+
+    for(UBaseType_t i = 0; i < count; i++){
+        uint32_t d_run = status[i].ulRunTimeCounter - task_stats_prev_runtime(status[i].xTaskNumber);
+        share[i] = (uint32_t)(((uint64_t)d_run * 1000) / d_total);
+
+        for(BaseType_t c = 0; c < portNUM_PROCESSORS; c++){
+            if(status[i].xHandle == xTaskGetIdleTaskHandleForCore(c)) idle_share[c] = share[i];
+        }
+    }
+
+    /*guardo la muestra actual como referencia de la próxima consulta*/
+    for(UBaseType_t i = 0; i < count; i++){
+        prev[i].task_number = status[i].xTaskNumber;
+        prev[i].run_time = status[i].ulRunTimeCounter;
+    }
+    prev_count = count;
+    prev_total = total;
+
+    size_t pos = 0;
+    for(BaseType_t c = 0; c < portNUM_PROCESSORS; c++){
+        uint32_t load = (idle_share[c] >= 1000) ? 0 : (1000 - idle_share[c]);
+        int w = snprintf(buf + pos, len - pos, "C%d:%lu.%lu%% ", (int)c, (unsigned long)(load / 10), (unsigned long)(load % 10));
+        if(w < 0 || (size_t)w >= len - pos){
+            buf[pos] = '\0';
+            return true;
+        }
+        pos += w;
+    }
+
+    /*listado por consumo decreciente (selección simple, count es chico)*/
+    bool listed[TASK_STATS_MAX_TASKS] = {false};
+    for(UBaseType_t n = 0; n < count; n++){
+        int best = -1;
+        for(UBaseType_t i = 0; i < count; i++){
+            if(!listed[i] && (best < 0 || share[i] > share[best])) best = (int)i;
+        }
+        listed[best] = true;
+        if(share[best] < TASK_STATS_MIN_SHARE_PERMIL) break;
+
+        BaseType_t core = xTaskGetCoreID(status[best].xHandle);
+        char core_c = (core >= 0 && core < portNUM_PROCESSORS) ? (char)('0' + core) : '*';
+
+        int w = snprintf(buf + pos, len - pos, "%s/%c:%lu.%lu ", status[best].pcTaskName, core_c, (unsigned long)(share[best] / 10), (unsigned long)(share[best] % 10));
+        if(w < 0 || (size_t)w >= len - pos){
+            buf[pos] = '\0'; // no entra la tarea completa, descarto lo truncado
+            break;
+        }
+        pos += w;
+    }
+
+    if(pos > 0 && buf[pos - 1] == ' ') buf[pos - 1] = '\0';
+    return true;
+}
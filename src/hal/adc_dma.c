@@ -1,59 +1,574 @@
 #include "hal/adc_dma.h"
+#include "esp_timer.h"
+#include <string.h>
 
 static adc_continuous_handle_t s_adc_handle;
 static adc_cali_handle_t adc1_cali_handle = NULL;
+static int16_t adc_cal_lut[ADC_MAX_COUNT + 1]; // raw → mV
+static bool adc_lut_calibrated = false;
+static const uint8_t adc_pattern_ch[ADC_PATTERN_LEN] = ADC_PATTERN_CHANNELS;
 
-void app_adc_dma_init(){
+/*dimensionado y telemetría del DMA: sólo los escribe la tarea lectora; el resto de las tareas pide cambios por flags*/
+static adc_dma_cfg_t dma_cfg = {
+    .ring_bytes = ADC_DMA_RING_DEFAULT_BYTES,
+    .frame_bytes = FRAME_BYTES,
+    .auto_grow = true,
+};
+static adc_dma_cfg_t dma_cfg_req;
+static volatile bool dma_reinit_req = false;
+static volatile bool dma_reset_req = false;
+static bool dma_started = false;        // app_adc_dma_start_conv() ya se llamó
+static bool dma_running = false;        // el handle vivo está convirtiendo
+static bool dma_down = false;           // sin handle: falló también la reapertura con la configuración anterior
+static adc_dma_stats_t dma_stats;
+static int64_t dma_last_read_us = 0;    // 0: sin lectura previa válida para medir el intervalo
+#if !ADC_DMA_EVENT_ENABLE
+static int64_t dma_ovf_window_us = 0;   // crecimiento automático del ring
+static uint8_t dma_ovf_count = 0;
+#endif
+
+/*frame entregado por app_adc_dma_get_frame(): buffer propio (lectura bloqueante y reproducción), alineado a 4 bytes*/
+static uint32_t dma_frame[FRAME_BYTES / sizeof(uint32_t)];
+static bool frame_from_dma = false;
+
+/*frames perdidos informados por la ISR; la tarea lectora guarda lo ya contabilizado*/
+static volatile uint32_t isr_lost_frames = 0;
+static uint32_t isr_lost_seen = 0;
+
+#if ADC_DMA_EVENT_ENABLE
+/*cola de un productor (ISR on_conv_done) y un consumidor (tarea lectora) con referencias a los buffers DMA*/
+typedef struct {
+    const uint8_t *buf;
+    uint32_t len;
+    uint32_t seq;
+} adc_dma_evt_ref_t;
+
+static adc_dma_evt_ref_t evt_queue[ADC_DMA_EVT_QUEUE];
+static volatile uint32_t evt_head = 0;  // lo avanza sólo la ISR
+static volatile uint32_t evt_tail = 0;  // lo avanza sólo la tarea lectora
+static volatile uint32_t evt_seq = 0;   // frames completados por el driver
+static uint32_t evt_cur_seq = 0;        // frame entregado a la tarea
+static TaskHandle_t evt_task = NULL;
+
+static bool IRAM_ATTR adc_dma_on_conv_done(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data){
+    uint32_t seq = ++evt_seq;
+
+    if(evt_head - evt_tail >= ADC_DMA_EVT_QUEUE){
+        isr_lost_frames++; // la tarea no alcanzó a procesar: el frame se pierde
+        return false;
+    }
+    adc_dma_evt_ref_t *ref = &evt_queue[evt_head % ADC_DMA_EVT_QUEUE];
+    ref->buf = edata->conv_frame_buffer;
+    ref->len = edata->size;
+    ref->seq = seq;
+    evt_head++; // publicado después de completar la referencia
+
+    BaseType_t woken = pdFALSE;
+    if(evt_task != NULL) vTaskNotifyGiveFromISR(evt_task, &woken);
+    return (woken == pdTRUE);
+}
+
+/*el ring del driver no se lee en este modo: lo vacía el driver (flush_pool); si igual se llena no se pierde ningún frame*/
+static volatile uint32_t isr_pool_ovf = 0;
+static uint32_t isr_pool_ovf_seen = 0;
+
+static bool IRAM_ATTR adc_dma_on_pool_ovf(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data){
+    isr_pool_ovf++;
+    return false;
+}
+#else
+static bool IRAM_ATTR adc_dma_on_pool_ovf(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data){
+    isr_lost_frames++; // el ring del driver estaba lleno: el frame no se guardó
+    return false;
+}
+#endif
+
+#if ADC_REC_ENABLE
+/*grabación: sólo la escribe la tarea lectora; el resto de las tareas pide cambios por flags*/
+static uint8_t rec_buf[ADC_REC_BUF_BYTES];
+static uint32_t rec_bytes = 0;
+static uint32_t rec_frames = 0;
+static uint32_t rec_last_us = 0;
+static int64_t rec_t0_us = 0;
+static uint32_t rec_pos = 0;        // próximo registro a reproducir
+static uint32_t rec_loops = 0;
+static bool rec_realtime = true;
+static volatile adc_rec_state_t rec_state = ADC_REC_IDLE;
+static volatile bool rec_start_req = false;
+static volatile bool rec_replay_req = false;
+static volatile bool rec_stop_req = false;
+
+/* Atiende los pedidos de otras tareas antes de la próxima lectura */
+static void adc_rec_poll_requests(){
+    if(rec_stop_req){
+        rec_stop_req = false;
+        rec_replay_req = false;
+        rec_state = (rec_frames > 0) ? ADC_REC_DONE : ADC_REC_IDLE;
+    }
+    if(rec_start_req){
+        rec_start_req = false;
+        rec_bytes = 0;
+        rec_frames = 0;
+        rec_last_us = 0;
+        rec_t0_us = esp_timer_get_time();
+        rec_state = ADC_REC_RECORDING;
+    }
+    if(rec_replay_req){
+        rec_replay_req = false;
+        if(rec_state == ADC_REC_DONE || rec_state == ADC_REC_REPLAY){
+            rec_pos = 0;
+            rec_loops = 0;
+            rec_state = ADC_REC_REPLAY;
+        }
+    }
+}
+
+/* Agrega el frame leído a la grabación; al no haber lugar la da por terminada */
+static void adc_rec_append(const uint8_t *buf, uint32_t n){
+    if(rec_bytes + ADC_REC_HDR_BYTES + n > sizeof(rec_buf)){
+        rec_state = ADC_REC_DONE;
+        return;
+    }
+    uint32_t t_us = (uint32_t)(esp_timer_get_time() - rec_t0_us);
+    uint16_t len = (uint16_t)n;
+
+    memcpy(&rec_buf[rec_bytes], &t_us, sizeof(t_us)); // el ESP32 es little endian
+    memcpy(&rec_buf[rec_bytes + 4], &len, sizeof(len));
+    memcpy(&rec_buf[rec_bytes + ADC_REC_HDR_BYTES], buf, n);
+    rec_bytes += ADC_REC_HDR_BYTES + n;
+    rec_frames++;
+    rec_last_us = t_us;
+}
+
+/* Copia el próximo frame grabado en buf, en bucle. Retorna los bytes copiados */
+static uint32_t adc_rec_next(uint8_t *buf, size_t len){
+    if(rec_pos >= rec_bytes){
+        rec_pos = 0;
+        rec_loops++;
+    }
+    uint16_t n;
+    memcpy(&n, &rec_buf[rec_pos + 4], sizeof(n));
+    uint32_t copy = (n < len) ? n : (uint32_t)len;
+    memcpy(buf, &rec_buf[rec_pos + ADC_REC_HDR_BYTES], copy);
+    rec_pos += ADC_REC_HDR_BYTES + n;
+    return copy;
+}
+#endif
+
+/* Crea y configura el driver continuo con los tamaños de cfg. Si falla un paso no queda handle abierto */
+static esp_err_t adc_dma_open(const adc_dma_cfg_t *cfg){
 
     esp_err_t ret;
 
     /*creo el handler*/
     adc_continuous_handle_cfg_t handle_cfg = { 
-        .max_store_buf_size = 1024, //ring buffer de hasta 1024 bytes
-        .conv_frame_size = FRAME_BYTES, //leo esta cantidad de bytes
+        .max_store_buf_size = cfg->ring_bytes, //ring buffer del driver
+        .conv_frame_size = cfg->frame_bytes, //leo esta cantidad de bytes
+#if ADC_DMA_EVENT_ENABLE
+        .flags.flush_pool = 1, //nadie lee el ring: el driver lo vacía al llenarse en lugar de avisar on_pool_ovf en cada frame
+#endif
     };
     ret = adc_continuous_new_handle(&handle_cfg, &s_adc_handle);
-    ESP_ERROR_CHECK(ret);
+    if(ret != ESP_OK){
+        s_adc_handle = NULL;
+        return ret;
+    }
     /* Si no llamo a adc_continuous_read con suficiente frecuencia, el buffer circular puede sobreescribirse
     y se pierden datos. Flujo temporal deja de ser continuo. 
     Si pasa podemos bajar la SAMPLE_FREQ, aumentar el storage del buffer, aumentar la prioridad de la task de adquisición
     */
 
-    /*creo el patrón de conversión*/
-    adc_digi_pattern_config_t pattern[2] = {0};
+    /*creo el patrón de conversión: slots 0 y 1 son tensión y corriente, luego los auxiliares*/
+    adc_digi_pattern_config_t pattern[ADC_PATTERN_LEN] = {0};
 
-    /*canal voltaje*/
-    pattern[0].atten = ADC_ATTEN_CFG;
-    pattern[0].bit_width = ADC_BITWIDTH;
-    pattern[0].channel = ADC_CH_V;
-    pattern[0].unit = ADC_UNIT;
-
-    /*canal corriente*/
-    pattern[1].atten = ADC_ATTEN_CFG;
-    pattern[1].bit_width = ADC_BITWIDTH;
-    pattern[1].channel = ADC_CH_I;
-    pattern[1].unit = ADC_UNIT;
+    for(uint8_t k = 0; k < ADC_PATTERN_LEN; k++){
+        pattern[k].atten = ADC_ATTEN_CFG;
+        pattern[k].bit_width = ADC_BITWIDTH;
+        pattern[k].channel = adc_pattern_ch[k];
+        pattern[k].unit = ADC_UNIT;
+    }
 
     adc_continuous_config_t dig_cfg = {
-        .sample_freq_hz = SAMPLE_FREQ_HZ,
+        .sample_freq_hz = ADC_RAW_FREQ_HZ * ADC_PATTERN_LEN / 2, //misma tasa por canal que el patrón V-I
         .conv_mode = ADC_CONV_SINGLE_UNIT_1,
         .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
-        .pattern_num = 2,
+        .pattern_num = ADC_PATTERN_LEN,
         .adc_pattern = pattern,
     };
 
     ret = adc_continuous_config(s_adc_handle, &dig_cfg);
-    ESP_ERROR_CHECK(ret);
+
+    adc_continuous_evt_cbs_t cbs = {
+#if ADC_DMA_EVENT_ENABLE
+        .on_conv_done = adc_dma_on_conv_done,
+#endif
+        .on_pool_ovf = adc_dma_on_pool_ovf,
+    };
+    if(ret == ESP_OK) ret = adc_continuous_register_event_callbacks(s_adc_handle, &cbs, NULL);
+
+    if(ret != ESP_OK){
+        adc_continuous_deinit(s_adc_handle);
+        s_adc_handle = NULL;
+        return ret;
+    }
+
+    dma_stats.ring_bytes = cfg->ring_bytes;
+    dma_stats.frame_bytes = cfg->frame_bytes;
+    return ESP_OK;
+}
+
+/* Abre el driver con cfg y, si la conversión estaba iniciada, la arranca */
+static esp_err_t adc_dma_reopen(const adc_dma_cfg_t *cfg){
+    esp_err_t ret = adc_dma_open(cfg);
+    if(ret == ESP_OK && dma_started){
+        ret = adc_continuous_start(s_adc_handle);
+        if(ret != ESP_OK){
+            adc_continuous_deinit(s_adc_handle);
+            s_adc_handle = NULL;
+        }
+    }
+    dma_running = (ret == ESP_OK) && dma_started;
+    return ret;
+}
+
+/* Detiene y libera el handle. Si no se puede liberar lo deja convirtiendo como estaba */
+static esp_err_t adc_dma_close(){
+    esp_err_t ret = ESP_OK;
+    if(dma_running){
+        ret = adc_continuous_stop(s_adc_handle);
+        if(ret != ESP_OK) return ret;
+        dma_running = false;
+    }
+    ret = adc_continuous_deinit(s_adc_handle);
+    if(ret != ESP_OK){
+        if(dma_started && adc_continuous_start(s_adc_handle) == ESP_OK) dma_running = true;
+        return ret;
+    }
+    s_adc_handle = NULL;
+    return ESP_OK;
+}
+
+void app_adc_dma_init(){
+    ESP_ERROR_CHECK(adc_dma_open(&dma_cfg));
 }
 
 void app_adc_dma_start_conv(){
     esp_err_t ret;
+#if ADC_DMA_EVENT_ENABLE
+    evt_task = xTaskGetCurrentTaskHandle();     // consumidor registrado antes del primer frame
+#endif
     ret = adc_continuous_start(s_adc_handle);
     ESP_ERROR_CHECK(ret);
+    dma_started = true;
+    dma_running = true;
+}
+
+/* Registra un fallo de la reinicialización */
+static void adc_dma_reinit_failed(const char *step, esp_err_t err){
+    dma_stats.reinit_errors++;
+    dma_stats.last_err = err;
+    ESP_LOGE("ADC", "Reconfiguración del DMA: falló %s (%s)", step, esp_err_to_name(err));
+}
+
+/* Atiende los pedidos de otras tareas; la reinicialización se hace acá para no competir con la lectura */
+static void adc_dma_poll_requests(){
+    if(dma_reset_req){
+        dma_reset_req = false;
+        memset(&dma_stats, 0, sizeof(dma_stats));
+        dma_stats.ring_bytes = dma_down ? 0 : dma_cfg.ring_bytes;
+        dma_stats.frame_bytes = dma_down ? 0 : dma_cfg.frame_bytes;
+#if !ADC_DMA_EVENT_ENABLE
+        dma_ovf_count = 0;
+#endif
+    }
+    if(dma_down){
+        // reintenta abrir con la última configuración que funcionó
+        esp_err_t err = adc_dma_reopen(&dma_cfg);
+        if(err != ESP_OK){
+            dma_stats.last_err = err;
+            vTaskDelay(pdMS_TO_TICKS(ADC_DMA_REOPEN_RETRY_MS)); // sin driver no hay qué esperar: no acaparar la CPU
+            return;
+        }
+        dma_down = false;
+        dma_last_read_us = 0;
+        ESP_LOGW("ADC", "DMA reabierto: ring %lu B, frame %lu B", (unsigned long)dma_cfg.ring_bytes, (unsigned long)dma_cfg.frame_bytes);
+    }
+    if(dma_reinit_req){
+        dma_reinit_req = false;
+        adc_dma_cfg_t next = dma_cfg;
+        next.ring_bytes = dma_cfg_req.ring_bytes;
+        next.frame_bytes = dma_cfg_req.frame_bytes;
+
+        esp_err_t err = adc_dma_close();
+        if(err != ESP_OK){
+            // el handle anterior sigue abierto: se conserva la configuración vigente
+            adc_dma_reinit_failed("la liberación del driver", err);
+            return;
+        }
+#if ADC_DMA_EVENT_ENABLE
+        // con el driver detenido la ISR no escribe: las referencias pendientes apuntan a buffers liberados
+        evt_tail = evt_head;
+#endif
+        dma_last_read_us = 0; // el intervalo de la reinicialización no cuenta como demora
+
+        err = adc_dma_reopen(&next);
+        if(err == ESP_OK){
+            dma_cfg = next;
+            dma_stats.reinits++;
+            ESP_LOGI("ADC", "DMA reconfigurado: ring %lu B, frame %lu B", (unsigned long)dma_cfg.ring_bytes, (unsigned long)dma_cfg.frame_bytes);
+            return;
+        }
+        adc_dma_reinit_failed("la apertura con la configuración nueva", err);
+
+        err = adc_dma_reopen(&dma_cfg);
+        if(err != ESP_OK){
+            adc_dma_reinit_failed("la reapertura con la configuración anterior", err);
+            dma_stats.ring_bytes = 0;
+            dma_stats.frame_bytes = 0;
+            dma_down = true;
+            return;
+        }
+        ESP_LOGW("ADC", "DMA de vuelta en ring %lu B, frame %lu B", (unsigned long)dma_cfg.ring_bytes, (unsigned long)dma_cfg.frame_bytes);
+    }
+}
+
+#if !ADC_DMA_EVENT_ENABLE
+/* Con auto_grow, duplica el ring si los desbordes se repiten dentro de la ventana (sólo el ring del driver se desborda en modo bloqueante) */
+static void adc_dma_autogrow(int64_t now_us){
+    if(now_us - dma_ovf_window_us > (int64_t)ADC_DMA_AUTOGROW_WINDOW_MS * 1000){
+        dma_ovf_window_us = now_us;
+        dma_ovf_count = 0;
+    }
+    if(++dma_ovf_count < ADC_DMA_AUTOGROW_OVF) return;
+    dma_ovf_count = 0;
+
+    if(dma_cfg.auto_grow && dma_cfg.ring_bytes < ADC_DMA_RING_MAX_BYTES && !dma_reinit_req){
+        uint32_t ring = dma_cfg.ring_bytes * 2;
+        if(ring > ADC_DMA_RING_MAX_BYTES) ring = ADC_DMA_RING_MAX_BYTES;
+        dma_cfg_req = dma_cfg;
+        dma_cfg_req.ring_bytes = ring;
+        dma_reinit_req = true;
+        dma_stats.grows++;
+        ESP_LOGW("ADC", "Desbordes repetidos: ring %lu -> %lu B", (unsigned long)dma_cfg.ring_bytes, (unsigned long)ring);
+    }
+}
+#endif
+
+/* Suma a la telemetría los frames que la ISR informó perdidos y el tiempo desde la lectura anterior */
+static void adc_dma_account(int64_t now_us){
+    uint32_t lost = isr_lost_frames;
+    uint32_t delta = lost - isr_lost_seen;
+    isr_lost_seen = lost;
+    if(delta > 0){
+        dma_stats.overflows += delta;
+        dma_stats.bytes_lost += delta * dma_cfg.frame_bytes;
+#if !ADC_DMA_EVENT_ENABLE
+        adc_dma_autogrow(now_us);
+#endif
+    }
+#if ADC_DMA_EVENT_ENABLE
+    uint32_t pool_ovf = isr_pool_ovf;
+    dma_stats.pool_ovf += pool_ovf - isr_pool_ovf_seen;
+    isr_pool_ovf_seen = pool_ovf;
+#endif
+
+    dma_stats.frames++;
+    if(dma_last_read_us != 0){
+        uint32_t gap = (uint32_t)(now_us - dma_last_read_us);
+        dma_stats.gap_last_us = gap;
+        if(gap > dma_stats.gap_max_us) dma_stats.gap_max_us = gap;
+    }
+    dma_last_read_us = now_us;
+}
+
+#if ADC_DMA_EVENT_ENABLE
+/* Espera el próximo frame completo y lo entrega en el lugar, dentro del buffer DMA del driver */
+static esp_err_t adc_dma_wait_frame(const uint8_t **frame, uint32_t *out_bytes, TickType_t tout){
+    adc_dma_poll_requests();
+    if(dma_down) return ESP_ERR_INVALID_STATE;
+    if(evt_task == NULL) evt_task = xTaskGetCurrentTaskHandle();
+
+    while(evt_tail == evt_head){
+        if(ulTaskNotifyTake(pdTRUE, tout) == 0) return ESP_ERR_TIMEOUT;
+    }
+
+    const adc_dma_evt_ref_t *ref = &evt_queue[evt_tail % ADC_DMA_EVT_QUEUE];
+    *frame = ref->buf;
+    *out_bytes = ref->len;
+    evt_cur_seq = ref->seq;
+    evt_tail++;
+
+    adc_dma_account(esp_timer_get_time());
+    return ESP_OK;
+}
+
+/* true si el driver todavía no volvió a escribir el buffer DMA del frame entregado */
+static bool adc_dma_frame_intact(){
+    return (evt_seq - evt_cur_seq) < (ADC_DMA_DRIVER_BUFS - 1);
+}
+#else
+/* Lectura bloqueante del driver con telemetría */
+static esp_err_t adc_dma_read_driver(uint8_t *buf, size_t len, uint32_t *out_bytes, TickType_t tout){
+    adc_dma_poll_requests();
+    if(dma_down) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t ret = adc_continuous_read(s_adc_handle, buf, len, out_bytes, tout);
+    if(ret == ESP_OK){
+        adc_dma_account(esp_timer_get_time());
+    } else if(ret == ESP_ERR_INVALID_STATE){
+        dma_last_read_us = 0;
+    }
+    return ret;
+}
+#endif
+
+esp_err_t app_adc_dma_get_frame(const uint8_t **frame, uint32_t *out_bytes, TickType_t tout){
+#if ADC_REC_ENABLE
+    adc_rec_poll_requests();
+
+    if(rec_state == ADC_REC_REPLAY){
+        if(!rec_realtime){
+            vTaskDelay(1); // máxima velocidad sin dejar sin CPU a las tareas de menor prioridad
+            dma_last_read_us = 0; // el ADC no se lee: al volver no se mide el intervalo
+        } else {
+            // se sigue leyendo el ADC para mantener el ritmo real (y que no desborde al volver)
+#if ADC_DMA_EVENT_ENABLE
+            const uint8_t *live;
+            esp_err_t ret = adc_dma_wait_frame(&live, out_bytes, tout);
+#else
+            esp_err_t ret = adc_dma_read_driver((uint8_t*)dma_frame, sizeof(dma_frame), out_bytes, tout);
+#endif
+            if(ret == ESP_ERR_TIMEOUT) return ret;
+        }
+        // los registros grabados no están alineados a 4 bytes: se copian al buffer propio
+        *out_bytes = adc_rec_next((uint8_t*)dma_frame, sizeof(dma_frame));
+        *frame = (const uint8_t*)dma_frame;
+        frame_from_dma = false;
+        return ESP_OK;
+    }
+#endif
+
+#if ADC_DMA_EVENT_ENABLE
+    esp_err_t ret = adc_dma_wait_frame(frame, out_bytes, tout);
+    frame_from_dma = (ret == ESP_OK);
+#else
+    esp_err_t ret = adc_dma_read_driver((uint8_t*)dma_frame, sizeof(dma_frame), out_bytes, tout);
+    *frame = (const uint8_t*)dma_frame;
+#endif
+
+#if ADC_REC_ENABLE
+    if(ret == ESP_OK && rec_state == ADC_REC_RECORDING){
+        adc_rec_append(*frame, *out_bytes);
+    }
+#endif
+    return ret;
+}
+
+bool app_adc_dma_release_frame(){
+#if ADC_DMA_EVENT_ENABLE
+    if(!frame_from_dma) return true;
+    frame_from_dma = false;
+    if(adc_dma_frame_intact()) return true;
+
+    // el DMA alcanzó al frame mientras se procesaba: parte de sus muestras son de un frame posterior
+    dma_stats.overflows++;
+    dma_stats.bytes_lost += dma_cfg.frame_bytes;
+    return false;
+#else
+    return true;
+#endif
 }
 
 esp_err_t app_adc_dma_read(uint8_t *buf, size_t len, uint32_t *out_bytes, TickType_t tout){
-    return adc_continuous_read(s_adc_handle, buf, len, out_bytes, tout);
+    const uint8_t *frame;
+    esp_err_t ret = app_adc_dma_get_frame(&frame, out_bytes, tout);
+    if(ret == ESP_OK){
+        if(*out_bytes > len) *out_bytes = len;
+        memcpy(buf, frame, *out_bytes);
+        app_adc_dma_release_frame();
+    }
+    return ret;
+}
+
+bool app_adc_dma_set_config(const adc_dma_cfg_t *cfg){
+    if(cfg->frame_bytes < ADC_DMA_FRAME_MIN_BYTES || cfg->frame_bytes > FRAME_BYTES) return false;
+    if(cfg->ring_bytes < cfg->frame_bytes || cfg->ring_bytes > ADC_DMA_RING_MAX_BYTES) return false;
+    if((cfg->frame_bytes % ADC_DMA_ALIGN_BYTES) != 0 || (cfg->ring_bytes % ADC_DMA_ALIGN_BYTES) != 0) return false;
+
+    dma_cfg.auto_grow = cfg->auto_grow;
+    if(cfg->ring_bytes != dma_cfg.ring_bytes || cfg->frame_bytes != dma_cfg.frame_bytes){
+        dma_cfg_req = *cfg;
+        dma_reinit_req = true;
+    }
+    return true;
+}
+
+void app_adc_dma_get_config(adc_dma_cfg_t *out){
+    *out = dma_reinit_req ? dma_cfg_req : dma_cfg;
+    out->auto_grow = dma_cfg.auto_grow;
+}
+
+void app_adc_dma_get_stats(adc_dma_stats_t *out){
+    *out = dma_stats;
+}
+
+void app_adc_dma_reset_stats(){
+    dma_reset_req = true;
+}
+
+bool app_adc_rec_start(){
+#if ADC_REC_ENABLE
+    rec_start_req = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool app_adc_rec_replay(bool realtime){
+#if ADC_REC_ENABLE
+    adc_rec_state_t st = rec_state;
+    if(st != ADC_REC_DONE && st != ADC_REC_REPLAY) return false;
+    rec_realtime = realtime;
+    rec_replay_req = true;
+    return true;
+#else
+    (void)realtime;
+    return false;
+#endif
+}
+
+void app_adc_rec_stop(){
+#if ADC_REC_ENABLE
+    rec_stop_req = true;
+#endif
+}
+
+void app_adc_rec_get_info(adc_rec_info_t *out){
+    memset(out, 0, sizeof(*out));
+#if ADC_REC_ENABLE
+    out->state = rec_state;
+    out->realtime = rec_realtime;
+    out->bytes = rec_bytes;
+    out->frames = rec_frames;
+    out->duration_us = rec_last_us;
+    out->loops = rec_loops;
+#endif
+}
+
+size_t app_adc_rec_read(uint32_t offset, uint8_t *dst, size_t len){
+#if ADC_REC_ENABLE
+    // la grabación no cambia en DONE ni en REPLAY
+    adc_rec_state_t st = rec_state;
+    if(st != ADC_REC_DONE && st != ADC_REC_REPLAY) return 0;
+    if(offset >= rec_bytes) return 0;
+    if(len > rec_bytes - offset) len = rec_bytes - offset;
+    memcpy(dst, &rec_buf[offset], len);
+    return len;
+#else
+    (void)offset; (void)dst; (void)len;
+    return 0;
+#endif
 }
 
 esp_err_t app_adc_get_voltage(int raw, int *mv){
@@ -66,5 +581,27 @@ bool app_adc_init_calibration(){
         .atten = ADC_ATTEN_CFG,
         .bitwidth = ADC_BITWIDTH,
     };
-    return (ESP_OK == adc_cali_create_scheme_line_fitting(&cali_config, &adc1_cali_handle));
+    adc_lut_calibrated = (ESP_OK == adc_cali_create_scheme_line_fitting(&cali_config, &adc1_cali_handle));
+
+    for(int raw = 0; raw <= ADC_MAX_COUNT; raw++){
+        int mv;
+        if(!adc_lut_calibrated || adc_cali_raw_to_voltage(adc1_cali_handle, raw, &mv) != ESP_OK){
+            /*conversión lineal nominal si no hay calibración*/
+            mv = (raw * ADC_FALLBACK_FULL_SCALE_MV) / ADC_MAX_COUNT;
+        }
+        adc_cal_lut[raw] = (int16_t)mv;
+    }
+    return adc_lut_calibrated;
+}
+
+const int16_t *app_adc_get_cal_lut(){
+    return adc_cal_lut;
+}
+
+bool app_adc_is_calibrated(){
+    return adc_lut_calibrated;
+}
+
+const uint8_t *app_adc_get_pattern(){
+    return adc_pattern_ch;
 }
\ No newline at end of file
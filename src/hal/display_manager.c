@@ -310,12 +310,17 @@ void task_display(void *pvParameters)
     oled_draw_text_line(2, "   Inicializando...");
     vTaskDelay(pdMS_TO_TICKS(1000)); //todo: reemplazar esto por una confirmación real de que está listo para mostrar datos
 
+    state_sub_t sub = state_subscribe(STATE_EV_MEASURE | STATE_EV_OUTPUTS | STATE_EV_FAILS);
+
     while (1) {
+        uint32_t ev = state_wait(sub, STATE_WAIT_MAX_MS);
         state_get(&st);
 
         char line[SSD1306_MAX_TXT_LINES][22] = {0};
         
-        if(state_change_detector_update(&change_detector, &st, &update_thresholds)){
+        // salidas y fallas se muestran al instante; las mediciones, con los umbrales
+        bool urgent = (ev & (STATE_EV_OUTPUTS | STATE_EV_FAILS)) != 0;
+        if(urgent || state_change_detector_update(&change_detector, &st, &update_thresholds)){
 
             snprintf(line[0], sizeof(line[0]), "V :%d V", (int16_t)st.measure.Vrms);
             snprintf(line[1], sizeof(line[1]), "I :%.2f A", st.measure.Irms);
@@ -341,6 +346,5 @@ void task_display(void *pvParameters)
                 
             state_change_detector_mark_sent(&change_detector, &st);
         }
-        vTaskDelay(pdMS_TO_TICKS(TASK_PERIOD_DISPLAY_MS));
     }
 }
@@ -5,6 +5,7 @@
 #include "hal/adc_dma.h"
 #include "app/measure.h"
 #include "app/acquisition.h"
+#include "app/calibration.h"
 #include "app/control.h"
 #include "config/system_config.h"
 #include "comms/uart_protocol.h"
@@ -12,17 +13,49 @@
 #include "comms/iot_mqtt.h"
 #include "comms/wifi_conn.h"
 #include "hal/gpio_loads.h"
+#include "core/persist.h"
+#include "core/energy_log.h"
+#include "app/history.h"
+
+/**
+ * Tabla de ubicación de tareas: función, nombre, stack, prioridad y núcleo
+ * (ver task_cores en system_config.h)
+ */
+typedef struct {
+    TaskFunction_t fn;
+    const char *name;
+    uint32_t stack;
+    UBaseType_t priority;
+    BaseType_t core;
+} task_cfg_t;
+
+static const task_cfg_t task_table[] = {
+    {task_adc_acquisition, "adc_acq",        TASK_STACK_ADC_ACQ,   TASK_PRIORITY_ADC_ACQ,   TASK_CORE_ADC_ACQ},
+    {task_measure_compute, "meas_compute",   TASK_STACK_MEASURE,   TASK_PRIORITY_MEASURE,   TASK_CORE_MEASURE},
+    {task_control,         "control_cargas", TASK_STACK_CONTROL,   TASK_PRIORITY_CONTROL,   TASK_CORE_CONTROL},
+    {task_uart_rx,         "uart_rx",        TASK_STACK_COMM_UART, TASK_PRIORITY_COMM_UART, TASK_CORE_COMM_UART},
+    {task_uart_handler,    "uart_handler",   TASK_STACK_COMM_UART, TASK_PRIORITY_COMM_UART, TASK_CORE_COMM_UART},
+    {task_uart_tx,         "uart_tx",        TASK_STACK_COMM_UART, TASK_PRIORITY_COMM_UART, TASK_CORE_COMM_UART},
+    {task_display,         "task_display",   TASK_STACK_DISPLAY,   TASK_PRIORITY_DISPLAY,   TASK_CORE_DISPLAY},
+    {task_iot_tx,          "task_iot_tx",    TASK_STACK_COMM_IOT,  TASK_PRIORITY_COMM_IOT,  TASK_CORE_COMM_IOT},
+    {task_iot_rx,          "task_iot_rx",    TASK_STACK_COMM_IOT,  TASK_PRIORITY_COMM_IOT,  TASK_CORE_COMM_IOT},
+    {task_persist,         "persist",        TASK_STACK_PERSIST,   TASK_PRIORITY_PERSIST,   TASK_CORE_PERSIST},
+};
 
 static void main_init(){
 
     nvs_config_init();
+    energy_log_init();
+    history_init();
+    persist_init();
 
     state_init();
+    calibration_init();
     ESP_ERROR_CHECK(gpio_loads_init());
     control_init();
 
-    if(app_adc_init_calibration()){
-        ESP_LOGW("ADC", "Calibración no disponible");
+    if(!app_adc_init_calibration()){
+        ESP_LOGW("ADC", "Calibración no disponible, usando conversión nominal");
     }
     app_adc_dma_init();
 
@@ -36,8 +69,6 @@ static void main_init(){
     if (display_init() != ESP_OK) {
         ESP_LOGE("MAIN", "Error inicializando display");
     }
-
-    app_adc_dma_start_conv();
 }
 
 void app_main(){
@@ -53,76 +84,12 @@ void app_main(){
 
     main_init();
 
-    xTaskCreate(
-        task_adc_acquisition,
-        "adc_acq",
-        TASK_STACK_ADC_ACQ,
-        NULL,
-        TASK_PRIORITY_ADC_ACQ,
-        NULL
-    );
-
-    xTaskCreate(
-        task_control,
-        "control_cargas",
-        TASK_STACK_CONTROL,
-        NULL,
-        TASK_PRIORITY_CONTROL,
-        NULL
-    );
-
-    xTaskCreate(
-        task_uart_rx,
-        "uart_rx",
-        TASK_STACK_COMM_UART,
-        NULL,
-        TASK_PRIORITY_COMM_UART,
-        NULL
-    );
-
-    xTaskCreate(
-        task_uart_handler,
-        "uart_handler",
-        TASK_STACK_COMM_UART,
-        NULL,
-        TASK_PRIORITY_COMM_UART,
-        NULL
-    );
-
-    xTaskCreate(
-        task_uart_tx,
-        "uart_tx",
-        TASK_STACK_COMM_UART,
-        NULL,
-        TASK_PRIORITY_COMM_UART,
-        NULL
-    );
-
-     xTaskCreate(
-        task_display,
-        "task_display",
-        TASK_STACK_DISPLAY,
-        NULL,
-        TASK_PRIORITY_DISPLAY,
-        NULL
-    );
-
-    xTaskCreate(
-        task_iot_tx,
-        "task_iot_tx",
-        TASK_STACK_COMM_IOT,
-        NULL,
-        TASK_PRIORITY_COMM_IOT,
-        NULL
-    );
-
-    xTaskCreate(
-        task_iot_rx,
-        "task_iot_rx",
-        TASK_STACK_COMM_IOT,
-        NULL,
-        TASK_PRIORITY_COMM_IOT,
-        NULL
-    );
+    for(size_t i = 0; i < sizeof(task_table)/sizeof(task_table[0]); i++){
+        const task_cfg_t *t = &task_table[i];
+        BaseType_t ret = xTaskCreatePinnedToCore(t->fn, t->name, t->stack, NULL, t->priority, NULL, t->core);
+        if(ret != pdPASS){
+            ESP_LOGE("MAIN", "No se pudo crear la tarea %s", t->name);
+        }
+    }
 
 }
\ No newline at end of file
@@ -0,0 +1,231 @@
+/**
+ * @file adc_dma_host.c
+ * @brief adc_dma.h para el build nativo: frames leídos de una grabación
+ */
+
+#include "adc_dma_host.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t *rec = NULL;
+static uint32_t rec_bytes = 0;
+static uint32_t rec_frames = 0;
+static uint32_t rec_pos = 0;
+static uint32_t rec_loops = 0;
+static bool rec_loop = false;
+static uint32_t last_t_us = 0;
+static bool have_last = false;
+
+static uint32_t frame[FRAME_BYTES / sizeof(uint32_t)];
+static adc_dma_stats_t stats;
+static adc_dma_cfg_t cfg = {
+    .ring_bytes = ADC_DMA_RING_DEFAULT_BYTES,
+    .frame_bytes = FRAME_BYTES,
+    .auto_grow = true,
+};
+
+static adc_cali_handle_t cali = NULL;
+static int16_t cal_lut[ADC_MAX_COUNT + 1];
+static bool calibrated = false;
+static const uint8_t pattern_ch[ADC_PATTERN_LEN] = ADC_PATTERN_CHANNELS;
+
+/* Lee el campo little endian de n bytes en p */
+static uint32_t read_le(const uint8_t *p, int n){
+    uint32_t x = 0;
+    for(int k = n - 1; k >= 0; k--) x = (x << 8) | p[k];
+    return x;
+}
+
+bool adc_dma_host_open(const char *path, bool loop){
+    adc_dma_host_close();
+
+    FILE *f = fopen(path, "rb");
+    if(f == NULL) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if(size <= 0){
+        fclose(f);
+        return false;
+    }
+    rec = malloc((size_t)size);
+    bool ok = (rec != NULL) && fread(rec, 1, (size_t)size, f) == (size_t)size;
+    fclose(f);
+    rec_bytes = (uint32_t)size;
+
+    /*valida la cadena de registros antes de entregar ninguno*/
+    uint32_t pos = 0;
+    rec_frames = 0;
+    while(ok && pos < rec_bytes){
+        if(rec_bytes - pos < ADC_REC_HDR_BYTES){
+            ok = false;
+            break;
+        }
+        uint32_t len = read_le(&rec[pos + 4], 2);
+        if(len > FRAME_BYTES || rec_bytes - pos - ADC_REC_HDR_BYTES < len){
+            ok = false;
+            break;
+        }
+        pos += ADC_REC_HDR_BYTES + len;
+        rec_frames++;
+    }
+    if(!ok || rec_frames == 0){
+        adc_dma_host_close();
+        return false;
+    }
+
+    rec_pos = 0;
+    rec_loops = 0;
+    rec_loop = loop;
+    have_last = false;
+    memset(&stats, 0, sizeof(stats));
+    stats.ring_bytes = cfg.ring_bytes;
+    stats.frame_bytes = cfg.frame_bytes;
+    return true;
+}
+
+void adc_dma_host_close(void){
+    free(rec);
+    rec = NULL;
+    rec_bytes = 0;
+    rec_frames = 0;
+}
+
+uint32_t adc_dma_host_frames(void){
+    return rec_frames;
+}
+
+void app_adc_dma_init(){
+}
+
+void app_adc_dma_start_conv(){
+}
+
+bool app_adc_dma_set_config(const adc_dma_cfg_t *c){
+    if(c->frame_bytes < ADC_DMA_FRAME_MIN_BYTES || c->frame_bytes > FRAME_BYTES) return false;
+    if(c->ring_bytes < c->frame_bytes || c->ring_bytes > ADC_DMA_RING_MAX_BYTES) return false;
+    if((c->frame_bytes % ADC_DMA_ALIGN_BYTES) != 0 || (c->ring_bytes % ADC_DMA_ALIGN_BYTES) != 0) return false;
+    cfg = *c; // el tamaño de frame lo fija la grabación
+    return true;
+}
+
+void app_adc_dma_get_config(adc_dma_cfg_t *out){
+    *out = cfg;
+}
+
+void app_adc_dma_get_stats(adc_dma_stats_t *out){
+    *out = stats;
+}
+
+void app_adc_dma_reset_stats(){
+    memset(&stats, 0, sizeof(stats));
+    stats.ring_bytes = cfg.ring_bytes;
+    stats.frame_bytes = cfg.frame_bytes;
+}
+
+esp_err_t app_adc_dma_get_frame(const uint8_t **out, uint32_t *out_bytes, TickType_t tout){
+    (void)tout;
+    if(rec == NULL) return ESP_ERR_INVALID_STATE;
+    if(rec_pos >= rec_bytes){
+        if(!rec_loop) return ESP_ERR_TIMEOUT; // fin de la grabación: como un ADC que dejó de entregar
+        rec_pos = 0;
+        rec_loops++;
+        have_last = false; // el salto al principio no es un intervalo real
+    }
+
+    uint32_t t_us = read_le(&rec[rec_pos], 4);
+    uint32_t len = read_le(&rec[rec_pos + 4], 2);
+    memcpy(frame, &rec[rec_pos + ADC_REC_HDR_BYTES], len);
+    rec_pos += ADC_REC_HDR_BYTES + len;
+
+    stats.frames++;
+    if(have_last){
+        stats.gap_last_us = t_us - last_t_us;
+        if(stats.gap_last_us > stats.gap_max_us) stats.gap_max_us = stats.gap_last_us;
+    }
+    last_t_us = t_us;
+    have_last = true;
+
+    *out = (const uint8_t*)frame;
+    *out_bytes = len;
+    return ESP_OK;
+}
+
+bool app_adc_dma_release_frame(){
+    return true;
+}
+
+esp_err_t app_adc_dma_read(uint8_t *buf, size_t len, uint32_t *out_bytes, TickType_t tout){
+    const uint8_t *f;
+    esp_err_t ret = app_adc_dma_get_frame(&f, out_bytes, tout);
+    if(ret == ESP_OK){
+        if(*out_bytes > len) *out_bytes = len;
+        memcpy(buf, f, *out_bytes);
+    }
+    return ret;
+}
+
+/* La grabación ya es la fuente: no se graba sobre ella */
+bool app_adc_rec_start(){
+    return false;
+}
+
+bool app_adc_rec_replay(bool realtime){
+    (void)realtime;
+    return rec != NULL;
+}
+
+void app_adc_rec_stop(){
+}
+
+void app_adc_rec_get_info(adc_rec_info_t *out){
+    memset(out, 0, sizeof(*out));
+    if(rec == NULL) return;
+    out->state = ADC_REC_REPLAY;
+    out->realtime = false;
+    out->bytes = rec_bytes;
+    out->frames = rec_frames;
+    out->loops = rec_loops;
+}
+
+size_t app_adc_rec_read(uint32_t offset, uint8_t *dst, size_t len){
+    if(rec == NULL || offset >= rec_bytes) return 0;
+    if(len > rec_bytes - offset) len = rec_bytes - offset;
+    memcpy(dst, &rec[offset], len);
+    return len;
+}
+
+esp_err_t app_adc_get_voltage(int raw, int *mv){
+    return adc_cali_raw_to_voltage(cali, raw, mv);
+}
+
+bool app_adc_init_calibration(){
+    adc_cali_line_fitting_config_t cali_config = {
+        .unit_id = ADC_UNIT,
+        .atten = ADC_ATTEN_CFG,
+        .bitwidth = ADC_BITWIDTH,
+    };
+    if(cali == NULL) calibrated = (ESP_OK == adc_cali_create_scheme_line_fitting(&cali_config, &cali));
+
+    for(int raw = 0; raw <= ADC_MAX_COUNT; raw++){
+        int mv;
+        if(!calibrated || adc_cali_raw_to_voltage(cali, raw, &mv) != ESP_OK){
+            mv = (raw * ADC_FALLBACK_FULL_SCALE_MV) / ADC_MAX_COUNT;
+        }
+        cal_lut[raw] = (int16_t)mv;
+    }
+    return calibrated;
+}
+
+const int16_t *app_adc_get_cal_lut(){
+    return cal_lut;
+}
+
+bool app_adc_is_calibrated(){
+    return calibrated;
+}
+
+const uint8_t *app_adc_get_pattern(){
+    return pattern_ch;
+}
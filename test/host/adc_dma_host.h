@@ -0,0 +1,43 @@
+/**
+ * @file adc_dma_host.h
+ * @brief adc_dma.h para el build nativo: frames leídos de una grabación
+ *
+ * Reemplaza a src/hal/adc_dma.c en los tests de reproducción. La fuente es
+ * un archivo con el formato de la grabación del equipo ("ADCREC DUMP"
+ * decodificado de base64):
+ *
+ * ```
+ * uint32_t t_us   (little endian)
+ * uint16_t len    (little endian)
+ * uint8_t  data[len]
+ * ```
+ *
+ * app_adc_dma_get_frame() entrega un registro por llamada en un buffer
+ * alineado a 4 bytes, como la reproducción del equipo, y la telemetría toma
+ * los intervalos de t_us. La tabla raw→mV es la del esquema simulado de
+ * shims/esp_adc (la del equipo depende del eFuse de cada placa).
+ */
+
+#ifndef ADC_DMA_HOST_H
+#define ADC_DMA_HOST_H
+
+#include <stdbool.h>
+#include "hal/adc_dma.h"
+
+/**
+ * @brief Abre la grabación
+ *
+ * @param path Archivo con registros {t_us, len, data}
+ * @param loop true: al terminar vuelve al principio (como ADCREC REPLAY)
+ *
+ * @return false si no se puede leer o algún registro está truncado o excede FRAME_BYTES
+ */
+bool adc_dma_host_open(const char *path, bool loop);
+
+/** @brief Cierra la grabación (app_adc_dma_get_frame() devuelve ESP_ERR_INVALID_STATE) */
+void adc_dma_host_close(void);
+
+/** @brief Registros de la grabación abierta */
+uint32_t adc_dma_host_frames(void);
+
+#endif // ADC_DMA_HOST_H
@@ -0,0 +1,92 @@
+/**
+ * @file bench_measure.c
+ * @brief Costo por par del camino de medición en el host
+ *
+ * Mide measure_add_sample(), la decodificación de frames y el análisis
+ * armónico sobre una señal de referencia. En el host los números sólo
+ * sirven para comparar variantes entre sí (el ESP32 no tiene FPU de doble
+ * precisión ni la misma caché); el costo en el equipo lo da TASKS.
+ *
+ *   bench_measure [--quick]
+ */
+
+#include "synth.h"
+#include "app/adc_frame.h"
+#include "hal/adc_dma.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Evita que el compilador descarte resultados */
+static volatile uint32_t sink;
+
+static double bench_measure_stream(uint32_t pairs){
+    measure_stream_t st;
+    synth_t s;
+    synth_cfg_t cfg;
+    static int16_t v[NUM_SAMPLES_ACCUM], i[NUM_SAMPLES_ACCUM];
+
+    synth_cfg_default(&cfg);
+    synth_init(&s, &cfg);
+    for(uint32_t k = 0; k < NUM_SAMPLES_ACCUM; k++) synth_next(&s, &v[k], &i[k]);
+
+    measure_stream_init(&st);
+    uint32_t evts = 0;
+    uint64_t t0 = synth_now_ns();
+    for(uint32_t k = 0; k < pairs; k++){
+        uint32_t j = k % NUM_SAMPLES_ACCUM;
+        evts += measure_add_sample(&st, v[j], i[j]);
+    }
+    uint64_t t1 = synth_now_ns();
+    sink = evts;
+    return (double)(t1 - t0) / pairs;
+}
+
+static double bench_decode(uint32_t frames){
+    static int16_t lut[ADC_MAX_COUNT + 1];
+    static uint32_t words[FRAME_BYTES / sizeof(uint32_t)];
+    static int16_t v[ADC_FRAME_MAX_PAIRS], i[ADC_FRAME_MAX_PAIRS];
+    adc_frame_decoder_t dec;
+
+    for(int k = 0; k <= ADC_MAX_COUNT; k++) lut[k] = (int16_t)(k * ADC_FALLBACK_FULL_SCALE_MV / ADC_MAX_COUNT);
+    for(uint32_t k = 0; k < FRAME_BYTES / sizeof(uint32_t); k++){
+        uint32_t raw = (k * 37u) & 0x0FFFu;
+        words[k] = (raw | ((uint32_t)ADC_CH_V << 12)) | ((raw ^ 0x555u) << 16) | ((uint32_t)ADC_CH_I << 28);
+    }
+    adc_frame_decoder_init(&dec, ADC_CH_V, ADC_CH_I, lut);
+
+    size_t pairs = 0;
+    uint64_t t0 = synth_now_ns();
+    for(uint32_t f = 0; f < frames; f++) pairs += adc_frame_decode(&dec, words, FRAME_BYTES, v, i);
+    uint64_t t1 = synth_now_ns();
+    sink = (uint32_t)pairs + (uint32_t)v[0];
+    return (double)(t1 - t0) / pairs;
+}
+
+static double bench_harmonics(uint32_t runs){
+    static harmonics_capture_t cap;
+    harmonics_t h;
+    synth_t s;
+    synth_cfg_t cfg;
+
+    synth_cfg_default(&cfg);
+    synth_init(&s, &cfg);
+    cap.n = PAIRS_PER_CYCLE;
+    for(uint16_t k = 0; k < cap.n; k++) synth_next(&s, &cap.v[k], &cap.i[k]);
+
+    uint64_t t0 = synth_now_ns();
+    for(uint32_t r = 0; r < runs; r++) harmonics_compute(&cap, &h);
+    uint64_t t1 = synth_now_ns();
+    sink = (uint32_t)h.thd_i;
+    return (double)(t1 - t0) / runs / 1000.0;
+}
+
+int main(int argc, char **argv){
+    bool quick = (argc > 1 && strcmp(argv[1], "--quick") == 0);
+    uint32_t scale = quick ? 1 : 50;
+
+    printf("kernel %s, skew %s\n", MEASURE_FIXED_POINT ? "punto fijo" : "double", MEASURE_SKEW_COMP ? "compensado" : "sin compensar");
+    printf("measure_add_sample  %8.2f ns/par\n", bench_measure_stream(200000 * scale));
+    printf("adc_frame_decode    %8.2f ns/par\n", bench_decode(2000 * scale));
+    printf("harmonics_compute   %8.2f us/ciclo\n", bench_harmonics(50 * scale));
+    return 0;
+}
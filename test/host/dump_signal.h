@@ -0,0 +1,30 @@
+/**
+ * @file dump_signal.h
+ * @brief Señal de data/adc_rec_48hz.bin (la genera make_adc_dump, la verifica test_replay)
+ */
+
+#ifndef DUMP_SIGNAL_H
+#define DUMP_SIGNAL_H
+
+#include "synth.h"
+#include "hal/adc_dma.h"
+
+/** @brief Ciclos de red en la grabación completa: la reproducción en bucle es continua */
+#define DUMP_CYCLES 10
+
+/** @brief Pares de la grabación completa */
+#define DUMP_PAIRS (ADC_REC_FRAMES * FRAME_BYTES / 4)
+
+/** @brief 48.83 Hz, fp 0.8 con 3ro y 5to en la corriente y algo de ruido */
+static inline void dump_signal_cfg(synth_cfg_t *cfg){
+    synth_cfg_default(cfg);
+    cfg->f_hz = (double)SAMPLE_FREQ_HZ * DUMP_CYCLES / DUMP_PAIRS;
+    cfg->phi_deg = 36.87;
+    cfg->v_h[2] = 0.03;
+    cfg->i_h[2] = 0.25;
+    cfg->i_h[4] = 0.10;
+    cfg->noise_mv = 2.0;
+    cfg->seed = 2025;
+}
+
+#endif // DUMP_SIGNAL_H
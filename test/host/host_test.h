@@ -0,0 +1,52 @@
+/**
+ * @file host_test.h
+ * @brief Aserciones mínimas de los tests nativos (test/host)
+ *
+ * Cada CHECK que falla imprime archivo, línea y valores y suma a
+ * host_test_failures; main() retorna HOST_TEST_RESULT() para ctest.
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <math.h>
+
+static int host_test_failures = 0;
+static int host_test_checks = 0;
+
+#define CHECK(cond) do{ \
+    host_test_checks++; \
+    if(!(cond)){ \
+        host_test_failures++; \
+        printf("FALLA %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+}while(0)
+
+/** @brief |a - b| <= tol */
+#define CHECK_NEAR(a, b, tol) do{ \
+    double a_ = (double)(a), b_ = (double)(b), t_ = (double)(tol); \
+    host_test_checks++; \
+    if(!(fabs(a_ - b_) <= t_)){ \
+        host_test_failures++; \
+        printf("FALLA %s:%d: %s = %.6g, esperado %.6g ± %.3g\n", __FILE__, __LINE__, #a, a_, b_, t_); \
+    } \
+}while(0)
+
+/** @brief |a - b| <= rel·|b| */
+#define CHECK_REL(a, b, rel) CHECK_NEAR(a, b, fabs((double)(b)) * (rel))
+
+#define CHECK_EQ_INT(a, b) do{ \
+    long long a_ = (long long)(a), b_ = (long long)(b); \
+    host_test_checks++; \
+    if(a_ != b_){ \
+        host_test_failures++; \
+        printf("FALLA %s:%d: %s = %lld, esperado %lld\n", __FILE__, __LINE__, #a, a_, b_); \
+    } \
+}while(0)
+
+#define HOST_TEST_RESULT() ( \
+    printf("%d verificaciones, %d fallas\n", host_test_checks, host_test_failures), \
+    host_test_failures == 0 ? 0 : 1)
+
+#endif // HOST_TEST_H
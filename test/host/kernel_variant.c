@@ -0,0 +1,73 @@
+/**
+ * @file kernel_variant.c
+ * @brief measure.c con los MEASURE_FIXED_POINT / MEASURE_SKEW_COMP del build y prefijo KERNEL_PREFIX
+ *
+ * Se compila una vez por variante (ver CMakeLists.txt); sólo expone
+ * KERNEL_PREFIX_kernel_run().
+ */
+
+#ifndef KERNEL_PREFIX
+#error "KERNEL_PREFIX no definido"
+#endif
+
+#define KP3(a, b) a##_##b
+#define KP2(a, b) KP3(a, b)
+#define KP(x) KP2(KERNEL_PREFIX, x)
+
+#define measure_accum_reset KP(measure_accum_reset)
+#define measure_stream_init KP(measure_stream_init)
+#define measure_aux_init KP(measure_aux_init)
+#define measure_add_sample KP(measure_add_sample)
+#define measure_add_set KP(measure_add_set)
+#define measure_get_results KP(measure_get_results)
+#define measure_total KP(measure_total)
+#define measure_get_raw KP(measure_get_raw)
+#define measure_cal_default KP(measure_cal_default)
+#define measure_set_cal KP(measure_set_cal)
+#define measure_get_cal KP(measure_get_cal)
+#define measure_display_results KP(measure_display_results)
+
+#include "../../src/app/measure.c"
+#include "kernel_variant.h"
+#include "synth.h"
+
+void KP(kernel_run)(const int16_t *v, const int16_t *i, uint32_t n, uint32_t reps, kernel_result_t *out){
+    static measure_stream_t st;
+    uint64_t acc_ns = 0, fin_ns = 0, cyc = 0;
+    uint32_t win_count = 0;
+
+    memset(out, 0, sizeof(*out));
+    for(uint32_t r = 0; r < reps; r++){
+        measure_stream_init(&st);
+        uint32_t k = 0;
+        while(k < n){
+            /*tramos de un cuarto de ciclo para que la lectura del reloj no domine*/
+            uint32_t end = (n - k > PAIRS_PER_CYCLE / 4) ? k + PAIRS_PER_CYCLE / 4 : n;
+            uint8_t evt = MEASURE_EVT_NONE;
+            uint64_t c0 = kernel_cycles();
+            uint64_t t0 = synth_now_ns();
+            while(k < end && !(evt & MEASURE_EVT_WINDOW)){
+                evt = measure_add_sample(&st, v[k], i[k]);
+                k++;
+            }
+            acc_ns += synth_now_ns() - t0;
+            cyc += kernel_cycles() - c0;
+            if(!(evt & MEASURE_EVT_WINDOW)) continue;
+
+            measure_t m;
+            c0 = kernel_cycles();
+            t0 = synth_now_ns();
+            measure_get_results(&st.last_window, &m);
+            fin_ns += synth_now_ns() - t0;
+            cyc += kernel_cycles() - c0;
+            win_count++;
+            if(r == 0 && out->windows < KERNEL_MAX_WINDOWS){
+                out->win_pairs[out->windows] = st.last_window.n;
+                out->win[out->windows++] = m;
+            }
+        }
+    }
+    out->ns_per_pair = (double)acc_ns / ((double)n * reps);
+    out->ns_finalize = win_count ? (double)fin_ns / win_count : 0.0;
+    out->cycles_per_window = win_count ? (double)cyc / win_count : 0.0;
+}
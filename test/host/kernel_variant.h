@@ -0,0 +1,45 @@
+/**
+ * @file kernel_variant.h
+ * @brief measure.c compilado con cada kernel de acumulación en un mismo binario
+ *
+ * kernel_variant.c incluye measure.c con MEASURE_FIXED_POINT o
+ * MEASURE_SKEW_COMP fijados desde el build y le antepone KERNEL_PREFIX a las
+ * funciones públicas, de modo que fixed_kernel_run(), float_kernel_run() y
+ * noskew_kernel_run() conviven y procesan los mismos pares.
+ */
+
+#ifndef KERNEL_VARIANT_H
+#define KERNEL_VARIANT_H
+
+#include <stdint.h>
+#include "app/measure.h"
+
+/** @brief Ventanas máximas que guarda una corrida */
+#define KERNEL_MAX_WINDOWS 64
+
+/**
+ * @brief Resultado de una corrida
+ */
+typedef struct {
+    measure_t win[KERNEL_MAX_WINDOWS];  /**< Resultados de cada ventana cerrada */
+    uint32_t win_pairs[KERNEL_MAX_WINDOWS]; /**< Pares de cada ventana */
+    int windows;                        /**< Ventanas cerradas */
+    double ns_per_pair;                 /**< Costo medio de measure_add_sample() */
+    double ns_finalize;                 /**< Costo medio de measure_get_results() */
+    double cycles_per_window;           /**< Ciclos de CPU por ventana (acumulación + cierre), 0 sin contador */
+} kernel_result_t;
+
+/**
+ * @brief Pasa n pares por el stream y cierra cada ventana
+ *
+ * @param reps Repeticiones de la acumulación para medir el costo (los resultados son de la primera)
+ */
+void fixed_kernel_run(const int16_t *v, const int16_t *i, uint32_t n, uint32_t reps, kernel_result_t *out);
+void float_kernel_run(const int16_t *v, const int16_t *i, uint32_t n, uint32_t reps, kernel_result_t *out);
+/** @brief Kernel por defecto sin compensación del desfasaje V/I (MEASURE_SKEW_COMP=0) */
+void noskew_kernel_run(const int16_t *v, const int16_t *i, uint32_t n, uint32_t reps, kernel_result_t *out);
+
+/** @brief Contador de ciclos de la CPU del host (0 si no hay) */
+uint64_t kernel_cycles(void);
+
+#endif // KERNEL_VARIANT_H
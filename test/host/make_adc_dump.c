@@ -0,0 +1,109 @@
+/**
+ * @file make_adc_dump.c
+ * @brief Genera una grabación de frames con el grabador de adc_dma.c
+ *
+ * Corre src/hal/adc_dma.c sobre el ADC simulado (shims/host_adc.c) con una
+ * señal de synth.c y vuelca la grabación completa (app_adc_rec_read()) tal
+ * como la entrega "ADCREC DUMP". data/adc_rec_48hz.bin se generó así; con
+ * --check se regenera en memoria y se compara byte a byte, lo que detecta
+ * cambios de formato del grabador.
+ *
+ *   make_adc_dump <salida.bin>
+ *   make_adc_dump --check <esperado.bin>
+ *
+ * La señal (dump_signal.h) tiene DUMP_CYCLES ciclos exactos en los
+ * ADC_REC_FRAMES frames para que la reproducción en bucle sea continua.
+ */
+
+#include "dump_signal.h"
+#include "host_adc.h"
+#include "host_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    synth_t s;
+    const int16_t *lut;
+    int16_t i_next;     // I del par cuya V ya se entregó
+} dump_src_t;
+
+/* Fuente del ADC simulado: V e I de cada par en el orden del patrón */
+static uint16_t dump_source(void *ctx, uint8_t ch, uint64_t n){
+    dump_src_t *d = ctx;
+    if(ch == ADC_CH_V){
+        int16_t v;
+        synth_next(&d->s, &v, &d->i_next);
+        return synth_mv_to_raw(d->lut, v);
+    }
+    return synth_mv_to_raw(d->lut, d->i_next);
+}
+
+/* Graba ADC_REC_FRAMES frames y devuelve la grabación (malloc) */
+static uint8_t *record(uint32_t *bytes){
+    static dump_src_t src;
+    synth_cfg_t cfg;
+    adc_rec_info_t info;
+    const uint32_t frame_us = (uint32_t)((uint64_t)FRAME_BYTES / 4 * 1000000 / SAMPLE_FREQ_HZ);
+
+    host_timer_manual(true);
+    app_adc_init_calibration();
+    dump_signal_cfg(&cfg);
+    synth_init(&src.s, &cfg);
+    src.lut = app_adc_get_cal_lut();
+    host_adc_set_source(dump_source, &src);
+
+    app_adc_dma_init();
+    app_adc_dma_start_conv();
+    app_adc_rec_start();
+    do{
+        const uint8_t *f;
+        uint32_t n;
+        host_adc_complete(1);
+        host_timer_advance(frame_us);
+        if(app_adc_dma_get_frame(&f, &n, 0) == ESP_OK) app_adc_dma_release_frame();
+        app_adc_rec_get_info(&info);
+    } while(info.state == ADC_REC_RECORDING || info.state == ADC_REC_IDLE);
+
+    uint8_t *buf = malloc(info.bytes);
+    *bytes = (uint32_t)app_adc_rec_read(0, buf, info.bytes);
+    return buf;
+}
+
+int main(int argc, char **argv){
+    bool check = (argc == 3 && strcmp(argv[1], "--check") == 0);
+    if(argc != 2 && !check){
+        fprintf(stderr, "uso: make_adc_dump <salida.bin> | --check <esperado.bin>\n");
+        return 2;
+    }
+    const char *path = argv[argc - 1];
+
+    uint32_t bytes;
+    uint8_t *buf = record(&bytes);
+
+    if(!check){
+        FILE *f = fopen(path, "wb");
+        if(f == NULL || fwrite(buf, 1, bytes, f) != bytes){
+            fprintf(stderr, "no se pudo escribir %s\n", path);
+            return 1;
+        }
+        fclose(f);
+        printf("%s: %u bytes\n", path, (unsigned)bytes);
+        return 0;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if(f == NULL){
+        fprintf(stderr, "no se pudo leer %s\n", path);
+        return 1;
+    }
+    uint8_t *exp = malloc(bytes + 1);
+    size_t n = fread(exp, 1, bytes + 1, f);
+    fclose(f);
+    if(n != bytes || memcmp(exp, buf, bytes) != 0){
+        printf("FALLA: la grabación (%u bytes) no coincide con %s (%zu bytes)\n", (unsigned)bytes, path, n);
+        return 1;
+    }
+    printf("grabación idéntica a %s (%u bytes)\n", path, (unsigned)bytes);
+    return 0;
+}
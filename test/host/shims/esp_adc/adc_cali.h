@@ -0,0 +1,16 @@
+/**
+ * @file adc_cali.h
+ * @brief Shim de la calibración del ADC para el build nativo (test/host)
+ */
+
+#ifndef HOST_ADC_CALI_H
+#define HOST_ADC_CALI_H
+
+#include "esp_err.h"
+
+typedef struct adc_cali_scheme_t *adc_cali_handle_t;
+
+/** @brief Conversión raw → mV por el esquema (llamada indirecta, como en IDF) */
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *voltage);
+
+#endif // HOST_ADC_CALI_H
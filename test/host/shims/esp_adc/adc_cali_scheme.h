@@ -0,0 +1,25 @@
+/**
+ * @file adc_cali_scheme.h
+ * @brief Shim del esquema line fitting para el build nativo (test/host)
+ *
+ * Usa los coeficientes del esquema del ESP32 con Vref de 1100 mV (sin eFuse),
+ * suficiente para comparar la tabla precalculada contra el esquema.
+ */
+
+#ifndef HOST_ADC_CALI_SCHEME_H
+#define HOST_ADC_CALI_SCHEME_H
+
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_continuous.h"
+
+typedef struct {
+    adc_unit_t unit_id;
+    adc_atten_t atten;
+    adc_bitwidth_t bitwidth;
+    uint32_t default_vref;
+} adc_cali_line_fitting_config_t;
+
+esp_err_t adc_cali_create_scheme_line_fitting(const adc_cali_line_fitting_config_t *config, adc_cali_handle_t *ret_handle);
+esp_err_t adc_cali_delete_scheme_line_fitting(adc_cali_handle_t handle);
+
+#endif // HOST_ADC_CALI_SCHEME_H
@@ -0,0 +1,17 @@
+/**
+ * @file esp_crc.h
+ * @brief Shim de los CRC de la ROM del ESP32 para el build nativo (test/host)
+ */
+
+#ifndef HOST_ESP_CRC_H
+#define HOST_ESP_CRC_H
+
+#include <stdint.h>
+
+/** @brief CRC32 little endian (polinomio 0xEDB88320), igual que esp_crc32_le() */
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+/** @brief CRC16 little endian (polinomio 0x8408), igual que esp_crc16_le() */
+uint16_t esp_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len);
+
+#endif // HOST_ESP_CRC_H
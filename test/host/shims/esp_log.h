@@ -0,0 +1,24 @@
+/**
+ * @file esp_log.h
+ * @brief Shim del log de ESP-IDF para el build nativo (test/host)
+ *
+ * Errores y advertencias van a stderr; info y debug sólo con HOST_LOG_VERBOSE
+ * para que la salida de los tests quede limpia.
+ */
+
+#ifndef HOST_ESP_LOG_H
+#define HOST_ESP_LOG_H
+
+#include <stdio.h>
+#include "esp_err.h"
+
+#ifndef HOST_LOG_VERBOSE
+#define HOST_LOG_VERBOSE 0
+#endif
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) do{ if(HOST_LOG_VERBOSE) fprintf(stderr, "I (%s) " fmt "\n", tag, ##__VA_ARGS__); }while(0)
+#define ESP_LOGD(tag, fmt, ...) do{ if(HOST_LOG_VERBOSE) fprintf(stderr, "D (%s) " fmt "\n", tag, ##__VA_ARGS__); }while(0)
+
+#endif // HOST_ESP_LOG_H
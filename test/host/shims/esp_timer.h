@@ -0,0 +1,14 @@
+/**
+ * @file esp_timer.h
+ * @brief Shim de esp_timer para el build nativo (test/host): reloj monotónico del host
+ */
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+/** @brief Microsegundos desde el arranque del proceso */
+int64_t esp_timer_get_time(void);
+
+#endif // HOST_ESP_TIMER_H
@@ -0,0 +1,54 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Shim de FreeRTOS para el build nativo (test/host)
+ *
+ * Sólo lo que usan los módulos que se compilan en la PC (state.c,
+ * energy_log.c, adc_dma_host.c): tipos, ticks de 1 ms, secciones críticas
+ * sobre un pthread mutex, notificaciones y event groups. Las secciones
+ * críticas del ESP32 no se pueden interrumpir; en la PC un mutex da la
+ * misma exclusión entre escritores, que es lo que verifican los tests.
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void *TaskHandle_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define pdFAIL  0
+
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTICKS_TO_MS(t) ((uint32_t)(t))
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define IRAM_ATTR
+
+#define configASSERT(x) do{ if(!(x)) host_assert_fail(#x, __FILE__, __LINE__); }while(0)
+
+/*secciones críticas: exclusión entre hilos del host*/
+typedef pthread_mutex_t portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED PTHREAD_MUTEX_INITIALIZER
+#define portENTER_CRITICAL(mux) pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux) pthread_mutex_unlock(mux)
+#define portENTER_CRITICAL_ISR(mux) pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL_ISR(mux) pthread_mutex_unlock(mux)
+#define portYIELD_FROM_ISR(x) ((void)(x))
+
+void host_assert_fail(const char *expr, const char *file, int line);
+
+#include "freertos/task.h"
+
+#endif // HOST_FREERTOS_H
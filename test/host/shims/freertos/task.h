@@ -0,0 +1,27 @@
+/**
+ * @file task.h
+ * @brief Shim de las tareas de FreeRTOS para el build nativo (test/host)
+ *
+ * Cada hilo del host es una "tarea": el handle identifica al hilo y las
+ * notificaciones son un contador por hilo (sólo las formas Give/Take).
+ */
+
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+/** @brief Ticks (ms) desde el arranque del proceso */
+TickType_t xTaskGetTickCount(void);
+
+/** @brief Duerme el hilo ticks milisegundos */
+void vTaskDelay(TickType_t ticks);
+
+/** @brief Handle de la tarea (hilo) llamante */
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+void xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+
+#endif // HOST_FREERTOS_TASK_H
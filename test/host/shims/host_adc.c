@@ -0,0 +1,281 @@
+/**
+ * @file host_adc.c
+ * @brief Driver continuo del ADC y esquema de calibración simulados (test/host)
+ */
+
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "host_adc.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Buffers DMA que rota el driver de IDF (INTERNAL_BUF_NUM) */
+#define HOST_ADC_DMA_BUFS 5
+
+#define HOST_ADC_MAX_PATTERN 8
+
+struct adc_continuous_ctx_t {
+    adc_continuous_handle_cfg_t cfg;
+    adc_digi_pattern_config_t pattern[HOST_ADC_MAX_PATTERN];
+    uint32_t pattern_num;
+    uint32_t slot;                  // próximo slot del patrón
+    uint64_t per_ch[16];            // muestras generadas por canal
+    adc_continuous_evt_cbs_t cbs;
+    void *user_data;
+    bool configured;
+    bool started;
+    uint8_t *dma[HOST_ADC_DMA_BUFS];
+    uint32_t dma_next;
+    uint8_t *pool;                  // ring de bytes del driver
+    uint32_t pool_head;
+    uint32_t pool_used;
+};
+
+static struct adc_continuous_ctx_t *live = NULL;
+static host_adc_source_t source = NULL;
+static void *source_ctx = NULL;
+static host_adc_stats_t stats;
+
+static struct {
+    esp_err_t err;
+    uint32_t count;
+    uint32_t frame_bytes;   // != 0: falla sólo con ese conv_frame_size
+} faults[HOST_ADC_OP_COUNT];
+
+/* Error inyectado para op, o ESP_OK */
+static esp_err_t fault(host_adc_op_t op, uint32_t frame_bytes){
+    if(faults[op].frame_bytes != 0){
+        return (faults[op].frame_bytes == frame_bytes) ? faults[op].err : ESP_OK;
+    }
+    if(faults[op].count == 0) return ESP_OK;
+    faults[op].count--;
+    return faults[op].err;
+}
+
+void host_adc_set_source(host_adc_source_t src, void *ctx){
+    source = src;
+    source_ctx = ctx;
+}
+
+void host_adc_fail(host_adc_op_t op, esp_err_t err, uint32_t count){
+    faults[op].err = err;
+    faults[op].count = count;
+    faults[op].frame_bytes = 0;
+}
+
+void host_adc_fail_frame_bytes(host_adc_op_t op, uint32_t frame_bytes, esp_err_t err){
+    faults[op].err = err;
+    faults[op].count = 0;
+    faults[op].frame_bytes = frame_bytes;
+}
+
+void host_adc_get_stats(host_adc_stats_t *out){
+    *out = stats;
+    out->handles = (live != NULL) ? 1 : 0;
+    out->pool_bytes = (live != NULL) ? live->pool_used : 0;
+    out->frame_bytes = (live != NULL) ? live->cfg.conv_frame_size : 0;
+    out->ring_bytes = (live != NULL) ? live->cfg.max_store_buf_size : 0;
+    out->started = (live != NULL) && live->started;
+}
+
+void host_adc_reset(void){
+    memset(faults, 0, sizeof(faults));
+    memset(&stats, 0, sizeof(stats));
+}
+
+/* Copia n bytes al ring; false si no entran (el ring de IDF no acepta items parciales) */
+static bool pool_push(struct adc_continuous_ctx_t *h, const uint8_t *src, uint32_t n){
+    uint32_t cap = h->cfg.max_store_buf_size;
+    if(cap - h->pool_used < n) return false;
+    uint32_t tail = (h->pool_head + h->pool_used) % cap;
+    for(uint32_t k = 0; k < n; k++) h->pool[(tail + k) % cap] = src[k];
+    h->pool_used += n;
+    return true;
+}
+
+void host_adc_complete(uint32_t frames){
+    struct adc_continuous_ctx_t *h = live;
+    if(h == NULL || !h->started) return;
+
+    for(uint32_t f = 0; f < frames; f++){
+        uint8_t *buf = h->dma[h->dma_next];
+        h->dma_next = (h->dma_next + 1) % HOST_ADC_DMA_BUFS;
+
+        adc_digi_output_data_t *out = (adc_digi_output_data_t*)buf;
+        uint32_t n = h->cfg.conv_frame_size / sizeof(adc_digi_output_data_t);
+        for(uint32_t k = 0; k < n; k++){
+            uint8_t ch = h->pattern[h->slot].channel & 0x0F;
+            h->slot = (h->slot + 1) % h->pattern_num;
+            uint16_t raw = (source != NULL) ? source(source_ctx, ch, h->per_ch[ch]) : 2048;
+            h->per_ch[ch]++;
+            out[k].type1.data = raw & 0x0FFF;
+            out[k].type1.channel = ch;
+        }
+        stats.frames++;
+
+        /*mismo orden que s_adc_dma_intr() de IDF: callback, luego copia al pool*/
+        adc_continuous_evt_data_t edata = { .conv_frame_buffer = buf, .size = h->cfg.conv_frame_size };
+        if(h->cbs.on_conv_done != NULL) h->cbs.on_conv_done(h, &edata, h->user_data);
+        if(!pool_push(h, buf, h->cfg.conv_frame_size)){
+            if(h->cfg.flags.flush_pool){
+                // flush_pool: el driver descarta el contenido del ring y guarda el frame nuevo
+                h->pool_head = 0;
+                h->pool_used = 0;
+                stats.pool_isr_flushes++;
+                pool_push(h, buf, h->cfg.conv_frame_size);
+            } else {
+                stats.pool_drops++;
+                if(h->cbs.on_pool_ovf != NULL) h->cbs.on_pool_ovf(h, &edata, h->user_data);
+            }
+        }
+    }
+}
+
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t *hdl_config, adc_continuous_handle_t *ret_handle){
+    esp_err_t err = fault(HOST_ADC_OP_NEW_HANDLE, hdl_config->conv_frame_size);
+    if(err != ESP_OK) return err;
+    if(live != NULL) return ESP_ERR_INVALID_STATE; // el ADC continuo admite un solo handle
+    if(hdl_config->conv_frame_size == 0 || hdl_config->max_store_buf_size < hdl_config->conv_frame_size) return ESP_ERR_INVALID_ARG;
+
+    struct adc_continuous_ctx_t *h = calloc(1, sizeof(*h));
+    if(h == NULL) return ESP_ERR_NO_MEM;
+    h->cfg = *hdl_config;
+    h->pool = malloc(hdl_config->max_store_buf_size);
+    for(int k = 0; k < HOST_ADC_DMA_BUFS; k++) h->dma[k] = calloc(1, hdl_config->conv_frame_size);
+    live = h;
+    *ret_handle = h;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_config(adc_continuous_handle_t handle, const adc_continuous_config_t *config){
+    if(handle == NULL) return ESP_ERR_INVALID_STATE;
+    esp_err_t err = fault(HOST_ADC_OP_CONFIG, handle->cfg.conv_frame_size);
+    if(err != ESP_OK) return err;
+    if(handle->started) return ESP_ERR_INVALID_STATE;
+    if(config->pattern_num == 0 || config->pattern_num > HOST_ADC_MAX_PATTERN) return ESP_ERR_INVALID_ARG;
+    memcpy(handle->pattern, config->adc_pattern, config->pattern_num * sizeof(adc_digi_pattern_config_t));
+    handle->pattern_num = config->pattern_num;
+    handle->slot = 0;
+    handle->configured = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_register_event_callbacks(adc_continuous_handle_t handle, const adc_continuous_evt_cbs_t *cbs, void *user_data){
+    if(handle == NULL) return ESP_ERR_INVALID_STATE;
+    esp_err_t err = fault(HOST_ADC_OP_REGISTER_CBS, handle->cfg.conv_frame_size);
+    if(err != ESP_OK) return err;
+    if(handle->started) return ESP_ERR_INVALID_STATE;
+    handle->cbs = *cbs;
+    handle->user_data = user_data;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_start(adc_continuous_handle_t handle){
+    if(handle == NULL) return ESP_ERR_INVALID_STATE;
+    esp_err_t err = fault(HOST_ADC_OP_START, handle->cfg.conv_frame_size);
+    if(err != ESP_OK) return err;
+    if(handle->started || !handle->configured) return ESP_ERR_INVALID_STATE;
+    handle->started = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_stop(adc_continuous_handle_t handle){
+    if(handle == NULL) return ESP_ERR_INVALID_STATE;
+    esp_err_t err = fault(HOST_ADC_OP_STOP, handle->cfg.conv_frame_size);
+    if(err != ESP_OK) return err;
+    if(!handle->started) return ESP_ERR_INVALID_STATE;
+    handle->started = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_read(adc_continuous_handle_t handle, uint8_t *buf, uint32_t length_max, uint32_t *out_length, uint32_t timeout_ms){
+    (void)timeout_ms; // el driver simulado no tiene hilo: lo que no está en el pool no llega esperando
+    *out_length = 0;
+    if(handle == NULL || !handle->started) return ESP_ERR_INVALID_STATE;
+
+    uint32_t n = (handle->pool_used < length_max) ? handle->pool_used : length_max;
+    if(n == 0) return ESP_ERR_TIMEOUT;
+    uint32_t cap = handle->cfg.max_store_buf_size;
+    for(uint32_t k = 0; k < n; k++) buf[k] = handle->pool[(handle->pool_head + k) % cap];
+    handle->pool_head = (handle->pool_head + n) % cap;
+    handle->pool_used -= n;
+    stats.read_bytes += n;
+    *out_length = n;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_flush_pool(adc_continuous_handle_t handle){
+    if(handle == NULL || !handle->started) return ESP_ERR_INVALID_STATE;
+    handle->pool_head = 0;
+    handle->pool_used = 0;
+    stats.pool_flushes++;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_deinit(adc_continuous_handle_t handle){
+    if(handle == NULL) return ESP_ERR_INVALID_STATE;
+    esp_err_t err = fault(HOST_ADC_OP_DEINIT, handle->cfg.conv_frame_size);
+    if(err != ESP_OK) return err;
+    if(handle->started) return ESP_ERR_INVALID_STATE;
+    for(int k = 0; k < HOST_ADC_DMA_BUFS; k++) free(handle->dma[k]);
+    free(handle->pool);
+    if(live == handle) live = NULL;
+    free(handle);
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------------- calibración */
+
+/* Coeficientes del line fitting del ESP32 (esp_adc_cal de IDF): escala por atenuación y offset [mV] */
+static const uint32_t lf_atten_scale[] = { 57431, 76236, 105481, 196602 };
+static const uint32_t lf_atten_offset[] = { 75, 78, 88, 142 };
+
+struct adc_cali_scheme_t {
+    esp_err_t (*raw_to_voltage)(void *ctx, int raw, int *voltage);
+    void *ctx;
+};
+
+typedef struct {
+    uint32_t coeff_a;
+    uint32_t coeff_b;
+} line_fitting_ctx_t;
+
+static esp_err_t line_fitting_raw_to_voltage(void *arg, int raw, int *voltage){
+    const line_fitting_ctx_t *c = arg;
+    if(raw < 0 || raw > 4095) return ESP_ERR_INVALID_ARG;
+    *voltage = (int)((((uint32_t)raw * c->coeff_a) + 32767u) / 65536u + c->coeff_b);
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_create_scheme_line_fitting(const adc_cali_line_fitting_config_t *config, adc_cali_handle_t *ret_handle){
+    if(config->atten > ADC_ATTEN_DB_12) return ESP_ERR_INVALID_ARG;
+    esp_err_t err = fault(HOST_ADC_OP_CALI_CREATE, 0);
+    if(err != ESP_OK) return err;
+    struct adc_cali_scheme_t *s = calloc(1, sizeof(*s));
+    line_fitting_ctx_t *c = calloc(1, sizeof(*c));
+    if(s == NULL || c == NULL){
+        free(s);
+        free(c);
+        return ESP_ERR_NO_MEM;
+    }
+    uint32_t vref = (config->default_vref != 0) ? config->default_vref : 1100;
+    c->coeff_a = (vref * lf_atten_scale[config->atten]) / 4096u;
+    c->coeff_b = lf_atten_offset[config->atten];
+    s->raw_to_voltage = line_fitting_raw_to_voltage;
+    s->ctx = c;
+    *ret_handle = s;
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_delete_scheme_line_fitting(adc_cali_handle_t handle){
+    if(handle == NULL) return ESP_ERR_INVALID_ARG;
+    free(handle->ctx);
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *voltage){
+    if(handle == NULL) return ESP_ERR_INVALID_ARG;
+    return handle->raw_to_voltage(handle->ctx, raw, voltage);
+}
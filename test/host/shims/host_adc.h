@@ -0,0 +1,65 @@
+/**
+ * @file host_adc.h
+ * @brief Control del ADC simulado del build nativo (test/host)
+ *
+ * El driver simulado no tiene hilo propio: el test decide cuándo se completa
+ * cada frame con host_adc_complete(), que corre el camino de la ISR (buffers
+ * DMA rotativos, on_conv_done, copia al pool u on_pool_ovf) en el hilo
+ * llamante. Las muestras las genera host_adc_source_t por canal.
+ */
+
+#ifndef HOST_ADC_H
+#define HOST_ADC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/** @brief Operaciones del driver en las que se puede inyectar un error */
+typedef enum {
+    HOST_ADC_OP_NEW_HANDLE = 0,
+    HOST_ADC_OP_CONFIG,
+    HOST_ADC_OP_REGISTER_CBS,
+    HOST_ADC_OP_START,
+    HOST_ADC_OP_STOP,
+    HOST_ADC_OP_DEINIT,
+    HOST_ADC_OP_CALI_CREATE,    /**< adc_cali_create_scheme_line_fitting() */
+    HOST_ADC_OP_COUNT
+} host_adc_op_t;
+
+/** @brief Cuenta cruda de 12 bits del canal ch para la muestra n (por canal) */
+typedef uint16_t (*host_adc_source_t)(void *ctx, uint8_t ch, uint64_t n);
+
+/** @brief Contadores del driver simulado */
+typedef struct {
+    uint64_t frames;            /**< Frames completados */
+    uint64_t pool_drops;        /**< Frames que no entraron en el pool */
+    uint64_t pool_flushes;      /**< Llamadas a adc_continuous_flush_pool() */
+    uint64_t pool_isr_flushes;  /**< Ring vaciado por el driver al llenarse (flags.flush_pool) */
+    uint64_t read_bytes;        /**< Bytes copiados por adc_continuous_read() */
+    uint32_t handles;           /**< Handles vivos (deben ser 0 o 1) */
+    uint32_t pool_bytes;        /**< Bytes ocupados en el pool */
+    uint32_t frame_bytes;       /**< conv_frame_size del handle vivo */
+    uint32_t ring_bytes;        /**< max_store_buf_size del handle vivo */
+    bool started;               /**< Conversión en marcha */
+} host_adc_stats_t;
+
+/** @brief Fuente de muestras (NULL: media escala en todos los canales) */
+void host_adc_set_source(host_adc_source_t src, void *ctx);
+
+/** @brief Completa frames: corre el camino de la ISR del driver (sólo con el driver iniciado) */
+void host_adc_complete(uint32_t frames);
+
+/** @brief Hace fallar las próximas count llamadas de op con err */
+void host_adc_fail(host_adc_op_t op, esp_err_t err, uint32_t count);
+
+/** @brief Hace fallar las llamadas a op cuyo conv_frame_size es frame_bytes (0: desactiva) */
+void host_adc_fail_frame_bytes(host_adc_op_t op, uint32_t frame_bytes, esp_err_t err);
+
+/** @brief Lectura de los contadores */
+void host_adc_get_stats(host_adc_stats_t *out);
+
+/** @brief Borra fallas inyectadas y contadores (no toca el handle vivo) */
+void host_adc_reset(void);
+
+#endif // HOST_ADC_H
@@ -0,0 +1,76 @@
+/**
+ * @file host_esp.c
+ * @brief esp_timer, CRC32 y utilidades de ESP-IDF para el build nativo (test/host)
+ */
+
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_crc.h"
+#include "esp_system.h"
+#include "host_timer.h"
+#include <time.h>
+#include <stdatomic.h>
+
+static atomic_bool timer_manual;
+static _Atomic int64_t timer_manual_us;
+
+static int64_t timer_real_us(void){
+    static int64_t t0 = 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if(t0 == 0) t0 = now - 1; // el ESP32 arranca en ~0 us; nunca devuelve 0
+    return now - t0;
+}
+
+int64_t esp_timer_get_time(void){
+    if(atomic_load(&timer_manual)) return atomic_load(&timer_manual_us);
+    return timer_real_us();
+}
+
+void host_timer_manual(bool on){
+    if(on && !atomic_load(&timer_manual)) atomic_store(&timer_manual_us, timer_real_us());
+    atomic_store(&timer_manual, on);
+}
+
+void host_timer_advance(int64_t us){
+    atomic_fetch_add(&timer_manual_us, us);
+}
+
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len){
+    crc = ~crc;
+    for(uint32_t k = 0; k < len; k++){
+        crc ^= buf[k];
+        for(int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+uint16_t esp_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len){
+    crc = (uint16_t)~crc;
+    for(uint32_t k = 0; k < len; k++){
+        crc ^= buf[k];
+        for(int b = 0; b < 8; b++) crc = (uint16_t)((crc >> 1) ^ (0x8408u & (0u - (crc & 1u))));
+    }
+    return (uint16_t)~crc;
+}
+
+const char *esp_err_to_name(esp_err_t err){
+    switch(err){
+        case ESP_OK:                return "ESP_OK";
+        case ESP_FAIL:              return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:  return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:     return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:       return "ESP_ERR_TIMEOUT";
+        default:                    return "UNKNOWN ERROR";
+    }
+}
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler){
+    (void)handler;
+    return ESP_OK;
+}
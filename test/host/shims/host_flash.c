@@ -0,0 +1,200 @@
+/**
+ * @file host_flash.c
+ * @brief Flash NOR en RAM con cortes de alimentación para el build nativo (test/host)
+ */
+
+#include "esp_partition.h"
+#include "host_flash.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define HOST_FLASH_MAX_PARTS 4
+
+typedef struct {
+    esp_partition_t part;
+    uint8_t *data;
+    uint32_t *erases;       // por sector
+    uint32_t *reads;        // lecturas que cubrieron cada dirección
+    bool fail_armed;
+    uint32_t fail_addr;
+    uint32_t fail_skip;
+} host_part_t;
+
+static host_part_t parts[HOST_FLASH_MAX_PARTS];
+static uint32_t n_parts = 0;
+
+static bool cut_armed = false;
+static bool cut_done = false;
+static uint64_t cut_budget = 0;
+static uint64_t read_ops = 0;
+
+static host_part_t *lookup(const esp_partition_t *part){
+    for(uint32_t k = 0; k < n_parts; k++){
+        if(&parts[k].part == part) return &parts[k];
+    }
+    return NULL;
+}
+
+/* Consume presupuesto de bytes hasta el corte. Retorna los bytes que alcanzan a completarse */
+static size_t cut_consume(size_t n){
+    if(!cut_armed) return n;
+    if(cut_budget >= n){
+        cut_budget -= n;
+        return n;
+    }
+    size_t done = (size_t)cut_budget;
+    cut_budget = 0;
+    cut_done = true;
+    return done;
+}
+
+const esp_partition_t *host_flash_create(const char *label, uint32_t size, uint8_t fill, uint32_t seed){
+    host_part_t *p = NULL;
+    for(uint32_t k = 0; k < n_parts; k++){
+        if(strcmp(parts[k].part.label, label) == 0) p = &parts[k];
+    }
+    if(p == NULL){
+        if(n_parts >= HOST_FLASH_MAX_PARTS) return NULL;
+        p = &parts[n_parts++];
+    }
+    free(p->data);
+    free(p->erases);
+    free(p->reads);
+    memset(p, 0, sizeof(*p));
+
+    p->part.type = ESP_PARTITION_TYPE_DATA;
+    p->part.subtype = ESP_PARTITION_SUBTYPE_ANY;
+    p->part.size = size;
+    p->part.erase_size = HOST_FLASH_SECTOR;
+    strncpy(p->part.label, label, sizeof(p->part.label) - 1);
+    p->data = malloc(size);
+    p->erases = calloc(size / HOST_FLASH_SECTOR, sizeof(uint32_t));
+    p->reads = calloc(size, sizeof(uint32_t));
+
+    if(seed != 0){
+        uint32_t x = seed;
+        for(uint32_t k = 0; k < size; k++){
+            x = x * 1664525u + 1013904223u;
+            p->data[k] = (uint8_t)(x >> 24);
+        }
+    } else {
+        memset(p->data, fill, size);
+    }
+    return &p->part;
+}
+
+void host_flash_reset(void){
+    for(uint32_t k = 0; k < n_parts; k++){
+        free(parts[k].data);
+        free(parts[k].erases);
+        free(parts[k].reads);
+    }
+    memset(parts, 0, sizeof(parts));
+    n_parts = 0;
+    host_flash_power_on();
+}
+
+uint8_t *host_flash_data(const esp_partition_t *part){
+    host_part_t *p = lookup(part);
+    return (p != NULL) ? p->data : NULL;
+}
+
+void host_flash_cut_after(uint64_t n){
+    cut_armed = true;
+    cut_done = false;
+    cut_budget = n;
+}
+
+bool host_flash_is_cut(void){
+    return cut_done;
+}
+
+void host_flash_power_on(void){
+    cut_armed = false;
+    cut_done = false;
+    cut_budget = 0;
+    for(uint32_t k = 0; k < n_parts; k++){
+        parts[k].fail_armed = false;
+        memset(parts[k].reads, 0, parts[k].part.size * sizeof(uint32_t));
+    }
+}
+
+void host_flash_fail_read(const esp_partition_t *part, uint32_t addr, uint32_t skip){
+    host_part_t *p = lookup(part);
+    if(p == NULL) return;
+    p->fail_armed = true;
+    p->fail_addr = addr;
+    p->fail_skip = skip;
+}
+
+uint32_t host_flash_reads_at(const esp_partition_t *part, uint32_t addr){
+    host_part_t *p = lookup(part);
+    return (p != NULL && addr < p->part.size) ? p->reads[addr] : 0;
+}
+
+uint32_t host_flash_erase_count(const esp_partition_t *part, uint32_t sector){
+    host_part_t *p = lookup(part);
+    return (p != NULL && sector < p->part.size / HOST_FLASH_SECTOR) ? p->erases[sector] : 0;
+}
+
+uint64_t host_flash_read_ops(void){
+    return read_ops;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label){
+    for(uint32_t k = 0; k < n_parts; k++){
+        if(parts[k].part.type != type) continue;
+        if(subtype != ESP_PARTITION_SUBTYPE_ANY && parts[k].part.subtype != subtype) continue;
+        if(label == NULL || strcmp(parts[k].part.label, label) == 0) return &parts[k].part;
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t src_offset, void *dst, size_t size){
+    host_part_t *p = lookup(part);
+    if(p == NULL) return ESP_ERR_INVALID_ARG;
+    if(src_offset + size > part->size) return ESP_ERR_INVALID_SIZE;
+    if(cut_done) return ESP_FAIL;
+
+    read_ops++;
+    for(size_t k = 0; k < size; k++) p->reads[src_offset + k]++;
+    if(p->fail_armed && p->fail_addr >= src_offset && p->fail_addr < src_offset + size){
+        if(p->fail_skip == 0) return ESP_FAIL;
+        p->fail_skip--;
+    }
+    memcpy(dst, &p->data[src_offset], size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t dst_offset, const void *src, size_t size){
+    host_part_t *p = lookup(part);
+    if(p == NULL) return ESP_ERR_INVALID_ARG;
+    if(dst_offset + size > part->size) return ESP_ERR_INVALID_SIZE;
+    if(cut_done) return ESP_FAIL;
+
+    size_t done = cut_consume(size);
+    const uint8_t *s = src;
+    for(size_t k = 0; k < done; k++) p->data[dst_offset + k] &= s[k]; // NOR: sólo baja bits
+    return (done == size) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size){
+    host_part_t *p = lookup(part);
+    if(p == NULL) return ESP_ERR_INVALID_ARG;
+    if((offset % HOST_FLASH_SECTOR) != 0 || (size % HOST_FLASH_SECTOR) != 0) return ESP_ERR_INVALID_ARG;
+    if(offset + size > part->size) return ESP_ERR_INVALID_SIZE;
+    if(cut_done) return ESP_FAIL;
+
+    for(size_t s = offset; s < offset + size; s += HOST_FLASH_SECTOR){
+        size_t done = cut_consume(HOST_FLASH_SECTOR);
+        p->erases[s / HOST_FLASH_SECTOR]++;
+        if(done < HOST_FLASH_SECTOR){
+            /*borrado interrumpido: una parte del sector queda en 0xFF y el resto con basura*/
+            memset(&p->data[s], 0xFF, done);
+            for(size_t k = done; k < HOST_FLASH_SECTOR; k++) p->data[s + k] &= (uint8_t)(0x5A ^ k);
+            return ESP_FAIL;
+        }
+        memset(&p->data[s], 0xFF, HOST_FLASH_SECTOR);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file host_flash.h
+ * @brief Control de la flash simulada del build nativo: creación, cortes y fallas
+ *
+ * Modelo NOR: borrar pone el sector en 0xFF; escribir hace AND byte a byte.
+ *
+ * - Corte de alimentación: host_flash_cut_after(n) deja que se programen (o
+ *   borren) n bytes más y corta en el siguiente. La operación cortada queda a
+ *   medias y devuelve ESP_FAIL; desde ahí toda operación falla hasta
+ *   host_flash_power_on(), que simula el reinicio. El test vuelve a llamar
+ *   al init del módulo, como en un arranque.
+ * - Lecturas fallidas: host_flash_fail_read(addr, skip) hace fallar las
+ *   lecturas que cubren addr después de las primeras skip.
+ * - Contadores de borrado por sector para medir el desgaste.
+ */
+
+#ifndef HOST_FLASH_H
+#define HOST_FLASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_partition.h"
+
+/** @brief Sector de borrado de la flash simulada [bytes] */
+#define HOST_FLASH_SECTOR 4096
+
+/**
+ * @brief Crea (o recrea) una partición de datos
+ *
+ * @param label Etiqueta
+ * @param size Tamaño, múltiplo de HOST_FLASH_SECTOR
+ * @param fill Contenido inicial de cada byte (0xFF: borrada)
+ * @param seed Si no es 0, contenido inicial pseudoaleatorio con esa semilla (fill se ignora)
+ */
+const esp_partition_t *host_flash_create(const char *label, uint32_t size, uint8_t fill, uint32_t seed);
+
+/** @brief Elimina todas las particiones (esp_partition_find_first() ya no las encuentra) */
+void host_flash_reset(void);
+
+/** @brief Contenido crudo de una partición (para inspeccionar o corromper) */
+uint8_t *host_flash_data(const esp_partition_t *part);
+
+/** @brief Corta la alimentación después de n bytes programados o borrados */
+void host_flash_cut_after(uint64_t n);
+
+/** @brief true si hubo un corte desde el último host_flash_power_on() */
+bool host_flash_is_cut(void);
+
+/** @brief Vuelve la alimentación y desactiva los cortes y fallas de lectura */
+void host_flash_power_on(void);
+
+/** @brief Falla las lecturas que cubren addr después de las primeras skip */
+void host_flash_fail_read(const esp_partition_t *part, uint32_t addr, uint32_t skip);
+
+/** @brief Lecturas que cubrieron addr desde host_flash_power_on() */
+uint32_t host_flash_reads_at(const esp_partition_t *part, uint32_t addr);
+
+/** @brief Borrados del sector de part que empieza en sector·HOST_FLASH_SECTOR */
+uint32_t host_flash_erase_count(const esp_partition_t *part, uint32_t sector);
+
+/** @brief Operaciones de lectura desde el arranque */
+uint64_t host_flash_read_ops(void);
+
+#endif // HOST_FLASH_H
@@ -0,0 +1,180 @@
+/**
+ * @file host_freertos.c
+ * @brief FreeRTOS mínimo sobre pthreads para el build nativo (test/host)
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+
+void host_assert_fail(const char *expr, const char *file, int line){
+    fprintf(stderr, "configASSERT(%s) falló en %s:%d\n", expr, file, line);
+    abort();
+}
+
+/* Deadline absoluto (CLOCK_MONOTONIC) a ticks milisegundos de ahora */
+static struct timespec deadline_after(TickType_t ticks){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += ticks / 1000;
+    ts.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if(ts.tv_nsec >= 1000000000L){
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static void cond_init_monotonic(pthread_cond_t *cond){
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/* Espera en cond hasta que pred sea verdadero o venza ticks (portMAX_DELAY: sin límite) */
+#define WAIT_UNTIL(cond, mutex, ticks, pred) do{ \
+    struct timespec dl_ = deadline_after(ticks); \
+    while(!(pred)){ \
+        if((ticks) == 0) break; \
+        if((ticks) == portMAX_DELAY) pthread_cond_wait(cond, mutex); \
+        else if(pthread_cond_timedwait(cond, mutex, &dl_) == ETIMEDOUT) break; \
+    } \
+}while(0)
+
+TickType_t xTaskGetTickCount(void){
+    return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+void vTaskDelay(TickType_t ticks){
+    struct timespec ts = { .tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000L };
+    if(ticks == 0){
+        sched_yield();
+        return;
+    }
+    nanosleep(&ts, NULL);
+}
+
+/* ---------------------------------------------------------------- notificaciones */
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t count;
+} host_task_t;
+
+static __thread host_task_t *cur_task = NULL;
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void){
+    if(cur_task == NULL){
+        cur_task = calloc(1, sizeof(*cur_task)); // vive lo que el proceso
+        pthread_mutex_init(&cur_task->lock, NULL);
+        cond_init_monotonic(&cur_task->cond);
+    }
+    return cur_task;
+}
+
+void xTaskNotifyGive(TaskHandle_t task){
+    host_task_t *t = task;
+    pthread_mutex_lock(&t->lock);
+    t->count++;
+    pthread_cond_broadcast(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken){
+    xTaskNotifyGive(task);
+    if(woken != NULL) *woken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks){
+    host_task_t *t = xTaskGetCurrentTaskHandle();
+    pthread_mutex_lock(&t->lock);
+    WAIT_UNTIL(&t->cond, &t->lock, ticks, t->count > 0);
+    uint32_t ret = t->count;
+    if(ret > 0) t->count = clear ? 0 : ret - 1;
+    pthread_mutex_unlock(&t->lock);
+    return ret;
+}
+
+/* ---------------------------------------------------------------- mutex */
+
+struct host_sem {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool taken;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void){
+    struct host_sem *s = calloc(1, sizeof(*s));
+    if(s == NULL) return NULL;
+    pthread_mutex_init(&s->lock, NULL);
+    cond_init_monotonic(&s->cond);
+    return s;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks){
+    pthread_mutex_lock(&sem->lock);
+    WAIT_UNTIL(&sem->cond, &sem->lock, ticks, !sem->taken);
+    BaseType_t ok = !sem->taken;
+    if(ok) sem->taken = true;
+    pthread_mutex_unlock(&sem->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem){
+    pthread_mutex_lock(&sem->lock);
+    sem->taken = false;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->lock);
+    return pdTRUE;
+}
+
+/* ---------------------------------------------------------------- event groups */
+
+struct host_event_group {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void){
+    struct host_event_group *g = calloc(1, sizeof(*g));
+    if(g == NULL) return NULL;
+    pthread_mutex_init(&g->lock, NULL);
+    cond_init_monotonic(&g->cond);
+    return g;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group){
+    if(group == NULL) return;
+    pthread_mutex_destroy(&group->lock);
+    pthread_cond_destroy(&group->cond);
+    free(group);
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits){
+    pthread_mutex_lock(&group->lock);
+    group->bits |= bits;
+    EventBits_t ret = group->bits;
+    pthread_cond_broadcast(&group->cond);
+    pthread_mutex_unlock(&group->lock);
+    return ret;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear, BaseType_t all, TickType_t ticks){
+    pthread_mutex_lock(&group->lock);
+    WAIT_UNTIL(&group->cond, &group->lock, ticks, all ? ((group->bits & bits) == bits) : ((group->bits & bits) != 0));
+    EventBits_t ret = group->bits;
+    bool met = all ? ((ret & bits) == bits) : ((ret & bits) != 0);
+    if(met && clear) group->bits &= ~bits;
+    pthread_mutex_unlock(&group->lock);
+    return ret;
+}
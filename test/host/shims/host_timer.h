@@ -0,0 +1,23 @@
+/**
+ * @file host_timer.h
+ * @brief Reloj manual de esp_timer para los tests nativos
+ *
+ * En modo manual esp_timer_get_time() (y con él xTaskGetTickCount()) sólo
+ * avanza con host_timer_advance(), para que los tests de timeouts y marcas
+ * de tiempo sean determinísticos. Las esperas con timeout siguen usando el
+ * reloj real.
+ */
+
+#ifndef HOST_TIMER_H
+#define HOST_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Activa (true) o desactiva el reloj manual; al activarlo conserva la hora actual */
+void host_timer_manual(bool on);
+
+/** @brief Avanza el reloj manual us microsegundos */
+void host_timer_advance(int64_t us);
+
+#endif // HOST_TIMER_H
@@ -0,0 +1,14 @@
+/**
+ * @file nvs.h
+ * @brief Shim vacío de NVS para el build nativo (test/host)
+ *
+ * nvs_config.h lo incluye pero sólo declara funciones propias; los tests
+ * que lo necesitan proveen esas funciones.
+ */
+
+#ifndef HOST_NVS_H
+#define HOST_NVS_H
+
+#include "esp_err.h"
+
+#endif // HOST_NVS_H
@@ -0,0 +1,11 @@
+/**
+ * @file nvs_flash.h
+ * @brief Shim vacío de nvs_flash para el build nativo (test/host)
+ */
+
+#ifndef HOST_NVS_FLASH_H
+#define HOST_NVS_FLASH_H
+
+#include "nvs.h"
+
+#endif // HOST_NVS_FLASH_H
@@ -0,0 +1,39 @@
+/**
+ * @file stubs_state.c
+ * @brief Dependencias de state.c fuera del núcleo de medición, para los tests nativos
+ *
+ * Registran las llamadas para que los tests verifiquen qué pidió guardar
+ * el estado, sin NVS ni particiones.
+ */
+
+#include "stubs_state.h"
+#include <string.h>
+
+stub_state_calls_t stub_state_calls;
+
+void persist_energy(const energy_regs_t *regs, const load_energy_t *loads){
+    stub_state_calls.persist_energy++;
+    stub_state_calls.last_regs = *regs;
+}
+
+void history_add(const measure_t *m){
+    stub_state_calls.history_add++;
+}
+
+bool energy_log_latest(energy_regs_t *regs, load_energy_t *loads){
+    return false;
+}
+
+bool energy_log_is_ready(){
+    return false;
+}
+
+bool nvs_load_energy(energy_regs_t *regs){
+    memset(regs, 0, sizeof(*regs));
+    return false;
+}
+
+bool nvs_load_load_energy(load_energy_t *regs){
+    memset(regs, 0, sizeof(*regs));
+    return false;
+}
@@ -0,0 +1,23 @@
+/**
+ * @file stubs_state.h
+ * @brief Registro de llamadas de las dependencias simuladas de state.c
+ */
+
+#ifndef STUBS_STATE_H
+#define STUBS_STATE_H
+
+#include "app/state.h"
+#include "core/persist.h"
+#include "core/energy_log.h"
+#include "core/nvs_config.h"
+#include "app/history.h"
+
+typedef struct {
+    uint32_t persist_energy;    /**< Llamadas a persist_energy() */
+    uint32_t history_add;       /**< Llamadas a history_add() */
+    energy_regs_t last_regs;    /**< Último registro pedido a persist_energy() */
+} stub_state_calls_t;
+
+extern stub_state_calls_t stub_state_calls;
+
+#endif // STUBS_STATE_H
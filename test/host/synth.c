@@ -0,0 +1,103 @@
+/**
+ * @file synth.c
+ * @brief Generador determinístico de formas de onda para los tests nativos
+ */
+
+#include "synth.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+void synth_cfg_default(synth_cfg_t *cfg){
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->f_hz = 50.0;
+    cfg->v1_rms = 230.0;
+    cfg->i1_rms = 2.0;
+    cfg->phi_deg = 30.0;
+    cfg->skew_pairs = 1.0 / ADC_PATTERN_LEN;
+    cfg->v_gain = VOLT_DRIVER_GAIN;
+    cfg->i_sens = ACS712_5A_SENSITIVITY;
+    cfg->seed = 12345;
+}
+
+void synth_init(synth_t *s, const synth_cfg_t *cfg){
+    s->cfg = *cfg;
+    s->n = 0;
+    s->rng = cfg->seed;
+}
+
+/* Uniforme en [-1, 1) */
+static double synth_rand(synth_t *s){
+    s->rng = s->rng * 1664525u + 1013904223u;
+    return (double)(s->rng >> 8) / (double)(1u << 23) - 1.0;
+}
+
+/* Señal de línea (sin escalar) en t segundos */
+static double synth_wave(double t, double f, double amp_rms, const double *h, double phi_rad){
+    double w = 2.0 * M_PI * f * t;
+    double x = sin(w - phi_rad);
+    for(int k = 1; k < HARM_NUM; k++){
+        if(h[k] != 0.0) x += h[k] * sin((k + 1) * (w - phi_rad));
+    }
+    return sqrt(2.0) * amp_rms * x;
+}
+
+static int16_t synth_round(double mv){
+    return (int16_t)lround(mv);
+}
+
+void synth_next(synth_t *s, int16_t *v_mv, int16_t *i_mv){
+    const synth_cfg_t *c = &s->cfg;
+    double t_v = (double)s->n / SAMPLE_FREQ_HZ;
+    double t_i = ((double)s->n + c->skew_pairs) / SAMPLE_FREQ_HZ;
+    double phi = c->phi_deg * M_PI / 180.0;
+
+    double v = synth_wave(t_v, c->f_hz, c->v1_rms, c->v_h, 0.0);
+    double i = synth_wave(t_i, c->f_hz, c->i1_rms, c->i_h, phi);
+
+    double nv = (c->noise_mv > 0.0) ? synth_rand(s) * c->noise_mv : 0.0;
+    double ni = (c->noise_mv > 0.0) ? synth_rand(s) * c->noise_mv : 0.0;
+    *v_mv = synth_round(SYNTH_V_DC_MV + v * c->v_gain * 1000.0 + nv);
+    *i_mv = synth_round(SYNTH_I_DC_MV + i * c->i_sens * 1000.0 + ni);
+    s->n++;
+}
+
+void synth_truth(const synth_cfg_t *cfg, synth_truth_t *out){
+    double sv = 1.0, si = 1.0, hv = 0.0, hi = 0.0, p = 1.0;
+    double phi = cfg->phi_deg * M_PI / 180.0;
+
+    p = cos(phi);
+    for(int k = 1; k < HARM_NUM; k++){
+        hv += cfg->v_h[k] * cfg->v_h[k];
+        hi += cfg->i_h[k] * cfg->i_h[k];
+        p += cfg->v_h[k] * cfg->i_h[k] * cos((k + 1) * phi);
+    }
+    sv += hv;
+    si += hi;
+
+    out->Vrms = cfg->v1_rms * sqrt(sv);
+    out->Irms = cfg->i1_rms * sqrt(si);
+    out->P = cfg->v1_rms * cfg->i1_rms * p;
+    out->Q1 = cfg->v1_rms * cfg->i1_rms * sin(phi);
+    out->fp = fabs(out->P) / (out->Vrms * out->Irms);
+    out->f = cfg->f_hz;
+    out->thd_v = 100.0 * sqrt(hv);
+    out->thd_i = 100.0 * sqrt(hi);
+}
+
+uint16_t synth_mv_to_raw(const int16_t *lut, int16_t mv){
+    int lo = 0, hi = 4095;
+    while(lo < hi){
+        int mid = (lo + hi) / 2;
+        if(lut[mid] < mv) lo = mid + 1;
+        else hi = mid;
+    }
+    if(lo > 0 && (mv - lut[lo - 1]) < (lut[lo] - mv)) lo--;
+    return (uint16_t)lo;
+}
+
+uint64_t synth_now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
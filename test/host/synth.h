@@ -0,0 +1,94 @@
+/**
+ * @file synth.h
+ * @brief Generador determinístico de formas de onda para los tests nativos
+ *
+ * Produce las muestras en mV que recibe measure_add_sample() a partir de
+ * una red de valores conocidos, con el mismo modelo de señal que el
+ * hardware:
+ *
+ * - v_mv = SYNTH_V_DC_MV + v(t) · v_gain · 1000 (divisor con ganancia negativa)
+ * - i_mv = SYNTH_I_DC_MV + i(t) · i_sens · 1000 (ACS712)
+ * - I se convierte skew pares después que V (ADC_PATTERN_LEN slots por par)
+ * - Armónicos: v = √2·V1·Σ a_h·sin(h·ωt), i = √2·I1·Σ b_h·sin(h·(ωt - φ))
+ * - Ruido uniforme ±noise_mv (LCG con semilla fija) y redondeo a 1 mV
+ *
+ * synth_truth() da los valores exactos de la señal continua, contra los
+ * que se comparan los resultados.
+ */
+
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app/measure.h"
+#include "app/harmonics.h"
+
+/** @brief DC de la tensión en el pin del ADC [mV] */
+#define SYNTH_V_DC_MV 1650.0
+
+/** @brief DC de la corriente en el pin del ADC [mV] */
+#define SYNTH_I_DC_MV 2500.0
+
+/**
+ * @brief Parámetros de la señal
+ */
+typedef struct {
+    double f_hz;                /**< Frecuencia de red [Hz] */
+    double v1_rms;              /**< Tensión fundamental [V] */
+    double i1_rms;              /**< Corriente fundamental [A] */
+    double phi_deg;             /**< Atraso de la corriente fundamental [°] */
+    double v_h[HARM_NUM];       /**< Amplitud relativa a la fundamental por orden (índice = orden - 1; [0] se ignora) */
+    double i_h[HARM_NUM];       /**< Ídem para la corriente */
+    double noise_mv;            /**< Ruido uniforme ±noise_mv en cada canal [mV] */
+    double skew_pairs;          /**< Atraso de la conversión de I respecto de V [pares] */
+    double v_gain;              /**< Ganancia del divisor de tensión [V/V] */
+    double i_sens;              /**< Sensibilidad del sensor de corriente [V/A] */
+    uint32_t seed;              /**< Semilla del ruido */
+} synth_cfg_t;
+
+/**
+ * @brief Estado del generador
+ */
+typedef struct {
+    synth_cfg_t cfg;
+    uint64_t n;                 /**< Pares generados */
+    uint32_t rng;
+} synth_t;
+
+/**
+ * @brief Valores exactos de la señal continua
+ */
+typedef struct {
+    double Vrms;
+    double Irms;
+    double P;
+    double Q1;                  /**< Reactiva de la fundamental [var] */
+    double fp;                  /**< P / (Vrms·Irms) */
+    double f;
+    double thd_v;               /**< [%] */
+    double thd_i;               /**< [%] */
+} synth_truth_t;
+
+/** @brief Configuración de referencia: 50 Hz, 230 V, 2 A, φ = 30°, sin armónicos ni ruido, calibración por defecto */
+void synth_cfg_default(synth_cfg_t *cfg);
+
+void synth_init(synth_t *s, const synth_cfg_t *cfg);
+
+/** @brief Próximo par en mV (con el redondeo del decodificador) */
+void synth_next(synth_t *s, int16_t *v_mv, int16_t *i_mv);
+
+/** @brief Valores exactos de cfg */
+void synth_truth(const synth_cfg_t *cfg, synth_truth_t *out);
+
+/**
+ * @brief Cuenta cruda cuya conversión por lut más se acerca a mv
+ *
+ * @param lut Tabla raw→mV creciente (ADC_MAX_COUNT+1 entradas)
+ */
+uint16_t synth_mv_to_raw(const int16_t *lut, int16_t mv);
+
+/** @brief Tiempo monotónico del host [ns] */
+uint64_t synth_now_ns(void);
+
+#endif // SYNTH_H
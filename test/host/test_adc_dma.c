@@ -0,0 +1,119 @@
+/**
+ * @file test_adc_dma.c
+ * @brief Reconfiguración del driver continuo con fallas inyectadas (adc_dma.c sobre shims/host_adc.c)
+ *
+ * Ninguna falla del driver durante app_adc_dma_set_config() puede abortar:
+ * se vuelve a la configuración anterior, queda registrada en la telemetría
+ * y la lectura sigue. Si ni la anterior abre, las lecturas devuelven
+ * ESP_ERR_INVALID_STATE hasta que un reintento la reabre.
+ */
+
+#include "host_test.h"
+#include "host_adc.h"
+#include "hal/adc_dma.h"
+#include <string.h>
+
+/* Completa un frame y lo lee; retorna los bytes del frame (0 si no hubo) */
+static uint32_t read_one(esp_err_t *ret_out){
+    const uint8_t *f;
+    uint32_t n = 0;
+    host_adc_complete(1);
+    esp_err_t ret = app_adc_dma_get_frame(&f, &n, 0);
+    if(ret == ESP_OK) app_adc_dma_release_frame();
+    if(ret_out != NULL) *ret_out = ret;
+    return (ret == ESP_OK) ? n : 0;
+}
+
+/* Pide frame_bytes y corre una lectura para que se aplique */
+static esp_err_t request_frame(uint32_t frame_bytes){
+    adc_dma_cfg_t cfg;
+    esp_err_t ret;
+    app_adc_dma_get_config(&cfg);
+    cfg.frame_bytes = frame_bytes;
+    CHECK(app_adc_dma_set_config(&cfg));
+    read_one(&ret);
+    return ret;
+}
+
+static void check_live(uint32_t frame_bytes){
+    host_adc_stats_t hs;
+    adc_dma_stats_t st;
+    host_adc_get_stats(&hs);
+    app_adc_dma_get_stats(&st);
+    CHECK_EQ_INT(hs.handles, 1);
+    CHECK(hs.started);
+    CHECK_EQ_INT(hs.frame_bytes, frame_bytes);
+    CHECK_EQ_INT(st.frame_bytes, frame_bytes);
+    CHECK_EQ_INT(read_one(NULL), frame_bytes);
+}
+
+int main(void){
+    adc_dma_stats_t st;
+
+    host_adc_reset();
+    app_adc_init_calibration();
+    app_adc_dma_init();
+    app_adc_dma_start_conv();
+    check_live(FRAME_BYTES);
+
+    // la configuración nueva no abre: vuelve a la anterior
+    host_adc_fail_frame_bytes(HOST_ADC_OP_CONFIG, 512, ESP_ERR_INVALID_ARG);
+    request_frame(512);
+    app_adc_dma_get_stats(&st);
+    CHECK_EQ_INT(st.reinits, 0);
+    CHECK_EQ_INT(st.reinit_errors, 1);
+    CHECK_EQ_INT(st.last_err, ESP_ERR_INVALID_ARG);
+    check_live(FRAME_BYTES);
+
+    // falla al arrancar la nueva
+    host_adc_reset();
+    host_adc_fail_frame_bytes(HOST_ADC_OP_START, 512, ESP_ERR_TIMEOUT);
+    request_frame(512);
+    app_adc_dma_get_stats(&st);
+    CHECK_EQ_INT(st.reinit_errors, 2);
+    CHECK_EQ_INT(st.last_err, ESP_ERR_TIMEOUT);
+    check_live(FRAME_BYTES);
+
+    // sin fallas se aplica
+    host_adc_reset();
+    request_frame(512);
+    app_adc_dma_get_stats(&st);
+    CHECK_EQ_INT(st.reinits, 1);
+    check_live(512);
+
+    // el driver no se deja liberar: sigue el handle anterior, convirtiendo
+    host_adc_fail(HOST_ADC_OP_DEINIT, ESP_FAIL, 1);
+    request_frame(768);
+    app_adc_dma_get_stats(&st);
+    CHECK_EQ_INT(st.reinit_errors, 3);
+    CHECK_EQ_INT(st.last_err, ESP_FAIL);
+    check_live(512);
+
+    host_adc_fail(HOST_ADC_OP_STOP, ESP_ERR_INVALID_STATE, 1);
+    request_frame(768);
+    app_adc_dma_get_stats(&st);
+    CHECK_EQ_INT(st.reinit_errors, 4);
+    check_live(512);
+
+    // no abre ni la nueva ni la anterior: lecturas en error hasta que reabre
+    host_adc_fail(HOST_ADC_OP_NEW_HANDLE, ESP_ERR_NO_MEM, 2);
+    esp_err_t ret = request_frame(768);
+    CHECK_EQ_INT(ret, ESP_ERR_INVALID_STATE);
+    app_adc_dma_get_stats(&st);
+    CHECK_EQ_INT(st.reinit_errors, 6);
+    CHECK_EQ_INT(st.last_err, ESP_ERR_NO_MEM);
+    CHECK_EQ_INT(st.ring_bytes, 0);
+    CHECK_EQ_INT(st.frame_bytes, 0);
+    host_adc_stats_t hs;
+    host_adc_get_stats(&hs);
+    CHECK_EQ_INT(hs.handles, 0);
+
+    // el próximo intento abre con la última que funcionó (el frame completado sin driver no existe)
+    read_one(&ret);
+    CHECK_EQ_INT(ret, ESP_ERR_TIMEOUT);
+    check_live(512);
+
+    app_adc_dma_get_stats(&st);
+    printf("reinits %u, pasos fallidos %u, último error %s\n", st.reinits, st.reinit_errors, esp_err_to_name(st.last_err));
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,223 @@
+/**
+ * @file test_adc_frame.c
+ * @brief Conversión raw→mV y decodificación de frames contra sus versiones muestra a muestra
+ *
+ * app_adc_init_calibration() (adc_dma.c) llena la tabla con el esquema de
+ * calibración simulado; cada entrada debe coincidir con la conversión por
+ * llamada, y sin esquema debe quedar la recta nominal.
+ *
+ * adc_frame_decode() debe dar los mismos pares y contadores que el
+ * emparejamiento muestra a muestra, también con canales inválidos, muestras
+ * perdidas o repetidas y frames de longitud impar. Se informa el costo por
+ * muestra o par de cada camino.
+ *
+ *   test_adc_frame [--quick]
+ */
+
+#include "host_test.h"
+#include "host_adc.h"
+#include "synth.h"
+#include "hal/adc_dma.h"
+#include "app/adc_frame.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Evita que el compilador descarte resultados */
+static volatile int32_t sink;
+
+static void test_lut_matches_cali(void){
+    host_adc_reset();
+    CHECK(app_adc_init_calibration());
+    CHECK(app_adc_is_calibrated());
+
+    const int16_t *lut = app_adc_get_cal_lut();
+    int max_err = 0;
+    for(int raw = 0; raw <= ADC_MAX_COUNT; raw++){
+        int mv = 0;
+        CHECK_EQ_INT(app_adc_get_voltage(raw, &mv), ESP_OK);
+        int err = abs(lut[raw] - mv);
+        if(err > max_err) max_err = err;
+    }
+    CHECK_EQ_INT(max_err, 0);
+
+    // monótona y dentro del rango de la atenuación configurada
+    for(int raw = 1; raw <= ADC_MAX_COUNT; raw++) CHECK(lut[raw] >= lut[raw - 1]);
+    CHECK(lut[0] > 0);
+    CHECK(lut[ADC_MAX_COUNT] > 2500 && lut[ADC_MAX_COUNT] < 3600);
+    printf("tabla raw→mV: error máximo %d mV, %d..%d mV\n", max_err, lut[0], lut[ADC_MAX_COUNT]);
+}
+
+static void test_lut_fallback(void){
+    host_adc_reset();
+    host_adc_fail(HOST_ADC_OP_CALI_CREATE, ESP_ERR_NOT_SUPPORTED, 1);
+    CHECK(!app_adc_init_calibration());
+    CHECK(!app_adc_is_calibrated());
+
+    const int16_t *lut = app_adc_get_cal_lut();
+    CHECK_EQ_INT(lut[0], 0);
+    CHECK_EQ_INT(lut[ADC_MAX_COUNT], ADC_FALLBACK_FULL_SCALE_MV);
+    CHECK_EQ_INT(lut[2048], 2048 * ADC_FALLBACK_FULL_SCALE_MV / ADC_MAX_COUNT);
+    host_adc_reset();
+}
+
+static void bench_lut(uint32_t samples){
+    host_adc_reset();
+    app_adc_init_calibration();
+    const int16_t *lut = app_adc_get_cal_lut();
+
+    int32_t acc = 0;
+    uint64_t t0 = synth_now_ns();
+    for(uint32_t k = 0; k < samples; k++){
+        int mv;
+        if(app_adc_get_voltage((int)((k * 37u) & ADC_MAX_COUNT), &mv) == ESP_OK) acc += mv;
+    }
+    uint64_t t1 = synth_now_ns();
+    int32_t acc_lut = 0;
+    for(uint32_t k = 0; k < samples; k++){
+        acc_lut += lut[(k * 37u) & ADC_MAX_COUNT];
+    }
+    uint64_t t2 = synth_now_ns();
+
+    CHECK_EQ_INT(acc_lut, acc);
+    sink = acc + acc_lut;
+    printf("adc_cali_raw_to_voltage %6.2f ns/muestra, tabla %6.2f ns/muestra\n",
+           (double)(t1 - t0) / samples, (double)(t2 - t1) / samples);
+}
+
+/* ---------------------------------------------------------------- decodificación */
+
+/* Emparejamiento muestra a muestra: el bucle de task_adc_acquisition anterior a adc_frame_decode() */
+typedef struct {
+    bool have_v;
+    int16_t v_pending;
+    uint32_t invalid;
+    uint32_t unpaired;
+} ref_decoder_t;
+
+static size_t ref_decode(ref_decoder_t *r, const int16_t *lut, const uint16_t *samples, size_t bytes,
+                         int16_t *v_mv, int16_t *i_mv){
+    size_t n = 0;
+    for(size_t k = 0; k < bytes / ADC_FRAME_SAMPLE_BYTES; k++){
+        uint8_t ch = samples[k] >> 12;
+        int16_t mv = lut[samples[k] & ADC_MAX_COUNT];
+        if(ch == ADC_CH_V){
+            if(r->have_v) r->unpaired++;
+            r->v_pending = mv;
+            r->have_v = true;
+        } else if(ch == ADC_CH_I){
+            if(!r->have_v){
+                r->unpaired++;
+                continue;
+            }
+            v_mv[n] = r->v_pending;
+            i_mv[n] = mv;
+            n++;
+            r->have_v = false;
+        } else {
+            r->invalid++;
+            if(r->have_v) r->unpaired++;
+            r->have_v = false;
+        }
+    }
+    return n;
+}
+
+static uint32_t rng_state = 12345;
+static uint32_t rng(void){
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+/* Frame (V,I) alternado con errores inyectados; retorna los bytes escritos */
+static size_t make_frame(uint16_t *samples, bool faults){
+    size_t n = 0;
+    size_t max = FRAME_BYTES / ADC_FRAME_SAMPLE_BYTES;
+    // algunos frames empiezan con una I (V pendiente del frame anterior)
+    bool next_v = !(faults && (rng() % 8 == 0));
+    while(n < max){
+        uint16_t raw = (uint16_t)(rng() & ADC_MAX_COUNT);
+        uint8_t ch = next_v ? ADC_CH_V : ADC_CH_I;
+        next_v = !next_v;
+        if(faults){
+            uint32_t r = rng() % 1000;
+            if(r < 4) ch = 9;                           // canal desconocido
+            else if(r < 8) next_v = !next_v;            // muestra perdida: se repite el canal
+            else if(r < 10) ch = ADC_CHANNEL_5;         // canal del ADC fuera del par V,I
+        }
+        samples[n++] = (uint16_t)(((uint16_t)ch << 12) | raw);
+    }
+    // longitud impar en muestras o frame corto
+    if(faults){
+        uint32_t r = rng() % 8;
+        if(r == 0) n--;
+        else if(r == 1) n = 1 + rng() % (max - 1);
+    }
+    return n * ADC_FRAME_SAMPLE_BYTES;
+}
+
+static void test_decode_matches_ref(uint32_t frames){
+    static int16_t lut[ADC_MAX_COUNT + 1];
+    static uint32_t words[FRAME_BYTES / sizeof(uint32_t)];
+    static int16_t v[ADC_FRAME_MAX_PAIRS + 1], i[ADC_FRAME_MAX_PAIRS + 1];
+    static int16_t rv[ADC_FRAME_MAX_PAIRS + 1], ri[ADC_FRAME_MAX_PAIRS + 1];
+    adc_frame_decoder_t dec;
+    ref_decoder_t ref = {0};
+
+    for(int k = 0; k <= ADC_MAX_COUNT; k++) lut[k] = (int16_t)(k * 3 - 2000);
+    adc_frame_decoder_init(&dec, ADC_CH_V, ADC_CH_I, lut);
+
+    uint64_t pairs = 0;
+    uint32_t mismatched = 0;
+    for(uint32_t f = 0; f < frames; f++){
+        size_t bytes = make_frame((uint16_t*)words, (f % 4) != 0);
+        size_t n = adc_frame_decode(&dec, words, bytes, v, i);
+        size_t rn = ref_decode(&ref, lut, (const uint16_t*)words, bytes, rv, ri);
+        if(n != rn || memcmp(v, rv, n * sizeof(int16_t)) != 0 || memcmp(i, ri, n * sizeof(int16_t)) != 0){
+            if(mismatched++ == 0) printf("frame %u: %zu pares, referencia %zu\n", f, n, rn);
+        }
+        pairs += rn;
+    }
+
+    CHECK_EQ_INT(mismatched, 0);
+    CHECK_EQ_INT(dec.invalid, ref.invalid);
+    CHECK_EQ_INT(dec.unpaired, ref.unpaired);
+    CHECK_EQ_INT(dec.have_v, ref.have_v);
+    CHECK(ref.invalid > 0 && ref.unpaired > 0);
+    printf("decodificación: %u frames, %llu pares, %u inválidas, %u sin par\n",
+           frames, (unsigned long long)pairs, ref.invalid, ref.unpaired);
+}
+
+static void bench_decode(uint32_t frames){
+    static int16_t lut[ADC_MAX_COUNT + 1];
+    static uint32_t words[FRAME_BYTES / sizeof(uint32_t)];
+    static int16_t v[ADC_FRAME_MAX_PAIRS + 1], i[ADC_FRAME_MAX_PAIRS + 1];
+    adc_frame_decoder_t dec;
+    ref_decoder_t ref = {0};
+
+    for(int k = 0; k <= ADC_MAX_COUNT; k++) lut[k] = (int16_t)k;
+    size_t bytes = make_frame((uint16_t*)words, false);
+    adc_frame_decoder_init(&dec, ADC_CH_V, ADC_CH_I, lut);
+
+    size_t pairs = 0, ref_pairs = 0;
+    uint64_t t0 = synth_now_ns();
+    for(uint32_t f = 0; f < frames; f++) ref_pairs += ref_decode(&ref, lut, (const uint16_t*)words, bytes, v, i);
+    uint64_t t1 = synth_now_ns();
+    for(uint32_t f = 0; f < frames; f++) pairs += adc_frame_decode(&dec, words, bytes, v, i);
+    uint64_t t2 = synth_now_ns();
+
+    CHECK_EQ_INT(pairs, ref_pairs);
+    sink = (int32_t)pairs + v[0];
+    printf("muestra a muestra %6.2f ns/par, adc_frame_decode %6.2f ns/par\n",
+           (double)(t1 - t0) / ref_pairs, (double)(t2 - t1) / pairs);
+}
+
+int main(int argc, char **argv){
+    bool quick = (argc > 1 && strcmp(argv[1], "--quick") == 0);
+
+    test_lut_matches_cali();
+    test_lut_fallback();
+    bench_lut(quick ? 200000 : 20000000);
+    test_decode_matches_ref(quick ? 2000 : 20000);
+    bench_decode(quick ? 200 : 20000);
+    return HOST_TEST_RESULT();
+}
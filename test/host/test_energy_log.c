@@ -0,0 +1,233 @@
+/**
+ * @file test_energy_log.c
+ * @brief Diario de energía sobre la flash simulada: desgaste, cortes de alimentación y fallas de lectura
+ *
+ * Cada "arranque" es host_flash_power_on() + energy_log_init(), como en el
+ * equipo. Los registros llevan un contador en E para saber cuál se recuperó.
+ */
+
+#include "host_test.h"
+#include "host_flash.h"
+#include "core/energy_log.h"
+#include <string.h>
+
+#define SECTORS 8
+#define RPS ((uint32_t)ENERGY_LOG_RECS_PER_SECTOR)
+
+static const esp_partition_t *part;
+
+static bool append_n(uint32_t value){
+    energy_regs_t regs;
+    load_energy_t loads;
+    memset(&regs, 0, sizeof(regs));
+    memset(&loads, 0, sizeof(loads));
+    regs.E = value;
+    regs.E_imp = value;
+    loads.E[0] = value;
+    return energy_log_append(&regs, &loads);
+}
+
+/* Valor recuperado por el último arranque, 0 si el diario quedó vacío */
+static uint32_t boot(energy_log_info_t *li){
+    energy_regs_t regs;
+    load_energy_t loads;
+    host_flash_power_on();
+    CHECK(energy_log_init());
+    energy_log_get_info(li);
+    if(!energy_log_latest(&regs, &loads)) return 0;
+    CHECK_NEAR(regs.E_imp, regs.E, 0.0);
+    CHECK_NEAR(loads.E[0], regs.E, 0.0);
+    return (uint32_t)regs.E;
+}
+
+/* Lecturas máximas de una recuperación sin fallas: dos búsquedas binarias, el retroceso y la verificación del lugar libre */
+static uint32_t boot_read_bound(void){
+    uint32_t b = 4;
+    for(uint32_t n = SECTORS; n > 1; n >>= 1) b++;
+    for(uint32_t n = RPS; n > 1; n >>= 1) b++;
+    return b + 2;
+}
+
+static void test_empty_and_resume(void){
+    energy_log_info_t li;
+    part = host_flash_create(ENERGY_LOG_PARTITION, SECTORS * HOST_FLASH_SECTOR, 0xFF, 0);
+
+    CHECK_EQ_INT(boot(&li), 0);
+    CHECK_EQ_INT(li.seq, 0);
+    CHECK_EQ_INT(li.next, 0);
+
+    for(uint32_t k = 1; k <= 10; k++) CHECK(append_n(k));
+    CHECK_EQ_INT(boot(&li), 10);
+    CHECK_EQ_INT(li.seq, 10);
+    CHECK_EQ_INT(li.boot_torn, 0);
+    CHECK(li.boot_reads <= boot_read_bound());
+
+    // apagado limpio: sigue en el mismo sector, sin borrar otro
+    CHECK_EQ_INT(li.next, 10);
+    CHECK(append_n(11));
+    CHECK_EQ_INT(boot(&li), 11);
+    CHECK_EQ_INT(li.next, 11);
+    CHECK_EQ_INT(host_flash_erase_count(part, 1), 0);
+
+    // sector lleno: sigue en el siguiente
+    for(uint32_t k = 12; k <= RPS; k++) CHECK(append_n(k));
+    CHECK_EQ_INT(boot(&li), RPS);
+    CHECK_EQ_INT(li.next, RPS);
+
+    // basura inicial: diario vacío, y se puede escribir
+    part = host_flash_create(ENERGY_LOG_PARTITION, SECTORS * HOST_FLASH_SECTOR, 0, 2025);
+    CHECK_EQ_INT(boot(&li), 0);
+    CHECK(append_n(7));
+    CHECK_EQ_INT(boot(&li), 7);
+}
+
+/**
+ * Desgaste: muchas vueltas con arranques intercalados
+ *
+ * Los arranques con cierre limpio no abandonan sectores, así que los
+ * borrados quedan parejos y en la cantidad mínima.
+ */
+static void test_wear(void){
+    energy_log_info_t li;
+    part = host_flash_create(ENERGY_LOG_PARTITION, SECTORS * HOST_FLASH_SECTOR, 0xFF, 0);
+    boot(&li);
+
+    const uint32_t total = SECTORS * RPS * 20 + RPS / 3;
+    uint32_t max_reads = 0;
+    for(uint32_t k = 1; k <= total; k++){
+        CHECK(append_n(k));
+        if(k % 97 == 0){
+            CHECK_EQ_INT(boot(&li), k);
+            CHECK_EQ_INT(li.seq, k);
+            if(li.boot_reads > max_reads) max_reads = li.boot_reads;
+        }
+    }
+    CHECK_EQ_INT(boot(&li), total);
+    CHECK(max_reads <= boot_read_bound());
+
+    uint32_t min_e = UINT32_MAX, max_e = 0, sum_e = 0;
+    for(uint32_t s = 0; s < SECTORS; s++){
+        uint32_t e = host_flash_erase_count(part, s);
+        if(e < min_e) min_e = e;
+        if(e > max_e) max_e = e;
+        sum_e += e;
+    }
+    CHECK(max_e - min_e <= 1);
+    CHECK_EQ_INT(sum_e, (total + RPS - 1) / RPS);
+    printf("desgaste: %u registros, borrados por sector %u..%u, %u lecturas máx. por arranque\n",
+           total, min_e, max_e, max_reads);
+}
+
+/**
+ * Corte de alimentación en cada byte de una escritura y en borrados
+ *
+ * Después del corte se recupera el último registro escrito entero, la
+ * secuencia sigue avanzando y el diario sigue funcionando en las vueltas
+ * siguientes.
+ */
+static void test_power_cut(void){
+    energy_log_info_t li;
+    uint32_t cuts = 0, torn_boots = 0;
+
+    for(uint32_t pos = 0; pos < 3 * RPS; pos += 7){
+        for(uint32_t b = 0; b < sizeof(energy_log_rec_t); b += 5){
+            part = host_flash_create(ENERGY_LOG_PARTITION, SECTORS * HOST_FLASH_SECTOR, 0xFF, 0);
+            boot(&li);
+
+            uint32_t ok = 0;
+            for(uint32_t k = 1; k <= pos; k++){
+                if(append_n(k)) ok = k;
+            }
+            // corta a mitad del registro pos+1 (o a mitad del borrado si empieza sector)
+            uint32_t extra = ((pos % RPS) == 0) ? HOST_FLASH_SECTOR / 2 + b : b;
+            host_flash_cut_after(extra);
+            CHECK(!append_n(pos + 1));
+            CHECK(host_flash_is_cut());
+            cuts++;
+
+            uint32_t got = boot(&li);
+            CHECK_EQ_INT(got, ok);
+            CHECK(li.seq >= ok);
+            if(li.boot_torn > 0) torn_boots++;
+
+            // sigue escribiendo y vuelve a recuperar, también después de dar la vuelta
+            uint32_t last_seq = li.seq;
+            for(uint32_t k = 1; k <= SECTORS * RPS + 3; k++) CHECK(append_n(1000 + k));
+            CHECK_EQ_INT(boot(&li), 1000 + SECTORS * RPS + 3);
+            CHECK_EQ_INT(li.seq, last_seq + SECTORS * RPS + 3);
+        }
+    }
+    CHECK(torn_boots > 0);
+    printf("cortes: %u, %u arranques con registro roto\n", cuts, torn_boots);
+}
+
+/**
+ * Fallas de lectura durante la recuperación
+ *
+ * - Último registro ilegible: retrocede al anterior y sigue en el sector siguiente.
+ * - Cabeza entera ilegible: el retroceso se detiene en el lugar 0 y usa el
+ *   último registro del sector anterior, sin que la secuencia retroceda.
+ */
+static void test_read_faults(void){
+    energy_log_info_t li;
+    uint32_t n = RPS + 5;   // cabeza: sector 1, lugares 0..4
+
+    part = host_flash_create(ENERGY_LOG_PARTITION, SECTORS * HOST_FLASH_SECTOR, 0xFF, 0);
+    boot(&li);
+    for(uint32_t k = 1; k <= n; k++) CHECK(append_n(k));
+
+    host_flash_power_on();
+    host_flash_fail_read(part, HOST_FLASH_SECTOR + 4 * sizeof(energy_log_rec_t) + 8, 0);
+    CHECK(energy_log_init());
+    energy_log_get_info(&li);
+    energy_regs_t regs;
+    load_energy_t loads;
+    CHECK(energy_log_latest(&regs, &loads));
+    CHECK_NEAR(regs.E, n - 1, 0.0);
+    CHECK_EQ_INT(li.boot_torn, 1);
+    CHECK_EQ_INT(li.seq, n - 1);
+    CHECK_EQ_INT(li.next, 2 * RPS);
+
+    // sin la falla el registro n sigue ahí; el nuevo va en el sector 2 con secuencia mayor
+    CHECK(append_n(n + 1));
+    CHECK_EQ_INT(boot(&li), n + 1);
+
+    // cabeza con un solo registro que se lee bien en la búsqueda y falla después
+    part = host_flash_create(ENERGY_LOG_PARTITION, SECTORS * HOST_FLASH_SECTOR, 0xFF, 0);
+    boot(&li);
+    for(uint32_t k = 1; k <= RPS + 1; k++) CHECK(append_n(k));
+    host_flash_power_on();
+    host_flash_fail_read(part, HOST_FLASH_SECTOR + 8, 1);
+    CHECK(energy_log_init());
+    energy_log_get_info(&li);
+    CHECK(energy_log_latest(&regs, &loads));
+    CHECK_NEAR(regs.E, RPS, 0.0);
+    CHECK_EQ_INT(li.seq, RPS + 1);
+    CHECK_EQ_INT(li.next, 2 * RPS);
+    CHECK(li.boot_reads <= boot_read_bound() + 1);
+
+    CHECK(append_n(RPS + 2));
+    energy_log_get_info(&li);
+    CHECK_EQ_INT(li.seq, RPS + 2);
+    CHECK_EQ_INT(boot(&li), RPS + 2);
+
+    // cabeza ilegible y sector anterior vacío: diario vacío, secuencia conservada
+    part = host_flash_create(ENERGY_LOG_PARTITION, SECTORS * HOST_FLASH_SECTOR, 0xFF, 0);
+    boot(&li);
+    CHECK(append_n(1));
+    host_flash_power_on();
+    host_flash_fail_read(part, 8, 1);
+    CHECK(energy_log_init());
+    energy_log_get_info(&li);
+    CHECK(!energy_log_latest(&regs, &loads));
+    CHECK_EQ_INT(li.seq, 1);
+    CHECK_EQ_INT(li.next, RPS);
+}
+
+int main(void){
+    test_empty_and_resume();
+    test_wear();
+    test_power_cut();
+    test_read_faults();
+    return HOST_TEST_RESULT();
+}
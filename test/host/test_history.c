@@ -0,0 +1,418 @@
+/**
+ * @file test_history.c
+ * @brief Anillos de minutos y horas del historial sobre la flash simulada
+ *
+ * Incluye history.c (como kernel_variant.c con measure.c) para encolar
+ * puntos con t elegido y volver a cero el estado estático en cada
+ * "arranque" (host_flash_power_on() + history_init()). Los puntos son
+ * consecutivos: el punto k de un nivel tiene t = T0 + k·período.
+ *
+ * Cada valor leído debe quedar dentro del error que admite el delta escalado:
+ * a lo sumo 1/127,5 de la mayor diferencia de su grupo (el promedio, o mín y
+ * máx del campo) contra el punto anterior, más el error de ese punto (0 en
+ * las claves). Una consulta entrega, en orden, todos los
+ * puntos escritos desde el más viejo que el anillo conserva.
+ */
+
+#include "host_test.h"
+#include "host_flash.h"
+#include "../../src/app/history.c"
+
+/* El test escribe con history_flush() */
+void persist_history(){
+}
+
+#define SECTORS 12                                  // 6 de minutos y 6 de horas
+#define RING_SECTORS (SECTORS / 2)
+#define PTS_PER_SECTOR (SLOTS_PER_SECTOR - 1)       // una clave de dos lugares y deltas
+#define MAXK 4096
+#define T0 1000000u
+
+enum { PROFILE_STEADY, PROFILE_VARIABLE, PROFILE_EXTREME };
+
+/* Lo escrito en cada nivel */
+typedef struct {
+    hist_point_t p[MAXK];
+    float tol[MAXK][HIST_VALUES];       // error admitido de cada valor
+    bool written[MAXK];
+    int32_t last;                       // último k escrito (-1: ninguno)
+} model_t;
+
+static model_t model[HIST_TIERS];
+static bool seen[MAXK];
+static const esp_partition_t *hpart;
+static uint32_t profile;
+static uint32_t vals_total, vals_exact;     // valores leídos y cuántos sin error
+static float worst_p;                       // mayor error del promedio de P [W]
+
+static uint32_t hash(uint32_t x){
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static uint32_t period_of(hist_tier_t tier){
+    return (tier == HIST_TIER_MIN) ? 60 : 3600;
+}
+
+static void set_field(hist_point_t *p, hist_field_t f, int32_t avg, int32_t spread){
+    p->avg[f] = clamp_q(avg);
+    p->min[f] = clamp_q(avg - spread);
+    p->max[f] = clamp_q(avg + spread);
+}
+
+/* Punto k: tensión y frecuencia estables; la carga según el perfil */
+static void gen(hist_tier_t tier, uint32_t k, hist_point_t *p){
+    uint32_t h = hash(k * 3 + tier);
+    int32_t watts;
+
+    switch(profile){
+    case PROFILE_STEADY:    watts = 800 + (int32_t)(h % 9); break;
+    case PROFILE_VARIABLE:  watts = (int32_t)(hash(k / 3 + 77 * tier) % 7000) + (int32_t)(h % 50); break;
+    default:                watts = (h & 1) ? 32000 : -32000; break;
+    }
+
+    memset(p, 0, sizeof(*p));
+    p->t = T0 + k * period_of(tier);
+    p->n = (uint16_t)(period_of(tier) * 5 - h % 3);
+    p->tier = tier;
+    set_field(p, HIST_V, 2300 + (int32_t)(h % 40) - 20, 30 + (int32_t)(h % 20));
+    set_field(p, HIST_I, watts * 100 / 230, (int32_t)(h % 400));
+    set_field(p, HIST_P, watts, (int32_t)((h >> 8) % 3000));
+    set_field(p, HIST_Q, -watts / 3, (int32_t)((h >> 12) % 1000));
+    set_field(p, HIST_FP, 950 - (int32_t)(h % 300), (int32_t)(h % 100));
+    set_field(p, HIST_F, 5000 + (int32_t)(h % 10) - 5, 3);
+}
+
+static void point_values(const hist_point_t *p, int16_t *q){
+    memcpy(&q[0], p->avg, sizeof(p->avg));
+    memcpy(&q[HIST_FIELDS], p->min, sizeof(p->min));
+    memcpy(&q[2 * HIST_FIELDS], p->max, sizeof(p->max));
+}
+
+static void boot(void){
+    host_flash_power_on();
+    pend_head = pend_count = 0;
+    CHECK(history_init());
+}
+
+static void fresh(uint32_t prof){
+    profile = prof;
+    memset(model, 0, sizeof(model));
+    for(uint8_t t = 0; t < HIST_TIERS; t++) model[t].last = -1;
+    stat_records = stat_keys = stat_erases = stat_dropped = 0;
+    vals_total = vals_exact = 0;
+    worst_p = 0.0f;
+    hpart = host_flash_create(HIST_PARTITION, SECTORS * HOST_FLASH_SECTOR, 0xFF, 0);
+    boot();
+}
+
+/* Encola y escribe el punto k; retorna el resultado de history_flush() */
+static bool write_point(hist_tier_t tier, uint32_t k, uint8_t flags){
+    model_t *m = &model[tier];
+    hist_point_t p;
+
+    gen(tier, k, &p);
+    p.flags = flags;
+    pending_push(&p);
+    bool ok = history_flush();
+    if(!ok) return false;
+
+    // la escala de cada grupo (promedio, o mín y máx) la fija su mayor diferencia
+    int16_t q[HIST_VALUES], prev[HIST_VALUES];
+    float group[DELTA_SCALES] = {0};
+    point_values(&p, q);
+    if(m->last >= 0){
+        point_values(&m->p[m->last], prev);
+        for(uint8_t v = 0; v < HIST_VALUES; v++){
+            float d = (fabsf((float)q[v] - prev[v]) + m->tol[m->last][v]) / 127.5f;
+            if(d > group[delta_scale_of(v)]) group[delta_scale_of(v)] = d;
+        }
+    }
+    for(uint8_t v = 0; v < HIST_VALUES; v++) m->tol[k][v] = group[delta_scale_of(v)];
+    m->p[k] = p;
+    m->written[k] = true;
+    m->last = (int32_t)k;
+    return true;
+}
+
+/**
+ * Consulta los puntos k en [from_k, to_k] de a pocos y los compara con lo escrito
+ *
+ * @return Puntos entregados; en first_k el primero (-1 si ninguno)
+ */
+static uint32_t verify(hist_tier_t tier, uint32_t from_k, uint32_t to_k, int32_t *first_k){
+    const model_t *m = &model[tier];
+    uint32_t per = period_of(tier);
+    hist_cursor_t c;
+    hist_point_t out[7];
+    uint32_t count = 0;
+    int32_t prev = -1, first = -1;
+    size_t n;
+
+    memset(seen, 0, sizeof(seen));
+    history_query_begin(&c, tier, T0 + from_k * per, T0 + to_k * per);
+    while((n = history_query_next(&c, out, 7)) > 0){
+        for(size_t j = 0; j < n; j++){
+            const hist_point_t *p = &out[j];
+            CHECK(p->t >= T0 && (p->t - T0) % per == 0);
+            int32_t k = (int32_t)((p->t - T0) / per);
+            CHECK(k > prev && k >= (int32_t)from_k && k <= (int32_t)to_k && k < MAXK);
+            if(k <= prev || k < 0 || k >= MAXK) continue;
+            prev = k;
+            if(first < 0) first = k;
+            count++;
+            seen[k] = true;
+
+            CHECK(m->written[k]);
+            if(!m->written[k]) continue;
+            CHECK_EQ_INT(p->tier, tier);
+            CHECK_EQ_INT(p->n, m->p[k].n);
+            CHECK_EQ_INT(p->flags, m->p[k].flags);
+            int16_t got[HIST_VALUES], want[HIST_VALUES];
+            point_values(p, got);
+            point_values(&m->p[k], want);
+            for(uint8_t v = 0; v < HIST_VALUES; v++){
+                float err = fabsf((float)got[v] - want[v]);
+                if(err > m->tol[k][v] + 1e-3f){
+                    CHECK_NEAR(got[v], want[v], m->tol[k][v]);
+                }
+                vals_total++;
+                if(err == 0.0f) vals_exact++;
+                if(v == HIST_P && err > worst_p) worst_p = err;
+            }
+        }
+    }
+
+    // desde el primero entregado no falta ninguno de los escritos
+    if(first >= 0){
+        for(uint32_t k = (uint32_t)first; k <= to_k && k < MAXK; k++){
+            if(m->written[k] != seen[k]) CHECK_EQ_INT(seen[k], m->written[k]);
+        }
+    }
+    if(first_k != NULL) *first_k = first;
+    return count;
+}
+
+/**
+ * Muchas vueltas del anillo: el alcance es de RING_SECTORS - 1 a RING_SECTORS
+ * sectores de 127 puntos y, sin arranques, hay una clave por sector
+ */
+static void test_wrap(hist_tier_t tier, uint32_t prof, const char *name){
+    fresh(prof);
+    uint32_t total = 3 * RING_SECTORS * PTS_PER_SECTOR + 40;
+    for(uint32_t k = 0; k < total; k++) CHECK(write_point(tier, k, 0));
+
+    int32_t first;
+    uint32_t got = verify(tier, 0, total - 1, &first);
+    CHECK(got >= (RING_SECTORS - 1) * PTS_PER_SECTOR && got <= RING_SECTORS * PTS_PER_SECTOR);
+    CHECK_EQ_INT(first + got, total);
+    CHECK_EQ_INT(stat_keys, stat_erases);
+    printf("%-8s %-4s: %u puntos, conserva %u (%u por sector), %u claves, %.1f B por punto, "
+           "%.1f%% de valores exactos, error máx. de P %.0f W\n",
+           name, history_tier_name(tier), total, got, PTS_PER_SECTOR, stat_keys,
+           (double)(stat_records + stat_keys) * HIST_SLOT_BYTES / stat_records,
+           100.0 * vals_exact / vals_total, worst_p);
+
+    // la recuperación encuentra lo mismo y se sigue escribiendo después
+    boot();
+    CHECK_EQ_INT(verify(tier, 0, total - 1, NULL), got);
+    for(uint32_t k = total; k < total + PTS_PER_SECTOR; k++) CHECK(write_point(tier, k, 0));
+    boot();
+    CHECK_EQ_INT(verify(tier, total - 1, total + PTS_PER_SECTOR - 1, NULL), PTS_PER_SECTOR + 1);
+}
+
+/**
+ * Consultas que cruzan claves: las del inicio de cada sector y la que sigue
+ * a un arranque a mitad de sector
+ */
+static void test_query_spans_key(hist_tier_t tier){
+    fresh(PROFILE_VARIABLE);
+    uint32_t n = 2 * PTS_PER_SECTOR + 60;
+    for(uint32_t k = 0; k < n; k++) CHECK(write_point(tier, k, 0));
+    boot();
+    uint32_t boot_k = n;
+    for(uint32_t k = n; k < n + 10; k++) CHECK(write_point(tier, k, (k == boot_k) ? HIST_F_BOOT : 0));
+    n += 10;
+
+    int32_t first;
+    CHECK_EQ_INT(verify(tier, 0, n - 1, &first), n);
+    CHECK_EQ_INT(first, 0);
+
+    // de la mitad del sector 0 a la del 2
+    uint32_t a = PTS_PER_SECTOR / 2, b = 2 * PTS_PER_SECTOR + 30;
+    CHECK_EQ_INT(verify(tier, a, b, &first), b - a + 1);
+    CHECK_EQ_INT(first, a);
+
+    // empezando justo en una clave y terminando justo antes de otra
+    CHECK_EQ_INT(verify(tier, PTS_PER_SECTOR, 2 * PTS_PER_SECTOR - 1, &first), PTS_PER_SECTOR);
+    CHECK_EQ_INT(first, PTS_PER_SECTOR);
+    CHECK_EQ_INT(verify(tier, boot_k - 3, boot_k + 3, NULL), 7);
+    CHECK_EQ_INT(verify(tier, boot_k, boot_k, &first), 1);
+    CHECK_EQ_INT(first, boot_k);
+    CHECK_EQ_INT(verify(tier, PTS_PER_SECTOR, PTS_PER_SECTOR, NULL), 1);
+
+    // fuera de lo escrito
+    CHECK_EQ_INT(verify(tier, n, n + 100, NULL), 0);
+}
+
+/**
+ * Recuperación cuando el último registro es una clave: a mitad de sector se
+ * sigue en el mismo; si la clave ocupa los dos últimos lugares, en el siguiente
+ */
+static void test_recover_after_key(hist_tier_t tier){
+    const hist_ring_t *r = &rings[tier - 1];
+
+    fresh(PROFILE_VARIABLE);
+    for(uint32_t k = 0; k < 5; k++) CHECK(write_point(tier, k, 0));
+    boot();
+    CHECK(write_point(tier, 5, HIST_F_BOOT));
+    CHECK_EQ_INT(r->slot, 2 + 4 + 2);
+    boot();
+    CHECK_EQ_INT(r->head, 0);
+    CHECK_EQ_INT(r->slot, 8);
+    CHECK_EQ_INT(r->t, T0 + 5 * period_of(tier));
+    CHECK(write_point(tier, 6, HIST_F_BOOT));
+    CHECK(write_point(tier, 7, 0));
+    CHECK_EQ_INT(r->slot, 11);
+    CHECK_EQ_INT(verify(tier, 0, 7, NULL), 8);
+
+    // clave en los dos últimos lugares del sector
+    fresh(PROFILE_VARIABLE);
+    uint32_t k = 0;
+    while(r->slot < SLOTS_PER_SECTOR - 2) CHECK(write_point(tier, k++, 0));
+    boot();
+    CHECK(write_point(tier, k++, HIST_F_BOOT));
+    CHECK_EQ_INT(r->slot, SLOTS_PER_SECTOR);
+    boot();
+    CHECK_EQ_INT(r->head, 1);
+    CHECK_EQ_INT(r->slot, 0);
+    CHECK(write_point(tier, k++, 0));
+    CHECK(write_point(tier, k++, 0));
+    CHECK_EQ_INT(verify(tier, 0, k - 1, NULL), k);
+}
+
+/**
+ * Corte de alimentación durante la escritura del punto pos (delta, clave
+ * después de un arranque, clave que empieza sector con o sin datos viejos):
+ * se recupera todo lo anterior y el anillo sigue funcionando
+ */
+static void test_torn_writes(hist_tier_t tier){
+    static const uint32_t positions[] = {
+        0, 1, 60, PTS_PER_SECTOR - 1, PTS_PER_SECTOR, RING_SECTORS * PTS_PER_SECTOR
+    };
+    const hist_ring_t *r = &rings[tier - 1];
+    uint32_t cuts = 0;
+
+    for(size_t c = 0; c < sizeof(positions) / sizeof(positions[0]); c++){
+        for(uint8_t reboot = 0; reboot < 2; reboot++){
+            for(uint32_t stage = 0; stage < 2; stage++){
+                for(uint32_t b = 0; b < 2 * HIST_SLOT_BYTES; b += 3){
+                    uint32_t pos = positions[c];
+                    fresh(PROFILE_VARIABLE);
+                    for(uint32_t k = 0; k < pos; k++) CHECK(write_point(tier, k, 0));
+                    if(reboot) boot();
+
+                    // stage 1 corta el borrado del sector nuevo; sólo si el punto empieza uno
+                    uint32_t need = (r->chain && !reboot) ? 1 : 2;
+                    bool starts = (r->slot == 0) || (r->slot + need > SLOTS_PER_SECTOR);
+                    if(stage == 1 && !starts) break;
+                    if(!starts && b >= need * HIST_SLOT_BYTES) break;
+                    uint32_t extra = starts ? (stage == 1 ? b * 61 : HOST_FLASH_SECTOR + b) : b;
+
+                    host_flash_cut_after(extra);
+                    CHECK(!write_point(tier, pos, reboot ? HIST_F_BOOT : 0));
+                    CHECK(host_flash_is_cut());
+                    cuts++;
+
+                    boot();
+                    int32_t first;
+                    uint32_t got = (pos > 0) ? verify(tier, 0, pos, &first) : verify(tier, 0, 0, &first);
+                    if(pos > 0){
+                        CHECK(got > 0);
+                        CHECK_EQ_INT(first + got, pos);     // hasta pos - 1, sin pos
+                        CHECK(first <= (int32_t)PTS_PER_SECTOR + 1);
+                    } else {
+                        CHECK_EQ_INT(got, 0);
+                    }
+
+                    // sigue escribiendo más de una vuelta y recupera otra vez
+                    uint32_t end = pos + 1 + RING_SECTORS * PTS_PER_SECTOR + 17;
+                    for(uint32_t k = pos + 1; k < end; k++) CHECK(write_point(tier, k, (k == pos + 1) ? HIST_F_BOOT : 0));
+                    boot();
+                    got = verify(tier, 0, end - 1, &first);
+                    CHECK_EQ_INT(first + got + (first <= (int32_t)pos ? 1 : 0), end);
+                    CHECK(got >= (RING_SECTORS - 1) * PTS_PER_SECTOR);
+                }
+            }
+        }
+    }
+    printf("cortes %-4s: %u, todos recuperados\n", history_tier_name(tier), cuts);
+}
+
+/**
+ * Consulta que sigue leyendo mientras el anillo pisa el sector que lee: no
+ * repite ni desordena puntos y termina en el más nuevo
+ */
+static void test_query_while_writing(hist_tier_t tier){
+    fresh(PROFILE_VARIABLE);
+    uint32_t n = RING_SECTORS * PTS_PER_SECTOR;
+    for(uint32_t k = 0; k < n; k++) CHECK(write_point(tier, k, 0));
+
+    hist_cursor_t c;
+    hist_point_t out[10];
+    uint32_t per = period_of(tier);
+    history_query_begin(&c, tier, 0, UINT32_MAX);
+    size_t got = history_query_next(&c, out, 10);
+    CHECK_EQ_INT(got, 10);
+    uint32_t last_t = out[got - 1].t;
+
+    for(uint32_t k = n; k < n + 3 * PTS_PER_SECTOR; k++) CHECK(write_point(tier, k, 0));
+    n += 3 * PTS_PER_SECTOR;
+
+    uint32_t total = (uint32_t)got, jumped = 0;
+    while((got = history_query_next(&c, out, 10)) > 0){
+        for(size_t j = 0; j < got; j++){
+            CHECK(out[j].t > last_t);
+            uint32_t k = (out[j].t - T0) / per;
+            CHECK(k < n && model[tier].written[k]);
+            if(k < n && out[j].avg[HIST_P] != model[tier].p[k].avg[HIST_P]){
+                CHECK_NEAR(out[j].avg[HIST_P], model[tier].p[k].avg[HIST_P], model[tier].tol[k][HIST_P]);
+            }
+            if(out[j].t != last_t + per) jumped++;
+            last_t = out[j].t;
+            total++;
+        }
+    }
+    CHECK_EQ_INT(last_t, T0 + (n - 1) * per);
+    CHECK_EQ_INT(jumped, 1);    // salta una sola vez, sobre lo que el anillo borró
+    (void)total;
+}
+
+/* Saltos de ±32000 en cada punto: el delta escalado acota el error sin escribir claves */
+static void test_extreme_jumps(hist_tier_t tier){
+    fresh(PROFILE_EXTREME);
+    uint32_t n = PTS_PER_SECTOR + 20;
+    for(uint32_t k = 0; k < n; k++) CHECK(write_point(tier, k, 0));
+    CHECK_EQ_INT(verify(tier, 0, n - 1, NULL), n);
+    CHECK_EQ_INT(stat_keys, 2);
+}
+
+int main(void){
+    test_wrap(HIST_TIER_MIN, PROFILE_STEADY, "estable");
+    test_wrap(HIST_TIER_MIN, PROFILE_VARIABLE, "variable");
+    test_wrap(HIST_TIER_HOUR, PROFILE_VARIABLE, "variable");
+
+    test_query_spans_key(HIST_TIER_MIN);
+    test_query_spans_key(HIST_TIER_HOUR);
+    test_recover_after_key(HIST_TIER_MIN);
+    test_recover_after_key(HIST_TIER_HOUR);
+    test_torn_writes(HIST_TIER_MIN);
+    test_torn_writes(HIST_TIER_HOUR);
+    test_query_while_writing(HIST_TIER_MIN);
+    test_extreme_jumps(HIST_TIER_HOUR);
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,94 @@
+/**
+ * @file test_kernels.c
+ * @brief Kernel de punto fijo contra el de double: resultados y costo por ventana
+ *
+ * Los dos kernels procesan los mismos pares (kernel_variant.c). Las sumas
+ * son enteros exactos en ambos, así que las ventanas deben coincidir salvo
+ * el redondeo a float de measure_t; además informa el costo de cada uno.
+ * En el host el double es nativo: la diferencia de costo en el ESP32 (double
+ * emulado por software) es mucho mayor que la que se ve acá.
+ *
+ *   test_kernels [--quick]
+ */
+
+#include "host_test.h"
+#include "kernel_variant.h"
+#include "synth.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+uint64_t kernel_cycles(void){
+    return __rdtsc();
+}
+#else
+uint64_t kernel_cycles(void){
+    return 0;
+}
+#endif
+
+#define PAIRS (NUM_SAMPLES_ACCUM * 12)
+
+/* Mayor diferencia relativa a ref (absoluta si |ref| < floor) */
+static double rel_diff(double a, double ref, double floor){
+    double d = fabs(a - ref);
+    return (fabs(ref) < floor) ? d : d / fabs(ref);
+}
+
+static void compare(const char *name, const synth_cfg_t *cfg, uint32_t reps){
+    static int16_t v[PAIRS], i[PAIRS];
+    static kernel_result_t fx, fl;
+    synth_t s;
+
+    synth_init(&s, cfg);
+    for(uint32_t k = 0; k < PAIRS; k++) synth_next(&s, &v[k], &i[k]);
+
+    fixed_kernel_run(v, i, PAIRS, reps, &fx);
+    float_kernel_run(v, i, PAIRS, reps, &fl);
+
+    CHECK_EQ_INT(fx.windows, fl.windows);
+    CHECK(fx.windows >= 10);
+
+    double worst = 0.0;
+    for(int w = 0; w < fx.windows && w < fl.windows; w++){
+        const measure_t *a = &fx.win[w], *b = &fl.win[w];
+        CHECK_EQ_INT(fx.win_pairs[w], fl.win_pairs[w]);
+        double d[] = {
+            rel_diff(a->Vrms, b->Vrms, 1.0), rel_diff(a->Irms, b->Irms, 0.01),
+            rel_diff(a->P, b->P, 1.0), rel_diff(a->Q, b->Q, 1.0),
+            rel_diff(a->fp, b->fp, 0.01), rel_diff(a->f, b->f, 1.0),
+            rel_diff(a->VDC, b->VDC, 0.01), rel_diff(a->IDC, b->IDC, 0.01),
+        };
+        for(size_t k = 0; k < sizeof(d) / sizeof(d[0]); k++){
+            CHECK(d[k] <= 1e-6);
+            if(d[k] > worst) worst = d[k];
+        }
+    }
+
+    printf("%-18s error máx %.1e | punto fijo %6.2f ns/par %7.0f ns cierre %9.0f ciclos/ventana"
+           " | double %6.2f ns/par %7.0f ns cierre %9.0f ciclos/ventana\n",
+           name, worst, fx.ns_per_pair, fx.ns_finalize, fx.cycles_per_window,
+           fl.ns_per_pair, fl.ns_finalize, fl.cycles_per_window);
+}
+
+int main(int argc, char **argv){
+    bool quick = (argc > 1 && strcmp(argv[1], "--quick") == 0);
+    uint32_t reps = quick ? 1 : 20;
+    synth_cfg_t cfg;
+
+    synth_cfg_default(&cfg);
+    cfg.noise_mv = 3.0;
+    compare("nominal", &cfg, reps);
+
+    cfg.v_h[2] = 0.08;
+    cfg.i_h[2] = 0.6;
+    cfg.i_h[4] = 0.3;
+    cfg.f_hz = 51.7;
+    compare("distorsionada", &cfg, reps);
+
+    synth_cfg_default(&cfg);
+    cfg.i1_rms = 6.0; // corriente al borde del rango del ACS712-5A
+    compare("fondo de escala", &cfg, reps);
+
+    return HOST_TEST_RESULT();
+}
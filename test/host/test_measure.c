@@ -0,0 +1,316 @@
+/**
+ * @file test_measure.c
+ * @brief Regresión de measure.c contra formas de onda de referencia
+ *
+ * Cada caso genera una red conocida con synth.c, la pasa por el stream de
+ * medición igual que la tarea de adquisición y compara cada ventana con los
+ * valores exactos. Las primeras ventanas se descartan mientras se asienta
+ * el nivel de cruce: la primera se cierra por longitud (todavía no hay DC),
+ * y cada cambio del nivel deja un ciclo de largo intermedio en la ventana
+ * siguiente.
+ */
+
+#include "host_test.h"
+#include "synth.h"
+#include <string.h>
+
+#define WINDOWS_SKIP 4
+#define WINDOWS_CHECK 8
+
+/** @brief Tolerancias de una ventana respecto de los valores exactos */
+typedef struct {
+    double vrms_rel;
+    double irms_rel;
+    double p_rel;
+    double q_rel;       /**< Relativa a S (0: no se verifica; con armónicos Q sólo aproxima la fundamental) */
+    double fp_abs;
+    double f_abs;
+} tol_t;
+
+/* Corre la señal de cfg hasta WINDOWS_SKIP + WINDOWS_CHECK ventanas y verifica las últimas */
+static void run_golden(const char *name, const synth_cfg_t *cfg, const tol_t *tol){
+    measure_stream_t st;
+    synth_t s;
+    synth_truth_t truth;
+    measure_cal_t cal;
+    double worst_v = 0.0, worst_i = 0.0, worst_p = 0.0, worst_fp = 0.0, worst_f = 0.0;
+
+    measure_stream_init(&st);
+    synth_init(&s, cfg);
+    synth_truth(cfg, &truth);
+    measure_get_cal(&cal);
+
+    double irms_exp = truth.Irms - cal.i_offset;
+    int windows = 0;
+    uint64_t guard = (uint64_t)(WINDOWS_SKIP + WINDOWS_CHECK + 2) * NUM_SAMPLES_ACCUM * 2;
+
+    for(uint64_t k = 0; k < guard && windows < WINDOWS_SKIP + WINDOWS_CHECK; k++){
+        int16_t v, i;
+        synth_next(&s, &v, &i);
+        if(!(measure_add_sample(&st, v, i) & MEASURE_EVT_WINDOW)) continue;
+        if(windows++ < WINDOWS_SKIP) continue;
+
+        measure_t m;
+        measure_get_results(&st.last_window, &m);
+
+        CHECK_REL(m.Vrms, truth.Vrms, tol->vrms_rel);
+        CHECK_REL(m.Irms, irms_exp, tol->irms_rel);
+        CHECK_REL(m.P, truth.P, tol->p_rel);
+        if(tol->q_rel > 0.0) CHECK_NEAR(m.Q, truth.Q1, tol->q_rel * truth.Vrms * truth.Irms);
+        CHECK_NEAR(m.fp, truth.fp, tol->fp_abs);
+        CHECK_NEAR(m.f, truth.f, tol->f_abs);
+
+        if(fabs(m.Vrms / truth.Vrms - 1.0) > worst_v) worst_v = fabs(m.Vrms / truth.Vrms - 1.0);
+        if(fabs(m.Irms / irms_exp - 1.0) > worst_i) worst_i = fabs(m.Irms / irms_exp - 1.0);
+        if(fabs(m.P / truth.P - 1.0) > worst_p) worst_p = fabs(m.P / truth.P - 1.0);
+        if(fabs(m.fp - truth.fp) > worst_fp) worst_fp = fabs(m.fp - truth.fp);
+        if(fabs(m.f - truth.f) > worst_f) worst_f = fabs(m.f - truth.f);
+    }
+    CHECK_EQ_INT(windows, WINDOWS_SKIP + WINDOWS_CHECK);
+
+    printf("%-22s Vrms %.4f%%  Irms %.4f%%  P %.4f%%  fp %.5f  f %.4f Hz\n",
+           name, 100.0 * worst_v, 100.0 * worst_i, 100.0 * worst_p, worst_fp, worst_f);
+}
+
+/* V alineada al instante de I, igual que measure_add_sample() con MEASURE_SKEW_COMP */
+static int16_t align_v(int16_t v_prev, int16_t v_now){
+#if MEASURE_SKEW_COMP
+    return (int16_t)(v_prev + (((int32_t)(v_now - v_prev) * MEASURE_SKEW_Q15 + (1 << 14)) >> 15));
+#else
+    return v_now;
+#endif
+}
+
+/**
+ * Acumulador en streaming contra la referencia de dos pasadas
+ *
+ * Guarda los pares (ya alineados) que entran en cada ventana y, al cerrarse,
+ * la recalcula como lo hacía la versión con buffers: primero la media, después
+ * los momentos centrados. Las sumas del streaming son enteros exactos, así que
+ * ambos resultados coinciden salvo el redondeo final en double, aun con la
+ * señal chica sobre un DC grande (el caso que arruina la fórmula de una pasada
+ * en float).
+ */
+static void run_two_pass(const char *name, const synth_cfg_t *cfg){
+    static int16_t wv[NUM_SAMPLES_ACCUM * 2], wi[NUM_SAMPLES_ACCUM * 2];
+    measure_stream_t st;
+    synth_t s;
+    measure_cal_t cal;
+    uint32_t n = 0;
+    int16_t v_prev = 0, i_prev = 0;
+    bool primed = !MEASURE_SKEW_COMP;
+    int windows = 0;
+    double worst = 0.0;
+
+    /*sin pisos de ruido: la señal chica queda por debajo de los de fábrica*/
+    measure_cal_default(&cal);
+    cal.v_noise = 0.0f;
+    cal.i_noise = 0.0f;
+    measure_set_cal(&cal);
+
+    measure_stream_init(&st);
+    synth_init(&s, cfg);
+
+    while(windows < 6){
+        int16_t v, i, va, ia;
+        synth_next(&s, &v, &i);
+        uint8_t evt = measure_add_sample(&st, v, i);
+
+        /*par que vio el acumulador en esta llamada (un par de atraso con la compensación)*/
+        if(!primed){
+            primed = true;
+            v_prev = v;
+            i_prev = i;
+            continue;
+        }
+#if MEASURE_SKEW_COMP
+        va = align_v(v_prev, v);
+        ia = i_prev;
+        v_prev = v;
+        i_prev = i;
+#else
+        va = v;
+        ia = i;
+#endif
+        /*un cruce cierra el ciclo antes de acumular el par; el cierre por longitud, después*/
+        bool pair_in_window = (evt & MEASURE_EVT_WINDOW) && st.cycle.n == 0;
+        if(!(evt & MEASURE_EVT_WINDOW) || pair_in_window){
+            wv[n] = va;
+            wi[n] = ia;
+            n++;
+        }
+        if(!(evt & MEASURE_EVT_WINDOW)) continue;
+
+        CHECK_EQ_INT(st.last_window.n, n);
+
+        double N = n, mv = 0.0, mi = 0.0, vv = 0.0, ii = 0.0, vi = 0.0, q = 0.0;
+        for(uint32_t k = 0; k < n; k++){ mv += wv[k]; mi += wi[k]; }
+        mv /= N;
+        mi /= N;
+        for(uint32_t k = 0; k < n; k++){
+            double dv = wv[k] - mv, di = wi[k] - mi;
+            vv += dv * dv;
+            ii += di * di;
+            vi += dv * di;
+            if(k > 0) q += (wv[k - 1] - mv) * (wi[k] - mi) - (wv[k] - mv) * (wi[k - 1] - mi);
+        }
+
+        measure_t m;
+        measure_get_results(&st.last_window, &m);
+        double Vrms = sqrt(vv / N) / 1000.0 / fabs(cal.v_gain);
+        double Irms = sqrt(ii / N) / 1000.0 / cal.i_sens;
+        double P = vi / N / 1e6 / (cal.v_gain * cal.i_sens);
+        double w = 2.0 * M_PI * (m.f > 0.0f ? m.f : FUND_FREQ_HZ) / SAMPLE_FREQ_HZ;
+        double Q = q / (N - 1.0) / (2.0 * sin(w)) / 1e6 / (cal.v_gain * cal.i_sens);
+
+        CHECK_REL(m.Vrms, Vrms, 1e-6);
+        CHECK_REL(m.Irms + cal.i_offset, Irms, 1e-6);
+        CHECK_REL(m.P, P, 1e-6);
+        CHECK_NEAR(m.Q, Q, 1e-6 * Vrms * Irms);
+        CHECK_NEAR(m.VDC, mv / 1000.0, 1e-6);
+        CHECK_NEAR(m.IDC, mi / 1000.0, 1e-6);
+        if(fabs(m.P / P - 1.0) > worst) worst = fabs(m.P / P - 1.0);
+
+        /*el par que cerró por cruce abre la ventana siguiente*/
+        n = 0;
+        if(!pair_in_window){
+            wv[n] = va;
+            wi[n] = ia;
+            n++;
+        }
+        windows++;
+    }
+    measure_cal_default(&cal);
+    measure_set_cal(&cal);
+    printf("%-22s streaming vs dos pasadas: P %.2e rel\n", name, worst);
+}
+
+/* Vrms de un bloque de pares sin alinear, por dos pasadas [V] */
+static double block_vrms(const int16_t *v, uint32_t n, double v_gain){
+    double m = 0.0, vv = 0.0;
+    for(uint32_t k = 0; k < n; k++) m += v[k];
+    m /= n;
+    for(uint32_t k = 0; k < n; k++) vv += (v[k] - m) * (v[k] - m);
+    return sqrt(vv / n) / 1000.0 / fabs(v_gain);
+}
+
+/**
+ * Estabilidad de las ventanas alineadas a cruces por cero
+ *
+ * Con la red fuera de 50 Hz una ventana de largo fijo corta ciclos a la
+ * mitad y Vrms/P oscilan de una ventana a otra. Alineadas a los cruces,
+ * cada ventana tiene NUM_CYCLES_ACCUM períodos, los ciclos miden el período
+ * redondeado y la dispersión entre ventanas queda en el ruido. Se compara
+ * contra bloques fijos de NUM_SAMPLES_ACCUM pares de la misma señal.
+ */
+static void run_zc_stability(double f_hz, double noise_mv){
+    static int16_t raw_v[NUM_SAMPLES_ACCUM * 16];
+    measure_stream_t st;
+    synth_t s;
+    synth_cfg_t cfg;
+    double v_min = 1e9, v_max = 0.0, p_min = 1e9, p_max = -1e9;
+    int windows = 0;
+    uint32_t n = 0;
+    const double period = SAMPLE_FREQ_HZ / f_hz;
+
+    synth_cfg_default(&cfg);
+    cfg.f_hz = f_hz;
+    cfg.noise_mv = noise_mv;
+    cfg.v_h[2] = 0.04; // cruces algo deformados
+    synth_init(&s, &cfg);
+    measure_stream_init(&st);
+
+    while(n < sizeof(raw_v) / sizeof(raw_v[0])){
+        int16_t v, i;
+        synth_next(&s, &v, &i);
+        raw_v[n++] = v;
+        uint8_t evt = measure_add_sample(&st, v, i);
+
+        if((evt & MEASURE_EVT_CYCLE) && windows >= WINDOWS_SKIP){
+            CHECK(st.last_cycle.n >= (uint32_t)floor(period) && st.last_cycle.n <= (uint32_t)ceil(period));
+        }
+        if(!(evt & MEASURE_EVT_WINDOW)) continue;
+        if(windows++ < WINDOWS_SKIP) continue;
+
+        measure_t m;
+        measure_get_results(&st.last_window, &m);
+        CHECK_EQ_INT(st.last_window.zc_periods, NUM_CYCLES_ACCUM);
+        CHECK_NEAR(st.last_window.n, period * NUM_CYCLES_ACCUM, 1.0);
+        if(m.Vrms < v_min) v_min = m.Vrms;
+        if(m.Vrms > v_max) v_max = m.Vrms;
+        if(m.P < p_min) p_min = m.P;
+        if(m.P > p_max) p_max = m.P;
+    }
+    CHECK(windows >= WINDOWS_SKIP + 8);
+
+    double fix_min = 1e9, fix_max = 0.0;
+    for(uint32_t b = 2; (b + 1) * NUM_SAMPLES_ACCUM <= n; b++){
+        double vr = block_vrms(&raw_v[b * NUM_SAMPLES_ACCUM], NUM_SAMPLES_ACCUM, cfg.v_gain);
+        if(vr < fix_min) fix_min = vr;
+        if(vr > fix_max) fix_max = vr;
+    }
+
+    double spread_v = (v_max - v_min) / v_max;
+    double spread_p = (p_max - p_min) / p_max;
+    double spread_fix = (fix_max - fix_min) / fix_max;
+    CHECK(spread_v < 5e-4);
+    CHECK(spread_p < 1e-3);
+    /*si la ventana fija no abarca ciclos enteros oscila mucho más (a 50 y 60 Hz coinciden)*/
+    double cut = fmod(NUM_SAMPLES_ACCUM, period);
+    if(fmin(cut, period - cut) > 1.0) CHECK(spread_v * 5.0 < spread_fix);
+
+    printf("zc %5.1f Hz ruido %3.0f mV  dispersión Vrms %.4f%% P %.4f%%  (ventana fija %.4f%%)\n",
+           f_hz, noise_mv, 100.0 * spread_v, 100.0 * spread_p, 100.0 * spread_fix);
+}
+
+int main(void){
+    synth_cfg_t cfg;
+    const tol_t tol_sine = { .vrms_rel = 3e-4, .irms_rel = 3e-4, .p_rel = 5e-4, .q_rel = 2e-3, .fp_abs = 3e-4, .f_abs = 0.005 };
+    const tol_t tol_dist = { .vrms_rel = 3e-4, .irms_rel = 5e-4, .p_rel = 6e-4, .q_rel = 0.0, .fp_abs = 5e-4, .f_abs = 0.01 };
+
+    /*referencia: 230 V, 2 A, 30° a 50 Hz*/
+    synth_cfg_default(&cfg);
+    run_golden("sine 50 Hz 30deg", &cfg, &tol_sine);
+
+    /*carga resistiva a 60 Hz*/
+    synth_cfg_default(&cfg);
+    cfg.f_hz = 60.0;
+    cfg.phi_deg = 0.0;
+    cfg.i1_rms = 1.0;
+    run_golden("sine 60 Hz 0deg", &cfg, &tol_sine);
+
+    /*carga capacitiva con red fuera de nominal*/
+    synth_cfg_default(&cfg);
+    cfg.f_hz = 49.3;
+    cfg.phi_deg = -45.0;
+    run_golden("sine 49.3 Hz -45deg", &cfg, &tol_sine);
+
+    /*red distorsionada, rectificador con ruido de fondo*/
+    synth_cfg_default(&cfg);
+    cfg.v_h[2] = 0.05;
+    cfg.v_h[4] = 0.03;
+    cfg.i_h[2] = 0.50;
+    cfg.i_h[4] = 0.30;
+    cfg.i_h[6] = 0.20;
+    cfg.phi_deg = 10.0;
+    cfg.noise_mv = 4.0;
+    run_golden("distorted + noise", &cfg, &tol_dist);
+
+    /*streaming contra dos pasadas: carga nominal y señal chica sobre el DC*/
+    synth_cfg_default(&cfg);
+    cfg.noise_mv = 2.0;
+    run_two_pass("nominal", &cfg);
+    cfg.v1_rms = 5.0;
+    cfg.i1_rms = 0.3;
+    run_two_pass("small signal", &cfg);
+
+    /*ventanas alineadas a cruces dentro del rango de frecuencia admitido*/
+    run_zc_stability(50.0, 0.0);
+    run_zc_stability(47.3, 3.0);
+    run_zc_stability(52.7, 3.0);
+    run_zc_stability(60.0, 8.0);
+    run_zc_stability(MEASURE_FREQ_MIN_HZ + 0.5, 3.0);
+    run_zc_stability(MEASURE_FREQ_MAX_HZ - 0.5, 3.0);
+
+    return HOST_TEST_RESULT();
+}
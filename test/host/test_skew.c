@@ -0,0 +1,83 @@
+/**
+ * @file test_skew.c
+ * @brief Error de fp en función del ángulo, con y sin compensación del desfasaje V/I
+ *
+ * La misma señal (I convertida medio par después que V, como el patrón del
+ * ADC) pasa por measure.c con MEASURE_SKEW_COMP (kernel_fixed) y sin ella
+ * (kernel_noskew). Sin compensar, el atraso suma 360·f/(2·SAMPLE_FREQ_HZ)
+ * grados al desfasaje y el error de fp crece con sin(phi); compensado debe
+ * quedar en el orden del resto del camino de medición en todo el rango.
+ */
+
+#include "host_test.h"
+#include "kernel_variant.h"
+#include "synth.h"
+#include <string.h>
+
+uint64_t kernel_cycles(void){
+    return 0;
+}
+
+#define WINDOWS_SKIP 4
+#define PAIRS (NUM_SAMPLES_ACCUM * (WINDOWS_SKIP + 8))
+
+/** @brief Error máximo de fp con compensación, en todo el rango de ángulos */
+#define SKEW_FP_TOL 3e-4
+
+/* Mayor |fp - esperado| de las ventanas estables */
+static double worst_fp(const kernel_result_t *r, double fp){
+    double worst = 0.0;
+    for(int w = WINDOWS_SKIP; w < r->windows; w++){
+        double d = fabs(r->win[w].fp - fp);
+        if(d > worst) worst = d;
+    }
+    return worst;
+}
+
+static void run_angle(double f_hz, double phi_deg){
+    static int16_t v[PAIRS], i[PAIRS];
+    static kernel_result_t comp, raw;
+    synth_cfg_t cfg;
+    synth_truth_t truth;
+    synth_t s;
+
+    synth_cfg_default(&cfg);
+    cfg.f_hz = f_hz;
+    cfg.phi_deg = phi_deg;
+    synth_init(&s, &cfg);
+    synth_truth(&cfg, &truth);
+    for(uint32_t k = 0; k < PAIRS; k++) synth_next(&s, &v[k], &i[k]);
+
+    fixed_kernel_run(v, i, PAIRS, 1, &comp);
+    noskew_kernel_run(v, i, PAIRS, 1, &raw);
+    CHECK(comp.windows > WINDOWS_SKIP);
+    CHECK_EQ_INT(comp.windows, raw.windows);
+
+    double e_comp = worst_fp(&comp, truth.fp);
+    double e_raw = worst_fp(&raw, truth.fp);
+
+    // el error que deja el atraso sin compensar: cos(phi) - cos(phi + delta)
+    double delta = 2.0 * M_PI * f_hz * cfg.skew_pairs / SAMPLE_FREQ_HZ;
+    double phi = phi_deg * M_PI / 180.0;
+    double e_model = fabs(cos(phi) - cos(phi + delta));
+
+    CHECK(e_comp <= SKEW_FP_TOL);
+    if(e_model > 4.0 * SKEW_FP_TOL){
+        // el atraso domina: sin compensar se ve el error del modelo, compensado desaparece
+        CHECK_NEAR(e_raw, e_model, 0.25 * e_model + SKEW_FP_TOL);
+        CHECK(e_comp < e_raw / 4.0);
+    }
+
+    printf("%5.1f Hz %6.1f°  fp %.4f  error compensado %.5f  sin compensar %.5f  (modelo %.5f)\n",
+           f_hz, phi_deg, truth.fp, e_comp, e_raw, e_model);
+}
+
+int main(void){
+    static const double angles[] = { -85.0, -60.0, -30.0, 0.0, 15.0, 30.0, 45.0, 60.0, 75.0, 85.0 };
+
+    for(size_t k = 0; k < sizeof(angles) / sizeof(angles[0]); k++) run_angle(50.0, angles[k]);
+    run_angle(60.0, 60.0);
+    run_angle(60.0, 85.0);
+
+    return HOST_TEST_RESULT();
+}
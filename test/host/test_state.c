@@ -0,0 +1,247 @@
+/**
+ * @file test_state.c
+ * @brief Tests de state.c: publicación de ventanas, energía, avisos de cambio y seqlock
+ */
+
+#include "host_test.h"
+#include "stubs_state.h"
+#include "synth.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+/* Ventana con la energía de P durante una ventana de medición */
+static measure_t window_of(float Vrms, float P){
+    measure_t m;
+    memset(&m, 0, sizeof(m));
+    m.Vrms = Vrms;
+    m.Irms = P / Vrms;
+    m.P = P;
+    m.S = P;
+    m.fp = 1.0f;
+    m.f = 50.0f;
+    m.E = P * NUM_SAMPLES_ACCUM / (double)SAMPLE_FREQ_HZ / 3600.0 / 1000.0;
+    return m;
+}
+
+static void test_publish(void){
+    state_t s;
+    state_gen_t g0, g1;
+
+    state_init();
+    state_get_gen(&g0);
+
+    measure_t m = window_of(230.0f, 1000.0f);
+    state_update_measure(&m);
+
+    state_get(&s);
+    state_get_gen(&g1);
+    CHECK_NEAR(s.measure.Vrms, 230.0f, 0.0);
+    CHECK_NEAR(s.measure.P, 1000.0f, 0.0);
+    CHECK_NEAR(s.energy.E, m.E, 1e-12);
+    CHECK_NEAR(s.energy.E_imp, m.E, 1e-12);
+    CHECK_NEAR(s.measure.E, s.energy.E, 1e-9);
+    CHECK_EQ_INT(g1.measure, g0.measure + 1);
+    CHECK_EQ_INT(s.gen.measure, g1.measure);
+    CHECK_EQ_INT(stub_state_calls.history_add, 1);
+
+    /*exportación: sólo crece E_exp*/
+    measure_t e = window_of(230.0f, -500.0f);
+    state_update_measure(&e);
+    state_get(&s);
+    CHECK_NEAR(s.energy.E_exp, -e.E, 1e-12);
+    CHECK_NEAR(s.energy.E, m.E + e.E, 1e-12);
+}
+
+static void test_energy_save(void){
+    state_t s;
+
+    state_init();
+    stub_state_calls.persist_energy = 0;
+
+    /*SAVE_ENERGY_THS_KWH sin diario: 10 kW durante 360 ventanas de 0.2 s = 1 kWh*/
+    measure_t m = window_of(230.0f, 10000.0f);
+    uint32_t windows = (uint32_t)(SAVE_ENERGY_THS_KWH / m.E) + 2;
+    for(uint32_t k = 0; k < windows; k++) state_update_measure(&m);
+
+    state_get(&s);
+    CHECK_EQ_INT(stub_state_calls.persist_energy, 1);
+    CHECK(stub_state_calls.last_regs.E_imp >= SAVE_ENERGY_THS_KWH);
+    CHECK(stub_state_calls.last_regs.E_imp <= s.energy.E_imp);
+
+    state_reset_energy();
+    state_get(&s);
+    CHECK_EQ_INT(stub_state_calls.persist_energy, 2);
+    CHECK_NEAR(s.energy.E, 0.0, 0.0);
+    CHECK_NEAR(stub_state_calls.last_regs.E_imp, 0.0, 0.0);
+}
+
+static void test_generations(void){
+    state_t s;
+    state_gen_t g0, g1;
+    bool out[NUM_LOADS] = { true, false, false, false };
+
+    state_init();
+    state_sub_t sub = state_subscribe(STATE_EV_OUTPUTS);
+    CHECK(sub >= 0);
+    state_get_gen(&g0);
+
+    state_update_outputs(out);
+    CHECK(state_wait(sub, 0) & STATE_EV_OUTPUTS);
+
+    /*sin cambios no avanza la generación ni avisa*/
+    state_update_outputs(out);
+    CHECK_EQ_INT(state_wait(sub, 0) & STATE_EV_OUTPUTS, 0);
+
+    state_get_gen(&g1);
+    CHECK_EQ_INT(g1.outputs, g0.outputs + 1);
+    state_get(&s);
+    CHECK(s.output[0]);
+
+    state_wake(sub);
+    CHECK(state_wait(sub, 0) & STATE_EV_WAKE);
+}
+
+/* ---------------------------------------------------------------- seqlock */
+
+#define STRESS_READERS 3
+#define STRESS_MS 300
+
+static atomic_bool stress_stop;
+
+/* Ventana k: todos los campos valen k, así una copia mezclada se detecta */
+static void *stress_measure_writer(void *arg){
+    uint32_t *count = arg;
+    measure_t m;
+    memset(&m, 0, sizeof(m));
+    for(uint32_t k = 1; !atomic_load(&stress_stop); k++){
+        float x = (float)k;
+        m.Vrms = m.VDC = m.Vpk = m.Irms = m.IDC = m.Ipk = x;
+        m.P = m.Q = m.S = m.fp = m.fp_disp = m.f = x;
+        m.E = 1.0f; // energía acumulada = k
+        state_update_measure(&m);
+        *count = k;
+    }
+    return NULL;
+}
+
+/* Alterna todas las salidas juntas y publica telemetría DMA con todos los campos iguales */
+static void *stress_outputs_writer(void *arg){
+    uint32_t *count = arg;
+    bool out[NUM_LOADS] = { false };
+    for(uint32_t k = 1; !atomic_load(&stress_stop); k++){
+        for(uint8_t n = 0; n < NUM_LOADS; n++) out[n] = !out[n];
+        state_update_outputs(out);
+
+        adc_dma_stats_t d;
+        uint32_t *w = (uint32_t *)&d;
+        for(size_t n = 0; n < sizeof(d) / sizeof(uint32_t); n++) w[n] = k;
+        state_update_dma(&d);
+        *count = k;
+    }
+    return NULL;
+}
+
+typedef struct {
+    uint32_t reads;
+    uint32_t torn;
+    uint32_t backwards;
+    uint32_t distinct;      // lecturas con una generación nueva
+} stress_reader_t;
+
+/* Una copia es consistente si cada dominio quedó entero de una misma escritura */
+static bool stress_consistent(const state_t *s){
+    const measure_t *m = &s->measure;
+    float x = (float)s->gen.measure;
+    const float f[] = { m->Vrms, m->VDC, m->Vpk, m->Irms, m->IDC, m->Ipk, m->P, m->Q, m->S, m->fp, m->fp_disp, m->f, m->E };
+    for(size_t n = 0; n < sizeof(f) / sizeof(f[0]); n++){
+        if(f[n] != x) return false;
+    }
+    if(s->energy.E_imp != (double)s->gen.measure || s->energy.E != s->energy.E_imp) return false;
+
+    for(uint8_t n = 0; n < NUM_LOADS; n++){
+        if(s->output[n] != ((s->gen.outputs & 1u) != 0)) return false;
+    }
+
+    const uint32_t *w = (const uint32_t *)&s->dma;
+    for(size_t n = 1; n < sizeof(s->dma) / sizeof(uint32_t); n++){
+        if(w[n] != w[0]) return false;
+    }
+    return true;
+}
+
+static void *stress_reader(void *arg){
+    stress_reader_t *r = arg;
+    static _Thread_local state_t s;
+    uint32_t last_measure = 0, last_outputs = 0;
+    while(!atomic_load(&stress_stop)){
+        state_get(&s);
+        r->reads++;
+        if(!stress_consistent(&s)) r->torn++;
+        if(s.gen.measure < last_measure || s.gen.outputs < last_outputs) r->backwards++;
+        if(s.gen.measure != last_measure) r->distinct++;
+        last_measure = s.gen.measure;
+        last_outputs = s.gen.outputs;
+    }
+    return NULL;
+}
+
+/**
+ * Escritores y lectores concurrentes sobre el seqlock
+ *
+ * Dos escritores (ventanas; salidas y DMA) y varios lectores corren a la
+ * vez. Ninguna copia de state_get() puede mezclar campos de escrituras
+ * distintas dentro de un dominio ni retroceder en generación. Con varios
+ * núcleos las copias se solapan con las escrituras todo el tiempo; con uno,
+ * cuando el planificador interrumpe a un lector a mitad de la copia.
+ */
+static void test_seqlock_stress(void){
+    pthread_t wm, wo, rd[STRESS_READERS];
+    stress_reader_t rs[STRESS_READERS];
+    uint32_t n_measure = 0, n_outputs = 0;
+
+    state_init();
+    memset(rs, 0, sizeof(rs));
+    atomic_store(&stress_stop, false);
+
+    pthread_create(&wm, NULL, stress_measure_writer, &n_measure);
+    pthread_create(&wo, NULL, stress_outputs_writer, &n_outputs);
+    for(int k = 0; k < STRESS_READERS; k++) pthread_create(&rd[k], NULL, stress_reader, &rs[k]);
+
+    uint64_t t0 = synth_now_ns();
+    while(synth_now_ns() - t0 < (uint64_t)STRESS_MS * 1000000u) vTaskDelay(pdMS_TO_TICKS(10));
+    atomic_store(&stress_stop, true);
+
+    pthread_join(wm, NULL);
+    pthread_join(wo, NULL);
+    uint32_t reads = 0, torn = 0, backwards = 0, distinct = 0;
+    for(int k = 0; k < STRESS_READERS; k++){
+        pthread_join(rd[k], NULL);
+        reads += rs[k].reads;
+        torn += rs[k].torn;
+        backwards += rs[k].backwards;
+        distinct += rs[k].distinct;
+        CHECK(rs[k].reads > 0);
+    }
+
+    CHECK_EQ_INT(torn, 0);
+    CHECK_EQ_INT(backwards, 0);
+    CHECK(n_measure > 1000 && n_outputs > 1000);
+    CHECK(distinct > 1); // los lectores vieron avanzar las ventanas (con un solo núcleo, sólo en cada cambio de hilo)
+
+    state_t s;
+    state_get(&s);
+    CHECK_EQ_INT(s.gen.measure, n_measure);
+    CHECK(stress_consistent(&s));
+
+    printf("seqlock: %u ventanas y %u cambios de salida escritos, %u lecturas (%u con ventana nueva), %u mezcladas\n",
+           n_measure, n_outputs, reads, distinct, torn);
+}
+
+int main(void){
+    test_publish();
+    test_energy_save();
+    test_generations();
+    test_seqlock_stress();
+    return HOST_TEST_RESULT();
+}